@@ -333,6 +333,10 @@ function(dsn_setup_system_libs)
         link_directories("${OPENSSL_ROOT_DIR}/lib")
     endif()
 
+    # for gzip of the http responses
+    find_package(ZLIB REQUIRED)
+    set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${ZLIB_LIBRARIES})
+
     if (NOT APPLE)
         if(ENABLE_GPERF)
             set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} tcmalloc_and_profiler)
@@ -258,6 +258,73 @@ typedef std::function<void(const download_response &)> download_callback;
 typedef future_task<download_response> download_future;
 typedef dsn::ref_ptr<download_future> download_future_ptr;
 
+/**
+ * @brief The upload_part_request struct, used by multipart upload
+ *  part_index: the index of the part, starting from 0
+ *  offset: where the part is located in the whole file
+ *  buffer: content of the part
+ *
+ * Notice: part 0 starts the upload and discards the parts left by the previous uploads, so it
+ *         must be uploaded before the others, which can be uploaded concurrently and in any
+ *         order. They are invisible until {@link block_file::complete_multipart_upload} succeeds.
+ */
+struct upload_part_request
+{
+    int32_t part_index;
+    uint64_t offset;
+    dsn::blob buffer;
+};
+
+/**
+ * @brief The upload_part_response struct
+ *  err: ERR_OK: the part is uploaded
+ *       ERR_NOT_IMPLEMENTED: the implementation doesn't support multipart upload
+ *       ERR_TIMEOUT: request timeout
+ *       ERR_FS_INTERNAL: an internal error occured in the service implementation
+ *          which we can't handle
+ *  uploaded_size: amount of bytes of the part have been uploaded.
+ */
+struct upload_part_response
+{
+    dsn::error_code err;
+    uint64_t uploaded_size;
+};
+typedef std::function<void(const upload_part_response &)> upload_part_callback;
+typedef future_task<upload_part_response> upload_part_future;
+typedef dsn::ref_ptr<upload_part_future> upload_part_future_ptr;
+
+/**
+ * @brief The complete_multipart_upload_request struct
+ *  part_count: total count of the parts uploaded
+ *  total_size: size of the whole file
+ *  md5: md5 of the whole file, which is computed by the uploader while reading the parts, so
+ *       that the implementation doesn't need to read the file again.
+ */
+struct complete_multipart_upload_request
+{
+    int32_t part_count;
+    uint64_t total_size;
+    std::string md5;
+};
+
+/**
+ * @brief The complete_multipart_upload_response struct
+ *  err: ERR_OK: all parts are combined into the file, and the metadata of the file is updated
+ *       ERR_NOT_IMPLEMENTED: the implementation doesn't support multipart upload
+ *       ERR_INVALID_DATA: the uploaded parts mismatch with the request, they are discarded
+ *       ERR_TIMEOUT: request timeout
+ *       ERR_FS_INTERNAL: an internal error occured in the service implementation
+ *          which we can't handle
+ */
+struct complete_multipart_upload_response
+{
+    dsn::error_code err;
+};
+typedef std::function<void(const complete_multipart_upload_response &)>
+    complete_multipart_upload_callback;
+typedef future_task<complete_multipart_upload_response> complete_multipart_upload_future;
+typedef dsn::ref_ptr<complete_multipart_upload_future> complete_multipart_upload_future_ptr;
+
 class block_filesystem
 {
 public:
@@ -403,6 +470,63 @@ public:
                                    const download_callback &cb,
                                    dsn::task_tracker *tracker = nullptr) = 0;
 
+    /**
+     * @brief support_multipart_upload
+     * @return true if {@link #upload_part} and {@link #complete_multipart_upload} are implemented,
+     *         otherwise users should use {@link #upload} instead.
+     */
+    virtual bool support_multipart_upload() const { return false; }
+
+    /**
+     * @brief upload_part
+     * @param req, ref {@link #upload_part_request}
+     * @param code, a task_code, describe how the callback executed
+     * @param callback, called when the part is uploaded
+     * @param tracker
+     * @return a task which represent the async operation
+     */
+    virtual dsn::task_ptr upload_part(const upload_part_request &req,
+                                      dsn::task_code code,
+                                      const upload_part_callback &cb,
+                                      dsn::task_tracker *tracker = nullptr)
+    {
+        upload_part_response resp;
+        resp.err = ERR_NOT_IMPLEMENTED;
+        resp.uploaded_size = 0;
+        return not_implemented<upload_part_future>(code, cb, tracker, resp);
+    }
+
+    /**
+     * @brief complete_multipart_upload
+     * @param req, ref {@link #complete_multipart_upload_request}
+     * @param code, a task_code, describe how the callback executed
+     * @param callback, called when all the parts are combined
+     * @param tracker
+     * @return a task which represent the async operation
+     */
+    virtual dsn::task_ptr complete_multipart_upload(const complete_multipart_upload_request &req,
+                                                    dsn::task_code code,
+                                                    const complete_multipart_upload_callback &cb,
+                                                    dsn::task_tracker *tracker = nullptr)
+    {
+        complete_multipart_upload_response resp;
+        resp.err = ERR_NOT_IMPLEMENTED;
+        return not_implemented<complete_multipart_upload_future>(code, cb, tracker, resp);
+    }
+
+protected:
+    template <typename TFuture, typename TCallback, typename TResponse>
+    static dsn::task_ptr not_implemented(dsn::task_code code,
+                                         const TCallback &cb,
+                                         dsn::task_tracker *tracker,
+                                         const TResponse &resp)
+    {
+        dsn::ref_ptr<TFuture> tsk(new TFuture(code, cb, 0));
+        tsk->set_tracker(tracker);
+        tsk->enqueue_with(resp);
+        return tsk;
+    }
+
 protected:
     std::string _name;
 };
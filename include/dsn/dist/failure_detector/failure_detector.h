@@ -58,11 +58,21 @@
  *
  * 4. The lease_periods must be less than the grace_periods, as required by prefect FD.
  *
+ * 5. With [replication] fd_phi_accrual_enabled, master keeps the distribution of the beacon
+ *    inter-arrival times of every worker, and tolerates a jittery worker (e.g. a long gc pause)
+ *    longer than grace_seconds, until its phi reaches fd_phi_threshold, by at most
+ *    fd_max_lease_extension_ms. The extension is promised in the beacon ack, so that the worker
+ *    extends its lease by the same amount, and master never declares a worker dead before the
+ *    deadline it has promised, which keeps the perfect FD: a worker always expires its lease
+ *    before master declares it dead. So grace_seconds can be shortened for a faster failover
+ *    without the false positive disconnections on jitters.
+ *
  */
 #pragma once
 
 #include <dsn/dist/failure_detector/fd.client.h>
 #include <dsn/dist/failure_detector/fd.server.h>
+#include <dsn/dist/failure_detector/phi_accrual_estimator.h>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/tool-api/zlocks.h>
 
@@ -113,6 +123,8 @@ public:
 
     uint32_t get_lease_ms() const { return _lease_milliseconds; }
     uint32_t get_grace_ms() const { return _grace_milliseconds; }
+    // the max time a worker may hold its lease longer than get_lease_ms()
+    static uint32_t get_max_lease_extension_ms();
 
     void register_master(::dsn::rpc_address target);
 
@@ -158,8 +170,17 @@ protected:
     void report(::dsn::rpc_address node, bool is_master, bool is_connected);
 
 private:
+    friend class failure_detector_lease_test;
+
     void check_all_records();
 
+    class worker_record;
+    // the lease extension to promise to the worker, by the phi accrual estimation
+    uint32_t get_lease_extension_ms(const worker_record &record) const;
+    // promises the lease extension in `ack`, and postpones the deadline of the worker to cover it
+    void update_lease_extension(worker_record &record, uint64_t now, /*out*/ beacon_ack &ack);
+    void remove_phi_counter(worker_record &record);
+
 private:
     class master_record
     {
@@ -169,6 +190,8 @@ private:
         bool is_alive;
         bool rejected;
         task_ptr send_beacon_timer;
+        // the lease extension promised by the master with the last acked beacon
+        uint32_t lease_extension_ms;
 
         // masters are always considered *disconnected* initially which is ok even when master
         // thinks workers are connected
@@ -178,6 +201,7 @@ private:
             last_send_time_for_beacon_with_ack = last_send_time_for_beacon_with_ack_;
             is_alive = false;
             rejected = false;
+            lease_extension_ms = 0;
         }
     };
 
@@ -188,6 +212,12 @@ private:
         uint64_t last_beacon_recv_time;
         bool is_alive;
 
+        // for phi accrual detection only: the worker mustn't be declared dead before the
+        // deadline, which covers all the lease extensions promised to it
+        uint64_t deadline;
+        std::shared_ptr<phi_accrual_estimator> estimator;
+        perf_counter_ptr phi_counter;
+
         // workers are always considered *connected* initially which is ok even when workers think
         // master is disconnected
         worker_record(::dsn::rpc_address node, uint64_t last_beacon_recv_time)
@@ -195,6 +225,7 @@ private:
             this->node = node;
             this->last_beacon_recv_time = last_beacon_recv_time;
             is_alive = true;
+            deadline = 0;
         }
     };
 
@@ -229,6 +260,8 @@ protected:
 
     // subClass can rewrite these method.
     virtual void send_beacon(::dsn::rpc_address node, uint64_t time);
+    // the clock of the beacons and the leases
+    virtual uint64_t now_ms() const { return dsn_now_ms(); }
 };
 }
 } // end namespace
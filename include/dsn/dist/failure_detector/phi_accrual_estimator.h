@@ -0,0 +1,57 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+namespace dsn {
+namespace fd {
+
+// Estimates the suspicion level of a node by the phi accrual failure detection (Hayashibara et
+// al.): the inter-arrival times of the recent beacons are approximated by a normal distribution,
+// and phi(t) = -log10(P(the next beacon arrives later than t after the last one)).
+//
+// phi = 1 means the chance to wrongly suspect the node is 10%, phi = 2 means 1%, and so on.
+class phi_accrual_estimator
+{
+public:
+    // `min_stddev_ms` avoids a too sharp distribution if the beacons arrive very regularly.
+    phi_accrual_estimator(int window_size, uint32_t min_stddev_ms);
+
+    void add_interval(uint64_t interval_ms);
+    int sample_count() const { return static_cast<int>(_intervals.size()); }
+
+    double mean() const;
+    double stddev() const;
+
+    double phi(uint64_t elapsed_ms) const;
+    // The elapsed time since the last beacon at which phi reaches `threshold`.
+    uint64_t timeout_ms(double threshold) const;
+
+private:
+    const int _window_size;
+    const uint32_t _min_stddev_ms;
+
+    std::deque<uint64_t> _intervals;
+    double _sum;
+    double _square_sum;
+};
+
+} // namespace fd
+} // namespace dsn
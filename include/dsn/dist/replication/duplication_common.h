@@ -28,6 +28,7 @@ namespace dsn {
 namespace replication {
 
 DSN_DECLARE_uint32(duplicate_log_batch_bytes);
+DSN_DECLARE_uint32(duplicate_max_in_flight_batches);
 
 typedef rpc_holder<duplication_modify_request, duplication_modify_response> duplication_modify_rpc;
 typedef rpc_holder<duplication_add_request, duplication_add_response> duplication_add_rpc;
@@ -22,6 +22,8 @@
 #include <dsn/dist/replication/replica_base.h>
 #include <dsn/cpp/pipeline.h>
 
+#include <vector>
+
 namespace dsn {
 namespace replication {
 
@@ -30,7 +32,7 @@ namespace replication {
 /// dsn::blob is the content of the mutation.
 typedef std::tuple<uint64_t, task_code, blob> mutation_tuple;
 
-/// mutations are sorted by timestamp in mutation_tuple_set.
+/// orders the mutations by timestamp.
 struct mutation_tuple_cmp
 {
     inline bool operator()(const mutation_tuple &lhs, const mutation_tuple &rhs) const
@@ -44,7 +46,9 @@ struct mutation_tuple_cmp
         return std::get<0>(lhs) < std::get<0>(rhs);
     }
 };
-typedef std::set<mutation_tuple, mutation_tuple_cmp> mutation_tuple_set;
+/// mutations are sorted by decree in mutation_tuple_set, which is also the order of timestamp
+/// since the timestamps of a replica never decrease.
+typedef std::vector<mutation_tuple> mutation_tuple_set;
 
 /// \brief This is an interface for handling the mutation logs intended to
 /// be duplicated to remote cluster.
@@ -56,6 +60,8 @@ public:
 
     /// Duplicate the provided mutations to the remote cluster.
     /// The implementation must be non-blocking.
+    /// If [replication] duplicate_max_in_flight_batches > 1, it's called again before the
+    /// previous batches are done, and the batches may complete in any order.
     ///
     /// \param cb: Call it when all the given mutations were sent successfully
     virtual void duplicate(mutation_tuple_set mutations, callback cb) = 0;
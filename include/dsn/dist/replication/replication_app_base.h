@@ -207,6 +207,11 @@ public:
     // return the error generated by storage engine
     virtual int on_request(message_ex *request) = 0;
 
+    // Whether on_request() can serve the read requests from several threads at the same time.
+    // If not, the reads of a replica are serialized when they are dispatched to a non-partitioned
+    // thread pool.
+    virtual bool is_read_concurrency_safe() const { return false; }
+
     //
     // Parameters:
     //  - timestamp: an incremental timestamp generated for this batch of requests.
@@ -238,6 +243,10 @@ public:
     // dump the write request some info to string, it may need overload
     virtual std::string dump_write_request(message_ex *request) { return "write request"; };
 
+    // the cost of the request charged by node-level and table-level throttling, it's the body
+    // size by default, storage engine may override it to report a more precise cost
+    virtual int64_t get_request_units(message_ex *request) const { return request->body_size(); }
+
     virtual void set_ingestion_status(ingestion_status::type status) {}
 
     virtual ingestion_status::type get_ingestion_status() { return ingestion_status::IS_INVALID; }
@@ -47,6 +47,8 @@ struct http_request
     blob body;
     blob full_url;
     http_method method;
+    // value of the "Accept-Encoding" header
+    std::string accept_encoding;
 };
 
 enum class http_status_code
@@ -70,18 +72,69 @@ struct http_response
 
 typedef std::function<void(const http_request &req, http_response &resp)> http_callback;
 
+// Writes the response of an HTTP call piece by piece, so that a large body is never
+// materialized: the body is sent with chunked transfer encoding, and gzip-compressed if the
+// client accepts it.
+//
+// The writer may be used from any thread after the callback returns, but by one producer at a
+// time. The response is done once finish() is called or the last reference is released.
+class http_response_writer
+{
+public:
+    virtual ~http_response_writer() = default;
+
+    // Sends the status line and the headers, must be called before write().
+    virtual void begin(http_status_code code, const std::string &content_type) = 0;
+
+    // Appends to the body, which is sent once enough data is buffered.
+    virtual void write(const char *data, size_t length) = 0;
+    void write(const std::string &data) { write(data.data(), data.length()); }
+
+    virtual void finish() = 0;
+
+    // Ends the response without completing the body, so that the client sees the connection
+    // closed rather than a complete response. Called instead of finish() if the body can't be
+    // produced to the end.
+    virtual void cancel() = 0;
+
+    // False if the peer falls behind, the producer should hold off writing for a while.
+    virtual bool writable() const = 0;
+    // True if the peer is gone, the producer should stop.
+    virtual bool aborted() const = 0;
+};
+
+typedef std::shared_ptr<http_response_writer> http_response_writer_ptr;
+
+typedef std::function<void(const http_request &req, http_response_writer_ptr writer)>
+    http_async_callback;
+
+// Produces the body into `writer` step by step, returns false once the body is done.
+typedef std::function<bool(http_response_writer &writer)> http_body_producer;
+
+// Calls `producer` on THREAD_POOL_DEFAULT until the body is done, pausing while the writer is
+// not writable. finish() is called on the writer at the end, or cancel() if the client is gone
+// or stalls.
+extern void stream_http_body(http_response_writer_ptr writer, http_body_producer producer);
+
 // Defines the structure of an HTTP call.
 struct http_call
 {
     std::string path;
     std::string help;
     http_callback callback;
+    // used instead of `callback` if set
+    http_async_callback async_callback;
 
     http_call &with_callback(http_callback cb)
     {
         callback = std::move(cb);
         return *this;
     }
+    http_call &with_async_callback(http_async_callback cb)
+    {
+        async_callback = std::move(cb);
+        return *this;
+    }
     http_call &with_help(std::string hp)
     {
         help = std::move(hp);
@@ -100,6 +153,7 @@ public:
     virtual std::string path() const = 0;
 
     void register_handler(std::string path, http_callback cb, std::string help);
+    void register_async_handler(std::string path, http_async_callback cb, std::string help);
 };
 
 // Example:
@@ -132,6 +132,10 @@ public:
         const std::vector<std::string> &args,
         std::function<bool(const std::string &arg, const counter_snapshot &cs)> filter) const;
 
+    // Gets the references of all the counters, without the values. Used to visit the counters
+    // incrementally rather than taking a snapshot of all.
+    void get_all_counters(std::vector<perf_counter_ptr> *all) const;
+
 private:
     perf_counters();
     ~perf_counters();
@@ -143,8 +147,6 @@ private:
                               dsn_perf_counter_type_t type,
                               const char *dsptr);
 
-    void get_all_counters(std::vector<perf_counter_ptr> *all) const;
-
     mutable utils::rw_lock_nr _lock;
     // keep counter as a refptr to make the counter can be safely accessed
     // by get_all_counters and remove_counter concurrently
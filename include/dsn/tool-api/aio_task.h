@@ -62,6 +62,7 @@ public:
     aio_type type;
     disk_engine *engine;
     void *file_object; // TODO(wutao1): make it disk_file*, and distinguish it from `file`
+    uint64_t submit_ts_ns; // when the io is submitted to the disk engine
 
     aio_context()
         : file(nullptr),
@@ -70,7 +71,8 @@ public:
           file_offset(0),
           type(AIO_Invalid),
           engine(nullptr),
-          file_object(nullptr)
+          file_object(nullptr),
+          submit_ts_ns(0)
     {
     }
 };
@@ -167,7 +167,10 @@ public:
     DSN_API void on_client_session_connected(rpc_session_ptr &s);
     DSN_API void on_client_session_disconnected(rpc_session_ptr &s);
 
-    // called upon RPC call, rpc client session is created on demand
+    // called upon RPC call, rpc client session is created on demand, one for each traffic class
+    // of the rpc codes (see task_spec::rpc_traffic_class) to the same remote address, and
+    // [network] client_sessions_per_peer ones for TC_DEFAULT, chosen by the thread hash of the
+    // request so that the requests of a partition are always sent in order
     DSN_API virtual void send_message(message_ex *request) override;
 
     // called by rpc engine
@@ -177,8 +180,16 @@ public:
     virtual rpc_session_ptr create_client_session(::dsn::rpc_address server_addr) = 0;
 
 protected:
+    // the traffic class of a request, by its rpc code
+    static rpc_traffic_class_t traffic_class_of(message_ex *request);
+    // the index of the client session to send a request through, among those of its class
+    uint32_t lane_of(message_ex *request, rpc_traffic_class_t tc) const;
+    // count of the client sessions of all traffic classes, should be called in _clients_lock
+    int client_session_count() const;
+
     typedef std::unordered_map<::dsn::rpc_address, rpc_session_ptr> client_sessions;
-    client_sessions _clients; // to_address => rpc_session
+    // traffic class => lane => to_address => rpc_session
+    std::vector<client_sessions> _clients[TC_COUNT];
     utils::rw_lock_nr _clients_lock;
 
     typedef std::unordered_map<::dsn::rpc_address, rpc_session_ptr> server_sessions;
@@ -226,6 +237,15 @@ public:
     bool is_client() const { return _is_client; }
 
     dsn::rpc_address remote_address() const { return _remote_addr; }
+    // the traffic class of the messages sent by this session, and its index among the sessions
+    // of the class to the same remote address, only meaningful on client side
+    rpc_traffic_class_t traffic_class() const { return _traffic_class; }
+    uint32_t lane() const { return _lane; }
+    void set_client_lane(rpc_traffic_class_t tc, uint32_t lane)
+    {
+        _traffic_class = tc;
+        _lane = lane;
+    }
     connection_oriented_network &net() const { return _net; }
     message_parser_ptr parser() const { return _parser; }
 
@@ -250,6 +270,11 @@ public:
     void set_client_username(const std::string &user_name);
     const std::string &get_client_username() const;
 
+    /// count of the messages queued or being sent, used by the streaming senders to wait
+    /// for a slow peer
+    int pending_send_count() const;
+    bool is_disconnected() const { return _connect_state == SS_DISCONNECTED; }
+
 public:
     ///
     /// for subclass to implement receiving message
@@ -331,6 +356,8 @@ protected:
 
 private:
     const bool _is_client;
+    rpc_traffic_class_t _traffic_class{TC_DEFAULT};
+    uint32_t _lane{0};
     rpc_client_matcher *_matcher;
 
     std::atomic_int _delay_server_receive_ms;
@@ -102,6 +102,40 @@ ENUM_REG(TM_REJECT)
 ENUM_REG(TM_DELAY)
 ENUM_END(throttling_mode_t)
 
+// Each traffic class of rpc calls is sent through its own session to the peer, so that the small
+// and latency-sensitive messages are never queued behind the bulk transfers on the same stream.
+typedef enum rpc_traffic_class_t {
+    TC_CONTROL, // e.g., beacons and configuration syncs
+    TC_DEFAULT, // e.g., client requests and 2pc prepares
+    TC_BULK,    // e.g., nfs copies and learning
+    TC_COUNT,
+    TC_INVALID
+} rpc_traffic_class_t;
+
+ENUM_BEGIN(rpc_traffic_class_t, TC_INVALID)
+ENUM_REG(TC_CONTROL)
+ENUM_REG(TC_DEFAULT)
+ENUM_REG(TC_BULK)
+ENUM_END(rpc_traffic_class_t)
+
+// The ios waiting for the same disk are scheduled by their classes, so that the mutation log
+// writes are not queued behind the bulk copies on a busy disk.
+typedef enum disk_io_class_t {
+    IOC_WAL,        // e.g., mutation log writes
+    IOC_FOREGROUND, // e.g., reads for the clients
+    IOC_COPY,       // e.g., nfs copies and learning
+    IOC_BACKGROUND, // e.g., backups and bulk loads
+    IOC_COUNT,
+    IOC_INVALID
+} disk_io_class_t;
+
+ENUM_BEGIN(disk_io_class_t, IOC_INVALID)
+ENUM_REG(IOC_WAL)
+ENUM_REG(IOC_FOREGROUND)
+ENUM_REG(IOC_COPY)
+ENUM_REG(IOC_BACKGROUND)
+ENUM_END(disk_io_class_t)
+
 typedef enum dsn_msg_serialize_format {
     DSF_INVALID = 0,
     DSF_THRIFT_BINARY = 1,
@@ -180,9 +214,11 @@ public:
     // for other tasks - allow-inline allows a task being execution in io-thread
     bool allow_inline;
     bool randomize_timer_delay_if_zero; // to avoid many timers executing at the same time
+    disk_io_class_t disk_io_class;      // for TASK_TYPE_AIO only
     network_header_format rpc_call_header_format;
     dsn_msg_serialize_format rpc_msg_payload_serialize_default_format;
     rpc_channel rpc_call_channel;
+    rpc_traffic_class_t rpc_traffic_class;
     bool rpc_message_crc_required;
 
     int32_t rpc_timeout_milliseconds;
@@ -270,6 +306,13 @@ CONFIG_FLD(bool,
            "initial delay is zero, to avoid "
            "multiple timers executing at the "
            "same time (e.g., checkpointing)")
+CONFIG_FLD_ENUM(disk_io_class_t,
+                disk_io_class,
+                IOC_FOREGROUND,
+                IOC_INVALID,
+                false,
+                "class of this kind of disk ios, by which the ios waiting for the same disk are "
+                "scheduled: IOC_WAL, IOC_FOREGROUND, IOC_COPY, IOC_BACKGROUND")
 CONFIG_FLD_ID(network_header_format,
               rpc_call_header_format,
               NET_HDR_DSN,
@@ -286,6 +329,13 @@ CONFIG_FLD_ID(rpc_channel,
               RPC_CHANNEL_TCP,
               false,
               "what kind of network channel for this kind of rpc calls")
+CONFIG_FLD_ENUM(rpc_traffic_class_t,
+                rpc_traffic_class,
+                TC_DEFAULT,
+                TC_INVALID,
+                false,
+                "traffic class of this kind of rpc calls, each class has its own session to a "
+                "peer: TC_CONTROL, TC_DEFAULT, TC_BULK")
 CONFIG_FLD(bool,
            bool,
            rpc_message_crc_required,
@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <dsn/tool_api.h>
+
+/*!
+@defgroup event_recorder Event Recorder
+@ingroup tools
+
+Event recorder toollet
+
+Unlike the tracer which logs a text line on every task operation, this toollet records fixed-size
+binary events into a lock-free ring buffer per thread, and is cheap enough to be kept on in
+production. The recent events can be dumped through the http call "traceEvents" in the Chrome
+trace event format, which can be loaded by chrome://tracing or https://ui.perfetto.dev.
+
+<PRE>
+
+[core]
+
+toollets = event_recorder
+
+; record the events of 1 in N tasks/rpcs (by their ids), 0 to stop recording, runtime mutable
+event_recorder_sample_one_in = 1
+
+; count of the events kept per thread, rounded up to a power of 2
+event_recorder_ring_size = 32768
+
+</PRE>
+*/
+namespace dsn {
+namespace tools {
+
+enum class trace_event_type : uint8_t
+{
+    task_begin,
+    task_end,
+    rpc_call,             // client sends a request
+    rpc_response_enqueue, // client gets the response
+    rpc_request_enqueue,  // server gets a request
+    rpc_reply,            // server replies
+    aio_call,
+    aio_complete,
+};
+
+struct trace_event
+{
+    uint64_t ts_ns;
+    // task id, or 0 if the event isn't bound to a task
+    uint64_t id;
+    // rpc trace id, or 0 if the event isn't of an rpc
+    uint64_t trace_id;
+    int32_t code;
+    trace_event_type type;
+};
+
+struct thread_trace_events
+{
+    int tid;
+    std::string thread_name;
+    // in the order of time
+    std::vector<trace_event> events;
+};
+
+class event_recorder : public toollet
+{
+public:
+    explicit event_recorder(const char *name);
+    void install(service_spec &spec) override;
+
+    // Records an event into the ring of the current thread, if sampled.
+    static void record(trace_event_type type, int32_t code, uint64_t id, uint64_t trace_id);
+
+    // Gets the events recorded during the last `duration_ms` by each thread.
+    static std::vector<thread_trace_events> snapshot(uint64_t duration_ms);
+
+    // Appends the events of a thread in the Chrome trace event format, as the elements of the
+    // "traceEvents" array. `first` tells whether a comma is needed before the first element.
+    static void append_chrome_trace(const thread_trace_events &events,
+                                    /*inout*/ bool &first,
+                                    /*out*/ std::string &out);
+};
+
+} // namespace tools
+} // namespace dsn
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 namespace dsn {
@@ -28,7 +29,8 @@ public:
     clock() = default;
     virtual ~clock() = default;
 
-    // Gets current time in nanoseconds.
+    // Gets current time in nanoseconds, read from the TSC if [core] enable_tsc_clock is set and
+    // the cpu supports, otherwise from the system clock.
     virtual uint64_t now_ns() const;
 
     // Gets singleton instance. eager singleton, which is thread safe
@@ -41,5 +43,20 @@ private:
     static std::unique_ptr<clock> _clock;
 };
 
+// The clock reading the invariant TSC of x86-64 cpus, which costs several times less than the
+// system clock. The ticks are converted into the time of the system clock with a rate calibrated
+// against it, and both the base and the rate are re-synchronized to the system clock every
+// [core] tsc_clock_resync_interval_ms, so that the time never drifts from it for long.
+class tsc_clock
+{
+public:
+    // Whether the cpu has an invariant TSC, which ticks at a constant rate in all power states.
+    static bool available();
+
+    // Gets current time in nanoseconds, in the same epoch as the system clock.
+    // Must be called only if available().
+    static uint64_t now_ns();
+};
+
 } // namespace utils
 } // namespace dsn
@@ -81,5 +81,8 @@ char *trim_string(char *s);
 
 // calculate the md5 checksum of buffer
 std::string string_md5(const char *buffer, unsigned int length);
+
+// convert the md5 digest of MD5_DIGEST_LENGTH bytes to the lowercase hex string
+std::string md5_digest_to_hex(const unsigned char *digest);
 } // namespace utils
 } // namespace dsn
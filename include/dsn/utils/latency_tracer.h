@@ -16,8 +16,10 @@
 // under the License.
 
 #pragma once
+#include <atomic>
 #include <dsn/utility/synchronize.h>
 #include <dsn/utility/flags.h>
+#include <dsn/utility/string_view.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/tool-api/task_code.h>
 #include <dsn/dist/replication/replication.codes.h>
@@ -25,52 +27,103 @@
 namespace dsn {
 namespace utils {
 
+// The stage of a trace point, which is registered once for each place adding trace points, so
+// that adding a point records only a small integer besides the timestamp.
+typedef uint32_t latency_stage_id;
+
+// Gets the id of the stage with `name`, registers it if not yet.
+extern latency_stage_id register_latency_stage(string_view name);
+
+extern const char *latency_stage_name(latency_stage_id stage);
+
+// A place adding trace points, defined as a static variable by the macros below.
+class latency_stage_site
+{
+public:
+    latency_stage_site(const char *file, int line, const char *function);
+
+    // The stage named "<file>:<line>:<function>".
+    latency_stage_id stage() const { return _stage; }
+
+    // The stage named "<file>:<line>:<function>_<message>". The name is formatted on stack, so
+    // there's no allocation unless the stage is new.
+    latency_stage_id stage(string_view message) const;
+
+    // A literal message is the same each time the place is reached, so the stage is looked up
+    // in the registry only the first time.
+    template <size_t N>
+    latency_stage_id stage(const char (&message)[N]) const
+    {
+        latency_stage_id id = _literal_stage.load(std::memory_order_relaxed);
+        if (dsn_unlikely(id == 0)) {
+            id = stage(string_view(message));
+            _literal_stage.store(id, std::memory_order_relaxed);
+        }
+        return id;
+    }
+
+private:
+    const std::string _name;
+    const latency_stage_id _stage;
+    // the stage with the literal message, 0 if not looked up yet
+    mutable std::atomic<latency_stage_id> _literal_stage{0};
+};
+
 #define ADD_POINT(tracer)                                                                          \
     do {                                                                                           \
-        if (dsn_unlikely(tracer != nullptr && (tracer)->enabled()))                                \
-            (tracer)->add_point(fmt::format("{}:{}:{}", __FILENAME__, __LINE__, __FUNCTION__));    \
+        if (dsn_unlikely(tracer != nullptr && (tracer)->enabled())) {                              \
+            static const ::dsn::utils::latency_stage_site _trace_site(                             \
+                __FILENAME__, __LINE__, __FUNCTION__);                                             \
+            (tracer)->add_point(_trace_site.stage());                                              \
+        }                                                                                          \
     } while (0)
 
 #define ADD_CUSTOM_POINT(tracer, message)                                                          \
     do {                                                                                           \
-        if (dsn_unlikely(tracer != nullptr && (tracer)->enabled()))                                \
-            (tracer)->add_point(                                                                   \
-                fmt::format("{}:{}:{}_{}", __FILENAME__, __LINE__, __FUNCTION__, (message)));      \
+        if (dsn_unlikely(tracer != nullptr && (tracer)->enabled())) {                              \
+            static const ::dsn::utils::latency_stage_site _trace_site(                             \
+                __FILENAME__, __LINE__, __FUNCTION__);                                             \
+            (tracer)->add_point(_trace_site.stage(message));                                       \
+        }                                                                                          \
     } while (0)
 
 #define APPEND_EXTERN_POINT(tracer, ts, message)                                                   \
     do {                                                                                           \
-        if (dsn_unlikely(tracer != nullptr && (tracer)->enabled()))                                \
-            (tracer)->append_point(                                                                \
-                fmt::format("{}:{}:{}_{}", __FILENAME__, __LINE__, __FUNCTION__, (message)),       \
-                (ts));                                                                             \
+        if (dsn_unlikely(tracer != nullptr && (tracer)->enabled())) {                              \
+            static const ::dsn::utils::latency_stage_site _trace_site(                             \
+                __FILENAME__, __LINE__, __FUNCTION__);                                             \
+            (tracer)->append_point(_trace_site.stage(message), (ts));                              \
+        }                                                                                          \
     } while (0)
 
 /**
  * latency_tracer is a tool for tracking the time spent in each of the stages during request
  * execution. It can help users to figure out where the latency bottleneck is located. User needs to
- * use `add_point` before entering one stage, which will record the name of this stage and its start
- * time. When the request is finished, the formatted result can be dumped automatically in
- * deconstructer
+ * use `ADD_POINT` before entering one stage, which will record the stage and its start time. When
+ * the request is finished, the formatted result can be dumped automatically in deconstructer.
+ *
+ * Adding a point takes neither lock nor allocation: the stages are registered once for each place,
+ * and the points are appended to a fixed-size array, so it's cheap enough to trace all the
+ * requests. The points beyond the capacity are dropped.
  *
  * For example, given a request with a 4-stage pipeline (the `latency_tracer` need to
  * be held by this request throughout the execution):
  *
  * ```
  * class request {
- *      latency_tracer tracer;
+ *      std::shared_ptr<latency_tracer> tracer;
  * }
  * void start(request req){
- *      req.tracer.add_point("start");
+ *      ADD_CUSTOM_POINT(req.tracer, "start");
  * }
  * void stageA(request req){
- *      req.tracer.add_point("stageA");
+ *      ADD_CUSTOM_POINT(req.tracer, "stageA");
  * }
  * void stageB(request req){
- *      req.tracer.add_point("stageB");
+ *      ADD_CUSTOM_POINT(req.tracer, "stageB");
  * }
  * void end(request req){
- *      req.tracer.add_point("end");
+ *      ADD_CUSTOM_POINT(req.tracer, "end");
  * }
  * ```
  *
@@ -87,6 +140,11 @@ DSN_DECLARE_bool(enable_latency_tracer_report);
 class latency_tracer
 {
 public:
+    // max count of the points of a tracer
+    static const int MAX_POINTS = 32;
+    // max count of the sub tracers of a tracer
+    static const int MAX_SUB_TRACERS = 8;
+
     //-is_sub:
     //  if `is_sub`=true means its points will be dumped by parent tracer and won't be dumped
     //  repeatedly in destructor
@@ -111,8 +169,8 @@ public:
 
     // add a trace point to the tracer, it will record the timestamp of point
     //
-    // -name: user specified name of the trace point
-    void add_point(const std::string &stage_name);
+    // -stage: the stage of the trace point, see ADD_POINT
+    void add_point(latency_stage_id stage);
 
     // append a trace point, the timestamp is passed. it will always append at last position
     //
@@ -121,9 +179,9 @@ public:
     // the send side timestamp, you need use the method to make sure the rule to avoid the clock
     // asynchronization problem. the detail resolution see the method implement
     //
-    // -name: user specified name of the trace point
+    // -stage: the stage of the trace point, see APPEND_EXTERN_POINT
     // -timestamp: user specified timestamp of the trace point
-    void append_point(const std::string &stage_name, uint64_t timestamp);
+    void append_point(latency_stage_id stage, uint64_t timestamp);
 
     // sub_tracer is used for tracking the request which may transfer the other thread, for example:
     // rdsn "mutataion" will async to execute send "mutation" to remote rpc node and execute io
@@ -132,33 +190,58 @@ public:
     // stageA[mutation]--stageB[mutation]--|-->stageC0[mutation]-->....
     //                                     |-->stageC1[io]-->....
     //                                     |-->stageC2[rpc]-->....
-    void add_sub_tracer(const std::shared_ptr<latency_tracer> &tracer);
+    //
+    // Returns the index of the sub tracer, which is used to get it by `sub_tracer`, or -1 if the
+    // trace is disabled or there are already MAX_SUB_TRACERS sub tracers.
+    int add_sub_tracer(const std::shared_ptr<latency_tracer> &tracer);
 
-    void add_sub_tracer(const std::string &name);
+    int add_sub_tracer(const std::string &name);
 
-    std::shared_ptr<latency_tracer> sub_tracer(const std::string &name);
+    // The sub tracer is named by the registered stage `name`, so that the name needn't be built
+    // for each tracer, see register_latency_stage.
+    int add_sub_tracer(latency_stage_id name);
+
+    std::shared_ptr<latency_tracer> sub_tracer(int index) const;
 
     void set_name(const std::string &name) { _name = name; }
 
     void set_description(const std::string &description) { _description = description; }
 
-    void set_parent_point_name(const std::string &name) { _parent_point_name = name; }
+    void set_parent_point_name(const std::string &name)
+    {
+        _parent_stage = register_latency_stage(name);
+    }
 
     void set_start_time(uint64_t start_time) { _start_time = start_time; }
 
-    const std::string &name() const { return _name; }
+    std::string name() const { return _name_stage != 0 ? latency_stage_name(_name_stage) : _name; }
 
     const std::string &description() const { return _description; }
 
     uint64_t start_time() const { return _start_time; }
 
-    uint64_t last_time() const { return _last_time; }
+    uint64_t last_time() const { return _last_time.load(std::memory_order_relaxed); }
 
-    const std::string &last_stage_name() const { return _last_stage; }
+    const char *last_stage_name() const
+    {
+        return latency_stage_name(_last_stage.load(std::memory_order_relaxed));
+    }
 
     bool enabled() const { return _enable_trace; }
 
 private:
+    struct trace_point
+    {
+        // 0 if the point is not written yet
+        std::atomic<latency_stage_id> stage{0};
+        uint64_t ts{0};
+    };
+
+    void record_point(latency_stage_id stage, uint64_t ts);
+
+    // the points written, in the order of time
+    std::vector<std::pair<uint64_t, latency_stage_id>> sorted_points() const;
+
     // report the trace point duration to monitor system
     static void report_trace_point(const std::string &name, uint64_t span);
 
@@ -167,23 +250,25 @@ private:
 
     bool _is_sub;
     std::string _name;
+    // the registered name, which takes precedence over `_name` if not 0
+    latency_stage_id _name_stage{0};
     std::string _description;
     uint64_t _threshold;
     uint64_t _start_time;
-    uint64_t _last_time;
-    std::string _last_stage;
+    std::atomic<uint64_t> _last_time;
+    std::atomic<latency_stage_id> _last_stage{0};
 
     dsn::task_code _task_code;
     bool _enable_trace;
 
-    utils::rw_lock_nr _point_lock; //{
-    std::map<int64_t, std::string> _points;
-    // }
+    // the points are appended by claiming the slots with `_point_count`, which may exceed
+    // MAX_POINTS, the points beyond are dropped
+    std::atomic<uint32_t> _point_count{0};
+    trace_point _points[MAX_POINTS];
 
-    std::string _parent_point_name;
-    utils::rw_lock_nr _sub_lock; //{
-    std::unordered_map<std::string, std::shared_ptr<latency_tracer>> _sub_tracers;
-    // }
+    latency_stage_id _parent_stage{0};
+    std::atomic<int> _sub_tracer_count{0};
+    std::shared_ptr<latency_tracer> _sub_tracers[MAX_SUB_TRACERS];
 
     friend class latency_tracer_test;
 };
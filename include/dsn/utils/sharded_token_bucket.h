@@ -0,0 +1,90 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace dsn {
+namespace utils {
+
+// A token bucket whose budget is split into several sub-buckets (shards), so that threads
+// consuming from the same bucket touch different cache lines in the common case.
+//
+// Each thread is bound to a home shard. A consumer first tries its home shard; if the home
+// shard runs dry, it borrows from the other shards before giving up, so the total throughput
+// admitted by the bucket is still bounded by `rate` (plus `burst`).
+//
+// consume() and refund() are lock-free and can be called from any thread. reset() is also
+// thread-safe, but a consumer racing with it may observe either the old or the new rate.
+class sharded_token_bucket
+{
+public:
+    // shard_count = 0 means using the number of hardware threads.
+    explicit sharded_token_bucket(uint32_t shard_count = 0);
+
+    // Sets the refill rate (units per second) and the capacity of the bucket.
+    // rate <= 0 disables the bucket, thus every consume() succeeds.
+    // burst <= 0 means the capacity equals to rate, i.e. one second of tokens.
+    // The rate is split exactly among the shards, and at most `rate` shards are used so that
+    // each of them refills at least one unit per second.
+    void reset(int64_t rate, int64_t burst = 0);
+
+    bool enabled() const { return _rate.load(std::memory_order_relaxed) > 0; }
+    int64_t rate() const { return _rate.load(std::memory_order_relaxed); }
+
+    // Takes `units` tokens from the bucket. Returns false and takes nothing if there are not
+    // enough tokens in all the shards.
+    bool consume(int64_t units);
+    bool consume(int64_t units, uint64_t now_ns);
+
+    // Puts back `units` tokens taken by a previous consume(), typically because the request was
+    // rejected by another level of throttling.
+    void refund(int64_t units);
+
+    // Sum of the tokens currently available in all shards, only for test and monitoring.
+    int64_t available(uint64_t now_ns);
+
+private:
+    struct alignas(64) shard
+    {
+        std::atomic<int64_t> tokens{0};
+        std::atomic<uint64_t> last_refill_ns{0};
+        std::atomic<int64_t> rate{0};
+        std::atomic<int64_t> burst{0};
+    };
+
+    void refill(shard &s, uint64_t now_ns);
+    bool try_take(shard &s, int64_t units);
+    shard &home_shard();
+
+    const uint32_t _shard_count;
+    std::unique_ptr<shard[]> _shards;
+
+    std::atomic<int64_t> _rate{0};
+    // the sum of the shard bursts, i.e. the capacity of the bucket
+    std::atomic<int64_t> _burst{0};
+    // the shards in use, min(_shard_count, rate)
+    std::atomic<uint32_t> _active_shard_count{1};
+
+    friend class sharded_token_bucket_test;
+};
+
+} // namespace utils
+} // namespace dsn
@@ -39,7 +39,10 @@ aio_task::aio_task(dsn::task_code code, aio_handler &&cb, int hash, service_node
 
     _aio_ctx = file::prepare_aio_context(this);
 
-    _tracer = std::make_shared<dsn::utils::latency_tracer>(true, "aio_task", 0, code);
+    // the tracer is only created if enabled, as there are plenty of aio tasks
+    if (utils::FLAGS_enable_latency_tracer) {
+        _tracer = std::make_shared<dsn::utils::latency_tracer>(true, "aio_task", 0, code);
+    }
 }
 
 void aio_task::collapse()
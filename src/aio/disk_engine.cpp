@@ -24,9 +24,15 @@
  * THE SOFTWARE.
  */
 
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <algorithm>
+
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/tool-api/aio_task.h>
 #include <dsn/utility/flags.h>
+#include <dsn/utility/smart_pointers.h>
 
 #include "disk_engine.h"
 #include "runtime/service_engine.h"
@@ -37,6 +43,35 @@ using namespace dsn::utils;
 namespace dsn {
 DEFINE_TASK_CODE_AIO(LPC_AIO_BATCH_WRITE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 
+DSN_DEFINE_uint32("aio",
+                  max_in_flight_ios_per_disk,
+                  0,
+                  "max count of the ios submitted to a disk at the same time, the others wait and "
+                  "are scheduled by their classes, 0 means unlimited");
+DSN_TAG_VARIABLE(max_in_flight_ios_per_disk, FT_MUTABLE);
+
+DSN_DEFINE_uint32("aio", disk_io_weight_wal, 8, "share of a busy disk for IOC_WAL ios");
+DSN_TAG_VARIABLE(disk_io_weight_wal, FT_MUTABLE);
+DSN_DEFINE_validator(disk_io_weight_wal, [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_uint32("aio",
+                  disk_io_weight_foreground,
+                  4,
+                  "share of a busy disk for IOC_FOREGROUND ios");
+DSN_TAG_VARIABLE(disk_io_weight_foreground, FT_MUTABLE);
+DSN_DEFINE_validator(disk_io_weight_foreground, [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_uint32("aio", disk_io_weight_copy, 2, "share of a busy disk for IOC_COPY ios");
+DSN_TAG_VARIABLE(disk_io_weight_copy, FT_MUTABLE);
+DSN_DEFINE_validator(disk_io_weight_copy, [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_uint32("aio",
+                  disk_io_weight_background,
+                  1,
+                  "share of a busy disk for IOC_BACKGROUND ios");
+DSN_TAG_VARIABLE(disk_io_weight_background, FT_MUTABLE);
+DSN_DEFINE_validator(disk_io_weight_background, [](uint32_t value) -> bool { return value > 0; });
+
+// the fixed cost of an io besides its size, in bytes, so that the small ios are not free
+static constexpr uint64_t IO_COST_BYTES = 64 * 1024;
+
 const char *native_aio_provider = "dsn::tools::native_aio_provider";
 DSN_REGISTER_COMPONENT_PROVIDER(native_linux_aio_provider, native_aio_provider);
 
@@ -91,7 +126,98 @@ aio_task *disk_write_queue::unlink_next_workload(void *plength)
     return first;
 }
 
-disk_file::disk_file(dsn_handle_t handle) : _handle(handle) {}
+//----------------- disk_io_queue ------------------------
+static uint32_t io_weight_of(int io_class)
+{
+    switch (io_class) {
+    case IOC_WAL:
+        return FLAGS_disk_io_weight_wal;
+    case IOC_COPY:
+        return FLAGS_disk_io_weight_copy;
+    case IOC_BACKGROUND:
+        return FLAGS_disk_io_weight_background;
+    default:
+        return FLAGS_disk_io_weight_foreground;
+    }
+}
+
+disk_io_queue::disk_io_queue(const std::string &name)
+{
+    std::fill(std::begin(_passes), std::end(_passes), 0);
+    _counter_queue_depth.init_app_counter("eon.disk_engine",
+                                          fmt::format("io_queue_depth.{}", name).c_str(),
+                                          COUNTER_TYPE_NUMBER,
+                                          "count of the ios waiting for or being served by a disk");
+    _counter_latency_ns.init_app_counter("eon.disk_engine",
+                                         fmt::format("io_latency_ns.{}", name).c_str(),
+                                         COUNTER_TYPE_NUMBER_PERCENTILES,
+                                         "latency of the ios of a disk, including the queueing");
+}
+
+aio_task *disk_io_queue::enqueue(aio_task *aio, disk_io_class_t io_class)
+{
+    aio->get_aio_context()->submit_ts_ns = dsn_now_ns();
+
+    std::lock_guard<std::mutex> guard(_lock);
+    aio_task *ret = nullptr;
+    uint32_t max_in_flight_count = FLAGS_max_in_flight_ios_per_disk;
+    if (max_in_flight_count == 0 || _in_flight_count < max_in_flight_count) {
+        _in_flight_count++;
+        ret = aio;
+    } else {
+        auto &queue = _queues[io_class];
+        if (queue.empty()) {
+            // an idle class doesn't save its share for later
+            _passes[io_class] = std::max(_passes[io_class], _virtual_time);
+        }
+        queue.push_back(aio);
+        _queued_count++;
+    }
+    _counter_queue_depth->set(_in_flight_count + _queued_count);
+    return ret;
+}
+
+aio_task *disk_io_queue::on_completed(aio_task *aio)
+{
+    _counter_latency_ns->set(dsn_now_ns() - aio->get_aio_context()->submit_ts_ns);
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _in_flight_count--;
+    aio_task *next = nullptr;
+    uint32_t max_in_flight_count = FLAGS_max_in_flight_ios_per_disk;
+    if (_queued_count > 0 &&
+        (max_in_flight_count == 0 || _in_flight_count < max_in_flight_count)) {
+        next = dequeue();
+        _in_flight_count++;
+    }
+    _counter_queue_depth->set(_in_flight_count + _queued_count);
+    return next;
+}
+
+aio_task *disk_io_queue::dequeue()
+{
+    int io_class = -1;
+    for (int i = 0; i < IOC_COUNT; i++) {
+        if (!_queues[i].empty() && (io_class < 0 || _passes[i] < _passes[io_class])) {
+            io_class = i;
+        }
+    }
+    dassert(io_class >= 0, "no io is queued");
+
+    aio_task *aio = _queues[io_class].front();
+    _queues[io_class].pop_front();
+    _queued_count--;
+    _virtual_time = _passes[io_class];
+    _passes[io_class] +=
+        (aio->get_aio_context()->buffer_size + IO_COST_BYTES) / io_weight_of(io_class);
+    return aio;
+}
+
+//----------------- disk_file ------------------------
+disk_file::disk_file(dsn_handle_t handle)
+    : _handle(handle), _io_queue(disk_engine::instance().get_io_queue(handle))
+{
+}
 
 aio_task *disk_file::read(aio_task *tsk)
 {
@@ -203,7 +329,7 @@ void disk_engine::process_write(aio_task *aio, uint64_t sz)
     // no batching
     if (dio->buffer_size == sz) {
         aio->collapse();
-        _provider->submit_aio_task(aio);
+        submit(aio);
     }
 
     // batching
@@ -239,8 +365,44 @@ void disk_engine::process_write(aio_task *aio, uint64_t sz)
     }
 }
 
+void disk_engine::submit(aio_task *aio)
+{
+    // the batched writes are of the class of the first one
+    aio_task *first = aio->code() == LPC_AIO_BATCH_WRITE
+                          ? static_cast<batch_write_io_task *>(aio)->_tasks
+                          : aio;
+    disk_io_class_t io_class = first->spec().disk_io_class;
+    auto df = (disk_file *)aio->get_aio_context()->file_object;
+    aio_task *wk = df->io_queue()->enqueue(aio, io_class);
+    if (wk) {
+        _provider->submit_aio_task(wk);
+    }
+}
+
+disk_io_queue *disk_engine::get_io_queue(dsn_handle_t handle)
+{
+    // the files whose device is unknown share a queue
+    uint64_t dev = 0;
+    struct stat st;
+    if (::fstat(static_cast<int>((uintptr_t)handle), &st) == 0) {
+        dev = st.st_dev;
+    }
+
+    std::lock_guard<std::mutex> guard(_io_queues_lock);
+    auto &queue = _io_queues[dev];
+    if (queue == nullptr) {
+        queue = make_unique<disk_io_queue>(fmt::format("dev_{}_{}", major(dev), minor(dev)));
+    }
+    return queue.get();
+}
+
 void disk_engine::complete_io(aio_task *aio, error_code err, uint64_t bytes)
 {
+    auto next = ((disk_file *)aio->get_aio_context()->file_object)->io_queue()->on_completed(aio);
+    if (next) {
+        _provider->submit_aio_task(next);
+    }
+
     if (err != ERR_OK) {
         dinfo("disk operation failure with code %s, err = %s, aio_task_id = %016" PRIx64,
               aio->spec().name.c_str(),
@@ -260,7 +422,7 @@ void disk_engine::complete_io(aio_task *aio, error_code err, uint64_t bytes)
         if (aio->get_aio_context()->type == AIO_Read) {
             auto wk = df->on_read_completed(aio, err, (size_t)bytes);
             if (wk) {
-                _provider->submit_aio_task(wk);
+                submit(wk);
             }
         }
 
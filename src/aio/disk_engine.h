@@ -28,12 +28,47 @@
 
 #include "aio_provider.h"
 
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/tool_api.h>
 #include <dsn/utility/synchronize.h>
 #include <dsn/utility/work_queue.h>
 
 namespace dsn {
 
+// The ios submitted to a disk (device). Up to [aio] max_in_flight_ios_per_disk ios are submitted
+// to the aio provider at the same time, and the others wait in the queues of their classes.
+// The waiting ios are picked by weighted fair queuing: each class takes a share of the disk
+// bandwidth in proportion to its weight, see `disk_io_class_t`.
+class disk_io_queue
+{
+public:
+    explicit disk_io_queue(const std::string &name);
+
+    // Returns `aio` if it can be submitted now, or nullptr if it has to wait.
+    aio_task *enqueue(aio_task *aio, disk_io_class_t io_class);
+
+    // Returns the next io to submit, if any.
+    aio_task *on_completed(aio_task *aio);
+
+private:
+    aio_task *dequeue();
+
+    std::mutex _lock;
+    std::deque<aio_task *> _queues[IOC_COUNT];
+    // the virtual finish time of the last io picked from each class, in weighted bytes
+    uint64_t _passes[IOC_COUNT];
+    uint64_t _virtual_time{0};
+    uint32_t _queued_count{0};
+    uint32_t _in_flight_count{0};
+
+    perf_counter_wrapper _counter_queue_depth;
+    perf_counter_wrapper _counter_latency_ns;
+};
+
 class disk_write_queue : public work_queue<aio_task>
 {
 public:
@@ -62,8 +97,11 @@ public:
     // TODO(wutao1): make it uint64_t
     dsn_handle_t native_handle() const { return _handle; }
 
+    disk_io_queue *io_queue() const { return _io_queue; }
+
 private:
     dsn_handle_t _handle;
+    disk_io_queue *_io_queue;
     disk_write_queue _write_queue;
     work_queue<aio_task> _read_queue;
 };
@@ -74,6 +112,12 @@ public:
     void write(aio_task *aio);
     static aio_provider &provider() { return *instance()._provider.get(); }
 
+    // Submits the io to the aio provider through the queue of its disk.
+    void submit(aio_task *aio);
+
+    // Gets the queue of the disk where the file is.
+    disk_io_queue *get_io_queue(dsn_handle_t handle);
+
 private:
     // the object of disk_engine must be created by `singleton::instance`
     disk_engine();
@@ -84,6 +128,10 @@ private:
 
     std::unique_ptr<aio_provider> _provider;
 
+    std::mutex _io_queues_lock;
+    // device id -> queue
+    std::unordered_map<uint64_t, std::unique_ptr<disk_io_queue>> _io_queues;
+
     friend class aio_provider;
     friend class batch_write_io_task;
     friend class utils::singleton<disk_engine>;
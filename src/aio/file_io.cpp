@@ -84,7 +84,7 @@ namespace file {
     }
     auto wk = file->read(cb);
     if (wk) {
-        disk_engine::provider().submit_aio_task(wk);
+        disk_engine::instance().submit(wk);
     }
     return cb;
 }
@@ -130,6 +130,44 @@ error_code native_linux_aio_provider::read(const aio_context &aio_ctx,
     return ERR_OK;
 }
 
+// Completes the io with an error if the task running it is cancelled, e.g. with its tracker, so
+// that the slot of the io in the disk io queue is freed. The callback of the cancelled task, and
+// so the guard, is destroyed by the canceller, which may hold the lock of the tracker; hence the
+// completion is enqueued rather than run in place.
+class native_linux_aio_provider::io_guard
+{
+public:
+    io_guard(native_linux_aio_provider *provider, aio_task *aio) : _provider(provider), _aio(aio)
+    {
+    }
+
+    ~io_guard()
+    {
+        if (_started) {
+            return;
+        }
+        native_linux_aio_provider *provider = _provider;
+        aio_task *aio = _aio;
+        tasking::enqueue(aio->code(),
+                         nullptr,
+                         [provider, aio]() {
+                             provider->complete_io(aio, ERR_FILE_OPERATION_FAILED, 0);
+                         },
+                         aio->hash());
+    }
+
+    void run()
+    {
+        _started = true;
+        _provider->aio_internal(_aio);
+    }
+
+private:
+    native_linux_aio_provider *_provider;
+    aio_task *_aio;
+    bool _started{false};
+};
+
 void native_linux_aio_provider::submit_aio_task(aio_task *aio_tsk)
 {
     // for the tests which use simulator need sync submit for aio
@@ -139,8 +177,9 @@ void native_linux_aio_provider::submit_aio_task(aio_task *aio_tsk)
     }
 
     ADD_POINT(aio_tsk->_tracer);
+    auto guard = std::make_shared<io_guard>(this, aio_tsk);
     tasking::enqueue(
-        aio_tsk->code(), aio_tsk->tracker(), [=]() { aio_internal(aio_tsk); }, aio_tsk->hash());
+        aio_tsk->code(), aio_tsk->tracker(), [guard]() { guard->run(); }, aio_tsk->hash());
 }
 
 error_code native_linux_aio_provider::aio_internal(aio_task *aio_tsk)
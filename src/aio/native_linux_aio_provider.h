@@ -47,6 +47,9 @@ public:
 
 protected:
     error_code aio_internal(aio_task *aio);
+
+private:
+    class io_guard;
 };
 
 } // namespace dsn
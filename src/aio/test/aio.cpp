@@ -24,6 +24,8 @@
  * THE SOFTWARE.
  */
 
+#include <map>
+
 #include <dsn/tool-api/async_calls.h>
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/smart_pointers.h>
@@ -31,6 +33,12 @@
 
 #include <gtest/gtest.h>
 
+#include "aio/disk_engine.h"
+
+namespace dsn {
+DSN_DECLARE_uint32(max_in_flight_ios_per_disk);
+} // namespace dsn
+
 using namespace ::dsn;
 
 DEFINE_THREAD_POOL_CODE(THREAD_POOL_TEST_SERVER)
@@ -282,3 +290,76 @@ TEST(core, dsn_file)
     ASSERT_TRUE(utils::filesystem::file_size("copy_dest.txt", fout_size));
     ASSERT_EQ(fin_size, fout_size);
 }
+
+TEST(core, disk_io_queue)
+{
+    uint32_t old_max_in_flight_ios = FLAGS_max_in_flight_ios_per_disk;
+    FLAGS_max_in_flight_ios_per_disk = 1;
+
+    std::vector<aio_task_ptr> tasks;
+    std::map<aio_task *, disk_io_class_t> classes;
+    auto create_task = [&tasks, &classes](disk_io_class_t io_class) {
+        aio_task_ptr t = file::create_aio_task(LPC_AIO_TEST, nullptr, nullptr);
+        t->get_aio_context()->buffer_size = 64 * 1024;
+        tasks.push_back(t);
+        classes[t.get()] = io_class;
+        return t.get();
+    };
+
+    disk_io_queue queue("test");
+    aio_task *current = create_task(IOC_FOREGROUND);
+    ASSERT_EQ(current, queue.enqueue(current, IOC_FOREGROUND));
+    for (int i = 0; i < 8; i++) {
+        aio_task *t = create_task(IOC_WAL);
+        ASSERT_EQ(nullptr, queue.enqueue(t, IOC_WAL));
+        t = create_task(IOC_BACKGROUND);
+        ASSERT_EQ(nullptr, queue.enqueue(t, IOC_BACKGROUND));
+    }
+
+    // IOC_WAL takes 8 times the share of IOC_BACKGROUND by default
+    int wal_count = 0;
+    for (int i = 0; i < 9; i++) {
+        current = queue.on_completed(current);
+        ASSERT_NE(nullptr, current);
+        if (classes[current] == IOC_WAL) {
+            wal_count++;
+        }
+    }
+    ASSERT_EQ(8, wal_count);
+
+    // the rest are all IOC_BACKGROUND
+    for (int i = 0; i < 7; i++) {
+        current = queue.on_completed(current);
+        ASSERT_NE(nullptr, current);
+        ASSERT_EQ(IOC_BACKGROUND, classes[current]);
+    }
+    ASSERT_EQ(nullptr, queue.on_completed(current));
+
+    FLAGS_max_in_flight_ios_per_disk = old_max_in_flight_ios;
+}
+
+TEST(core, disk_io_queue_cancelled)
+{
+    uint32_t old_max_in_flight_ios = FLAGS_max_in_flight_ios_per_disk;
+    FLAGS_max_in_flight_ios_per_disk = 1;
+
+    const char *buffer = "hello, world";
+    int len = (int)strlen(buffer);
+    auto fp = file::open("tmp_cancelled", O_RDWR | O_CREAT | O_BINARY, 0666);
+
+    // the ios cancelled with their tracker still free their slots of the disk
+    task_tracker tracker;
+    for (int i = 0; i < 16; i++) {
+        file::write(fp, buffer, len, i * len, LPC_AIO_TEST, &tracker, nullptr);
+    }
+    tracker.cancel_outstanding_tasks();
+
+    auto t = file::write(fp, buffer, len, 0, LPC_AIO_TEST, nullptr, nullptr);
+    ASSERT_TRUE(t->wait(10000));
+    ASSERT_EQ(ERR_OK, t->error());
+
+    tracker.wait_outstanding_tasks();
+    ASSERT_EQ(ERR_OK, file::close(fp));
+    utils::filesystem::remove_path("tmp_cancelled");
+    FLAGS_max_in_flight_ios_per_disk = old_max_in_flight_ios;
+}
@@ -33,10 +33,13 @@
 
 #include <memory>
 #include <fstream>
+#include <streambuf>
 #include <string.h>
+#include <openssl/md5.h>
 #include <dsn/utility/defer.h>
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/safe_strerror_posix.h>
+#include <dsn/utility/strings.h>
 #include <dsn/utility/TokenBucket.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/flags.h>
@@ -126,6 +129,45 @@ std::string utils::path_from_fds(const std::string &input, bool /*is_dir*/)
     return result;
 }
 
+// Forwards the writes to the local file, and calculates the md5 of the data on the way, so that
+// the downloaded file needn't be read again for the md5.
+class md5_file_streambuf : public std::streambuf
+{
+public:
+    explicit md5_file_streambuf(std::streambuf *file) : _file(file) { MD5_Init(&_md5_ctx); }
+
+    // Should be called only once, after all the data is written.
+    std::string md5()
+    {
+        unsigned char out[MD5_DIGEST_LENGTH];
+        MD5_Final(out, &_md5_ctx);
+        return dsn::utils::md5_digest_to_hex(out);
+    }
+
+protected:
+    std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+        std::streamsize written = _file->sputn(s, n);
+        if (written > 0) {
+            MD5_Update(&_md5_ctx, s, written);
+        }
+        return written;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+        }
+        char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+private:
+    std::streambuf *_file;
+    MD5_CTX _md5_ctx;
+};
+
 DEFINE_TASK_CODE(LPC_FDS_CALL, TASK_PRIORITY_COMMON, THREAD_POOL_BLOCK_SERVICE)
 
 const std::string fds_service::FILE_LENGTH_CUSTOM_KEY = "x-xiaomi-meta-content-length";
@@ -687,8 +729,13 @@ dsn::task_ptr fds_file_object::download(const download_request &req,
     auto download_background = [this, req, handle, t]() {
         download_response resp;
         uint64_t transfered_size;
-        resp.err =
-            get_content_in_batches(req.remote_pos, req.remote_length, *handle, transfered_size);
+        md5_file_streambuf md5_buf(handle->rdbuf());
+        std::ostream os(&md5_buf);
+        resp.err = get_content_in_batches(req.remote_pos, req.remote_length, os, transfered_size);
+        if (resp.err == ERR_OK && !os) {
+            derror_f("fds download failed: fail to write localfile({})", req.output_local_name);
+            resp.err = ERR_FILE_OPERATION_FAILED;
+        }
         resp.downloaded_size = 0;
         if (resp.err == ERR_OK && handle->tellp() != -1) {
             resp.downloaded_size = handle->tellp();
@@ -699,10 +746,8 @@ dsn::task_ptr fds_file_object::download(const download_request &req,
                      _fds_path,
                      req.output_local_name);
             dsn::utils::filesystem::remove_path(req.output_local_name);
-        } else if ((resp.err = dsn::utils::filesystem::md5sum(req.output_local_name,
-                                                              resp.file_md5)) != ERR_OK) {
-            derror_f("download failed when calculate the md5sum of local file {}",
-                     req.output_local_name);
+        } else if (resp.err == ERR_OK) {
+            resp.file_md5 = md5_buf.md5();
         }
         t->enqueue_with(resp);
         release_ref();
@@ -25,8 +25,11 @@
 #include <dsn/utility/safe_strerror_posix.h>
 #include <dsn/utility/strings.h>
 #include <dsn/utility/utils.h>
+#include <fcntl.h>
 #include <memory>
 #include <nlohmann/json.hpp>
+#include <openssl/md5.h>
+#include <unistd.h>
 
 #include "local_service.h"
 
@@ -66,6 +69,14 @@ std::string local_service::get_metafile(const std::string &filepath)
     return utils::filesystem::path_combine(dir_part, std::string(".") + base_part + ".meta");
 }
 
+std::string local_service::get_multipart_file(const std::string &filepath)
+{
+    std::string dir_part = utils::filesystem::remove_file_name(filepath);
+    std::string base_part = utils::filesystem::get_file_name(filepath);
+
+    return utils::filesystem::path_combine(dir_part, std::string(".") + base_part + ".multipart");
+}
+
 local_service::local_service() {}
 
 local_service::local_service(const std::string &root) : _root(root) {}
@@ -479,6 +490,112 @@ dsn::task_ptr local_file_object::upload(const upload_request &req,
     return tsk;
 }
 
+dsn::task_ptr local_file_object::upload_part(const upload_part_request &req,
+                                             dsn::task_code code,
+                                             const upload_part_callback &cb,
+                                             task_tracker *tracker)
+{
+    add_ref();
+    upload_part_future_ptr tsk(new upload_part_future(code, cb, 0));
+    tsk->set_tracker(tracker);
+    auto upload_part_func = [this, req, tsk]() {
+        upload_part_response resp;
+        resp.err = ERR_OK;
+        resp.uploaded_size = 0;
+
+        // parts may be written concurrently, so each part uses its own fd and pwrite; the first
+        // part truncates the bytes left by the previous uploads
+        std::string multipart_file = local_service::get_multipart_file(file_name());
+        int flags = O_WRONLY | O_CREAT | (req.part_index == 0 ? O_TRUNC : 0);
+        int fd = ::open(multipart_file.c_str(), flags, 0644);
+        if (fd < 0) {
+            dwarn_f("open multipart file {} for write failed, err({})",
+                    multipart_file,
+                    utils::safe_strerror(errno));
+            resp.err = ERR_FS_INTERNAL;
+        } else {
+            auto cleanup = dsn::defer([fd]() { ::close(fd); });
+            const char *data = req.buffer.data();
+            size_t left = req.buffer.length();
+            uint64_t offset = req.offset;
+            while (left > 0) {
+                ssize_t n = ::pwrite(fd, data, left, offset);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    dwarn_f("write part {} of file {} failed, err({})",
+                            req.part_index,
+                            multipart_file,
+                            utils::safe_strerror(errno));
+                    resp.err = ERR_FS_INTERNAL;
+                    break;
+                }
+                data += n;
+                left -= n;
+                offset += n;
+            }
+            if (resp.err == ERR_OK) {
+                resp.uploaded_size = req.buffer.length();
+            }
+        }
+
+        tsk->enqueue_with(resp);
+        release_ref();
+    };
+    ::dsn::tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, std::move(upload_part_func));
+
+    return tsk;
+}
+
+dsn::task_ptr
+local_file_object::complete_multipart_upload(const complete_multipart_upload_request &req,
+                                             dsn::task_code code,
+                                             const complete_multipart_upload_callback &cb,
+                                             task_tracker *tracker)
+{
+    add_ref();
+    complete_multipart_upload_future_ptr tsk(new complete_multipart_upload_future(code, cb, 0));
+    tsk->set_tracker(tracker);
+    auto complete_func = [this, req, tsk]() {
+        complete_multipart_upload_response resp;
+        resp.err = ERR_OK;
+
+        std::string multipart_file = local_service::get_multipart_file(file_name());
+        int64_t file_size = 0;
+        if (req.part_count == 0) {
+            // no part is uploaded for an empty file, drop the bytes left by the previous uploads
+            utils::filesystem::remove_path(multipart_file);
+            utils::filesystem::create_file(multipart_file);
+        }
+        if (!utils::filesystem::file_size(multipart_file, file_size)) {
+            dwarn_f("get size of multipart file {} failed", multipart_file);
+            resp.err = ERR_FS_INTERNAL;
+        } else if (static_cast<uint64_t>(file_size) != req.total_size) {
+            dwarn_f("size of multipart file {} mismatch, expected({}) vs actual({}), discard it",
+                    multipart_file,
+                    req.total_size,
+                    file_size);
+            utils::filesystem::remove_path(multipart_file);
+            resp.err = ERR_INVALID_DATA;
+        } else if (!utils::filesystem::rename_path(multipart_file, file_name())) {
+            resp.err = ERR_FS_INTERNAL;
+        } else {
+            // the md5 is computed by the uploader for simplicity, like write()
+            _size = req.total_size;
+            _md5_value = req.md5;
+            _has_meta_synced = true;
+            resp.err = store_metadata();
+        }
+
+        tsk->enqueue_with(resp);
+        release_ref();
+    };
+    ::dsn::tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, std::move(complete_func));
+
+    return tsk;
+}
+
 dsn::task_ptr local_file_object::download(const download_request &req,
                                           dsn::task_code code,
                                           const download_callback &cb,
@@ -531,22 +648,30 @@ dsn::task_ptr local_file_object::download(const download_request &req,
                       target_file.c_str());
                 int64_t total_sz = 0;
                 char buf[max_length] = {'\0'};
+                // calculate the md5sum while copying rather than reading the target file again
+                MD5_CTX md5_ctx;
+                MD5_Init(&md5_ctx);
                 while (!fin.eof()) {
                     fin.read(buf, max_length);
                     total_sz += fin.gcount();
                     fout.write(buf, fin.gcount());
+                    MD5_Update(&md5_ctx, buf, fin.gcount());
                 }
+                unsigned char out[MD5_DIGEST_LENGTH];
+                MD5_Final(out, &md5_ctx);
                 dinfo("finish download file(%s), total_size = %d", target_file.c_str(), total_sz);
                 fout.close();
                 fin.close();
                 resp.downloaded_size = static_cast<uint64_t>(total_sz);
 
                 _size = total_sz;
-                if ((resp.err = utils::filesystem::md5sum(target_file, _md5_value)) != ERR_OK) {
-                    dwarn("download %s failed when calculate the md5sum of %s",
+                if (!fout) {
+                    dwarn("download %s failed when write to %s",
                           file_name().c_str(),
                           target_file.c_str());
+                    resp.err = ERR_FILE_OPERATION_FAILED;
                 } else {
+                    _md5_value = utils::md5_digest_to_hex(out);
                     _has_meta_synced = true;
                     resp.file_md5 = _md5_value;
                 }
@@ -50,6 +50,9 @@ public:
 
     static std::string get_metafile(const std::string &filepath);
 
+    // the file which the parts of a multipart upload are written into before completed
+    static std::string get_multipart_file(const std::string &filepath);
+
 private:
     std::string _root;
 };
@@ -84,6 +87,19 @@ public:
                                    const download_callback &cb,
                                    dsn::task_tracker *tracker = nullptr) override;
 
+    virtual bool support_multipart_upload() const override { return true; }
+
+    virtual dsn::task_ptr upload_part(const upload_part_request &req,
+                                      dsn::task_code code,
+                                      const upload_part_callback &cb,
+                                      dsn::task_tracker *tracker = nullptr) override;
+
+    virtual dsn::task_ptr
+    complete_multipart_upload(const complete_multipart_upload_request &req,
+                              dsn::task_code code,
+                              const complete_multipart_upload_callback &cb,
+                              dsn::task_tracker *tracker = nullptr) override;
+
     error_code load_metadata();
     error_code store_metadata();
 
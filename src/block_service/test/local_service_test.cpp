@@ -21,12 +21,17 @@
 #include <boost/filesystem.hpp>
 #include <nlohmann/json.hpp>
 
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/strings.h>
+
 #include "block_service/local/local_service.h"
 
 namespace dsn {
 namespace dist {
 namespace block_service {
 
+DEFINE_TASK_CODE(LPC_TEST_LOCAL_SERVICE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
 // Simple tests for nlohmann::json serialization, via NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE.
 
 TEST(local_service, store_metadata)
@@ -81,6 +86,85 @@ TEST(local_service, load_metadata)
     }
 }
 
+static task_ptr upload_part(const block_file_ptr &file,
+                            int32_t part_index,
+                            uint64_t offset,
+                            const std::string &data)
+{
+    upload_part_request req;
+    req.part_index = part_index;
+    req.offset = offset;
+    req.buffer = blob::create_from_bytes(std::string(data));
+    return file->upload_part(req, LPC_TEST_LOCAL_SERVICE, [data](const upload_part_response &resp) {
+        ASSERT_EQ(ERR_OK, resp.err);
+        ASSERT_EQ(data.size(), resp.uploaded_size);
+    });
+}
+
+TEST(local_service, multipart_upload)
+{
+    block_file_ptr file(new local_file_object("multipart.txt"));
+    ASSERT_TRUE(file->support_multipart_upload());
+
+    // an upload is abandoned, leaving more bytes than the file
+    upload_part(file, 0, 0, "the bytes left by the previous upload")->wait();
+
+    // the first part starts the upload, the others are uploaded out of order
+    std::vector<std::string> parts = {"hello ", "multipart ", "upload"};
+    std::vector<uint64_t> offsets = {0, 6, 16};
+    upload_part(file, 0, offsets[0], parts[0])->wait();
+    std::vector<task_ptr> tasks;
+    for (int i = parts.size() - 1; i > 0; --i) {
+        tasks.emplace_back(upload_part(file, i, offsets[i], parts[i]));
+    }
+    for (auto &t : tasks) {
+        t->wait();
+    }
+    // invisible before completed
+    ASSERT_FALSE(utils::filesystem::file_exists(file->file_name()));
+
+    const std::string content = "hello multipart upload";
+    complete_multipart_upload_request req;
+    req.part_count = parts.size();
+    req.md5 = utils::string_md5(content.data(), content.size());
+    req.total_size = content.size();
+    file->complete_multipart_upload(req,
+                                    LPC_TEST_LOCAL_SERVICE,
+                                    [](const complete_multipart_upload_response &resp) {
+                                        ASSERT_EQ(ERR_OK, resp.err);
+                                    })
+        ->wait();
+
+    ASSERT_EQ(content.size(), file->get_size());
+    ASSERT_EQ(req.md5, file->get_md5sum());
+    std::string md5;
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(file->file_name(), md5));
+    ASSERT_EQ(req.md5, md5);
+    ASSERT_FALSE(
+        utils::filesystem::file_exists(local_service::get_multipart_file(file->file_name())));
+}
+
+TEST(local_service, multipart_upload_size_mismatch)
+{
+    block_file_ptr file(new local_file_object("multipart_mismatch.txt"));
+    upload_part(file, 0, 0, "hello ")->wait();
+
+    complete_multipart_upload_request req;
+    req.part_count = 1;
+    req.total_size = 7;
+    file->complete_multipart_upload(req,
+                                    LPC_TEST_LOCAL_SERVICE,
+                                    [](const complete_multipart_upload_response &resp) {
+                                        ASSERT_EQ(ERR_INVALID_DATA, resp.err);
+                                    })
+        ->wait();
+
+    // the parts are discarded
+    ASSERT_FALSE(utils::filesystem::file_exists(file->file_name()));
+    ASSERT_FALSE(
+        utils::filesystem::file_exists(local_service::get_multipart_file(file->file_name())));
+}
+
 } // namespace block_service
 } // namespace dist
 } // namespace dsn
@@ -82,6 +82,8 @@ struct partition_bulk_load_state
     3:optional ingestion_status ingest_status = ingestion_status.IS_INVALID;
     4:optional bool             is_cleaned_up = false;
     5:optional bool             is_paused = false;
+    // bytes of the sst files downloaded
+    6:optional i64              downloaded_size = 0;
 }
 
 // meta server -> replica server
@@ -130,6 +130,14 @@ enum learner_status
     LearningFailed,
 }
 
+// A file retained by the learner from its previous membership.
+struct learn_file_meta
+{
+    1:string name; // relative to the replica dir of the learner
+    2:i64    size;
+    3:string md5;
+}
+
 struct learn_request
 {
     1:dsn.gpid pid;
@@ -143,6 +151,14 @@ struct learn_request
     // be duplicated (ie. max_gced_decree < confirmed_decree), if not,
     // learnee will copy the missing logs.
     7:optional i64        max_gced_decree;
+
+    // Used by app learning: the checkpoint files the learner still holds, the learnee
+    // won't ship the files the learner already has.
+    8:optional list<learn_file_meta> learner_files;
+
+    // The learner can send learner_files if the learnee chooses to learn app, they are
+    // not built in advance because most rounds learn the cache or the logs.
+    9:optional bool       learner_files_available;
 }
 
 struct learn_response
@@ -156,6 +172,14 @@ struct learn_response
     7:dsn.rpc_address       address; // learnee's address
     8:string                base_local_dir; // base dir of files on learnee
     9:optional string replica_disk_tag; // the disk tag of learnee located
+
+    // Files in state.files which needn't be copied: relative path on learnee -> name of
+    // the same file in learn_request.learner_files, to be hard-linked into the learn dir.
+    10:optional map<string, string> retained_files;
+
+    // The learnee chooses to learn app, and asks the learner to send learner_files in
+    // another request of the same round, nothing else in the response is valid.
+    11:optional bool learner_files_requested;
 }
 
 struct learn_notify_response
@@ -30,6 +30,14 @@ DSN_DEFINE_uint32("replication",
                   4096,
                   "send mutation log batch bytes size per rpc");
 DSN_TAG_VARIABLE(duplicate_log_batch_bytes, FT_MUTABLE);
+DSN_DEFINE_uint32("replication",
+                  duplicate_max_in_flight_batches,
+                  1,
+                  "max count of the mutation log batches being shipped concurrently by a "
+                  "duplication, the mutation_duplicator must support concurrent calls if > 1");
+DSN_TAG_VARIABLE(duplicate_max_in_flight_batches, FT_MUTABLE);
+DSN_DEFINE_validator(duplicate_max_in_flight_batches,
+                     [](uint32_t value) -> bool { return value > 0; });
 
 const std::string duplication_constants::kDuplicationCheckpointRootDir /*NOLINT*/ = "duplication";
 const std::string duplication_constants::kClustersSectionName /*NOLINT*/ = "pegasus.clusters";
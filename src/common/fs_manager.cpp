@@ -35,6 +35,7 @@
 #include "fs_manager.h"
 #include <dsn/utility/utils.h>
 #include <dsn/utility/filesystem.h>
+#include <algorithm>
 #include <thread>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/fail_point.h>
@@ -51,6 +52,20 @@ DSN_DEFINE_int32("replication",
                  "space insufficient");
 DSN_TAG_VARIABLE(disk_min_available_space_ratio, FT_MUTABLE);
 
+DSN_DEFINE_uint32("replication",
+                  dir_allocation_space_weight,
+                  4,
+                  "when allocating the dir for a new replica, a full dir is avoided as if it held "
+                  "this many more replicas of the app than an empty one");
+DSN_TAG_VARIABLE(dir_allocation_space_weight, FT_MUTABLE);
+
+DSN_DEFINE_uint32("replication",
+                  dir_allocation_load_weight,
+                  2,
+                  "when allocating the dir for a new replica, the dir of the most io load is "
+                  "avoided as if it held this many more replicas of the app than an idle one");
+DSN_TAG_VARIABLE(dir_allocation_load_weight, FT_MUTABLE);
+
 unsigned dir_node::replicas_count() const
 {
     unsigned sum = 0;
@@ -240,39 +255,63 @@ void fs_manager::allocate_dir(const gpid &pid, const std::string &type, /*out*/
 
     zauto_write_lock l(_lock);
 
-    dir_node *selected = nullptr;
-
-    unsigned least_app_replicas_count = 0;
-    unsigned least_total_replicas_count = 0;
-
+    // the disk stat may be unavailable (e.g. in tests), then the dirs are weighted equally
+    bool capacity_known = true;
+    int64_t max_capacity_mb = 0;
+    double max_io_bytes_per_sec = 0;
+    bool has_normal_dir = false;
     for (auto &n : _dir_nodes) {
         dassert(!n->has(pid),
                 "gpid(%d.%d) already in dir_node(%s)",
                 pid.get_app_id(),
                 pid.get_partition_index(),
                 n->tag.c_str());
-        unsigned app_replicas = n->replicas_count(pid.get_app_id());
-        unsigned total_replicas = n->replicas_count();
+        capacity_known = capacity_known && n->disk_capacity_mb > 0;
+        max_capacity_mb = std::max(max_capacity_mb, n->disk_capacity_mb);
+        max_io_bytes_per_sec = std::max(max_io_bytes_per_sec, n->recent_io_bytes_per_sec);
+        has_normal_dir = has_normal_dir || n->status == disk_status::NORMAL;
+    }
 
-        if (selected == nullptr || least_app_replicas_count > app_replicas) {
-            least_app_replicas_count = app_replicas;
-            least_total_replicas_count = total_replicas;
-            selected = n.get();
-        } else if (least_app_replicas_count == app_replicas &&
-                   least_total_replicas_count > total_replicas) {
-            least_total_replicas_count = total_replicas;
+    dir_node *selected = nullptr;
+    double least_score = 0;
+    double least_total_replicas = 0;
+    for (auto &n : _dir_nodes) {
+        if (has_normal_dir && n->status != disk_status::NORMAL) {
+            continue;
+        }
+
+        // a dir twice as large is expected to hold twice as many replicas
+        double weight =
+            capacity_known ? static_cast<double>(n->disk_capacity_mb) / max_capacity_mb : 1.0;
+        double used_ratio =
+            capacity_known
+                ? 1.0 - static_cast<double>(n->disk_available_mb) / n->disk_capacity_mb
+                : 0.0;
+        double io_ratio =
+            max_io_bytes_per_sec > 0 ? n->recent_io_bytes_per_sec / max_io_bytes_per_sec : 0.0;
+        double score = n->replicas_count(pid.get_app_id()) / weight +
+                       FLAGS_dir_allocation_space_weight * used_ratio +
+                       FLAGS_dir_allocation_load_weight * io_ratio;
+        double total_replicas = n->replicas_count() / weight;
+
+        if (selected == nullptr || least_score > score ||
+            (least_score == score && least_total_replicas > total_replicas)) {
+            least_score = score;
+            least_total_replicas = total_replicas;
             selected = n.get();
         }
     }
 
-    ddebug(
-        "%s: put pid(%d.%d) to dir(%s), which has %u replicas of current app, %u replicas totally",
-        dsn_primary_address().to_string(),
-        pid.get_app_id(),
-        pid.get_partition_index(),
-        selected->tag.c_str(),
-        least_app_replicas_count,
-        least_total_replicas_count);
+    ddebug_f("{}: put pid({}) to dir({}), which has {} replicas of current app, {} replicas "
+             "totally, available_ratio = {}%, recent_io_bytes_per_sec = {}, score = {}",
+             dsn_primary_address().to_string(),
+             pid,
+             selected->tag,
+             selected->replicas_count(pid.get_app_id()),
+             selected->replicas_count(),
+             selected->disk_available_ratio,
+             selected->recent_io_bytes_per_sec,
+             least_score);
 
     selected->holding_replicas[pid.get_app_id()].emplace(pid);
     dir = utils::filesystem::path_combine(selected->full_dir, buffer);
@@ -40,6 +40,8 @@ public:
     int64_t disk_available_mb;
     int disk_available_ratio;
     disk_status::type status;
+    // the read and write bytes per second of the replicas on this dir, updated on disk stat
+    double recent_io_bytes_per_sec;
     std::map<app_id, std::set<gpid>> holding_replicas;
     std::map<app_id, std::set<gpid>> holding_primary_replicas;
     std::map<app_id, std::set<gpid>> holding_secondary_replicas;
@@ -56,7 +58,8 @@ public:
           disk_capacity_mb(disk_capacity_mb_),
           disk_available_mb(disk_available_mb_),
           disk_available_ratio(disk_available_ratio_),
-          status(status_)
+          status(status_),
+          recent_io_bytes_per_sec(0)
     {
     }
     unsigned replicas_count(app_id id) const;
@@ -79,6 +82,9 @@ public:
                                bool for_test);
 
     dsn::error_code get_disk_tag(const std::string &dir, /*out*/ std::string &tag);
+    // Chooses the dir for a new replica, by the replicas of the app on each dir weighted by the
+    // capacity of the dir, the used space and the recent io load. The dirs short of space are
+    // chosen only if all the dirs are.
     void allocate_dir(const dsn::gpid &pid,
                       const std::string &type,
                       /*out*/ std::string &dir);
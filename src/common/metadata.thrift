@@ -93,6 +93,19 @@ struct replica_configuration
     7:optional bool       split_sync_to_child = false;
 }
 
+// The load of a replica measured on the node serving it, reported to meta server on config-sync
+// for load-aware balancing. The rates are exponentially decayed averages.
+struct replica_load_info
+{
+    1:double read_qps;
+    2:double write_qps;
+    3:double read_bytes_per_sec;
+    4:double write_bytes_per_sec;
+    5:i64    disk_usage_mb;
+    // cpu time spent on executing the requests and mutations of the replica, in cores
+    6:double cpu_share;
+}
+
 struct replica_info
 {
     1:dsn.gpid                          pid;
@@ -104,4 +117,5 @@ struct replica_info
     7:string                            app_type;
     8:string                            disk_tag;
     9:optional manual_compaction_status manual_compact_status;
+    10:optional replica_load_info       load;
 }
@@ -34,13 +34,43 @@
  */
 
 #include <dsn/dist/failure_detector.h>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/perf_counter/perf_counters.h>
 #include <dsn/tool-api/command_manager.h>
+#include <dsn/utility/flags.h>
 #include <chrono>
+#include <cmath>
 #include <ctime>
 
 namespace dsn {
 namespace fd {
 
+DSN_DEFINE_bool("replication",
+                fd_phi_accrual_enabled,
+                false,
+                "whether master extends the grace period of the jittery workers by the phi "
+                "accrual failure detection");
+DSN_DEFINE_double("replication",
+                  fd_phi_threshold,
+                  8.0,
+                  "the suspicion level to declare a worker dead, the chance of a wrong decision "
+                  "is 10^-threshold");
+DSN_DEFINE_int32("replication",
+                 fd_phi_window_size,
+                 100,
+                 "count of the recent beacon intervals to estimate the phi of a worker");
+DSN_DEFINE_uint32("replication",
+                  fd_phi_min_stddev_ms,
+                  500,
+                  "min standard deviation of the beacon intervals to estimate the phi");
+DSN_DEFINE_uint32("replication",
+                  fd_max_lease_extension_ms,
+                  10000,
+                  "max lease extension promised to a worker by the phi accrual detection");
+
+// the lease is extended only if the phi is estimated from enough samples
+static const int MIN_PHI_SAMPLE_COUNT = 3;
+
 failure_detector::failure_detector()
 {
     dsn::threadpool_code pool = task_spec::get(LPC_BEACON_CHECK.code())->pool_code;
@@ -116,16 +146,59 @@ void failure_detector::stop()
     }
     _is_started = false;
     _masters.clear();
+    for (auto &kv : _workers) {
+        remove_phi_counter(kv.second);
+    }
     _workers.clear();
 }
 
+/*static*/ uint32_t failure_detector::get_max_lease_extension_ms()
+{
+    return FLAGS_fd_phi_accrual_enabled ? FLAGS_fd_max_lease_extension_ms : 0;
+}
+
+uint32_t failure_detector::get_lease_extension_ms(const worker_record &record) const
+{
+    if (!FLAGS_fd_phi_accrual_enabled || record.estimator == nullptr ||
+        record.estimator->sample_count() < MIN_PHI_SAMPLE_COUNT) {
+        return 0;
+    }
+    uint64_t timeout = record.estimator->timeout_ms(FLAGS_fd_phi_threshold);
+    if (timeout <= _grace_milliseconds) {
+        return 0;
+    }
+    return static_cast<uint32_t>(
+        std::min<uint64_t>(timeout - _grace_milliseconds, FLAGS_fd_max_lease_extension_ms));
+}
+
+void failure_detector::update_lease_extension(worker_record &record,
+                                              uint64_t now,
+                                              /*out*/ beacon_ack &ack)
+{
+    if (!FLAGS_fd_phi_accrual_enabled) {
+        return;
+    }
+    uint32_t extension = get_lease_extension_ms(record);
+    // never move the deadline backward, the worker may hold a lease extended by a previous ack
+    record.deadline = std::max(record.deadline, now + _grace_milliseconds + extension);
+    ack.__set_lease_extension_ms(extension);
+}
+
+void failure_detector::remove_phi_counter(worker_record &record)
+{
+    if (record.phi_counter != nullptr) {
+        perf_counters::instance().remove_counter(record.phi_counter->full_name());
+        record.phi_counter = nullptr;
+    }
+}
+
 void failure_detector::register_master(::dsn::rpc_address target)
 {
     bool setup_timer = false;
 
     zauto_lock l(_lock);
 
-    master_record record(target, dsn_now_ms());
+    master_record record(target, now_ms());
 
     auto ret = _masters.insert(std::make_pair(target, record));
     if (ret.second) {
@@ -146,7 +219,7 @@ void failure_detector::register_master(::dsn::rpc_address target)
         ret.first->second.send_beacon_timer =
             tasking::enqueue_timer(LPC_BEACON_SEND,
                                    &_tracker,
-                                   [this, target]() { this->send_beacon(target, dsn_now_ms()); },
+                                   [this, target]() { this->send_beacon(target, now_ms()); },
                                    std::chrono::milliseconds(_beacon_interval_milliseconds),
                                    0,
                                    std::chrono::milliseconds(1));
@@ -174,7 +247,7 @@ bool failure_detector::switch_master(::dsn::rpc_address from,
         it->second.send_beacon_timer =
             tasking::enqueue_timer(LPC_BEACON_SEND,
                                    &_tracker,
-                                   [this, to]() { this->send_beacon(to, dsn_now_ms()); },
+                                   [this, to]() { this->send_beacon(to, now_ms()); },
                                    std::chrono::milliseconds(_beacon_interval_milliseconds),
                                    0,
                                    std::chrono::milliseconds(delay_milliseconds));
@@ -225,7 +298,7 @@ void failure_detector::check_all_records()
     {
         zauto_lock l(_lock);
 
-        uint64_t now = dsn_now_ms();
+        uint64_t now = now_ms();
 
         for (auto itr = _masters.begin(); itr != _masters.end(); itr++) {
             master_record &record = itr->second;
@@ -240,7 +313,7 @@ void failure_detector::check_all_records()
             if (record.is_alive &&
                 is_time_greater_than(now, record.last_send_time_for_beacon_with_ack) &&
                 now + _check_interval_milliseconds - record.last_send_time_for_beacon_with_ack >
-                    _lease_milliseconds) {
+                    _lease_milliseconds + record.lease_extension_ms) {
                 derror("master %s disconnected, now=%" PRId64 ", last_send_time=%" PRId64
                        ", now+check_interval-last_send_time=%" PRId64,
                        record.node.to_string(),
@@ -275,21 +348,42 @@ void failure_detector::check_all_records()
     {
         zauto_lock l(_lock);
 
-        uint64_t now = dsn_now_ms();
+        uint64_t now = now_ms();
 
         for (auto itq = _workers.begin(); itq != _workers.end(); itq++) {
             worker_record &record = itq->second;
 
+            if (FLAGS_fd_phi_accrual_enabled && record.estimator != nullptr) {
+                if (record.phi_counter == nullptr) {
+                    std::string name = fmt::format("worker_phi_x100@{}", record.node);
+                    record.phi_counter = perf_counters::instance().get_app_counter(
+                        "eon.failure_detector",
+                        name.c_str(),
+                        COUNTER_TYPE_NUMBER,
+                        "phi of the worker multiplied by 100",
+                        true);
+                }
+                double phi = is_time_greater_than(now, record.last_beacon_recv_time)
+                                 ? record.estimator->phi(now - record.last_beacon_recv_time)
+                                 : 0;
+                record.phi_counter->set(static_cast<int64_t>(std::round(phi * 100)));
+            }
+
             // we should ensure now is greater than record.last_beacon_recv_time to aviod integer
             // overflow
+            bool expired = FLAGS_fd_phi_accrual_enabled
+                               ? now > std::max(record.deadline,
+                                                record.last_beacon_recv_time + _grace_milliseconds)
+                               : now - record.last_beacon_recv_time > _grace_milliseconds;
             if (record.is_alive && is_time_greater_than(now, record.last_beacon_recv_time) &&
-                now - record.last_beacon_recv_time > _grace_milliseconds) {
+                expired) {
                 derror("worker %s disconnected, now=%" PRId64 ", last_beacon_recv_time=%" PRId64
-                       ", now-last_recv=%" PRId64,
+                       ", now-last_recv=%" PRId64 ", deadline=%" PRId64,
                        record.node.to_string(),
                        now,
                        record.last_beacon_recv_time,
-                       now - record.last_beacon_recv_time);
+                       now - record.last_beacon_recv_time,
+                       record.deadline);
 
                 expire.push_back(record.node);
                 record.is_alive = false;
@@ -363,7 +457,7 @@ void failure_detector::on_ping_internal(const beacon_msg &beacon, /*out*/ beacon
 
     zauto_lock l(_lock);
 
-    uint64_t now = dsn_now_ms();
+    uint64_t now = now_ms();
     auto node = beacon.from_addr;
 
     worker_map::iterator itr = _workers.find(node);
@@ -378,13 +472,26 @@ void failure_detector::on_ping_internal(const beacon_msg &beacon, /*out*/ beacon
         // create new entry for node
         worker_record record(node, now);
         record.is_alive = true;
-        _workers.insert(std::make_pair(node, record));
+        // the worker may still hold a lease extended by the previous master
+        record.deadline = now + _grace_milliseconds + get_max_lease_extension_ms();
+        itr = _workers.insert(std::make_pair(node, record)).first;
+        update_lease_extension(itr->second, now, ack);
 
         report(node, false, true);
         on_worker_connected(node);
     } else if (is_time_greater_than(now, itr->second.last_beacon_recv_time)) {
+        // the interval is meaningless if the worker has been disconnected
+        if (FLAGS_fd_phi_accrual_enabled && itr->second.is_alive) {
+            if (itr->second.estimator == nullptr) {
+                itr->second.estimator = std::make_shared<phi_accrual_estimator>(
+                    FLAGS_fd_phi_window_size, FLAGS_fd_phi_min_stddev_ms);
+            }
+            itr->second.estimator->add_interval(now - itr->second.last_beacon_recv_time);
+        }
+
         // update last_beacon_recv_time
         itr->second.last_beacon_recv_time = now;
+        update_lease_extension(itr->second, now, ack);
 
         ddebug("master %s update last_beacon_recv_time=%" PRId64,
                itr->second.node.to_string(),
@@ -476,15 +583,22 @@ bool failure_detector::end_ping_internal(::dsn::error_code err, const beacon_ack
     // update last_send_time_for_beacon_with_ack
     record.last_send_time_for_beacon_with_ack = beacon_send_time;
     record.rejected = false;
+    // master promises not to declare this node dead before the extended lease expires
+    record.lease_extension_ms =
+        ack.__isset.lease_extension_ms
+            ? static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(ack.lease_extension_ms, 0),
+                                                      FLAGS_fd_max_lease_extension_ms))
+            : 0;
 
     ddebug("worker %s send beacon succeed, update last_send_time=%" PRId64,
            record.node.to_string(),
            record.last_send_time_for_beacon_with_ack);
 
-    uint64_t now = dsn_now_ms();
+    uint64_t now = now_ms();
     // we should ensure now is greater than record.last_beacon_recv_time to aviod integer overflow
     if (!record.is_alive && is_time_greater_than(now, record.last_send_time_for_beacon_with_ack) &&
-        now - record.last_send_time_for_beacon_with_ack <= _lease_milliseconds) {
+        now - record.last_send_time_for_beacon_with_ack <=
+            _lease_milliseconds + record.lease_extension_ms) {
         // report master connected
         report(node, true, true);
         itr->second.is_alive = true;
@@ -525,8 +639,11 @@ void failure_detector::register_worker(::dsn::rpc_address target, bool is_connec
     /*
      * callers should use the fd::_lock necessarily
      */
-    worker_record record(target, dsn_now_ms());
+    uint64_t now = now_ms();
+    worker_record record(target, now);
     record.is_alive = is_connected ? true : false;
+    // the worker may still hold a lease extended by the previous master
+    record.deadline = now + _grace_milliseconds + get_max_lease_extension_ms();
 
     auto ret = _workers.insert(std::make_pair(target, record));
     if (ret.second) {
@@ -543,6 +660,10 @@ bool failure_detector::unregister_worker(::dsn::rpc_address node)
      */
     bool ret;
 
+    auto it = _workers.find(node);
+    if (it != _workers.end()) {
+        remove_phi_counter(it->second);
+    }
     size_t count = _workers.erase(node);
 
     if (count == 0) {
@@ -561,6 +682,9 @@ bool failure_detector::unregister_worker(::dsn::rpc_address node)
 void failure_detector::clear_workers()
 {
     zauto_lock l(_lock);
+    for (auto &kv : _workers) {
+        remove_phi_counter(kv.second);
+    }
     _workers.clear();
 }
 
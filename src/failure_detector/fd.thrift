@@ -43,6 +43,9 @@ struct beacon_ack
     3: dsn.rpc_address primary_node;
     4: bool is_master;
     5: bool allowed;
+    // the master promises not to declare the worker dead until the lease of the worker,
+    // extended by this, expires
+    6: optional i64 lease_extension_ms;
 }
 
 struct config_master_message
@@ -0,0 +1,94 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/dist/failure_detector/phi_accrual_estimator.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace dsn {
+namespace fd {
+
+// phi of a beacon which will never arrive, i.e. the probability underflows
+static const double MAX_PHI = 300.0;
+
+phi_accrual_estimator::phi_accrual_estimator(int window_size, uint32_t min_stddev_ms)
+    : _window_size(std::max(1, window_size)),
+      _min_stddev_ms(std::max(1u, min_stddev_ms)),
+      _sum(0),
+      _square_sum(0)
+{
+}
+
+void phi_accrual_estimator::add_interval(uint64_t interval_ms)
+{
+    double v = static_cast<double>(interval_ms);
+    _intervals.push_back(interval_ms);
+    _sum += v;
+    _square_sum += v * v;
+    if (static_cast<int>(_intervals.size()) > _window_size) {
+        double old = static_cast<double>(_intervals.front());
+        _intervals.pop_front();
+        _sum -= old;
+        _square_sum -= old * old;
+    }
+}
+
+double phi_accrual_estimator::mean() const
+{
+    return _intervals.empty() ? 0 : _sum / _intervals.size();
+}
+
+double phi_accrual_estimator::stddev() const
+{
+    double m = mean();
+    double variance = _intervals.empty() ? 0 : _square_sum / _intervals.size() - m * m;
+    return std::max(static_cast<double>(_min_stddev_ms), std::sqrt(std::max(0.0, variance)));
+}
+
+double phi_accrual_estimator::phi(uint64_t elapsed_ms) const
+{
+    if (_intervals.empty()) {
+        return 0;
+    }
+    double y = (static_cast<double>(elapsed_ms) - mean()) / stddev();
+    double p_later = 0.5 * std::erfc(y / std::sqrt(2.0));
+    if (p_later <= 0) {
+        return MAX_PHI;
+    }
+    return std::min(MAX_PHI, -std::log10(p_later));
+}
+
+uint64_t phi_accrual_estimator::timeout_ms(double threshold) const
+{
+    // phi is monotonic on the elapsed time, search the crossing point in
+    // [mean, mean + 40 * stddev], within which phi grows far beyond any sane threshold
+    uint64_t low = static_cast<uint64_t>(mean());
+    uint64_t high = low + static_cast<uint64_t>(40 * stddev());
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (phi(mid) >= threshold) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+} // namespace fd
+} // namespace dsn
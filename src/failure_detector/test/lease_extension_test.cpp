@@ -0,0 +1,198 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/dist/failure_detector.h>
+#include <dsn/utility/flags.h>
+
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace fd {
+
+DSN_DECLARE_bool(fd_phi_accrual_enabled);
+DSN_DECLARE_uint32(fd_max_lease_extension_ms);
+
+// A failure detector driven by a manual clock, which never sends beacons by itself.
+class manual_clock_fd : public failure_detector
+{
+public:
+    void on_master_disconnected(const std::vector<rpc_address> &nodes) override {}
+    void on_master_connected(rpc_address node) override {}
+    void on_worker_disconnected(const std::vector<rpc_address> &nodes) override
+    {
+        disconnected_workers += static_cast<int>(nodes.size());
+    }
+    void on_worker_connected(rpc_address node) override {}
+
+    uint64_t now_ms() const override { return now; }
+
+    uint64_t now{0};
+    int disconnected_workers{0};
+
+protected:
+    void send_beacon(rpc_address node, uint64_t time) override {}
+};
+
+class failure_detector_lease_test : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        _phi_accrual_enabled = FLAGS_fd_phi_accrual_enabled;
+        FLAGS_fd_phi_accrual_enabled = true;
+
+        // as started by failure_detector::start(), but without the timers
+        _fd._check_interval_milliseconds = CHECK_INTERVAL_MS;
+        _fd._beacon_interval_milliseconds = 1000;
+        _fd._beacon_timeout_milliseconds = 666;
+        _fd._lease_milliseconds = LEASE_MS;
+        _fd._grace_milliseconds = GRACE_MS;
+        _fd._use_allow_list = false;
+        _fd._is_started = true;
+    }
+
+    void TearDown() override
+    {
+        _fd.stop();
+        FLAGS_fd_phi_accrual_enabled = _phi_accrual_enabled;
+    }
+
+    // master receives a beacon from the worker, returns the lease extension promised in the ack
+    int64_t recv_beacon(uint64_t now)
+    {
+        _fd.now = now;
+        beacon_msg beacon;
+        beacon.time = now;
+        beacon.from_addr = WORKER;
+        beacon.to_addr = MASTER;
+        beacon_ack ack;
+        _fd.on_ping_internal(beacon, ack);
+        return ack.lease_extension_ms;
+    }
+
+    // worker receives the ack of the beacon sent at `send_time`
+    void recv_ack(uint64_t send_time, uint64_t now, int64_t lease_extension_ms)
+    {
+        _fd.now = now;
+        beacon_ack ack;
+        ack.time = send_time;
+        ack.this_node = MASTER;
+        ack.primary_node = MASTER;
+        ack.is_master = true;
+        ack.allowed = true;
+        ack.__set_lease_extension_ms(lease_extension_ms);
+        zauto_lock l(_fd._lock);
+        ASSERT_TRUE(_fd.end_ping_internal(ERR_OK, ack));
+    }
+
+    bool worker_connected_at(uint64_t now)
+    {
+        _fd.now = now;
+        _fd.check_all_records();
+        return _fd.is_worker_connected(WORKER);
+    }
+
+    bool master_connected_at(uint64_t now)
+    {
+        _fd.now = now;
+        _fd.check_all_records();
+        return _fd.is_master_connected(MASTER);
+    }
+
+    static const uint64_t CHECK_INTERVAL_MS = 1000;
+    static const uint64_t LEASE_MS = 4000;
+    static const uint64_t GRACE_MS = 5000;
+    const rpc_address MASTER{"127.0.0.1", 34601};
+    const rpc_address WORKER{"127.0.0.1", 34801};
+
+    manual_clock_fd _fd;
+    bool _phi_accrual_enabled;
+};
+
+TEST_F(failure_detector_lease_test, worker_lease_extended)
+{
+    uint64_t now = 100000;
+    ASSERT_EQ(0, recv_beacon(now));
+
+    // mostly every second, but every 5th beacon is delayed by a long gc pause
+    int64_t extension = 0;
+    for (int i = 1; i <= 30; ++i) {
+        now += i % 5 == 0 ? 6000 : 1000;
+        extension = recv_beacon(now);
+    }
+    ASSERT_GT(extension, 0);
+    ASSERT_LE(extension, static_cast<int64_t>(FLAGS_fd_max_lease_extension_ms));
+
+    // the worker is tolerated longer than the grace period, until the promised deadline
+    ASSERT_TRUE(worker_connected_at(now + GRACE_MS + 1));
+    ASSERT_TRUE(worker_connected_at(now + GRACE_MS + extension));
+    ASSERT_EQ(0, _fd.disconnected_workers);
+    ASSERT_FALSE(worker_connected_at(now + GRACE_MS + extension + 1));
+    ASSERT_EQ(1, _fd.disconnected_workers);
+}
+
+TEST_F(failure_detector_lease_test, worker_lease_expired)
+{
+    // the first beacon covers the max extension the previous master may have promised
+    uint64_t now = 100000;
+    ASSERT_EQ(0, recv_beacon(now));
+    ASSERT_TRUE(worker_connected_at(now + GRACE_MS + FLAGS_fd_max_lease_extension_ms));
+
+    // the regular beacons need no extension
+    for (int i = 1; i <= 30; ++i) {
+        now += 1000;
+        ASSERT_EQ(0, recv_beacon(now));
+    }
+    ASSERT_TRUE(worker_connected_at(now + GRACE_MS));
+    ASSERT_FALSE(worker_connected_at(now + GRACE_MS + 1));
+    ASSERT_EQ(1, _fd.disconnected_workers);
+
+    // the lease isn't extended with phi accrual disabled
+    FLAGS_fd_phi_accrual_enabled = false;
+    now += GRACE_MS + 1;
+    ASSERT_EQ(0, recv_beacon(now));
+    ASSERT_TRUE(worker_connected_at(now + GRACE_MS));
+    ASSERT_FALSE(worker_connected_at(now + GRACE_MS + 1));
+}
+
+TEST_F(failure_detector_lease_test, master_lease_extended)
+{
+    uint64_t now = 100000;
+    _fd.now = now;
+    _fd.register_master(MASTER);
+
+    // the lease of the worker starts when the beacon is sent
+    uint64_t send_time = now + 1000;
+    recv_ack(send_time, send_time + 10, 3000);
+    ASSERT_TRUE(master_connected_at(send_time + 10));
+
+    // the records are checked once per check interval, so the lease expires one interval early
+    uint64_t expire_time = send_time + LEASE_MS + 3000 - CHECK_INTERVAL_MS;
+    ASSERT_TRUE(master_connected_at(expire_time));
+    ASSERT_FALSE(master_connected_at(expire_time + 1));
+
+    // a larger extension than the max is never trusted
+    send_time = expire_time + 1000;
+    recv_ack(send_time, send_time + 10, 1000000);
+    ASSERT_TRUE(master_connected_at(send_time + 10));
+    expire_time = send_time + LEASE_MS + FLAGS_fd_max_lease_extension_ms - CHECK_INTERVAL_MS;
+    ASSERT_TRUE(master_connected_at(expire_time));
+    ASSERT_FALSE(master_connected_at(expire_time + 1));
+}
+
+} // namespace fd
+} // namespace dsn
@@ -0,0 +1,60 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/dist/failure_detector/phi_accrual_estimator.h>
+
+#include <gtest/gtest.h>
+
+using namespace dsn::fd;
+
+TEST(phi_accrual_estimator, phi)
+{
+    phi_accrual_estimator estimator(4, 100);
+    ASSERT_EQ(0, estimator.phi(100000));
+
+    for (int i = 0; i < 10; ++i) {
+        estimator.add_interval(1000);
+    }
+    // only the recent intervals are kept
+    ASSERT_EQ(4, estimator.sample_count());
+    ASSERT_DOUBLE_EQ(1000, estimator.mean());
+    // the stddev is bounded by the min
+    ASSERT_DOUBLE_EQ(100, estimator.stddev());
+
+    // half of the beacons arrive later than the mean
+    ASSERT_NEAR(0.301, estimator.phi(1000), 0.001);
+    ASSERT_LT(estimator.phi(1000), estimator.phi(1200));
+    ASSERT_LT(estimator.phi(1200), estimator.phi(1500));
+    ASSERT_DOUBLE_EQ(300, estimator.phi(1000000));
+
+    uint64_t timeout = estimator.timeout_ms(8);
+    ASSERT_GE(estimator.phi(timeout), 8);
+    ASSERT_LT(estimator.phi(timeout - 1), 8);
+}
+
+TEST(phi_accrual_estimator, jitter_tolerance)
+{
+    phi_accrual_estimator regular(100, 100);
+    phi_accrual_estimator jittery(100, 100);
+    for (int i = 0; i < 100; ++i) {
+        regular.add_interval(3000);
+        jittery.add_interval(i % 10 == 0 ? 9000 : 2500);
+    }
+    ASSERT_GT(jittery.stddev(), regular.stddev());
+    // a jittery node is suspected much later than a regular one
+    ASSERT_GT(jittery.timeout_ms(8), regular.timeout_ms(8) + 5000);
+}
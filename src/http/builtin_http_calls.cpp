@@ -92,6 +92,20 @@ namespace dsn {
         })
         .with_help("Gets the value of a perf counter");
 
+    register_http_call("perfCounters")
+        .with_async_callback([](const http_request &req, http_response_writer_ptr writer) {
+            list_perf_counters_handler(req, std::move(writer));
+        })
+        .with_help("Lists the values of all the perf counters, or those with the name prefix "
+                   "specified by ?prefix=<prefix>");
+
+    register_http_call("traceEvents")
+        .with_async_callback([](const http_request &req, http_response_writer_ptr writer) {
+            get_trace_events_handler(req, std::move(writer));
+        })
+        .with_help("Dumps the recent events recorded by the event_recorder toollet in the Chrome "
+                   "trace event format, during the last seconds specified by ?seconds=<seconds>");
+
     register_http_call("updateConfig")
         .with_callback(
             [](const http_request &req, http_response &resp) { update_config(req, resp); })
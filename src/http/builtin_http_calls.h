@@ -28,6 +28,15 @@ extern void register_builtin_http_calls();
 
 extern void get_perf_counter_handler(const http_request &req, http_response &resp);
 
+// Get <ipport>/perfCounters?prefix=<prefix>
+// Streams the values of all the perf counters (with the name prefix) as a json array.
+extern void list_perf_counters_handler(const http_request &req, http_response_writer_ptr writer);
+
+// Get <ipport>/traceEvents?seconds=<seconds>
+// Dumps the events recorded by the event_recorder toollet during the last seconds (5 by default)
+// in the Chrome trace event format.
+extern void get_trace_events_handler(const http_request &req, http_response_writer_ptr writer);
+
 extern void get_help_handler(const http_request &req, http_response &resp);
 
 // Get <meta_server_ipport>/version
@@ -0,0 +1,253 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "chunked_response_writer.h"
+
+#include <cstring>
+
+#include <dsn/c/api_layer1.h>
+#include <dsn/cpp/rpc_stream.h>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/tool-api/async_calls.h>
+#include <dsn/tool-api/network.h>
+#include <boost/algorithm/string.hpp>
+
+namespace dsn {
+
+DSN_DEFINE_uint32("http",
+                  http_response_chunk_size_kb,
+                  64,
+                  "size of the chunks of the streaming http responses, before compression");
+DSN_DEFINE_int32("http",
+                 http_stream_max_pending_chunks,
+                 16,
+                 "a streaming http response holds off producing once this many chunks are "
+                 "waiting to be sent to the client");
+DSN_DEFINE_uint32("http",
+                  http_stream_stall_timeout_seconds,
+                  60,
+                  "a streaming http response is abandoned if the client doesn't read for this "
+                  "long");
+DSN_DEFINE_bool("http",
+                enable_http_gzip,
+                true,
+                "whether to gzip the streaming http responses if the client accepts it");
+
+DEFINE_TASK_CODE(LPC_HTTP_STREAM_BODY, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+chunked_response_writer::chunked_response_writer(message_ex *req, bool gzip)
+    : _request(req), _gzip(gzip && FLAGS_enable_http_gzip)
+{
+    if (_gzip) {
+        memset(&_zstream, 0, sizeof(_zstream));
+        // 16 + MAX_WBITS: with gzip header and trailer
+        int ret = deflateInit2(
+            &_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        dassert_f(ret == Z_OK, "deflateInit2 failed: {}", ret);
+    }
+}
+
+chunked_response_writer::~chunked_response_writer()
+{
+    // the body isn't complete, never let the client take it as a complete one
+    if (!_finished) {
+        cancel();
+    }
+    if (_gzip) {
+        deflateEnd(&_zstream);
+    }
+}
+
+/*static*/ bool chunked_response_writer::accepts_gzip(const std::string &accept_encoding)
+{
+    std::vector<std::string> codings;
+    boost::split(codings, accept_encoding, boost::is_any_of(","));
+    for (auto &coding : codings) {
+        std::vector<std::string> params;
+        boost::split(params, coding, boost::is_any_of(";"));
+        boost::trim(params[0]);
+        if (!boost::iequals(params[0], "gzip")) {
+            continue;
+        }
+        // "gzip;q=0" means not acceptable
+        for (size_t i = 1; i < params.size(); ++i) {
+            std::string param = boost::erase_all_copy(params[i], " ");
+            if (param == "q=0" || param == "q=0.0" || param == "q=0.00" || param == "q=0.000") {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void chunked_response_writer::begin(http_status_code code, const std::string &content_type)
+{
+    dassert(!_began, "the response has begun");
+    _began = true;
+
+    std::string header = fmt::format("HTTP/1.1 {}\r\nContent-Type: {}\r\n"
+                                     "Transfer-Encoding: chunked\r\n",
+                                     http_status_code_to_string(code),
+                                     content_type);
+    if (_gzip) {
+        header += "Content-Encoding: gzip\r\n";
+    }
+    header += "\r\n";
+    send(header);
+}
+
+void chunked_response_writer::write(const char *data, size_t length)
+{
+    dassert(_began && !_finished, "write to a response not begun or finished");
+    if (length == 0) {
+        return;
+    }
+
+    if (_gzip) {
+        compress(data, length, Z_NO_FLUSH);
+    } else {
+        _buffer.append(data, length);
+    }
+    if (_buffer.size() >= FLAGS_http_response_chunk_size_kb * 1024) {
+        flush_chunk();
+    }
+}
+
+void chunked_response_writer::finish()
+{
+    dassert(!_finished, "the response has finished");
+    if (!_began) {
+        begin(http_status_code::ok, "text/plain");
+    }
+    _finished = true;
+
+    if (_gzip) {
+        compress(nullptr, 0, Z_FINISH);
+    }
+    flush_chunk();
+    send("0\r\n\r\n");
+    _request = nullptr;
+}
+
+void chunked_response_writer::cancel()
+{
+    dassert(!_finished, "the response has finished");
+    _finished = true;
+
+    // without the last chunk, the client takes the body as truncated once the session is closed
+    if (_request != nullptr && _request->io_session != nullptr) {
+        _request->io_session->close();
+    }
+    _request = nullptr;
+}
+
+bool chunked_response_writer::writable() const
+{
+    if (_request == nullptr || _request->io_session == nullptr) {
+        return true;
+    }
+    return _request->io_session->pending_send_count() < FLAGS_http_stream_max_pending_chunks;
+}
+
+bool chunked_response_writer::aborted() const
+{
+    return _request != nullptr && _request->io_session != nullptr &&
+           _request->io_session->is_disconnected();
+}
+
+void chunked_response_writer::send(const std::string &data)
+{
+    message_ptr resp_msg = _request->create_response();
+    rpc_write_stream writer(resp_msg.get());
+    writer.write(data.data(), data.length());
+    writer.flush();
+    dsn_rpc_reply(resp_msg.get());
+}
+
+void chunked_response_writer::compress(const char *data, size_t length, int flush)
+{
+    char out[16 * 1024];
+    _zstream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    _zstream.avail_in = static_cast<uInt>(length);
+    do {
+        _zstream.next_out = reinterpret_cast<Bytef *>(out);
+        _zstream.avail_out = sizeof(out);
+        int ret = deflate(&_zstream, flush);
+        dassert_f(ret != Z_STREAM_ERROR, "deflate failed: {}", ret);
+        _buffer.append(out, sizeof(out) - _zstream.avail_out);
+    } while (_zstream.avail_out == 0);
+}
+
+void chunked_response_writer::flush_chunk()
+{
+    if (_buffer.empty()) {
+        return;
+    }
+    // a zero-sized chunk ends the body, so never send an empty one here
+    std::string chunk = fmt::format("{:x}\r\n", _buffer.size());
+    chunk.append(_buffer);
+    chunk.append("\r\n");
+    _buffer.clear();
+    send(chunk);
+}
+
+static void pump_http_body(http_response_writer_ptr writer,
+                           std::shared_ptr<http_body_producer> producer,
+                           uint64_t stall_start_ms)
+{
+    if (writer->aborted()) {
+        dwarn_f("client of the streaming http response is gone, abandon it");
+        writer->cancel();
+        return;
+    }
+
+    if (!writer->writable()) {
+        uint64_t now_ms = dsn_now_ms();
+        if (stall_start_ms == 0) {
+            stall_start_ms = now_ms;
+        } else if (now_ms - stall_start_ms > FLAGS_http_stream_stall_timeout_seconds * 1000) {
+            dwarn_f("client of the streaming http response stalls for {} ms, abandon it",
+                    now_ms - stall_start_ms);
+            writer->cancel();
+            return;
+        }
+        tasking::enqueue(LPC_HTTP_STREAM_BODY,
+                         nullptr,
+                         [writer, producer, stall_start_ms]() {
+                             pump_http_body(writer, producer, stall_start_ms);
+                         },
+                         0,
+                         std::chrono::milliseconds(10));
+        return;
+    }
+
+    if ((*producer)(*writer)) {
+        tasking::enqueue(LPC_HTTP_STREAM_BODY, nullptr, [writer, producer]() {
+            pump_http_body(writer, producer, 0);
+        });
+    } else {
+        writer->finish();
+    }
+}
+
+/*extern*/ void stream_http_body(http_response_writer_ptr writer, http_body_producer producer)
+{
+    pump_http_body(std::move(writer), std::make_shared<http_body_producer>(std::move(producer)), 0);
+}
+
+} // namespace dsn
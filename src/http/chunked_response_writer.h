@@ -0,0 +1,64 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <zlib.h>
+
+#include <dsn/http/http_server.h>
+#include <dsn/tool-api/rpc_message.h>
+
+namespace dsn {
+
+// Writes the response with chunked transfer encoding. Each chunk is replied as a standalone
+// rpc response on the session of the request, the session sends them in order.
+class chunked_response_writer : public http_response_writer
+{
+public:
+    // `req` may be nullptr in tests which override send().
+    chunked_response_writer(message_ex *req, bool gzip);
+    // Cancels the response if it's not finished.
+    ~chunked_response_writer() override;
+
+    void begin(http_status_code code, const std::string &content_type) override;
+    void write(const char *data, size_t length) override;
+    using http_response_writer::write;
+    void finish() override;
+    void cancel() override;
+    bool writable() const override;
+    bool aborted() const override;
+
+    // Whether the "Accept-Encoding" header allows gzip.
+    static bool accepts_gzip(const std::string &accept_encoding);
+
+protected:
+    virtual void send(const std::string &data);
+
+private:
+    void compress(const char *data, size_t length, int flush);
+    void flush_chunk();
+
+    message_ptr _request;
+    const bool _gzip;
+    z_stream _zstream;
+
+    bool _began{false};
+    bool _finished{false};
+    std::string _buffer;
+};
+
+} // namespace dsn
@@ -33,6 +33,7 @@
 #include <dsn/c/api_layer1.h>
 #include <dsn/http/http_server.h>
 #include <iomanip>
+#include <strings.h>
 
 namespace dsn {
 
@@ -99,6 +100,9 @@ http_message_parser::http_message_parser()
         msg_parser->_stage = HTTP_ON_HEADER_FIELD;
         if (strncmp(at, "Content-Type", length) == 0) {
             msg_parser->_is_field_content_type = true;
+        } else if (length == strlen("Accept-Encoding") &&
+                   strncasecmp(at, "Accept-Encoding", length) == 0) {
+            msg_parser->_is_field_accept_encoding = true;
         }
         return 0;
     };
@@ -112,6 +116,11 @@ http_message_parser::http_message_parser()
             // msg->buffers[3] = content-type
             msg->buffers[3] = blob::create_from_bytes(at, length);
             msg_parser->_is_field_content_type = false;
+        } else if (msg_parser->_is_field_accept_encoding) {
+            auto &msg = msg_parser->_current_message;
+            // msg->buffers[4] = accept-encoding
+            msg->buffers[4] = blob::create_from_bytes(at, length);
+            msg_parser->_is_field_accept_encoding = false;
         }
         return 0;
     };
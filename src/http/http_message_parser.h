@@ -39,7 +39,7 @@ namespace dsn {
 DEFINE_CUSTOMIZED_ID(network_header_format, NET_HDR_HTTP)
 
 // Number of blobs that a message_ex contains.
-#define HTTP_MSG_BUFFERS_NUM 4
+#define HTTP_MSG_BUFFERS_NUM 5
 
 // Incoming HTTP requests will be parsed into:
 //
@@ -51,6 +51,7 @@ DEFINE_CUSTOMIZED_ID(network_header_format, NET_HDR_HTTP)
 //    msg->buffers[1] = body
 //    msg->buffers[2] = url
 //    msg->buffers[3] = content-type
+//    msg->buffers[4] = accept-encoding
 //
 
 enum http_parser_stage
@@ -95,6 +96,7 @@ private:
     http_parser _parser;
 
     bool _is_field_content_type{false};
+    bool _is_field_accept_encoding{false};
     std::unique_ptr<message_ex> _current_message;
     http_parser_stage _stage{HTTP_INVALID};
     std::string _url;
@@ -27,6 +27,7 @@
 #include "uri_decoder.h"
 #include "http_call_registry.h"
 #include "http_server_impl.h"
+#include "chunked_response_writer.h"
 
 namespace dsn {
 
@@ -80,6 +81,23 @@ void http_service::register_handler(std::string path, http_callback cb, std::str
     http_call_registry::instance().add(std::move(call));
 }
 
+void http_service::register_async_handler(std::string path,
+                                          http_async_callback cb,
+                                          std::string help)
+{
+    if (!FLAGS_enable_http_server) {
+        return;
+    }
+    auto call = make_unique<http_call>();
+    call->path = this->path();
+    if (!path.empty()) {
+        call->path += "/" + std::move(path);
+    }
+    call->async_callback = std::move(cb);
+    call->help = std::move(help);
+    http_call_registry::instance().add(std::move(call));
+}
+
 http_server::http_server() : serverlet<http_server>("http_server")
 {
     if (!FLAGS_enable_http_server) {
@@ -104,6 +122,12 @@ void http_server::serve(message_ex *msg)
     } else {
         const http_request &req = res.get_value();
         std::shared_ptr<http_call> call = http_call_registry::instance().find(req.path);
+        if (call != nullptr && call->async_callback) {
+            // the writer holds the request until the response is done
+            bool gzip = chunked_response_writer::accepts_gzip(req.accept_encoding);
+            call->async_callback(req, std::make_shared<chunked_response_writer>(msg, gzip));
+            return;
+        }
         if (call != nullptr) {
             call->callback(req, resp);
         } else {
@@ -126,6 +150,7 @@ void http_server::serve(message_ex *msg)
     ret.body = m->buffers[1];
     ret.full_url = m->buffers[2];
     ret.method = static_cast<http_method>(m->header->hdr_type);
+    ret.accept_encoding = m->buffers[4].to_string();
 
     http_parser_url u{0};
     http_parser_parse_url(ret.full_url.data(), ret.full_url.length(), false, &u);
@@ -15,7 +15,12 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include <dsn/utility/output_utils.h>
+#include <fmt/format.h>
 #include "builtin_http_calls.h"
 
 namespace dsn {
@@ -54,4 +59,103 @@ void get_perf_counter_handler(const http_request &req, http_response &resp)
     resp.body = out.str();
     resp.status_code = http_status_code::ok;
 }
+
+// count of the counters serialized in one step of the streaming response
+static const size_t COUNTERS_PER_STEP = 256;
+
+static void append_json_string(std::string &out, const char *str)
+{
+    out += '"';
+    for (const char *p = str; *p != '\0'; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c < 0x20) {
+            out += fmt::format("\\u{:04x}", c);
+            continue;
+        }
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += *p;
+    }
+    out += '"';
+}
+
+// NaN and infinity are not valid json numbers, they are written as null
+static void append_json_number(std::string &out, double value)
+{
+    if (std::isfinite(value)) {
+        out += fmt::format("{:.2f}", value);
+    } else {
+        out += "null";
+    }
+}
+
+static void append_counter_json(std::string &out, perf_counter &counter)
+{
+    out += "{\"name\":";
+    append_json_string(out, counter.full_name());
+    out += ",\"type\":";
+    append_json_string(out, dsn_counter_type_to_string(counter.type()));
+    if (COUNTER_TYPE_NUMBER_PERCENTILES == counter.type()) {
+        out += ",\"p99\":";
+        append_json_number(out, counter.get_percentile(COUNTER_PERCENTILE_99));
+        out += ",\"p999\":";
+        append_json_number(out, counter.get_percentile(COUNTER_PERCENTILE_999));
+    } else {
+        out += ",\"value\":";
+        append_json_number(out, counter.get_value());
+    }
+    out += '}';
+}
+
+void list_perf_counters_handler(const http_request &req, http_response_writer_ptr writer)
+{
+    std::string prefix;
+    for (const auto &p : req.query_args) {
+        if ("prefix" == p.first) {
+            prefix = p.second;
+        } else {
+            writer->begin(http_status_code::bad_request, "text/plain");
+            writer->write(fmt::format("invalid argument: {}", p.first));
+            writer->finish();
+            return;
+        }
+    }
+
+    // only the references are collected here, the counters are serialized step by step as the
+    // client reads, so the dump is never built in memory as a whole
+    auto counters = std::make_shared<std::vector<perf_counter_ptr>>();
+    perf_counters::instance().get_all_counters(counters.get());
+    if (!prefix.empty()) {
+        counters->erase(std::remove_if(counters->begin(),
+                                       counters->end(),
+                                       [&prefix](const perf_counter_ptr &c) {
+                                           return strncmp(c->full_name(),
+                                                          prefix.data(),
+                                                          prefix.size()) != 0;
+                                       }),
+                        counters->end());
+    }
+
+    writer->begin(http_status_code::ok, "application/json");
+    writer->write("[");
+    size_t next = 0;
+    stream_http_body(writer, [counters, next](http_response_writer &w) mutable {
+        size_t end = std::min(next + COUNTERS_PER_STEP, counters->size());
+        std::string out;
+        for (; next < end; ++next) {
+            if (next > 0) {
+                out += ',';
+            }
+            append_counter_json(out, *(*counters)[next]);
+        }
+        if (next == counters->size()) {
+            out += "]\n";
+            w.write(out);
+            return false;
+        }
+        w.write(out);
+        return true;
+    });
+}
 } // namespace dsn
@@ -0,0 +1,205 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+
+#include "http/chunked_response_writer.h"
+
+namespace dsn {
+
+DSN_DECLARE_uint32(http_response_chunk_size_kb);
+
+class mock_response_writer : public chunked_response_writer
+{
+public:
+    explicit mock_response_writer(bool gzip) : chunked_response_writer(nullptr, gzip) {}
+
+    bool aborted() const override { return client_gone; }
+
+    void cancel() override
+    {
+        chunked_response_writer::cancel();
+        cancelled = true;
+    }
+
+    std::vector<std::string> sent;
+    bool client_gone{false};
+    bool cancelled{false};
+
+protected:
+    void send(const std::string &data) override { sent.push_back(data); }
+};
+
+// Decodes the chunked body, returns the count of the chunks.
+static int decode_chunked(const std::vector<std::string> &sent, std::string &body)
+{
+    body.clear();
+    int chunks = 0;
+    for (size_t i = 1; i < sent.size(); ++i) {
+        const std::string &chunk = sent[i];
+        size_t pos = chunk.find("\r\n");
+        EXPECT_NE(std::string::npos, pos);
+        size_t size = std::stoul(chunk.substr(0, pos), nullptr, 16);
+        EXPECT_EQ(chunk.size(), pos + 2 + size + 2);
+        body += chunk.substr(pos + 2, size);
+        if (size > 0) {
+            ++chunks;
+        }
+    }
+    EXPECT_EQ("0\r\n\r\n", sent.back());
+    return chunks;
+}
+
+static std::string gunzip(const std::string &data)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    EXPECT_EQ(Z_OK, inflateInit2(&zs, 16 + MAX_WBITS));
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+
+    std::string out;
+    char buf[4096];
+    int ret;
+    do {
+        zs.next_out = reinterpret_cast<Bytef *>(buf);
+        zs.avail_out = sizeof(buf);
+        ret = inflate(&zs, Z_NO_FLUSH);
+        EXPECT_TRUE(ret == Z_OK || ret == Z_STREAM_END) << ret;
+        out.append(buf, sizeof(buf) - zs.avail_out);
+    } while (ret == Z_OK);
+    inflateEnd(&zs);
+    return out;
+}
+
+TEST(chunked_response_writer_test, chunked)
+{
+    FLAGS_http_response_chunk_size_kb = 1;
+
+    mock_response_writer writer(false);
+    writer.begin(http_status_code::ok, "application/json");
+    std::string expected;
+    for (int i = 0; i < 50; ++i) {
+        std::string piece(100, 'a' + i % 26);
+        writer.write(piece);
+        expected += piece;
+    }
+    writer.finish();
+
+    ASSERT_EQ("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+              "Transfer-Encoding: chunked\r\n\r\n",
+              writer.sent[0]);
+    std::string body;
+    // 5000 bytes in chunks of 1100, 1100, 1100, 1100 and 600 bytes
+    ASSERT_EQ(5, decode_chunked(writer.sent, body));
+    ASSERT_EQ(expected, body);
+
+    FLAGS_http_response_chunk_size_kb = 64;
+}
+
+TEST(chunked_response_writer_test, gzip)
+{
+    mock_response_writer writer(true);
+    writer.begin(http_status_code::ok, "text/plain");
+    std::string expected;
+    for (int i = 0; i < 10000; ++i) {
+        std::string line = "counter_" + std::to_string(i) + "\n";
+        writer.write(line);
+        expected += line;
+    }
+    writer.finish();
+
+    ASSERT_NE(std::string::npos, writer.sent[0].find("Content-Encoding: gzip\r\n"));
+    std::string body;
+    decode_chunked(writer.sent, body);
+    ASSERT_LT(body.size(), expected.size());
+    ASSERT_EQ(expected, gunzip(body));
+}
+
+TEST(chunked_response_writer_test, finish_without_begin)
+{
+    mock_response_writer writer(false);
+    writer.finish();
+    ASSERT_EQ(2, writer.sent.size());
+    ASSERT_EQ(0, writer.sent[0].find("HTTP/1.1 200 OK\r\n"));
+    ASSERT_EQ("0\r\n\r\n", writer.sent[1]);
+}
+
+TEST(chunked_response_writer_test, cancel_midway)
+{
+    FLAGS_http_response_chunk_size_kb = 1;
+
+    auto writer = std::make_shared<mock_response_writer>(false);
+    writer->begin(http_status_code::ok, "text/plain");
+    writer->write(std::string(2000, 'a'));
+    ASSERT_EQ(2, writer->sent.size());
+
+    // the client is gone before the body is done, the producer is never called again
+    writer->client_gone = true;
+    bool produced = false;
+    stream_http_body(writer, [&produced](http_response_writer &) {
+        produced = true;
+        return false;
+    });
+    ASSERT_FALSE(produced);
+    ASSERT_TRUE(writer->cancelled);
+
+    // the body isn't terminated, nor is the buffered data sent
+    ASSERT_EQ(2, writer->sent.size());
+    for (const auto &data : writer->sent) {
+        ASSERT_EQ(std::string::npos, data.find("0\r\n\r\n"));
+    }
+
+    FLAGS_http_response_chunk_size_kb = 64;
+}
+
+TEST(chunked_response_writer_test, cancel)
+{
+    mock_response_writer writer(false);
+    writer.begin(http_status_code::ok, "text/plain");
+    writer.write(std::string(100, 'a'));
+    writer.cancel();
+
+    // neither the buffered data nor the last chunk is sent, and the writer is destroyed
+    // without finishing it again
+    ASSERT_TRUE(writer.cancelled);
+    ASSERT_EQ(1, writer.sent.size());
+}
+
+TEST(chunked_response_writer_test, accepts_gzip)
+{
+    struct test_case
+    {
+        std::string accept_encoding;
+        bool expected;
+    } tests[] = {
+        {"", false},
+        {"gzip", true},
+        {"GZIP", true},
+        {"deflate, gzip", true},
+        {"gzip;q=1.0, identity; q=0.5, *;q=0", true},
+        {"gzip; q=0", false},
+        {"br, deflate", false},
+        {"x-gzip", false},
+    };
+    for (const auto &tt : tests) {
+        ASSERT_EQ(tt.expected, chunked_response_writer::accepts_gzip(tt.accept_encoding))
+            << tt.accept_encoding;
+    }
+}
+
+} // namespace dsn
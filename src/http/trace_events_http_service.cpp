@@ -0,0 +1,71 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/toollet/event_recorder.h>
+#include <dsn/utility/string_conv.h>
+#include <fmt/format.h>
+
+#include "builtin_http_calls.h"
+
+namespace dsn {
+
+static const uint32_t DEFAULT_TRACE_SECONDS = 5;
+static const uint32_t MAX_TRACE_SECONDS = 600;
+
+void get_trace_events_handler(const http_request &req, http_response_writer_ptr writer)
+{
+    uint32_t seconds = DEFAULT_TRACE_SECONDS;
+    for (const auto &p : req.query_args) {
+        if ("seconds" == p.first && buf2uint32(p.second, seconds) && seconds > 0 &&
+            seconds <= MAX_TRACE_SECONDS) {
+            continue;
+        }
+        writer->begin(http_status_code::bad_request, "text/plain");
+        writer->write(fmt::format("invalid argument: {}={}, seconds should be in [1, {}]",
+                                  p.first,
+                                  p.second,
+                                  MAX_TRACE_SECONDS));
+        writer->finish();
+        return;
+    }
+
+    auto threads = std::make_shared<std::vector<tools::thread_trace_events>>(
+        tools::event_recorder::snapshot(seconds * 1000));
+
+    writer->begin(http_status_code::ok, "application/json");
+    writer->write(R"({"displayTimeUnit":"ns","traceEvents":[)");
+    size_t next = 0;
+    bool first = true;
+    // serialize a thread in each step, as a thread may hold tens of thousands of events
+    stream_http_body(writer, [threads, next, first](http_response_writer &w) mutable {
+        std::string out;
+        if (next < threads->size()) {
+            tools::event_recorder::append_chrome_trace((*threads)[next], first, out);
+            // release the events as soon as they are serialized
+            std::vector<tools::trace_event>().swap((*threads)[next++].events);
+        }
+        if (next == threads->size()) {
+            out += "]}\n";
+            w.write(out);
+            return false;
+        }
+        w.write(out);
+        return true;
+    });
+}
+
+} // namespace dsn
@@ -107,7 +107,7 @@ void meta_duplication_service::do_modify_duplication(std::shared_ptr<app_state>
                 rpc.response().appid = app->app_id;
 
                 if (rpc.request().status == duplication_status::DS_REMOVED) {
-                    zauto_write_lock l(app_lock());
+                    server_state::apps_write_lock l(_state);
                     app->duplications.erase(dup->id);
                     refresh_duplicating_no_lock(app);
                 }
@@ -211,7 +211,7 @@ void meta_duplication_service::do_add_duplication(std::shared_ptr<app_state> &ap
             resp.appid = app->app_id;
             resp.dupid = dup->id;
 
-            zauto_write_lock l(app_lock());
+            server_state::apps_write_lock l(_state);
             refresh_duplicating_no_lock(app);
         });
 }
@@ -504,7 +504,7 @@ meta_duplication_service::new_dup_from_init(const std::string &follower_cluster_
     // use current time to identify this duplication.
     auto dupid = static_cast<dupid_t>(dsn_now_ms() / 1000);
     {
-        zauto_write_lock l(app_lock());
+        server_state::apps_write_lock l(_state);
 
         // hold write lock here to ensure that dupid is unique
         while (app->duplications.find(dupid) != app->duplications.end())
@@ -615,7 +615,7 @@ void meta_duplication_service::do_restore_duplication(dupid_t dup_id,
     _meta_svc->get_meta_storage()->get_data(
         std::string(store_path),
         [ dup_id, this, app = std::move(app), store_path ](const blob &json) {
-            zauto_write_lock l(app_lock());
+            server_state::apps_write_lock l(_state);
 
             auto dup = duplication_info::decode_from_blob(
                 dup_id, app->app_id, app->app_name, app->partition_count, store_path, json);
@@ -0,0 +1,383 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "flow_balance_policy.h"
+
+#include <algorithm>
+#include <tuple>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
+
+#include "min_cost_flow.h"
+
+namespace dsn {
+namespace replication {
+DSN_DEFINE_uint32("meta_server",
+                  flow_balance_moves_per_round,
+                  10,
+                  "max replica moves planned per round by the min-cost-flow cluster balancer");
+DSN_TAG_VARIABLE(flow_balance_moves_per_round, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  flow_balance_app_weight,
+                  2.0,
+                  "weight of the replica count skew of every app in the min-cost-flow balancer");
+DSN_TAG_VARIABLE(flow_balance_app_weight, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  flow_balance_cluster_weight,
+                  1.0,
+                  "weight of the replica count skew of the nodes in the min-cost-flow balancer");
+DSN_TAG_VARIABLE(flow_balance_cluster_weight, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  flow_balance_disk_weight,
+                  0.5,
+                  "weight of the replica count skew of the disks in a node in the min-cost-flow "
+                  "balancer");
+DSN_TAG_VARIABLE(flow_balance_disk_weight, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  flow_balance_move_cost,
+                  1.0,
+                  "cost of every move in the min-cost-flow balancer, the moves which improve "
+                  "the balance less than it are not planned");
+DSN_TAG_VARIABLE(flow_balance_move_cost, FT_MUTABLE);
+
+flow_balance_policy::flow_balance_policy(meta_service *svc) : load_balance_policy(svc) {}
+
+void flow_balance_policy::balance(bool checker,
+                                  const meta_view *global_view,
+                                  migration_list *list)
+{
+    init(global_view, list);
+    _partitions.clear();
+    _app_partitions.clear();
+    _selected_pids.clear();
+
+    if (_global_view->nodes->size() < 3 || !collect_partitions()) {
+        return;
+    }
+
+    uint64_t start_ms = dsn_now_ms();
+    int64_t budget = FLAGS_flow_balance_moves_per_round;
+    for (auto type : {balance_type::COPY_PRIMARY, balance_type::COPY_SECONDARY}) {
+        int64_t remaining = budget - static_cast<int64_t>(_migration_result->size());
+        if (remaining <= 0) {
+            break;
+        }
+        for (const auto &move : plan_moves(type, remaining)) {
+            apply_move(type, move);
+        }
+    }
+
+    ddebug_f("min-cost-flow balancer planned {} moves in {} ms",
+             _migration_result->size(),
+             dsn_now_ms() - start_ms);
+}
+
+bool flow_balance_policy::collect_partitions()
+{
+    for (const auto &kv : *_global_view->apps) {
+        const std::shared_ptr<app_state> &app = kv.second;
+        if (app->status != app_status::AS_AVAILABLE) {
+            continue;
+        }
+        bool movable = !is_ignored_app(app->app_id) && !app->is_bulk_loading && !app->splitting();
+        for (int i = 0; i < app->partition_count; ++i) {
+            const partition_configuration &pc = app->partitions[i];
+            if (movable && (pc.primary.is_invalid() ||
+                            pc.secondaries.size() + 1 != pc.max_replica_count)) {
+                ddebug_f("skip the min-cost-flow balancer coz gpid({}) is unhealthy", pc.pid);
+                return false;
+            }
+
+            partition_replicas p;
+            p.pid = pc.pid;
+            p.primary = pc.primary;
+            p.secondaries = pc.secondaries;
+            p.movable = movable;
+            const config_context &cc = app->helpers->contexts[i];
+            for (const auto &r : cc.serving) {
+                p.disk_tags[r.node] = r.disk_tag;
+            }
+            _app_partitions[app->app_id].push_back(_partitions.size());
+            _partitions.emplace_back(std::move(p));
+        }
+    }
+    return true;
+}
+
+std::vector<flow_balance_policy::planned_move>
+flow_balance_policy::plan_moves(balance_type type, int64_t max_moves)
+{
+    const bool is_primary = type == balance_type::COPY_PRIMARY;
+    std::vector<rpc_address> nodes;
+    std::map<rpc_address, int64_t> node_count;
+    std::map<rpc_address, std::map<std::string, int64_t>> disk_count;
+    for (const auto &kv : *_global_view->nodes) {
+        if (kv.second.alive()) {
+            nodes.push_back(kv.first);
+            node_count[kv.first] = 0;
+        }
+    }
+
+    // app -> node -> count, only the movable apps
+    std::map<int32_t, std::map<rpc_address, int64_t>> app_count;
+    // (app, node, disk) -> count of the replicas which can be moved in this round
+    std::map<std::tuple<int32_t, rpc_address, std::string>, int64_t> movable_count;
+    for (const auto &p : _partitions) {
+        int32_t app_id = p.pid.get_app_id();
+        auto count = [&](const rpc_address &node) {
+            auto iter = node_count.find(node);
+            if (iter == node_count.end()) {
+                return;
+            }
+            ++iter->second;
+            auto tag_iter = p.disk_tags.find(node);
+            const std::string &tag = tag_iter == p.disk_tags.end() ? "" : tag_iter->second;
+            ++disk_count[node][tag];
+            if (p.movable) {
+                ++app_count[app_id][node];
+                if (_selected_pids.count(p.pid) == 0) {
+                    ++movable_count[std::make_tuple(app_id, node, tag)];
+                }
+            }
+        };
+        if (is_primary) {
+            count(p.primary);
+        } else {
+            for (const auto &node : p.secondaries) {
+                count(node);
+            }
+        }
+    }
+
+    min_cost_flow graph;
+    int source = graph.add_vertex();
+    int sink = graph.add_vertex();
+    std::map<rpc_address, int> node_in;
+    std::map<std::pair<rpc_address, std::string>, int> disk_out;
+    for (const auto &node : nodes) {
+        int out = graph.add_vertex();
+        node_in[node] = graph.add_vertex();
+        int64_t x = node_count[node];
+        for (int64_t k = 1; k <= std::min(x, max_moves); ++k) {
+            graph.add_edge(source, out, 1, -FLAGS_flow_balance_cluster_weight * (2 * (x - k) + 1));
+        }
+        for (int64_t k = 1; k <= max_moves; ++k) {
+            graph.add_edge(
+                node_in[node], sink, 1, FLAGS_flow_balance_cluster_weight * (2 * (x + k) - 1));
+        }
+
+        // the disk of a new replica is chosen by the replica server, so only the disks which
+        // replicas move out of are modeled, relative to the mean of the node
+        const auto &disks = disk_count[node];
+        double disk_mean = disks.empty() ? 0 : static_cast<double>(x) / disks.size();
+        for (const auto &kv : disks) {
+            int dv = graph.add_vertex();
+            disk_out[std::make_pair(node, kv.first)] = dv;
+            for (int64_t k = 1; k <= std::min(kv.second, max_moves); ++k) {
+                graph.add_edge(out,
+                               dv,
+                               1,
+                               FLAGS_flow_balance_disk_weight * 2 *
+                                   (disk_mean - (kv.second - k + 1)));
+            }
+        }
+    }
+
+    struct out_edge
+    {
+        int edge;
+        int32_t app_id;
+        rpc_address node;
+        std::string disk;
+    };
+    struct in_edge
+    {
+        int edge;
+        int32_t app_id;
+        rpc_address node;
+    };
+    std::vector<out_edge> out_edges;
+    std::vector<in_edge> in_edges;
+    const int64_t node_total = nodes.size();
+    for (auto &kv : app_count) {
+        int32_t app_id = kv.first;
+        int64_t total = 0;
+        for (const auto &c : kv.second) {
+            total += c.second;
+        }
+        int64_t low = total / node_total;
+        int64_t high = (total + node_total - 1) / node_total;
+
+        int hub = graph.add_vertex();
+        for (const auto &node : nodes) {
+            int64_t c = kv.second[node];
+            if (c > low) {
+                int out = graph.add_vertex();
+                for (int64_t k = 1; k <= std::min(c - low, max_moves); ++k) {
+                    graph.add_edge(out, hub, 1, -FLAGS_flow_balance_app_weight * (2 * (c - k) + 1));
+                }
+                for (const auto &d : disk_count[node]) {
+                    auto iter = movable_count.find(std::make_tuple(app_id, node, d.first));
+                    if (iter == movable_count.end()) {
+                        continue;
+                    }
+                    int e = graph.add_edge(disk_out[std::make_pair(node, d.first)],
+                                           out,
+                                           std::min(iter->second, max_moves),
+                                           0);
+                    out_edges.push_back(out_edge{e, app_id, node, d.first});
+                }
+            } else if (c < high) {
+                int in = graph.add_vertex();
+                for (int64_t k = 1; k <= std::min(high - c, max_moves); ++k) {
+                    graph.add_edge(hub,
+                                   in,
+                                   1,
+                                   FLAGS_flow_balance_move_cost +
+                                       FLAGS_flow_balance_app_weight * (2 * (c + k) - 1));
+                }
+                int e = graph.add_edge(in, node_in[node], max_moves, 0);
+                in_edges.push_back(in_edge{e, app_id, node});
+            }
+        }
+    }
+
+    int64_t units = graph.solve(source, sink, max_moves);
+    dinfo_f("min-cost-flow model of {}: {} vertices, {} edges, {} units, cost = {}",
+            enum_to_string(type),
+            graph.vertex_count(),
+            graph.edge_count(),
+            units,
+            graph.total_cost());
+
+    // every unit through an app hub is a move, pair the units in and out of each hub
+    std::map<int32_t, std::vector<const out_edge *>> sources;
+    std::map<int32_t, std::vector<rpc_address>> targets;
+    for (const auto &e : out_edges) {
+        for (int64_t i = 0; i < graph.get_flow(e.edge); ++i) {
+            sources[e.app_id].push_back(&e);
+        }
+    }
+    for (const auto &e : in_edges) {
+        for (int64_t i = 0; i < graph.get_flow(e.edge); ++i) {
+            targets[e.app_id].push_back(e.node);
+        }
+    }
+
+    std::vector<planned_move> moves;
+    for (const auto &kv : sources) {
+        const std::vector<rpc_address> &app_targets = targets[kv.first];
+        dassert_f(kv.second.size() == app_targets.size(),
+                  "the flow of app({}) is not conserved",
+                  kv.first);
+        for (size_t i = 0; i < kv.second.size(); ++i) {
+            moves.push_back(
+                planned_move{kv.first, kv.second[i]->node, kv.second[i]->disk, app_targets[i]});
+        }
+    }
+    return moves;
+}
+
+bool flow_balance_policy::apply_move(balance_type type, const planned_move &move)
+{
+    const bool is_primary = type == balance_type::COPY_PRIMARY;
+    auto serves = [](const partition_replicas &p, const rpc_address &node) {
+        return p.primary == node ||
+               std::find(p.secondaries.begin(), p.secondaries.end(), node) !=
+                   p.secondaries.end();
+    };
+    auto disk_of = [](const partition_replicas &p, const rpc_address &node) {
+        auto iter = p.disk_tags.find(node);
+        return iter == p.disk_tags.end() ? std::string() : iter->second;
+    };
+
+    // prefer the partitions on the planned disk, and moving a primary to a node which already
+    // serves the partition as secondary, which copies no data
+    partition_replicas *picked = nullptr;
+    balance_type picked_type = type;
+    for (int pass = 0; pass < 4 && picked == nullptr; ++pass) {
+        bool same_disk = pass % 2 == 0;
+        bool move_primary = is_primary && pass < 2;
+        if (!is_primary && pass >= 2) {
+            break;
+        }
+        for (size_t index : _app_partitions[move.app_id]) {
+            partition_replicas &p = _partitions[index];
+            if (!p.movable || _selected_pids.count(p.pid) != 0) {
+                continue;
+            }
+            bool on_source = is_primary ? p.primary == move.from
+                                        : std::find(p.secondaries.begin(),
+                                                    p.secondaries.end(),
+                                                    move.from) != p.secondaries.end();
+            if (!on_source || (same_disk && disk_of(p, move.from) != move.from_disk)) {
+                continue;
+            }
+            bool target_ok = move_primary
+                                 ? std::find(p.secondaries.begin(),
+                                             p.secondaries.end(),
+                                             move.to) != p.secondaries.end()
+                                 : !serves(p, move.to);
+            if (target_ok) {
+                picked = &p;
+                picked_type = move_primary ? balance_type::MOVE_PRIMARY : type;
+                break;
+            }
+        }
+    }
+    if (picked == nullptr) {
+        dinfo_f("no partition of app({}) can be moved from {} to {}",
+                move.app_id,
+                move.from.to_string(),
+                move.to.to_string());
+        return false;
+    }
+
+    const partition_configuration &pc = *get_config(*_global_view->apps, picked->pid);
+    auto request =
+        generate_balancer_request(*_global_view->apps, pc, picked_type, move.from, move.to);
+    if (request == nullptr) {
+        return false;
+    }
+    _migration_result->emplace(picked->pid, std::move(request));
+    _selected_pids.insert(picked->pid);
+
+    switch (picked_type) {
+    case balance_type::MOVE_PRIMARY:
+        std::replace(picked->secondaries.begin(), picked->secondaries.end(), move.to, move.from);
+        picked->primary = move.to;
+        break;
+    case balance_type::COPY_PRIMARY:
+        picked->primary = move.to;
+        break;
+    default:
+        std::replace(picked->secondaries.begin(), picked->secondaries.end(), move.from, move.to);
+        break;
+    }
+    if (picked_type != balance_type::MOVE_PRIMARY) {
+        picked->disk_tags.erase(move.from);
+        picked->disk_tags[move.to] = "";
+    }
+    return true;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include "load_balance_policy.h"
+
+namespace dsn {
+namespace replication {
+
+// A cluster balancer which plans the moves of all the apps at once, instead of one app and one
+// move at a time as cluster_balance_policy does.
+//
+// The replicas of one role (primary or secondary) are modeled as a min-cost flow, every unit of
+// which is a replica moved from one node to another:
+//
+//   source -> node_out(n) -> disk_out(n, d) -> app_out(a, n) -> app_hub(a)
+//          -> app_in(a, m) -> node_in(m) -> sink
+//
+// The costs of the links are the changes of the sum of squared replica counts per app, per node
+// and per disk, which are convex and thus modeled by parallel unit edges, weighted by
+// [meta_server] flow_balance_{app,cluster,disk}_weight, plus flow_balance_move_cost for every
+// move. The flow stops once no more move reduces the total cost, or the move budget of the round
+// runs out. The replica count of an app on a node never leaves the [floor, ceil] of its average
+// if it was inside.
+//
+// The primaries are planned first, by moving a primary to a node holding a secondary of the
+// partition if possible; then the secondaries are planned on the configuration after the primary
+// moves.
+class flow_balance_policy : public load_balance_policy
+{
+public:
+    explicit flow_balance_policy(meta_service *svc);
+    ~flow_balance_policy() = default;
+
+    void balance(bool checker, const meta_view *global_view, migration_list *list);
+
+private:
+    // The replicas of a partition, updated by the moves planned in this round.
+    struct partition_replicas
+    {
+        gpid pid;
+        rpc_address primary;
+        std::vector<rpc_address> secondaries;
+        // node -> disk tag, empty if unknown
+        std::map<rpc_address, std::string> disk_tags;
+        // false if the app can't be balanced now, the replicas still count in the node loads
+        bool movable;
+    };
+
+    // A unit of flow: a replica of `app_id` moved from `from_disk` of `from` to `to`.
+    struct planned_move
+    {
+        int32_t app_id;
+        rpc_address from;
+        std::string from_disk;
+        rpc_address to;
+    };
+
+    // Returns false if some partition of the apps to be balanced is unhealthy.
+    bool collect_partitions();
+    std::vector<planned_move> plan_moves(balance_type type, int64_t max_moves);
+    // Picks a partition for the planned move and adds it into the migration list.
+    bool apply_move(balance_type type, const planned_move &move);
+
+    std::vector<partition_replicas> _partitions;
+    // app_id -> indexes of its partitions in _partitions
+    std::map<int32_t, std::vector<size_t>> _app_partitions;
+    partition_set _selected_pids;
+
+    friend class flow_balance_policy_test;
+};
+
+} // namespace replication
+} // namespace dsn
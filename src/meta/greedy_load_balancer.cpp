@@ -36,12 +36,28 @@
 #include "meta_admin_types.h"
 #include "app_balance_policy.h"
 #include "cluster_balance_policy.h"
+#include "flow_balance_policy.h"
+#include "load_aware_balance_policy.h"
 
 namespace dsn {
 namespace replication {
 DSN_DEFINE_bool("meta_server", balance_cluster, false, "whether to enable cluster balancer");
 DSN_TAG_VARIABLE(balance_cluster, FT_MUTABLE);
 
+DSN_DEFINE_bool("meta_server",
+                balance_cluster_by_min_cost_flow,
+                false,
+                "whether the cluster balancer plans the moves of all apps at once by min-cost "
+                "flow, only valid if balance_cluster is true");
+DSN_TAG_VARIABLE(balance_cluster_by_min_cost_flow, FT_MUTABLE);
+
+DSN_DEFINE_bool("meta_server",
+                balance_by_load,
+                false,
+                "whether to balance by the load reported by replica servers rather than the "
+                "replica counts");
+DSN_TAG_VARIABLE(balance_by_load, FT_MUTABLE);
+
 DSN_DECLARE_uint64(min_live_node_count_for_unfreeze);
 
 greedy_load_balancer::greedy_load_balancer(meta_service *_svc)
@@ -49,6 +65,8 @@ greedy_load_balancer::greedy_load_balancer(meta_service *_svc)
 {
     _app_balance_policy = dsn::make_unique<app_balance_policy>(_svc);
     _cluster_balance_policy = dsn::make_unique<cluster_balance_policy>(_svc);
+    _flow_balance_policy = dsn::make_unique<flow_balance_policy>(_svc);
+    _load_aware_balance_policy = dsn::make_unique<load_aware_balance_policy>(_svc);
 
     ::memset(t_operation_counters, 0, sizeof(t_operation_counters));
 
@@ -183,10 +201,13 @@ void greedy_load_balancer::greedy_balancer(const bool balance_checker)
     }
 
     load_balance_policy *balance_policy = nullptr;
-    if (!FLAGS_balance_cluster) {
+    if (FLAGS_balance_by_load) {
+        balance_policy = _load_aware_balance_policy.get();
+    } else if (!FLAGS_balance_cluster) {
         balance_policy = _app_balance_policy.get();
     } else if (!balance_checker) {
-        balance_policy = _cluster_balance_policy.get();
+        balance_policy = FLAGS_balance_cluster_by_min_cost_flow ? _flow_balance_policy.get()
+                                                                : _cluster_balance_policy.get();
     }
     if (balance_policy != nullptr) {
         balance_policy->balance(balance_checker, t_global_view, t_migration_result);
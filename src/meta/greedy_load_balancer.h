@@ -73,6 +73,8 @@ private:
 
     std::unique_ptr<load_balance_policy> _app_balance_policy;
     std::unique_ptr<load_balance_policy> _cluster_balance_policy;
+    std::unique_ptr<load_balance_policy> _flow_balance_policy;
+    std::unique_ptr<load_balance_policy> _load_aware_balance_policy;
 
     dsn_handle_t _get_balance_operation_count;
 
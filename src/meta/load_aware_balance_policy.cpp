@@ -0,0 +1,276 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "load_aware_balance_policy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace replication {
+DSN_DEFINE_double("meta_server",
+                  load_balance_skew_threshold,
+                  0.1,
+                  "the load-aware balancer stops when (max - min) of the node loads is below "
+                  "this ratio of the mean");
+DSN_TAG_VARIABLE(load_balance_skew_threshold, FT_MUTABLE);
+
+DSN_DEFINE_uint32("meta_server",
+                  load_balance_moves_per_round,
+                  5,
+                  "max replica moves per round of the load-aware balancer");
+DSN_TAG_VARIABLE(load_balance_moves_per_round, FT_MUTABLE);
+
+DSN_DEFINE_uint32("meta_server",
+                  load_balance_moves_per_node,
+                  2,
+                  "max replica moves into or out of one node per round of the load-aware "
+                  "balancer");
+DSN_TAG_VARIABLE(load_balance_moves_per_node, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  load_balance_qps_weight,
+                  1.0,
+                  "weight of the read and write qps in the replica load");
+DSN_TAG_VARIABLE(load_balance_qps_weight, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  load_balance_bytes_weight,
+                  1.0,
+                  "weight of the read and write bytes in the replica load");
+DSN_TAG_VARIABLE(load_balance_bytes_weight, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  load_balance_disk_weight,
+                  1.0,
+                  "weight of the disk usage in the replica load");
+DSN_TAG_VARIABLE(load_balance_disk_weight, FT_MUTABLE);
+
+DSN_DEFINE_double("meta_server",
+                  load_balance_cpu_weight,
+                  1.0,
+                  "weight of the cpu share in the replica load");
+DSN_TAG_VARIABLE(load_balance_cpu_weight, FT_MUTABLE);
+
+/*static*/ void load_aware_balance_policy::add_replica_load(const replica_load_info &load,
+                                                          /*out*/ replica_load_info &total)
+{
+    total.read_qps += load.read_qps;
+    total.write_qps += load.write_qps;
+    total.read_bytes_per_sec += load.read_bytes_per_sec;
+    total.write_bytes_per_sec += load.write_bytes_per_sec;
+    total.disk_usage_mb += load.disk_usage_mb;
+    total.cpu_share += load.cpu_share;
+}
+
+/*static*/ double
+load_aware_balance_policy::get_replica_load_score(const replica_load_info &load,
+                                                  const replica_load_info &total)
+{
+    auto share = [](double value, double total_value) {
+        return total_value > 0 ? value / total_value : 0;
+    };
+    return FLAGS_load_balance_qps_weight * (share(load.read_qps, total.read_qps) +
+                                            share(load.write_qps, total.write_qps)) +
+           FLAGS_load_balance_bytes_weight *
+               (share(load.read_bytes_per_sec, total.read_bytes_per_sec) +
+                share(load.write_bytes_per_sec, total.write_bytes_per_sec)) +
+           FLAGS_load_balance_disk_weight * share(load.disk_usage_mb, total.disk_usage_mb) +
+           FLAGS_load_balance_cpu_weight * share(load.cpu_share, total.cpu_share);
+}
+
+load_aware_balance_policy::load_aware_balance_policy(meta_service *svc) : load_balance_policy(svc)
+{
+}
+
+void load_aware_balance_policy::balance(bool checker,
+                                        const meta_view *global_view,
+                                        migration_list *list)
+{
+    init(global_view, list);
+
+    std::map<rpc_address, node_load> node_loads;
+    if (!get_node_loads(node_loads) || node_loads.size() < 2) {
+        return;
+    }
+
+    double mean = 0;
+    for (const auto &kv : node_loads) {
+        mean += kv.second.score;
+    }
+    mean /= node_loads.size();
+    double max_skew = mean * FLAGS_load_balance_skew_threshold;
+
+    partition_set selected_pids;
+    while (_migration_result->size() < FLAGS_load_balance_moves_per_round) {
+        // nodes which can still move replicas in this round, from the most loaded
+        std::vector<std::pair<double, rpc_address>> candidates;
+        for (const auto &kv : node_loads) {
+            if (kv.second.move_count < FLAGS_load_balance_moves_per_node) {
+                candidates.emplace_back(kv.second.score, kv.first);
+            }
+        }
+        std::sort(candidates.rbegin(), candidates.rend());
+
+        bool moved = false;
+        for (size_t i = 0; i < candidates.size() && !moved; ++i) {
+            node_load &source = node_loads[candidates[i].second];
+            for (size_t j = candidates.size() - 1; j > i && !moved; --j) {
+                const rpc_address &target_addr = candidates[j].second;
+                double diff = source.score - node_loads[target_addr].score;
+                if (diff <= max_skew) {
+                    break;
+                }
+
+                replica_load picked;
+                if (!pick_replica(source, target_addr, diff, selected_pids, picked)) {
+                    continue;
+                }
+
+                const partition_configuration &pc = *get_config(*_global_view->apps, picked.pid);
+                auto type =
+                    picked.is_primary ? balance_type::COPY_PRIMARY : balance_type::COPY_SECONDARY;
+                auto request = generate_balancer_request(
+                    *_global_view->apps, pc, type, candidates[i].second, target_addr);
+                if (request == nullptr) {
+                    return;
+                }
+                _migration_result->emplace(picked.pid, std::move(request));
+                selected_pids.insert(picked.pid);
+
+                node_load &target = node_loads[target_addr];
+                source.score -= picked.score;
+                source.disk_scores[picked.disk_tag] -= picked.score;
+                ++source.move_count;
+                target.score += picked.score;
+                ++target.move_count;
+                moved = true;
+            }
+        }
+        if (!moved) {
+            break;
+        }
+    }
+
+    ddebug_f("load-aware balancer {}: {} moves planned, the mean load of nodes is {}",
+             checker ? "checker" : "round",
+             _migration_result->size(),
+             mean);
+}
+
+bool load_aware_balance_policy::get_node_loads(
+    /*out*/ std::map<rpc_address, node_load> &node_loads)
+{
+    const app_mapper &apps = *_global_view->apps;
+    for (const auto &kv : *_global_view->nodes) {
+        if (kv.second.alive()) {
+            node_loads[kv.first];
+        }
+    }
+
+    replica_load_info total;
+    for (const auto &kv : apps) {
+        const std::shared_ptr<app_state> &app = kv.second;
+        if (app->status != app_status::AS_AVAILABLE) {
+            continue;
+        }
+        for (const auto &cc : app->helpers->contexts) {
+            for (const auto &r : cc.serving) {
+                if (!r.has_load) {
+                    ddebug_f("the load of gpid({}) on {} is not reported, skip the load-aware "
+                             "balancer",
+                             cc.config_owner->pid,
+                             r.node.to_string());
+                    return false;
+                }
+                add_replica_load(r.load, total);
+            }
+        }
+    }
+
+    for (const auto &kv : apps) {
+        const std::shared_ptr<app_state> &app = kv.second;
+        if (app->status != app_status::AS_AVAILABLE) {
+            continue;
+        }
+        // the replicas of the apps which can't be balanced still contribute to the load
+        bool movable = !is_ignored_app(kv.first) && !app->is_bulk_loading && !app->splitting();
+        for (const auto &cc : app->helpers->contexts) {
+            const partition_configuration &pc = *cc.config_owner;
+            for (const auto &r : cc.serving) {
+                auto iter = node_loads.find(r.node);
+                if (iter == node_loads.end()) {
+                    continue;
+                }
+                double score = get_replica_load_score(r.load, total);
+                iter->second.score += score;
+                iter->second.disk_scores[r.disk_tag] += score;
+                if (movable && is_member(pc, r.node)) {
+                    iter->second.replicas.push_back(
+                        replica_load{pc.pid, r.disk_tag, pc.primary == r.node, score});
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool load_aware_balance_policy::pick_replica(const node_load &source,
+                                             const rpc_address &target,
+                                             double max_score,
+                                             const partition_set &selected_pids,
+                                             /*out*/ replica_load &picked)
+{
+    std::vector<std::pair<double, std::string>> disks;
+    for (const auto &kv : source.disk_scores) {
+        disks.emplace_back(kv.second, kv.first);
+    }
+    std::sort(disks.rbegin(), disks.rend());
+
+    for (const auto &disk : disks) {
+        const replica_load *best = nullptr;
+        for (const replica_load &r : source.replicas) {
+            // moving a replica as heavy as the diff only swaps the two nodes
+            if (r.disk_tag != disk.second || r.score <= 0 || r.score >= max_score ||
+                selected_pids.count(r.pid) != 0 || !is_healthy(r.pid) ||
+                is_member(*get_config(*_global_view->apps, r.pid), target)) {
+                continue;
+            }
+            // the best move halves the diff of the two nodes
+            if (best == nullptr ||
+                std::abs(max_score - 2 * r.score) < std::abs(max_score - 2 * best->score)) {
+                best = &r;
+            }
+        }
+        if (best != nullptr) {
+            picked = *best;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool load_aware_balance_policy::is_healthy(const gpid &pid) const
+{
+    const partition_configuration &pc = *get_config(*_global_view->apps, pid);
+    return !pc.primary.is_invalid() && pc.secondaries.size() + 1 == pc.max_replica_count;
+}
+
+} // namespace replication
+} // namespace dsn
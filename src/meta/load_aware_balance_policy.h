@@ -0,0 +1,77 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include "load_balance_policy.h"
+
+namespace dsn {
+namespace replication {
+// Balances the load of the nodes rather than the replica counts. The load of every replica is
+// reported by the replica servers on config-sync (see replica_load_info), so a node holding a
+// few very hot partitions is no longer considered balanced.
+//
+// Every move copies a replica from the most loaded node to a less loaded one, picking it from
+// the most loaded disk of the source node, until the skew of the node loads is below
+// [meta_server] load_balance_skew_threshold or the move budgets of this round run out.
+class load_aware_balance_policy : public load_balance_policy
+{
+public:
+    explicit load_aware_balance_policy(meta_service *svc);
+    ~load_aware_balance_policy() = default;
+
+    void balance(bool checker, const meta_view *global_view, migration_list *list);
+
+    static void add_replica_load(const replica_load_info &load,
+                                 /*out*/ replica_load_info &total);
+    // The load of a replica as a weighted sum of its share of the cluster-wide total in every
+    // dimension, so that the qps, bytes, disk usage and cpu are comparable.
+    static double get_replica_load_score(const replica_load_info &load,
+                                         const replica_load_info &total);
+
+private:
+    struct replica_load
+    {
+        gpid pid;
+        std::string disk_tag;
+        bool is_primary;
+        double score;
+    };
+
+    struct node_load
+    {
+        double score{0};
+        // disk_tag -> score
+        std::map<std::string, double> disk_scores;
+        // only the replicas which can be moved
+        std::vector<replica_load> replicas;
+        uint32_t move_count{0};
+    };
+
+    // Returns false if the load of some replica is not reported yet.
+    bool get_node_loads(/*out*/ std::map<rpc_address, node_load> &node_loads);
+    // Picks the replica on `source` whose move to `target` reduces the skew of the two nodes
+    // most, from the most loaded disk which has any candidate.
+    bool pick_replica(const node_load &source,
+                      const rpc_address &target,
+                      double max_score,
+                      const partition_set &selected_pids,
+                      /*out*/ replica_load &picked);
+    bool is_healthy(const gpid &pid) const;
+};
+} // namespace replication
+} // namespace dsn
@@ -228,7 +228,7 @@ void bulk_load_service::do_start_app_bulk_load(std::shared_ptr<app_state> app,
     _meta_svc->get_meta_storage()->set_data(
         _state->get_app_path(*app), std::move(value), [app, rpc, this]() {
             {
-                zauto_write_lock l(app_lock());
+                server_state::apps_write_lock l(_state);
                 app->is_bulk_loading = true;
             }
             {
@@ -1434,7 +1434,7 @@ void bulk_load_service::update_app_not_bulk_loading_on_remote_storage(
     blob value = dsn::json::json_forwarder<app_info>::encode(info);
     _meta_svc->get_meta_storage()->set_data(
         _state->get_app_path(*app), std::move(value), [app, this]() {
-            zauto_write_lock l(app_lock());
+            server_state::apps_write_lock l(_state);
             app->is_bulk_loading = false;
             ddebug_f("app({}) update app is_bulk_loading to false", app->app_name);
             _meta_svc->unlock_meta_op_status();
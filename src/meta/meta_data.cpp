@@ -476,12 +476,21 @@ void config_context::collect_serving_replica(const rpc_address &node, const repl
     auto iter = find_from_serving(node);
     auto compact_status = info.__isset.manual_compact_status ? info.manual_compact_status
                                                              : manual_compaction_status::IDLE;
-    if (iter != serving.end()) {
-        iter->disk_tag = info.disk_tag;
-        iter->storage_mb = 0;
-        iter->compact_status = compact_status;
+    if (iter == serving.end()) {
+        serving.emplace_back();
+        iter = serving.end() - 1;
+        iter->node = node;
+    }
+    iter->disk_tag = info.disk_tag;
+    iter->compact_status = compact_status;
+    // the replica servers of old versions don't report the load
+    iter->has_load = info.__isset.load;
+    if (info.__isset.load) {
+        iter->load = info.load;
+        iter->storage_mb = info.load.disk_usage_mb;
     } else {
-        serving.emplace_back(serving_replica{node, 0, info.disk_tag, compact_status});
+        iter->load = replica_load_info();
+        iter->storage_mb = 0;
     }
 }
 
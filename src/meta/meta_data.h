@@ -179,10 +179,12 @@ inline int dropped_cmp(const dropped_replica &d1, const dropped_replica &d2)
 struct serving_replica
 {
     dsn::rpc_address node;
-    // TODO: report the storage size of replica
     int64_t storage_mb;
     std::string disk_tag;
     manual_compaction_status::type compact_status;
+    // the load of the replica on this node, valid only if has_load is true
+    bool has_load;
+    replica_load_info load;
 };
 
 class config_context
@@ -356,6 +358,9 @@ public:
     const char *get_logname() const { return log_name.c_str(); }
     std::shared_ptr<app_state_helper> helpers;
     std::vector<partition_configuration> partitions;
+    // increased under the write lock whenever `partitions` is updated, so that publishing a
+    // server_state_view only copies the apps changed since the previous one
+    int64_t partitions_version{0};
     std::map<dupid_t, duplication_info_s_ptr> duplications;
 
     static std::shared_ptr<app_state> create(const app_info &info);
@@ -193,11 +193,13 @@ void meta_http_service::list_app_handler(const http_request &req, http_response
     }
     if (!redirect_if_not_primary(req, resp))
         return;
+    // query the apps and their partitions from the same view, so that they are consistent
+    server_state_view_ptr view = _service->_state->get_view();
     configuration_list_apps_response response;
     configuration_list_apps_request request;
     request.status = dsn::app_status::AS_INVALID;
 
-    _service->_state->list_apps(request, response);
+    server_state::list_apps(*view, request, response);
 
     if (response.err != dsn::ERR_OK) {
         resp.body = response.err.to_string();
@@ -285,7 +287,7 @@ void meta_http_service::list_app_handler(const http_request &req, http_response
             configuration_query_by_index_request request;
             configuration_query_by_index_response response;
             request.app_name = info.app_name;
-            _service->_state->query_configuration_by_index(request, response);
+            server_state::query_configuration_by_index(*view, request, response);
             dassert(info.app_id == response.app_id,
                     "invalid app_id, %d VS %d",
                     info.app_id,
@@ -376,15 +378,17 @@ void meta_http_service::list_node_handler(const http_request &req, http_response
     int unalive_node_count = (_service->_dead_set).size();
 
     if (detailed) {
+        // query the apps and their partitions from the same view, so that they are consistent
+        server_state_view_ptr view = _service->_state->get_view();
         configuration_list_apps_response response;
         configuration_list_apps_request request;
         request.status = dsn::app_status::AS_AVAILABLE;
-        _service->_state->list_apps(request, response);
+        server_state::list_apps(*view, request, response);
         for (const auto &app : response.infos) {
             configuration_query_by_index_request request_app;
             configuration_query_by_index_response response_app;
             request_app.app_name = app.app_name;
-            _service->_state->query_configuration_by_index(request_app, response_app);
+            server_state::query_configuration_by_index(*view, request_app, response_app);
             dassert(app.app_id == response_app.app_id,
                     "invalid app_id, %d VS %d",
                     app.app_id,
@@ -104,7 +104,9 @@ public:
         //    to M2, RS is not in the worker_map of M2.
         // 3. If M2 claims RS is not alive, then the perfect-FD's constraint will be broken.
         //    Coz RS will find itself dead after the leader-periods.
-        if (_election_moment.load() + get_grace_ms() < dsn_now_ms()) {
+        // The lease of RS may have been extended by M1, see failure_detector.h.
+        if (_election_moment.load() + get_grace_ms() + get_max_lease_extension_ms() <
+            dsn_now_ms()) {
             return true;
         }
         return failure_detector::is_worker_connected(node);
@@ -471,6 +471,7 @@ error_code meta_service::start()
     _split_svc = dsn::make_unique<meta_split_service>(this);
 
     _state->register_cli_commands();
+    _state->start_view_publisher();
 
     start_service();
 
@@ -39,7 +39,7 @@ void meta_split_service::start_partition_split(start_split_rpc rpc)
 
     std::shared_ptr<app_state> app;
     {
-        zauto_write_lock l(app_lock());
+        server_state::apps_write_lock l(_state);
 
         app = _state->get_app(request.app_name);
         if (app == nullptr || app->status != app_status::AS_AVAILABLE) {
@@ -87,11 +87,12 @@ void meta_split_service::do_start_partition_split(std::shared_ptr<app_state> app
                  app->app_name,
                  app->partition_count * 2);
 
-        zauto_write_lock l(app_lock());
+        server_state::apps_write_lock l(_state);
         app->helpers->split_states.splitting_count = app->partition_count;
         app->partition_count *= 2;
         app->helpers->contexts.resize(app->partition_count);
         app->partitions.resize(app->partition_count);
+        ++app->partitions_version;
         app->envs[replica_envs::SPLIT_VALIDATE_PARTITION_HASH] = "true";
 
         for (int i = 0; i < app->partition_count; ++i) {
@@ -126,7 +127,7 @@ void meta_split_service::register_child_on_meta(register_child_rpc rpc)
     auto &response = rpc.response();
     response.err = ERR_IO_PENDING;
 
-    zauto_write_lock l(app_lock());
+    server_state::apps_write_lock l(_state);
     std::shared_ptr<app_state> app = _state->get_app(app_name);
     dassert_f(app != nullptr, "app({}) is not existed", app_name);
     dassert_f(app->is_stateful, "app({}) is stateless currently", app_name);
@@ -207,30 +208,16 @@ dsn::task_ptr meta_split_service::add_child_on_remote_storage(register_child_rpc
                                                               bool create_new)
 {
     const auto &request = rpc.request();
-    const std::string &partition_path = _state->get_partition_path(request.child_config.pid);
-    blob value = dsn::json::json_forwarder<partition_configuration>::encode(request.child_config);
-    if (create_new) {
-        return _meta_svc->get_remote_storage()->create_node(
-            partition_path,
-            LPC_META_STATE_HIGH,
-            std::bind(&meta_split_service::on_add_child_on_remote_storage_reply,
-                      this,
-                      std::placeholders::_1,
-                      rpc,
-                      create_new),
-            value);
-    } else {
-        return _meta_svc->get_remote_storage()->set_data(
-            partition_path,
-            value,
-            LPC_META_STATE_HIGH,
-            std::bind(&meta_split_service::on_add_child_on_remote_storage_reply,
-                      this,
-                      std::placeholders::_1,
-                      rpc,
-                      create_new),
-            _meta_svc->tracker());
-    }
+    return _state->write_partition_config_on_remote(
+        request.child_config,
+        create_new,
+        LPC_META_STATE_HIGH,
+        std::bind(&meta_split_service::on_add_child_on_remote_storage_reply,
+                  this,
+                  std::placeholders::_1,
+                  rpc,
+                  create_new),
+        create_new ? nullptr : _meta_svc->tracker());
 }
 
 void meta_split_service::on_add_child_on_remote_storage_reply(error_code ec,
@@ -241,7 +228,7 @@ void meta_split_service::on_add_child_on_remote_storage_reply(error_code ec,
     auto &response = rpc.response();
     const std::string &app_name = request.app.app_name;
 
-    zauto_write_lock l(app_lock());
+    server_state::apps_write_lock l(_state);
     std::shared_ptr<app_state> app = _state->get_app(app_name);
     dassert_f(app != nullptr, "app({}) is not existed", app_name);
     dassert_f(app->is_stateful, "app({}) is stateless currently", app_name);
@@ -329,7 +316,7 @@ void meta_split_service::control_partition_split(control_split_rpc rpc)
     const auto &control_type = req.control_type;
     auto &response = rpc.response();
 
-    zauto_write_lock l(app_lock());
+    server_state::apps_write_lock l(_state);
     std::shared_ptr<app_state> app = _state->get_app(req.app_name);
     if (app == nullptr || app->status != app_status::AS_AVAILABLE) {
         response.err = app == nullptr ? ERR_APP_NOT_EXIST : ERR_APP_DROPPED;
@@ -463,7 +450,7 @@ void meta_split_service::notify_stop_split(notify_stop_split_rpc rpc)
 {
     const auto &request = rpc.request();
     auto &response = rpc.response();
-    zauto_write_lock l(app_lock());
+    server_state::apps_write_lock l(_state);
     std::shared_ptr<app_state> app = _state->get_app(request.app_name);
     dassert_f(app != nullptr, "app({}) is not existed", request.app_name);
     dassert_f(app->is_stateful, "app({}) is stateless currently", request.app_name);
@@ -528,10 +515,11 @@ void meta_split_service::do_cancel_partition_split(std::shared_ptr<app_state> ap
         ddebug_f("app({}) update partition count on remote storage, new partition count is {}",
                  app->app_name,
                  app->partition_count / 2);
-        zauto_write_lock l(app_lock());
+        server_state::apps_write_lock l(_state);
         app->partition_count /= 2;
         app->helpers->contexts.resize(app->partition_count);
         app->partitions.resize(app->partition_count);
+        ++app->partitions_version;
     };
 
     auto copy = *app;
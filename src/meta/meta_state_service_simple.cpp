@@ -27,16 +27,27 @@
 #include "meta_state_service_simple.h"
 
 #include <fcntl.h>
+#include <unistd.h>
 
 #include <stack>
 #include <utility>
 
+#include <dsn/dist/fmt_logging.h>
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/async_calls.h>
+#include <dsn/utility/crc.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace dist {
+DSN_DEFINE_uint64("meta_server",
+                  meta_state_service_simple_checkpoint_threshold_kb,
+                  64 * 1024,
+                  "checkpoint the simple meta state service once its log exceeds this size, "
+                  "0 means never");
+DSN_TAG_VARIABLE(meta_state_service_simple_checkpoint_threshold_kb, FT_MUTABLE);
+
 // path: /, /n1/n2, /n1/n2/, /n2/n2/n3
 std::string meta_state_service_simple::normalize_path(const std::string &s)
 {
@@ -74,39 +85,224 @@ void meta_state_service_simple::write_log(blob &&log_blob,
                                           std::function<error_code()> internal_operation,
                                           task_ptr task)
 {
-    _log_lock.lock();
-    uint64_t log_offset = _offset;
-    _offset += log_blob.length();
-    auto continuation_task = std::unique_ptr<operation>(new operation(false, [=](bool log_succeed) {
-        dassert(log_succeed, "we cannot handle logging failure now");
-        __err_cb_bind_and_enqueue(task, internal_operation(), 0);
-    }));
-    auto continuation_task_ptr = continuation_task.get();
-    _task_queue.emplace(move(continuation_task));
-    _log_lock.unlock();
+    zauto_lock l(_log_lock);
+    _pending_log_size += log_blob.length();
+    _pending_logs.emplace_back(std::move(log_blob));
+    _log_callbacks.emplace([=]() { __err_cb_bind_and_enqueue(task, internal_operation(), 0); });
+    flush_logs();
+}
+
+void meta_state_service_simple::flush_logs()
+{
+    if (_writing_log || _pending_logs.empty()) {
+        return;
+    }
+
+    size_t log_count = _pending_logs.size();
+    size_t total_size = _pending_log_size;
+    std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(total_size));
+    char *dest = buffer.get();
+    for (const blob &log_blob : _pending_logs) {
+        memcpy(dest, log_blob.data(), log_blob.length());
+        dest += log_blob.length();
+    }
+    _pending_logs.clear();
+    _pending_log_size = 0;
 
+    _writing_log = true;
+    uint64_t log_offset = _offset;
+    _offset += total_size;
     file::write(_log,
-                log_blob.data(),
-                log_blob.length(),
+                buffer.get(),
+                static_cast<int>(total_size),
                 log_offset,
                 LPC_META_STATE_SERVICE_SIMPLE_INTERNAL,
                 &_tracker,
-                [=](error_code err, size_t bytes) {
-                    dassert(err == ERR_OK && bytes == log_blob.length(),
+                [this, buffer, total_size, log_count](error_code err, size_t bytes) {
+                    dassert(err == ERR_OK && bytes == total_size,
                             "we cannot handle logging failure now");
-                    _log_lock.lock();
-                    continuation_task_ptr->done = true;
-                    while (!_task_queue.empty()) {
-                        if (!_task_queue.front()->done) {
-                            break;
-                        }
-                        _task_queue.front()->cb(true);
-                        _task_queue.pop();
-                    }
-                    _log_lock.unlock();
+                    on_logs_written(log_count);
                 });
 }
 
+void meta_state_service_simple::on_logs_written(size_t log_count)
+{
+    zauto_lock l(_log_lock);
+    for (size_t i = 0; i < log_count; ++i) {
+        _log_callbacks.front()();
+        _log_callbacks.pop();
+    }
+    _writing_log = false;
+
+    if (!_checkpointing && FLAGS_meta_state_service_simple_checkpoint_threshold_kb > 0 &&
+        _offset >= FLAGS_meta_state_service_simple_checkpoint_threshold_kb * 1024) {
+        start_checkpoint();
+    }
+    flush_logs();
+}
+
+std::string meta_state_service_simple::get_log_path(int64_t generation) const
+{
+    std::string log_path = utils::filesystem::path_combine(_work_dir, "meta_state_service.log");
+    return generation == 0 ? log_path : log_path + "." + std::to_string(generation);
+}
+
+std::string meta_state_service_simple::get_snapshot_path() const
+{
+    return utils::filesystem::path_combine(_work_dir, "meta_state_service.snapshot");
+}
+
+void meta_state_service_simple::start_checkpoint()
+{
+    std::string new_log_path = get_log_path(_log_generation + 1);
+    disk_file *new_log = file::open(new_log_path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
+    if (!new_log) {
+        derror_f("open file {} failed, skip the checkpoint", new_log_path);
+        return;
+    }
+    file::close(_log);
+    _log = new_log;
+    _offset = 0;
+    ++_log_generation;
+
+    // all the logs of the previous generations are applied, so the tree is exactly the state as
+    // of the beginning of the new generation
+    _checkpointing = true;
+    auto nodes = std::make_shared<std::vector<std::pair<std::string, blob>>>(dump_nodes());
+    int64_t log_generation = _log_generation;
+    tasking::enqueue(LPC_META_STATE_SERVICE_SIMPLE_CHECKPOINT,
+                     &_tracker,
+                     [this, nodes, log_generation]() { write_snapshot(log_generation, *nodes); });
+}
+
+std::vector<std::pair<std::string, blob>> meta_state_service_simple::dump_nodes()
+{
+    std::vector<std::pair<std::string, blob>> nodes;
+    zauto_lock _(_state_lock);
+    nodes.reserve(_quick_map.size());
+    std::queue<std::pair<std::string, const state_node *>> q;
+    q.emplace("/", &_root);
+    while (!q.empty()) {
+        const std::string &path = q.front().first;
+        const state_node *node = q.front().second;
+        nodes.emplace_back(path, node->data);
+        for (const auto &kv : node->children) {
+            q.emplace(path == "/" ? path + kv.first : path + "/" + kv.first, kv.second);
+        }
+        q.pop();
+    }
+    return nodes;
+}
+
+static const int32_t SNAPSHOT_MAGIC = 0x50414e53; // "SNAP"
+static const int32_t SNAPSHOT_VERSION = 1;
+
+void meta_state_service_simple::write_snapshot(
+    int64_t log_generation, const std::vector<std::pair<std::string, blob>> &nodes)
+{
+    uint64_t start_ms = dsn_now_ms();
+    binary_writer writer;
+    writer.write(SNAPSHOT_MAGIC);
+    writer.write(SNAPSHOT_VERSION);
+    writer.write(log_generation);
+    writer.write(static_cast<int64_t>(nodes.size()));
+    for (const auto &node : nodes) {
+        writer.write(node.first);
+        writer.write(node.second);
+    }
+    blob content = writer.get_buffer();
+    uint32_t crc = utils::crc32_calc(content.data(), content.length(), 0);
+
+    std::string snapshot_path = get_snapshot_path();
+    std::string tmp_path = snapshot_path + ".tmp";
+    bool succeed = false;
+    if (FILE *fd = fopen(tmp_path.c_str(), "wb")) {
+        succeed = fwrite(content.data(), content.length(), 1, fd) == 1 &&
+                  fwrite(&crc, sizeof(crc), 1, fd) == 1 && fflush(fd) == 0 &&
+                  fsync(fileno(fd)) == 0;
+        fclose(fd);
+    }
+    succeed = succeed && utils::filesystem::rename_path(tmp_path, snapshot_path);
+
+    zauto_lock l(_log_lock);
+    _checkpointing = false;
+    if (!succeed) {
+        // the logs are kept, so nothing is lost, just retry on the next checkpoint
+        derror_f("write snapshot {} failed", snapshot_path);
+        return;
+    }
+    for (int64_t g = _snapshot_generation; g < log_generation; ++g) {
+        std::string log_path = get_log_path(g);
+        if (utils::filesystem::file_exists(log_path) &&
+            !utils::filesystem::remove_path(log_path)) {
+            dwarn_f("remove log {} covered by the snapshot failed", log_path);
+        }
+    }
+    _snapshot_generation = log_generation;
+    ddebug_f("checkpoint of meta state done, node_count = {}, snapshot_size = {}, "
+             "log_generation = {}, time_used = {} ms",
+             nodes.size(),
+             content.length(),
+             log_generation,
+             dsn_now_ms() - start_ms);
+}
+
+error_code meta_state_service_simple::load_snapshot(/*out*/ int64_t &log_generation)
+{
+    std::string snapshot_path = get_snapshot_path();
+    std::string data;
+    error_code err = utils::filesystem::read_file(snapshot_path, data);
+    if (err != ERR_OK) {
+        derror_f("read snapshot {} failed, err = {}", snapshot_path, err);
+        return err;
+    }
+
+    uint32_t crc = 0;
+    if (data.size() < sizeof(crc)) {
+        derror_f("snapshot {} is corrupted, size = {}", snapshot_path, data.size());
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    size_t content_size = data.size() - sizeof(crc);
+    memcpy(&crc, data.data() + content_size, sizeof(crc));
+    if (crc != utils::crc32_calc(data.data(), content_size, 0)) {
+        derror_f("snapshot {} is corrupted, crc mismatch", snapshot_path);
+        return ERR_FILE_OPERATION_FAILED;
+    }
+
+    data.resize(content_size);
+    binary_reader reader(blob::create_from_bytes(std::move(data)));
+    int32_t magic = 0, version = 0;
+    int64_t node_count = 0;
+    reader.read(magic);
+    reader.read(version);
+    if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        derror_f("snapshot {} is invalid, magic = {}, version = {}", snapshot_path, magic, version);
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    reader.read(log_generation);
+    reader.read(node_count);
+    for (int64_t i = 0; i < node_count; ++i) {
+        std::string path;
+        blob value;
+        reader.read(path);
+        reader.read(value);
+        if (path == "/") {
+            _root.data = value;
+            continue;
+        }
+        err = create_node_internal(path, value);
+        if (err != ERR_OK) {
+            derror_f("load node {} from snapshot {} failed, err = {}", path, snapshot_path, err);
+            return ERR_FILE_OPERATION_FAILED;
+        }
+    }
+    ddebug_f("meta state loaded from snapshot {}, node_count = {}, log_generation = {}",
+             snapshot_path,
+             node_count,
+             log_generation);
+    return ERR_OK;
+}
+
 error_code meta_state_service_simple::create_node_internal(const std::string &node,
                                                            const blob &value)
 {
@@ -223,64 +419,85 @@ error_code meta_state_service_simple::apply_transaction(
     return ERR_OK;
 }
 
+uint64_t meta_state_service_simple::replay_log(const std::string &log_path)
+{
+    uint64_t valid_size = 0;
+    if (FILE *fd = fopen(log_path.c_str(), "rb")) {
+        for (;;) {
+            log_header header;
+            if (fread(&header, sizeof(log_header), 1, fd) != 1) {
+                break;
+            }
+            if (header.magic != log_header::default_magic) {
+                break;
+            }
+            std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(header.size));
+            if (fread(buffer.get(), header.size, 1, fd) != 1) {
+                break;
+            }
+            valid_size += sizeof(header) + header.size;
+            binary_reader reader(blob(buffer, (int)header.size));
+            int op_type;
+            reader.read(op_type);
+
+            switch (static_cast<operation_type>(op_type)) {
+            case operation_type::create_node: {
+                std::string node;
+                blob data;
+                create_node_log::parse(reader, node, data);
+                create_node_internal(node, data);
+                break;
+            }
+            case operation_type::delete_node: {
+                std::string node;
+                bool recursively_delete;
+                delete_node_log::parse(reader, node, recursively_delete);
+                delete_node_internal(node, recursively_delete);
+                break;
+            }
+            case operation_type::set_data: {
+                std::string node;
+                blob data;
+                set_data_log::parse(reader, node, data);
+                set_data_internal(node, data);
+                break;
+            }
+            default:
+                // The log is complete but its content is modified by cosmic ray. This is
+                // unacceptable
+                dassert(false, "meta state server log corrupted");
+            }
+        }
+        fclose(fd);
+    }
+    return valid_size;
+}
+
 error_code meta_state_service_simple::initialize(const std::vector<std::string> &args)
 {
-    const char *work_dir =
-        args.empty() ? service_app::current_service_app_info().data_dir.c_str() : args[0].c_str();
+    _work_dir = args.empty() ? service_app::current_service_app_info().data_dir : args[0];
 
     _offset = 0;
-    std::string log_path = dsn::utils::filesystem::path_combine(work_dir, "meta_state_service.log");
-    if (utils::filesystem::file_exists(log_path)) {
-        if (FILE *fd = fopen(log_path.c_str(), "rb")) {
-            for (;;) {
-                log_header header;
-                if (fread(&header, sizeof(log_header), 1, fd) != 1) {
-                    break;
-                }
-                if (header.magic != log_header::default_magic) {
-                    break;
-                }
-                std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(header.size));
-                if (fread(buffer.get(), header.size, 1, fd) != 1) {
-                    break;
-                }
-                _offset += sizeof(header) + header.size;
-                binary_reader reader(blob(buffer, (int)header.size));
-                int op_type;
-                reader.read(op_type);
-
-                switch (static_cast<operation_type>(op_type)) {
-                case operation_type::create_node: {
-                    std::string node;
-                    blob data;
-                    create_node_log::parse(reader, node, data);
-                    create_node_internal(node, data);
-                    break;
-                }
-                case operation_type::delete_node: {
-                    std::string node;
-                    bool recursively_delete;
-                    delete_node_log::parse(reader, node, recursively_delete);
-                    delete_node_internal(node, recursively_delete);
-                    break;
-                }
-                case operation_type::set_data: {
-                    std::string node;
-                    blob data;
-                    set_data_log::parse(reader, node, data);
-                    set_data_internal(node, data);
-                    break;
-                }
-                default:
-                    // The log is complete but its content is modified by cosmic ray. This is
-                    // unacceptable
-                    dassert(false, "meta state server log corrupted");
-                }
-            }
-            fclose(fd);
+    _log_generation = 0;
+    _snapshot_generation = 0;
+    if (utils::filesystem::file_exists(get_snapshot_path())) {
+        error_code err = load_snapshot(_log_generation);
+        if (err != ERR_OK) {
+            return err;
+        }
+        _snapshot_generation = _log_generation;
+    }
+
+    // a crash during a checkpoint may leave several generations of logs after the snapshot
+    for (;;) {
+        _offset = replay_log(get_log_path(_log_generation));
+        if (!utils::filesystem::file_exists(get_log_path(_log_generation + 1))) {
+            break;
         }
+        ++_log_generation;
     }
 
+    std::string log_path = get_log_path(_log_generation);
     _log = file::open(log_path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
     if (!_log) {
         derror("open file failed: %s", log_path.c_str());
@@ -43,6 +43,22 @@ namespace dist {
 DEFINE_TASK_CODE_AIO(LPC_META_STATE_SERVICE_SIMPLE_INTERNAL,
                      TASK_PRIORITY_HIGH,
                      THREAD_POOL_DEFAULT);
+DEFINE_TASK_CODE(LPC_META_STATE_SERVICE_SIMPLE_CHECKPOINT,
+                 TASK_PRIORITY_COMMON,
+                 THREAD_POOL_DEFAULT);
+
+// Every update is appended to a local log before it is applied to the in-memory tree. The
+// updates arriving while a log write is in flight are group committed by the next write.
+//
+// Once the current log exceeds [meta_server] meta_state_service_simple_checkpoint_threshold_kb,
+// the log is switched to a new generation and the tree is checkpointed into a binary snapshot
+// in background, after which the logs covered by the snapshot are removed:
+//
+//   meta_state_service.snapshot        the tree as of the beginning of log generation N
+//   meta_state_service.log             log generation 0, i.e. the log of the legacy versions
+//   meta_state_service.log.<N>         log generation N
+//
+// Recovery loads the snapshot, then replays the logs from its generation on.
 
 class meta_state_service_simple : public meta_state_service
 {
@@ -52,7 +68,12 @@ public:
           _quick_map({std::make_pair("/", &_root)}),
           _log_lock(true),
           _log(nullptr),
-          _offset(0)
+          _offset(0),
+          _log_generation(0),
+          _writing_log(false),
+          _pending_log_size(0),
+          _snapshot_generation(0),
+          _checkpointing(false)
     {
     }
 
@@ -104,13 +125,6 @@ public:
     virtual ~meta_state_service_simple() override;
 
 private:
-    struct operation
-    {
-        bool done;
-        std::function<void(bool)> cb;
-        operation(bool done, std::function<void(bool)> &&cb) : done(done), cb(move(cb)) {}
-    };
-
 #pragma pack(push, 1)
     struct log_header
     {
@@ -244,6 +258,24 @@ private:
 
     void
     write_log(blob &&log_blob, std::function<error_code(void)> internal_operation, task_ptr task);
+    // Writes all the pending logs in one write if no write is in flight, should be called with
+    // _log_lock held.
+    void flush_logs();
+    void on_logs_written(size_t log_count);
+
+    std::string get_log_path(int64_t generation) const;
+    std::string get_snapshot_path() const;
+    // Replays the log and returns the size of its valid prefix, 0 if it doesn't exist.
+    uint64_t replay_log(const std::string &log_path);
+
+    // Switches to a new log generation and checkpoints the tree in background, should be called
+    // with _log_lock held and no log write in flight.
+    void start_checkpoint();
+    void write_snapshot(int64_t log_generation,
+                        const std::vector<std::pair<std::string, blob>> &nodes);
+    error_code load_snapshot(/*out*/ int64_t &log_generation);
+    // Returns <path, data> of all the nodes, every parent is ahead of its children.
+    std::vector<std::pair<std::string, blob>> dump_nodes();
 
     error_code create_node_internal(const std::string &node, const blob &blob);
     error_code delete_node_internal(const std::string &node, bool recursive);
@@ -253,16 +285,25 @@ private:
 
     typedef std::unordered_map<std::string, state_node *> quick_map;
 
-    zlock _queue_lock;
-    std::queue<std::unique_ptr<operation>> _task_queue;
-
     zlock _state_lock;
     state_node _root;     // tree
     quick_map _quick_map; // <path, node*>
 
+    std::string _work_dir;
+
     zlock _log_lock;
     disk_file *_log;
     uint64_t _offset;
+    int64_t _log_generation;
+    bool _writing_log;
+    // logs not written yet, and the callbacks of all the logs not written yet or in flight,
+    // which are called in the order of the logs
+    std::vector<blob> _pending_logs;
+    size_t _pending_log_size;
+    std::queue<std::function<void()>> _log_callbacks;
+    // the log generation following the latest snapshot, the logs ahead of it are useless
+    int64_t _snapshot_generation;
+    bool _checkpointing;
 
     dsn::task_tracker _tracker;
 };
@@ -0,0 +1,116 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "min_cost_flow.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+#include <dsn/c/api_utilities.h>
+
+namespace dsn {
+namespace replication {
+
+// costs closer than this are considered equal
+static const double COST_EPSILON = 1e-9;
+
+int min_cost_flow::add_vertex()
+{
+    _adjacency.emplace_back();
+    return static_cast<int>(_adjacency.size()) - 1;
+}
+
+int min_cost_flow::add_edge(int from, int to, int64_t capacity, double cost)
+{
+    dassert(from >= 0 && from < vertex_count() && to >= 0 && to < vertex_count(),
+            "invalid edge %d -> %d",
+            from,
+            to);
+    int id = static_cast<int>(_edges.size());
+    _edges.push_back(edge{to, capacity, 0, cost});
+    _adjacency[from].push_back(id);
+    _edges.push_back(edge{from, 0, 0, -cost});
+    _adjacency[to].push_back(id + 1);
+    return id / 2;
+}
+
+bool min_cost_flow::find_shortest_path(int source,
+                                       int sink,
+                                       /*out*/ std::vector<int> &prev_edge,
+                                       /*out*/ double &distance)
+{
+    const double INF = std::numeric_limits<double>::infinity();
+    std::vector<double> dist(_adjacency.size(), INF);
+    std::vector<bool> in_queue(_adjacency.size(), false);
+    prev_edge.assign(_adjacency.size(), -1);
+
+    std::deque<int> queue;
+    dist[source] = 0;
+    queue.push_back(source);
+    in_queue[source] = true;
+    while (!queue.empty()) {
+        int u = queue.front();
+        queue.pop_front();
+        in_queue[u] = false;
+        for (int id : _adjacency[u]) {
+            const edge &e = _edges[id];
+            if (e.capacity - e.flow <= 0 || dist[u] + e.cost >= dist[e.to] - COST_EPSILON) {
+                continue;
+            }
+            dist[e.to] = dist[u] + e.cost;
+            prev_edge[e.to] = id;
+            if (!in_queue[e.to]) {
+                // SLF: the vertices closer to the source are relaxed first
+                if (!queue.empty() && dist[e.to] < dist[queue.front()]) {
+                    queue.push_front(e.to);
+                } else {
+                    queue.push_back(e.to);
+                }
+                in_queue[e.to] = true;
+            }
+        }
+    }
+
+    distance = dist[sink];
+    return distance != INF;
+}
+
+int64_t min_cost_flow::solve(int source, int sink, int64_t max_flow)
+{
+    int64_t sent = 0;
+    std::vector<int> prev_edge;
+    double distance;
+    while (sent < max_flow && find_shortest_path(source, sink, prev_edge, distance) &&
+           distance < -COST_EPSILON) {
+        int64_t units = max_flow - sent;
+        for (int v = sink; v != source; v = _edges[prev_edge[v] ^ 1].to) {
+            const edge &e = _edges[prev_edge[v]];
+            units = std::min(units, e.capacity - e.flow);
+        }
+        for (int v = sink; v != source; v = _edges[prev_edge[v] ^ 1].to) {
+            _edges[prev_edge[v]].flow += units;
+            _edges[prev_edge[v] ^ 1].flow -= units;
+        }
+        sent += units;
+        _total_cost += units * distance;
+    }
+    return sent;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,70 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace dsn {
+namespace replication {
+
+// Min-cost flow by successive shortest paths. The shortest paths are found by SPFA, so the
+// costs may be negative as long as the initial graph has no negative cycle.
+//
+// A convex cost of sending units over a link is modeled by parallel edges of capacity 1 with
+// increasing costs, the cheaper ones are always used first.
+class min_cost_flow
+{
+public:
+    int add_vertex();
+    // Returns the id of the edge.
+    int add_edge(int from, int to, int64_t capacity, double cost);
+
+    // Sends at most `max_flow` units from `source` to `sink` along the cheapest paths, and stops
+    // once the cheapest path costs no less than 0, i.e. more flow won't reduce the total cost.
+    // Returns the units sent.
+    int64_t solve(int source, int sink, int64_t max_flow);
+
+    int64_t get_flow(int edge) const { return _edges[2 * edge].flow; }
+    double total_cost() const { return _total_cost; }
+    int vertex_count() const { return static_cast<int>(_adjacency.size()); }
+    int edge_count() const { return static_cast<int>(_edges.size() / 2); }
+
+private:
+    struct edge
+    {
+        int to;
+        int64_t capacity;
+        int64_t flow;
+        double cost;
+    };
+
+    // Returns false if `sink` is unreachable.
+    bool find_shortest_path(int source,
+                            int sink,
+                            /*out*/ std::vector<int> &prev_edge,
+                            /*out*/ double &distance);
+
+    // the edge 2i is the i-th added edge, 2i+1 is its reverse edge in the residual graph
+    std::vector<edge> _edges;
+    std::vector<std::vector<int>> _adjacency;
+    double _total_cost{0};
+};
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,538 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "partition_config_store.h"
+
+#include <set>
+
+#include <dsn/cpp/json_helper.h>
+#include <dsn/cpp/serialization.h>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/dist/replication/replication.codes.h>
+#include <dsn/tool-api/zlocks.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/string_conv.h>
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_bool("meta_server",
+                partition_config_chunked_layout,
+                false,
+                "whether to persist partition configurations in binary chunks, the existing "
+                "partitions are migrated on meta server startup. Only enable it after all the "
+                "meta servers are upgraded, and disable it and restart before downgrading");
+DSN_DEFINE_int32("meta_server",
+                 partition_config_chunk_size,
+                 256,
+                 "max count of partitions in one chunk for new apps, a larger chunk means less "
+                 "nodes to load but more bytes to write on every configuration update");
+DSN_DEFINE_validator(partition_config_chunk_size, [](int32_t value) -> bool { return value > 0; });
+
+namespace {
+const uint32_t kChunkMagic = 0x4b4e4843; // "CHNK"
+const uint32_t kChunkVersion = 1;
+const char *kChunkRootName = "partition_chunks";
+const int kChunkHeaderSize = sizeof(uint32_t) * 2 + sizeof(int32_t) * 3;
+} // anonymous namespace
+
+/*static*/ bool partition_config_store::chunked_layout_enabled()
+{
+    return FLAGS_partition_config_chunked_layout;
+}
+
+/*static*/ std::string partition_config_store::get_chunk_root(const std::string &app_path)
+{
+    return app_path + "/" + kChunkRootName;
+}
+
+/*static*/ std::string partition_config_store::get_chunk_path(const std::string &app_path,
+                                                              int32_t chunk_index)
+{
+    return get_chunk_root(app_path) + "/" + std::to_string(chunk_index);
+}
+
+/*static*/ blob partition_config_store::encode_partition_config(const partition_configuration &pc)
+{
+    binary_writer writer;
+    dsn::marshall(writer, pc, DSF_THRIFT_BINARY);
+    return writer.get_buffer();
+}
+
+/*static*/ bool partition_config_store::decode_partition_config(const blob &value,
+                                                               partition_configuration &pc)
+{
+    if (value.length() == 0) {
+        return false;
+    }
+    binary_reader reader(value);
+    dsn::unmarshall(reader, pc, DSF_THRIFT_BINARY);
+    return true;
+}
+
+/*static*/ blob partition_config_store::encode_chunk(const partition_config_chunk &chunk)
+{
+    binary_writer writer;
+    writer.write(kChunkMagic);
+    writer.write(kChunkVersion);
+    writer.write(chunk.app_id);
+    writer.write(chunk.start_index);
+    writer.write(static_cast<int32_t>(chunk.entries.size()));
+    for (const blob &entry : chunk.entries) {
+        writer.write(entry);
+    }
+    return writer.get_buffer();
+}
+
+/*static*/ bool partition_config_store::decode_chunk(const blob &value,
+                                                    partition_config_chunk &chunk)
+{
+    binary_reader reader(value);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    int32_t count = 0;
+    if (reader.get_remaining_size() < kChunkHeaderSize) {
+        return false;
+    }
+    reader.read(magic);
+    reader.read(version);
+    if (magic != kChunkMagic || version != kChunkVersion) {
+        return false;
+    }
+    reader.read(chunk.app_id);
+    reader.read(chunk.start_index);
+    reader.read(count);
+    if (count < 0) {
+        return false;
+    }
+
+    chunk.entries.clear();
+    chunk.entries.reserve(count);
+    for (int32_t i = 0; i < count; ++i) {
+        int32_t len = 0;
+        if (reader.get_remaining_size() < static_cast<int>(sizeof(len))) {
+            return false;
+        }
+        reader.read(len);
+        if (len < 0 || len > reader.get_remaining_size()) {
+            return false;
+        }
+        blob entry;
+        reader.read(entry, len);
+        chunk.entries.emplace_back(std::move(entry));
+    }
+    return reader.is_eof();
+}
+
+/*static*/ blob partition_config_store::encode_chunk_size(int32_t chunk_size)
+{
+    return blob::create_from_bytes(std::to_string(chunk_size));
+}
+
+/*static*/ bool partition_config_store::decode_chunk_size(const blob &value, int32_t &chunk_size)
+{
+    return buf2int32(value.to_string(), chunk_size) && chunk_size > 0;
+}
+
+partition_config_store::~partition_config_store() { _tracker.cancel_outstanding_tasks(); }
+
+void partition_config_store::reset()
+{
+    zauto_lock l(_lock);
+    _apps.clear();
+}
+
+void partition_config_store::load_app(int32_t app_id, int32_t chunk_size)
+{
+    zauto_lock l(_lock);
+    _apps[app_id].chunk_size = chunk_size;
+}
+
+void partition_config_store::load_chunk(int32_t chunk_size, const partition_config_chunk &chunk)
+{
+    zauto_lock l(_lock);
+    app_context &app = _apps[chunk.app_id];
+    app.chunk_size = chunk_size;
+    chunk_context &ctx = app.chunks[chunk.start_index / chunk_size];
+    ctx.created = true;
+    ctx.entries = chunk.entries;
+}
+
+task_ptr partition_config_store::write(dist::meta_state_service *storage,
+                                       const std::string &app_path,
+                                       const partition_configuration &pc,
+                                       task_code cb_code,
+                                       const err_callback &cb,
+                                       task_tracker *tracker)
+{
+    error_code_future_ptr tsk(new error_code_future(cb_code, cb, 0));
+    tsk->set_tracker(tracker);
+    blob value = encode_partition_config(pc);
+
+    zauto_lock l(_lock);
+    app_context &app = _apps[pc.pid.get_app_id()];
+    if (app.chunk_size == 0) {
+        app.chunk_size = FLAGS_partition_config_chunk_size;
+    }
+    int32_t chunk_index = pc.pid.get_partition_index() / app.chunk_size;
+    pending_write &w = app.chunks[chunk_index].pending[pc.pid.get_partition_index()];
+    w.value = std::move(value);
+    w.callbacks.emplace_back(tsk);
+    flush_chunk(storage, app_path, pc.pid.get_app_id(), chunk_index);
+    return tsk;
+}
+
+void partition_config_store::flush_chunk(dist::meta_state_service *storage,
+                                         const std::string &app_path,
+                                         int32_t app_id,
+                                         int32_t chunk_index)
+{
+    app_context &app = _apps[app_id];
+    chunk_context &ctx = app.chunks[chunk_index];
+    if (ctx.writing || ctx.pending.empty()) {
+        return;
+    }
+    ctx.writing = true;
+
+    partition_config_chunk chunk;
+    chunk.app_id = app_id;
+    chunk.start_index = chunk_index * app.chunk_size;
+    chunk.entries = ctx.entries;
+    chunk.entries.resize(app.chunk_size);
+    std::vector<error_code_future_ptr> callbacks;
+    for (auto &kv : ctx.pending) {
+        chunk.entries[kv.first - chunk.start_index] = std::move(kv.second.value);
+        for (auto &tsk : kv.second.callbacks) {
+            callbacks.emplace_back(std::move(tsk));
+        }
+    }
+    ctx.pending.clear();
+
+    blob value = encode_chunk(chunk);
+    auto entries = std::make_shared<std::vector<blob>>(std::move(chunk.entries));
+    auto written_callbacks =
+        std::make_shared<std::vector<error_code_future_ptr>>(std::move(callbacks));
+    persist_chunk(storage,
+                  app_path,
+                  app.chunk_size,
+                  chunk_index,
+                  value,
+                  ctx.created,
+                  [this, storage, app_path, app_id, chunk_index, entries, written_callbacks](
+                      error_code ec) {
+                      on_chunk_written(ec,
+                                       storage,
+                                       app_path,
+                                       app_id,
+                                       chunk_index,
+                                       std::move(*entries),
+                                       std::move(*written_callbacks));
+                  });
+}
+
+void partition_config_store::on_chunk_written(error_code ec,
+                                              dist::meta_state_service *storage,
+                                              const std::string &app_path,
+                                              int32_t app_id,
+                                              int32_t chunk_index,
+                                              std::vector<blob> &&entries,
+                                              std::vector<error_code_future_ptr> &&callbacks)
+{
+    if (ec != ERR_OK) {
+        dwarn_f("persist partition chunk {} failed, err = {}",
+                get_chunk_path(app_path, chunk_index),
+                ec.to_string());
+    }
+
+    {
+        zauto_lock l(_lock);
+        auto app = _apps.find(app_id);
+        if (app != _apps.end()) {
+            chunk_context &ctx = app->second.chunks[chunk_index];
+            // the failed updates are not kept, the callers are responsible for the retries
+            if (ec == ERR_OK) {
+                ctx.created = true;
+                ctx.entries = std::move(entries);
+            }
+            ctx.writing = false;
+            flush_chunk(storage, app_path, app_id, chunk_index);
+        }
+    }
+
+    for (auto &tsk : callbacks) {
+        tsk->enqueue_with(ec);
+    }
+}
+
+void partition_config_store::persist_chunk(dist::meta_state_service *storage,
+                                           const std::string &app_path,
+                                           int32_t chunk_size,
+                                           int32_t chunk_index,
+                                           const blob &value,
+                                           bool created,
+                                           const err_callback &cb)
+{
+    std::string chunk_path = get_chunk_path(app_path, chunk_index);
+    if (created) {
+        storage->set_data(chunk_path, value, LPC_META_STATE_HIGH, cb, &_tracker);
+        return;
+    }
+
+    storage->create_node(
+        chunk_path,
+        LPC_META_STATE_HIGH,
+        [=](error_code ec) {
+            if (ec == ERR_NODE_ALREADY_EXIST) {
+                persist_chunk(storage, app_path, chunk_size, chunk_index, value, true, cb);
+            } else if (ec == ERR_OBJECT_NOT_FOUND) {
+                // the first chunk of the app, create the chunk root first
+                storage->create_node(get_chunk_root(app_path),
+                                     LPC_META_STATE_HIGH,
+                                     [=](error_code err) {
+                                         if (err == ERR_OK || err == ERR_NODE_ALREADY_EXIST) {
+                                             persist_chunk(storage,
+                                                           app_path,
+                                                           chunk_size,
+                                                           chunk_index,
+                                                           value,
+                                                           false,
+                                                           cb);
+                                         } else {
+                                             cb(err);
+                                         }
+                                     },
+                                     encode_chunk_size(chunk_size),
+                                     &_tracker);
+            } else {
+                cb(ec);
+            }
+        },
+        value,
+        &_tracker);
+}
+
+/*static*/ error_code partition_config_store::migrate_app(dist::meta_state_service *storage,
+                                                         const std::string &app_path,
+                                                         int32_t app_id,
+                                                         bool to_chunked)
+{
+    return to_chunked ? migrate_to_chunked(storage, app_path, app_id)
+                      : migrate_to_legacy(storage, app_path);
+}
+
+/*static*/ error_code partition_config_store::migrate_to_chunked(
+    dist::meta_state_service *storage, const std::string &app_path, int32_t app_id)
+{
+    error_code ec;
+    blob value;
+    std::vector<std::string> children;
+    auto on_get_data = [&ec, &value](error_code err, const blob &v) {
+        ec = err;
+        value = v;
+    };
+    auto on_get_children = [&ec, &children](error_code err, const std::vector<std::string> &c) {
+        ec = err;
+        children = c;
+    };
+
+    const std::string chunk_root = get_chunk_root(app_path);
+    int32_t chunk_size = 0;
+    storage->get_data(chunk_root, LPC_META_CALLBACK, on_get_data)->wait();
+    if (ec == ERR_OBJECT_NOT_FOUND) {
+        chunk_size = FLAGS_partition_config_chunk_size;
+        storage
+            ->create_node(chunk_root,
+                          LPC_META_CALLBACK,
+                          [&ec](error_code err) { ec = err; },
+                          encode_chunk_size(chunk_size))
+            ->wait();
+        if (ec != ERR_OK && ec != ERR_NODE_ALREADY_EXIST) {
+            return ec;
+        }
+    } else if (ec != ERR_OK) {
+        return ec;
+    } else if (!decode_chunk_size(value, chunk_size)) {
+        derror_f("invalid chunk size of {}", chunk_root);
+        return ERR_INVALID_DATA;
+    }
+
+    storage->get_children(app_path, LPC_META_CALLBACK, on_get_children)->wait();
+    if (ec != ERR_OK) {
+        return ec;
+    }
+    // chunk index -> partition nodes of the legacy layout
+    std::map<int32_t, std::vector<int32_t>> legacy_partitions;
+    int32_t legacy_partition_count = 0;
+    for (const std::string &name : children) {
+        int32_t pidx = 0;
+        if (buf2int32(name, pidx) && pidx >= 0) {
+            legacy_partitions[pidx / chunk_size].push_back(pidx);
+            ++legacy_partition_count;
+        }
+    }
+    if (legacy_partitions.empty()) {
+        return ERR_OK;
+    }
+
+    storage->get_children(chunk_root, LPC_META_CALLBACK, on_get_children)->wait();
+    if (ec != ERR_OK) {
+        return ec;
+    }
+    std::set<std::string> existing_chunks(children.begin(), children.end());
+
+    ddebug_f("migrate {} partitions of {} to {} chunks",
+             legacy_partition_count,
+             app_path,
+             legacy_partitions.size());
+    for (const auto &kv : legacy_partitions) {
+        const int32_t chunk_index = kv.first;
+        if (existing_chunks.count(std::to_string(chunk_index)) != 0) {
+            derror_f("both partition nodes and chunk {} exist",
+                     get_chunk_path(app_path, chunk_index));
+            return ERR_INCONSISTENT_STATE;
+        }
+
+        partition_config_chunk chunk;
+        chunk.app_id = app_id;
+        chunk.start_index = chunk_index * chunk_size;
+        chunk.entries.resize(chunk_size);
+        // the nodes are read concurrently, `read_lock` protects `read_err` and `chunk.entries`
+        error_code read_err = ERR_OK;
+        dsn::zlock read_lock;
+        dsn::task_tracker tracker;
+        for (int32_t pidx : kv.second) {
+            storage->get_data(
+                app_path + "/" + std::to_string(pidx),
+                LPC_META_CALLBACK,
+                [&chunk, &read_err, &read_lock, chunk_size, pidx](error_code err, const blob &v) {
+                    partition_configuration pc;
+                    if (err == ERR_OK &&
+                        !dsn::json::json_forwarder<partition_configuration>::decode(v, pc)) {
+                        err = ERR_INVALID_DATA;
+                    }
+                    const int32_t offset = pidx - chunk.start_index;
+                    if (err == ERR_OK && (offset < 0 || offset >= chunk_size)) {
+                        derror_f("partition {} is out of the chunk starting from {}",
+                                 pidx,
+                                 chunk.start_index);
+                        err = ERR_INVALID_DATA;
+                    }
+
+                    dsn::zauto_lock l(read_lock);
+                    if (err != ERR_OK) {
+                        read_err = err;
+                    } else {
+                        chunk.entries[offset] = encode_partition_config(pc);
+                    }
+                },
+                &tracker);
+        }
+        tracker.wait_outstanding_tasks();
+        if (read_err != ERR_OK) {
+            derror_f("read partition nodes of {} failed, err = {}", app_path, read_err);
+            return read_err;
+        }
+
+        // the chunk is created and the partition nodes are removed atomically, so that every
+        // partition is always in one of the layouts
+        auto entries = storage->new_transaction_entries(kv.second.size() + 1);
+        entries->create_node(get_chunk_path(app_path, chunk_index), encode_chunk(chunk));
+        for (int32_t pidx : kv.second) {
+            entries->delete_node(app_path + "/" + std::to_string(pidx));
+        }
+        storage
+            ->submit_transaction(entries, LPC_META_CALLBACK, [&ec](error_code err) { ec = err; })
+            ->wait();
+        if (ec != ERR_OK) {
+            derror_f("migrate partitions to chunk {} failed, err = {}",
+                     get_chunk_path(app_path, chunk_index),
+                     ec);
+            return ec;
+        }
+    }
+    return ERR_OK;
+}
+
+/*static*/ error_code partition_config_store::migrate_to_legacy(dist::meta_state_service *storage,
+                                                               const std::string &app_path)
+{
+    error_code ec;
+    blob value;
+    std::vector<std::string> children;
+
+    const std::string chunk_root = get_chunk_root(app_path);
+    storage
+        ->get_children(chunk_root,
+                       LPC_META_CALLBACK,
+                       [&ec, &children](error_code err, const std::vector<std::string> &c) {
+                           ec = err;
+                           children = c;
+                       })
+        ->wait();
+    if (ec == ERR_OBJECT_NOT_FOUND) {
+        return ERR_OK;
+    } else if (ec != ERR_OK) {
+        return ec;
+    }
+
+    ddebug_f("migrate {} chunks of {} to partition nodes", children.size(), app_path);
+    for (const std::string &name : children) {
+        const std::string chunk_path = chunk_root + "/" + name;
+        storage
+            ->get_data(chunk_path,
+                       LPC_META_CALLBACK,
+                       [&ec, &value](error_code err, const blob &v) {
+                           ec = err;
+                           value = v;
+                       })
+            ->wait();
+        if (ec != ERR_OK) {
+            return ec;
+        }
+        partition_config_chunk chunk;
+        if (!decode_chunk(value, chunk)) {
+            derror_f("invalid partition chunk {}", chunk_path);
+            return ERR_INVALID_DATA;
+        }
+
+        auto entries = storage->new_transaction_entries(chunk.entries.size() + 1);
+        for (const blob &entry : chunk.entries) {
+            partition_configuration pc;
+            if (decode_partition_config(entry, pc)) {
+                entries->create_node(
+                    app_path + "/" + std::to_string(pc.pid.get_partition_index()),
+                    dsn::json::json_forwarder<partition_configuration>::encode(pc));
+            }
+        }
+        entries->delete_node(chunk_path);
+        storage
+            ->submit_transaction(entries, LPC_META_CALLBACK, [&ec](error_code err) { ec = err; })
+            ->wait();
+        if (ec != ERR_OK) {
+            derror_f("migrate chunk {} to partition nodes failed, err = {}", chunk_path, ec);
+            return ec;
+        }
+    }
+
+    storage
+        ->delete_node(chunk_root, false, LPC_META_CALLBACK, [&ec](error_code err) { ec = err; })
+        ->wait();
+    return ec == ERR_OBJECT_NOT_FOUND ? ERR_OK : ec;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,165 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dsn/dist/meta_state_service.h>
+#include <dsn/dist/replication/replication_types.h>
+#include <dsn/tool-api/future_types.h>
+#include <dsn/tool-api/task_tracker.h>
+#include <dsn/tool-api/zlocks.h>
+
+namespace dsn {
+namespace replication {
+
+// A chunk holds the partition configurations of [start_index, start_index + entries.size()) of
+// an app. Every entry is a partition_configuration encoded in thrift binary, an empty entry means
+// the partition isn't persisted yet (e.g. a half created app or a half registered split child).
+struct partition_config_chunk
+{
+    int32_t app_id{0};
+    int32_t start_index{0};
+    std::vector<blob> entries;
+};
+
+// Persistence of partition configurations in the chunked layout:
+//
+//   _apps_root/<app-id>/partition_chunks               chunk size, i.e. "256"
+//   _apps_root/<app-id>/partition_chunks/<chunk-index>  partition_config_chunk, in binary
+//
+// Compared with the legacy layout, which stores every partition as a json node
+// _apps_root/<app-id>/<partition-id>, an app with N partitions only takes N / chunk_size nodes,
+// so that loading all the partitions on meta server startup takes a few reads per app.
+//
+// Writes to the partitions of the same chunk are group committed: only one write of a chunk is
+// in flight, the updates arriving meanwhile are batched into the next write. Every update is
+// acknowledged only after the chunk containing it is persisted, so the callers see the same
+// semantics as writing a single partition node.
+//
+// The layout is chosen by [meta_server] partition_config_chunked_layout, and the partitions are
+// converted between the layouts by migrate_app() on meta server startup, chunk by chunk in a
+// transaction, so a crash in the middle of a migration leaves every chunk in one of the layouts.
+class partition_config_store
+{
+public:
+    static bool chunked_layout_enabled();
+
+    static std::string get_chunk_root(const std::string &app_path);
+    static std::string get_chunk_path(const std::string &app_path, int32_t chunk_index);
+
+    static blob encode_partition_config(const partition_configuration &pc);
+    static bool decode_partition_config(const blob &value, /*out*/ partition_configuration &pc);
+
+    static blob encode_chunk(const partition_config_chunk &chunk);
+    static bool decode_chunk(const blob &value, /*out*/ partition_config_chunk &chunk);
+
+    static blob encode_chunk_size(int32_t chunk_size);
+    static bool decode_chunk_size(const blob &value, /*out*/ int32_t &chunk_size);
+
+    ~partition_config_store();
+
+    // Forgets all the persisted chunks, called before the partitions are reloaded.
+    void reset();
+
+    // Records the persisted chunks of an app, so that later writes keep the other partitions in
+    // the chunk unchanged.
+    void load_app(int32_t app_id, int32_t chunk_size);
+    void load_chunk(int32_t chunk_size, const partition_config_chunk &chunk);
+
+    // Persists `pc` into the chunk it belongs to, `cb` is called after the chunk is persisted.
+    // The returned task can be cancelled just like the ones of meta_state_service.
+    task_ptr write(dist::meta_state_service *storage,
+                   const std::string &app_path,
+                   const partition_configuration &pc,
+                   task_code cb_code,
+                   const err_callback &cb,
+                   task_tracker *tracker);
+
+    // Converts the partitions of an app to the chunked layout if `to_chunked`, or back to the
+    // legacy layout otherwise. Blocks until done, and must be called before the partitions are
+    // loaded.
+    static error_code migrate_app(dist::meta_state_service *storage,
+                                  const std::string &app_path,
+                                  int32_t app_id,
+                                  bool to_chunked);
+
+private:
+    struct pending_write
+    {
+        blob value;
+        std::vector<error_code_future_ptr> callbacks;
+    };
+
+    struct chunk_context
+    {
+        bool created{false};
+        bool writing{false};
+        // the persisted entries of the chunk
+        std::vector<blob> entries;
+        // partition index -> the latest update not persisted yet
+        std::map<int32_t, pending_write> pending;
+    };
+
+    struct app_context
+    {
+        int32_t chunk_size{0};
+        std::map<int32_t, chunk_context> chunks;
+    };
+
+    // Writes the pending updates of a chunk if there is no write of it in flight,
+    // should be called with _lock held.
+    void flush_chunk(dist::meta_state_service *storage,
+                     const std::string &app_path,
+                     int32_t app_id,
+                     int32_t chunk_index);
+    void on_chunk_written(error_code ec,
+                          dist::meta_state_service *storage,
+                          const std::string &app_path,
+                          int32_t app_id,
+                          int32_t chunk_index,
+                          std::vector<blob> &&entries,
+                          std::vector<error_code_future_ptr> &&callbacks);
+    // Sets the data of the chunk node, creates the node (and the chunk root) if not `created`.
+    void persist_chunk(dist::meta_state_service *storage,
+                       const std::string &app_path,
+                       int32_t chunk_size,
+                       int32_t chunk_index,
+                       const blob &value,
+                       bool created,
+                       const err_callback &cb);
+
+    static error_code migrate_to_chunked(dist::meta_state_service *storage,
+                                         const std::string &app_path,
+                                         int32_t app_id);
+    static error_code migrate_to_legacy(dist::meta_state_service *storage,
+                                        const std::string &app_path);
+
+    friend class partition_config_store_test;
+
+    zlock _lock;
+    std::map<int32_t, app_context> _apps;
+
+    // declared last to cancel the callbacks before the contexts are destroyed
+    dsn::task_tracker _tracker;
+};
+
+} // namespace replication
+} // namespace dsn
@@ -44,6 +44,7 @@
 #include <dsn/tool-api/async_calls.h>
 #include <sstream>
 #include <cinttypes>
+#include <set>
 #include <string>
 #include <boost/lexical_cast.hpp>
 
@@ -87,6 +88,12 @@ DSN_DEFINE_group_validator(min_max_allowed_replica_count, [](std::string &messag
     return true;
 });
 
+DSN_DEFINE_bool("meta_server",
+                enable_state_view,
+                true,
+                "publish a view of the apps after every batch of updates for the read-only "
+                "requests, false means they read the apps under the state lock");
+
 static const char *lock_state = "lock";
 static const char *unlock_state = "unlock";
 
@@ -214,6 +221,11 @@ void server_state::initialize(meta_service *meta_svc, const std::string &apps_ro
         "recent_partition_change_writable_count",
         COUNTER_TYPE_VOLATILE_NUMBER,
         "partition change to writable count in the recent period");
+    _state_view_age_ms.init_app_counter(
+        "eon.server_state",
+        "state_view_age_ms",
+        COUNTER_TYPE_NUMBER,
+        "milliseconds since the view served to the last read-only request was published");
 }
 
 bool server_state::spin_wait_staging(int timeout_seconds)
@@ -580,70 +592,178 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
     dsn::task_tracker tracker;
 
     dist::meta_state_service *storage = _meta_svc->get_remote_storage();
-    auto sync_partition = [this, storage, &err, &tracker](
+    // `partition_path` is the node the partition is loaded from, only for logging
+    auto on_partition_synced = [this, &err](std::shared_ptr<app_state> app,
+                                            int partition_id,
+                                            const std::string &partition_path,
+                                            error_code ec,
+                                            const partition_configuration &pc) {
+        if (ec == ERR_OK) {
+            dassert(pc.pid.get_app_id() == app->app_id &&
+                        pc.pid.get_partition_index() == partition_id,
+                    "invalid partition config");
+            {
+                apps_write_lock l(this);
+                app->partitions[partition_id] = pc;
+                ++app->partitions_version;
+                for (const dsn::rpc_address &addr : pc.last_drops) {
+                    app->helpers->contexts[partition_id].record_drop_history(addr);
+                }
+
+                if (app->status == app_status::AS_CREATING &&
+                    (pc.partition_flags & pc_flags::dropped) != 0) {
+                    recall_partition(app, partition_id);
+                } else if (app->status == app_status::AS_DROPPING &&
+                           (pc.partition_flags & pc_flags::dropped) == 0) {
+                    drop_partition(app, partition_id);
+                } else
+                    process_one_partition(app);
+                // check consistency between app bulk_loading flag and app bulk load dir
+                if (app->helpers->partitions_in_progress.load() == 0 &&
+                    app->status == app_status::AS_AVAILABLE &&
+                    _meta_svc->get_bulk_load_service()) {
+                    bool is_bulk_loading = app->is_bulk_loading;
+                    _meta_svc->get_bulk_load_service()->check_app_bulk_load_states(
+                        std::move(app), is_bulk_loading);
+                }
+            }
+        } else if (ec == ERR_OBJECT_NOT_FOUND) {
+            auto init_partition_count =
+                app->init_partition_count > 0 ? app->init_partition_count : app->partition_count;
+            if (partition_id < init_partition_count) {
+                dwarn_f("partition node {} not exist on remote storage, may half create before",
+                        partition_path);
+                init_app_partition_node(app, partition_id, nullptr);
+            } else if (partition_id >= app->partition_count / 2) {
+                dwarn_f("partition node {} not exist on remote storage, may half split before",
+                        partition_path);
+                apps_write_lock l(this);
+                app->helpers->split_states.status[partition_id - app->partition_count / 2] =
+                    split_status::SPLITTING;
+                app->helpers->split_states.splitting_count++;
+                app->partitions[partition_id].ballot = invalid_ballot;
+                app->partitions[partition_id].pid = gpid(app->app_id, partition_id);
+                ++app->partitions_version;
+                process_one_partition(app);
+            }
+
+        } else {
+            derror("get partition node failed, reason(%s)", ec.to_string());
+            err = ec;
+        }
+    };
+
+    auto sync_partition = [storage, &tracker, &on_partition_synced](
         std::shared_ptr<app_state> &app, int partition_id, const std::string &partition_path) {
         storage->get_data(
             partition_path,
             LPC_META_CALLBACK,
-            [this, app, partition_id, partition_path, &err](error_code ec,
-                                                            const blob &value) mutable {
+            [app, partition_id, partition_path, &on_partition_synced](error_code ec,
+                                                                      const blob &value) mutable {
+                partition_configuration pc;
                 if (ec == ERR_OK) {
-                    partition_configuration pc;
                     dsn::json::json_forwarder<partition_configuration>::decode(value, pc);
+                }
+                on_partition_synced(app, partition_id, partition_path, ec, pc);
+            },
+            &tracker);
+    };
 
-                    dassert(pc.pid.get_app_id() == app->app_id &&
-                                pc.pid.get_partition_index() == partition_id,
-                            "invalid partition config");
-                    {
-                        zauto_write_lock l(_lock);
-                        app->partitions[partition_id] = pc;
-                        for (const dsn::rpc_address &addr : pc.last_drops) {
-                            app->helpers->contexts[partition_id].record_drop_history(addr);
-                        }
-
-                        if (app->status == app_status::AS_CREATING &&
-                            (pc.partition_flags & pc_flags::dropped) != 0) {
-                            recall_partition(app, partition_id);
-                        } else if (app->status == app_status::AS_DROPPING &&
-                                   (pc.partition_flags & pc_flags::dropped) == 0) {
-                            drop_partition(app, partition_id);
-                        } else
-                            process_one_partition(app);
-                        // check consistency between app bulk_loading flag and app bulk load dir
-                        if (app->helpers->partitions_in_progress.load() == 0 &&
-                            app->status == app_status::AS_AVAILABLE &&
-                            _meta_svc->get_bulk_load_service()) {
-                            bool is_bulk_loading = app->is_bulk_loading;
-                            _meta_svc->get_bulk_load_service()->check_app_bulk_load_states(
-                                std::move(app), is_bulk_loading);
-                        }
-                    }
-                } else if (ec == ERR_OBJECT_NOT_FOUND) {
-                    auto init_partition_count = app->init_partition_count > 0
-                                                    ? app->init_partition_count
-                                                    : app->partition_count;
-                    if (partition_id < init_partition_count) {
-                        dwarn_f(
-                            "partition node {} not exist on remote storage, may half create before",
-                            partition_path);
-                        init_app_partition_node(app, partition_id, nullptr);
-                    } else if (partition_id >= app->partition_count / 2) {
-                        dwarn_f(
-                            "partition node {} not exist on remote storage, may half split before",
-                            partition_path);
-                        zauto_write_lock l(_lock);
-                        app->helpers->split_states.status[partition_id - app->partition_count / 2] =
-                            split_status::SPLITTING;
-                        app->helpers->split_states.splitting_count++;
-                        app->partitions[partition_id].ballot = invalid_ballot;
-                        app->partitions[partition_id].pid = gpid(app->app_id, partition_id);
-                        process_one_partition(app);
+    // load all the partitions in a chunk by one read, see partition_config_store
+    auto sync_partition_chunk = [this, storage, &err, &tracker, &on_partition_synced](
+        std::shared_ptr<app_state> &app, int32_t chunk_size, const std::string &chunk_path) {
+        storage->get_data(
+            chunk_path,
+            LPC_META_CALLBACK,
+            [this, app, chunk_size, chunk_path, &err, &on_partition_synced](
+                error_code ec, const blob &value) mutable {
+                if (ec != ERR_OK) {
+                    derror_f("get partition chunk {} failed, err = {}", chunk_path, ec);
+                    err = ec;
+                    return;
+                }
+                partition_config_chunk chunk;
+                dassert_f(partition_config_store::decode_chunk(value, chunk) &&
+                              chunk.app_id == app->app_id,
+                          "invalid partition chunk {}",
+                          chunk_path);
+                // must be loaded before the partitions are processed, which may update them
+                _partition_store.load_chunk(chunk_size, chunk);
+
+                for (int32_t i = 0; i < static_cast<int32_t>(chunk.entries.size()); ++i) {
+                    int32_t partition_id = chunk.start_index + i;
+                    if (partition_id >= app->partition_count) {
+                        break;
                     }
+                    partition_configuration pc;
+                    error_code pc_err =
+                        partition_config_store::decode_partition_config(chunk.entries[i], pc)
+                            ? ERR_OK
+                            : ERR_OBJECT_NOT_FOUND;
+                    on_partition_synced(app, partition_id, chunk_path, pc_err, pc);
+                }
+            },
+            &tracker);
+    };
 
-                } else {
-                    derror("get partition node failed, reason(%s)", ec.to_string());
+    auto sync_app_partitions = [this, storage, &err, &tracker, &sync_partition,
+                                &sync_partition_chunk](std::shared_ptr<app_state> &app,
+                                                       const std::string &app_path) {
+        auto sync_partitions = [app, app_path, &sync_partition](int begin, int end) mutable {
+            for (int i = begin; i < end; i++) {
+                sync_partition(app, i, app_path + "/" + boost::lexical_cast<std::string>(i));
+            }
+        };
+
+        std::string chunk_root = partition_config_store::get_chunk_root(app_path);
+        storage->get_data(
+            chunk_root,
+            LPC_META_CALLBACK,
+            [this, storage, app, chunk_root, sync_partitions, &err, &tracker,
+             &sync_partition_chunk](error_code ec, const blob &value) mutable {
+                if (ec == ERR_OBJECT_NOT_FOUND) {
+                    // the legacy layout
+                    sync_partitions(0, app->partition_count);
+                    return;
+                }
+                int32_t chunk_size = 0;
+                if (ec != ERR_OK) {
+                    derror_f("get partition chunk root {} failed, err = {}", chunk_root, ec);
                     err = ec;
+                    return;
                 }
+                dassert_f(partition_config_store::decode_chunk_size(value, chunk_size),
+                          "invalid chunk size of {}",
+                          chunk_root);
+                _partition_store.load_app(app->app_id, chunk_size);
+
+                storage->get_children(
+                    chunk_root,
+                    LPC_META_CALLBACK,
+                    [app, chunk_root, chunk_size, sync_partitions, &err, &sync_partition_chunk](
+                        error_code ec, const std::vector<std::string> &chunks) mutable {
+                        if (ec != ERR_OK) {
+                            derror_f("get partition chunks of {} failed, err = {}",
+                                     chunk_root,
+                                     ec);
+                            err = ec;
+                            return;
+                        }
+                        std::set<std::string> existing_chunks(chunks.begin(), chunks.end());
+                        for (int32_t begin = 0; begin < app->partition_count;
+                             begin += chunk_size) {
+                            std::string chunk_index = std::to_string(begin / chunk_size);
+                            if (existing_chunks.count(chunk_index) != 0) {
+                                sync_partition_chunk(
+                                    app, chunk_size, chunk_root + "/" + chunk_index);
+                            } else {
+                                // not persisted yet, or not migrated from the legacy layout
+                                sync_partitions(
+                                    begin, std::min(begin + chunk_size, app->partition_count));
+                            }
+                        }
+                    },
+                    &tracker);
             },
             &tracker);
     };
@@ -652,14 +772,14 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
         storage->get_data(
             app_path,
             LPC_META_CALLBACK,
-            [this, app_path, &err, &sync_partition](error_code ec, const blob &value) {
+            [this, app_path, &err, &sync_app_partitions](error_code ec, const blob &value) {
                 if (ec == ERR_OK) {
                     app_info info;
                     dassert(dsn::json::json_forwarder<app_info>::decode(value, info),
                             "invalid json data");
                     std::shared_ptr<app_state> app = app_state::create(info);
                     {
-                        zauto_write_lock l(_lock);
+                        apps_write_lock l(this);
                         _all_apps.emplace(app->app_id, app);
                         if (app->status == app_status::AS_AVAILABLE) {
                             app->status = app_status::AS_CREATING;
@@ -674,11 +794,7 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
                         }
                     }
                     app->helpers->split_states.splitting_count = 0;
-                    for (int i = 0; i < app->partition_count; i++) {
-                        std::string partition_path =
-                            app_path + "/" + boost::lexical_cast<std::string>(i);
-                        sync_partition(app, i, partition_path);
-                    }
+                    sync_app_partitions(app, app_path);
                 } else {
                     derror("get app info from meta state service failed, path = %s, err = %s",
                            app_path.c_str(),
@@ -691,6 +807,7 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
 
     _all_apps.clear();
     _exist_apps.clear();
+    _partition_store.reset();
 
     std::string transaction_state;
     storage
@@ -711,6 +828,11 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
             "invalid transaction state(%s)",
             transaction_state.c_str());
 
+    err = migrate_partitions_layout();
+    if (err != ERR_OK) {
+        return err;
+    }
+
     storage->get_children(
         _apps_root,
         LPC_META_CALLBACK,
@@ -734,9 +856,49 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
     return err;
 }
 
+error_code server_state::migrate_partitions_layout()
+{
+    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
+    const bool to_chunked = partition_config_store::chunked_layout_enabled();
+
+    error_code err;
+    std::vector<std::string> apps;
+    storage
+        ->get_children(_apps_root,
+                       LPC_META_CALLBACK,
+                       [&err, &apps](error_code ec, const std::vector<std::string> &children) {
+                           err = ec;
+                           apps = children;
+                       })
+        ->wait();
+    if (err != ERR_OK) {
+        derror_f("get app list from meta state service failed, path = {}, err = {}",
+                 _apps_root,
+                 err);
+        return err;
+    }
+
+    for (const auto &appid_str : apps) {
+        int32_t app_id = 0;
+        if (!buf2int32(appid_str, app_id)) {
+            continue;
+        }
+        err = partition_config_store::migrate_app(
+            storage, _apps_root + "/" + appid_str, app_id, to_chunked);
+        if (err != ERR_OK) {
+            derror_f("migrate partitions of app({}) to the {} layout failed, err = {}",
+                     app_id,
+                     to_chunked ? "chunked" : "legacy",
+                     err);
+            return err;
+        }
+    }
+    return ERR_OK;
+}
+
 void server_state::initialize_node_state()
 {
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
     for (auto &app_pair : _all_apps) {
         app_state &app = *(app_pair.second);
         for (partition_configuration &pc : app.partitions) {
@@ -973,25 +1135,83 @@ bool server_state::query_configuration_by_gpid(dsn::gpid id,
     return false;
 }
 
+server_state_view_ptr server_state::get_view() const
+{
+    server_state_view_ptr view = std::atomic_load(&_view);
+    if (view != nullptr) {
+        _state_view_age_ms->set(dsn_now_ms() - view->publish_time_ms);
+        return view;
+    }
+    zauto_read_lock l(_lock);
+    return server_state_view::build(_all_apps, _exist_apps, nullptr);
+}
+
+void server_state::start_view_publisher()
+{
+    if (!FLAGS_enable_state_view) {
+        return;
+    }
+    _view_enabled = true;
+    publish_view();
+}
+
+void server_state::publish_view()
+{
+    // the publishers are serialized, so that a view never replaces a newer one
+    zauto_lock view_lock(_view_lock);
+    server_state_view_ptr prev = std::atomic_load(&_view);
+    server_state_view_ptr view;
+    {
+        zauto_read_lock l(_lock);
+        view = server_state_view::build(_all_apps, _exist_apps, prev);
+    }
+    if (prev == nullptr || view->version != prev->version) {
+        dinfo_f("publish state view, version = {}", view->version);
+    }
+    std::atomic_store(&_view, view);
+}
+
+server_state::apps_write_lock::apps_write_lock(server_state *state) : _state(state)
+{
+    _state->_lock.lock_write();
+}
+
+server_state::apps_write_lock::~apps_write_lock()
+{
+    // the view is built under the read lock, after the batch of updates is done
+    _state->_lock.unlock_write();
+    if (_state->_view_enabled.load()) {
+        _state->publish_view();
+    }
+}
+
 void server_state::query_configuration_by_index(
     const configuration_query_by_index_request &request,
     /*out*/ configuration_query_by_index_response &response)
 {
-    zauto_read_lock l(_lock);
-    auto iter = _exist_apps.find(request.app_name.c_str());
-    if (iter == _exist_apps.end()) {
+    query_configuration_by_index(*get_view(), request, response);
+}
+
+/*static*/ void server_state::query_configuration_by_index(
+    const server_state_view &view,
+    const configuration_query_by_index_request &request,
+    /*out*/ configuration_query_by_index_response &response)
+{
+    auto iter = view.exist_apps.find(request.app_name);
+    if (iter == view.exist_apps.end()) {
         response.err = ERR_OBJECT_NOT_FOUND;
         return;
     }
 
-    std::shared_ptr<app_state> &app = iter->second;
-    if (app->status != app_status::AS_AVAILABLE) {
+    const app_info &app = iter->second->info;
+    const std::vector<partition_configuration> &partitions = iter->second->partitions;
+    if (app.status != app_status::AS_AVAILABLE) {
         derror("invalid status(%s) in exist app(%s), app_id(%d)",
-               enum_to_string(app->status),
-               (app->app_name).c_str(),
-               app->app_id);
+               enum_to_string(app.status),
+               app.app_name.c_str(),
+               app.app_id);
 
-        switch (app->status) {
+        switch (app.status) {
         case app_status::AS_CREATING:
         case app_status::AS_RECALLING:
             response.err = ERR_BUSY_CREATING;
@@ -1006,16 +1226,36 @@ void server_state::query_configuration_by_index(
     }
 
     response.err = ERR_OK;
-    response.app_id = app->app_id;
-    response.partition_count = app->partition_count;
-    response.is_stateful = app->is_stateful;
+    response.app_id = app.app_id;
+    response.partition_count = app.partition_count;
+    response.is_stateful = app.is_stateful;
 
     for (const int32_t &index : request.partition_indices) {
-        if (index >= 0 && index < app->partitions.size())
-            response.partitions.push_back(app->partitions[index]);
+        if (index >= 0 && index < partitions.size())
+            response.partitions.push_back(partitions[index]);
     }
     if (response.partitions.empty())
-        response.partitions = app->partitions;
+        response.partitions = partitions;
+}
+
+task_ptr server_state::write_partition_config_on_remote(const partition_configuration &pc,
+                                                        bool create_new,
+                                                        task_code cb_code,
+                                                        const err_callback &cb,
+                                                        task_tracker *tracker)
+{
+    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
+    if (partition_config_store::chunked_layout_enabled()) {
+        std::string app_path = _apps_root + "/" + std::to_string(pc.pid.get_app_id());
+        return _partition_store.write(storage, app_path, pc, cb_code, cb, tracker);
+    }
+
+    std::string partition_path = get_partition_path(pc.pid);
+    blob value = dsn::json::json_forwarder<partition_configuration>::encode(pc);
+    if (create_new) {
+        return storage->create_node(partition_path, cb_code, cb, value, tracker);
+    }
+    return storage->set_data(partition_path, value, cb_code, cb, tracker);
 }
 
 void server_state::init_app_partition_node(std::shared_ptr<app_state> &app,
@@ -1026,7 +1266,7 @@ void server_state::init_app_partition_node(std::shared_ptr<app_state> &app,
         dinfo("create partition node: gpid(%d.%d), result: %s", app->app_id, pidx, ec.to_string());
         if (ERR_OK == ec || ERR_NODE_ALREADY_EXIST == ec) {
             {
-                zauto_write_lock l(_lock);
+                apps_write_lock l(this);
                 process_one_partition(app);
             }
             if (callback) {
@@ -1050,11 +1290,8 @@ void server_state::init_app_partition_node(std::shared_ptr<app_state> &app,
         }
     };
 
-    std::string app_partition_path = get_partition_path(*app, pidx);
-    dsn::blob value =
-        dsn::json::json_forwarder<partition_configuration>::encode(app->partitions[pidx]);
-    _meta_svc->get_remote_storage()->create_node(
-        app_partition_path, LPC_META_STATE_HIGH, on_create_app_partition, value);
+    write_partition_config_on_remote(
+        app->partitions[pidx], true, LPC_META_STATE_HIGH, on_create_app_partition, nullptr);
 }
 
 void server_state::do_app_create(std::shared_ptr<app_state> &app)
@@ -1123,7 +1360,7 @@ void server_state::create_app(dsn::message_ex *msg)
         response.err = ERR_INVALID_PARAMETERS;
         will_create_app = false;
     } else {
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         app = get_app(request.app_name);
         if (nullptr != app) {
             switch (app->status) {
@@ -1183,7 +1420,7 @@ void server_state::do_app_drop(std::shared_ptr<app_state> &app)
 {
     auto after_mark_app_dropped = [this, app](error_code ec) mutable {
         if (ERR_OK == ec) {
-            zauto_write_lock l(_lock);
+            apps_write_lock l(this);
             _exist_apps.erase(app->app_name);
             for (int i = 0; i < app->partition_count; ++i) {
                 drop_partition(app, i);
@@ -1216,7 +1453,7 @@ void server_state::drop_app(dsn::message_ex *msg)
     dsn::unmarshall(msg, request);
     ddebug("drop app request, name(%s)", request.app_name.c_str());
     {
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         app = get_app(request.app_name);
         if (nullptr == app) {
             response.err = request.options.success_if_not_exist ? ERR_OK : ERR_APP_NOT_EXIST;
@@ -1270,7 +1507,7 @@ void server_state::drop_app(dsn::message_ex *msg)
 void server_state::do_app_recall(std::shared_ptr<app_state> &app)
 {
     auto after_recall_app = [this, app](dsn::error_code ec) mutable {
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         for (int i = 0; i < app->partition_count; ++i) {
             recall_partition(app, i);
         }
@@ -1293,7 +1530,7 @@ void server_state::recall_app(dsn::message_ex *msg)
 
     bool do_recalling = false;
     {
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         target_app = get_app(request.app_id);
         if (target_app == nullptr) {
             response.err = ERR_APP_NOT_EXIST;
@@ -1339,11 +1576,17 @@ void server_state::recall_app(dsn::message_ex *msg)
 
 void server_state::list_apps(const configuration_list_apps_request &request,
                              configuration_list_apps_response &response)
+{
+    list_apps(*get_view(), request, response);
+}
+
+/*static*/ void server_state::list_apps(const server_state_view &view,
+                                        const configuration_list_apps_request &request,
+                                        configuration_list_apps_response &response)
 {
     dinfo("list app request, status(%d)", request.status);
-    zauto_read_lock l(_lock);
-    for (auto &kv : _all_apps) {
-        app_state &app = *(kv.second);
+    for (const auto &kv : view.all_apps) {
+        const app_info &app = kv.second->info;
         if (request.status == app_status::AS_INVALID || request.status == app.status) {
             response.infos.push_back(app);
         }
@@ -1548,6 +1791,7 @@ void server_state::update_configuration_locally(
     // as we sync to remote storage according to it
     std::string old_config_str = boost::lexical_cast<std::string>(old_cfg);
     old_cfg = config_request->config;
+    ++app.partitions_version;
     auto find_name = _config_type_VALUES_TO_NAMES.find(config_request->type);
     if (find_name != _config_type_VALUES_TO_NAMES.end()) {
         ddebug("meta update config ok: type(%s), old_config=%s, %s",
@@ -1598,13 +1842,9 @@ task_ptr server_state::update_configuration_on_remote(
             std::chrono::seconds(1));
     }
 
-    partition_configuration &pc = config_request->config;
-    std::string storage_path = get_partition_path(pc.pid);
-
-    blob json_config = dsn::json::json_forwarder<partition_configuration>::encode(pc);
-    return _meta_svc->get_remote_storage()->set_data(
-        storage_path,
-        json_config,
+    return write_partition_config_on_remote(
+        config_request->config,
+        false,
         LPC_META_STATE_HIGH,
         std::bind(&server_state::on_update_configuration_on_remote_reply,
                   this,
@@ -1616,7 +1856,7 @@ task_ptr server_state::update_configuration_on_remote(
 void server_state::on_update_configuration_on_remote_reply(
     error_code ec, std::shared_ptr<configuration_update_request> &config_request)
 {
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
     dsn::gpid &gpid = config_request->config.pid;
     std::shared_ptr<app_state> app = get_app(gpid.get_app_id());
     config_context &cc = app->helpers->contexts[gpid.get_partition_index()];
@@ -1676,8 +1916,9 @@ void server_state::recall_partition(std::shared_ptr<app_state> &app, int pidx)
 {
     auto on_recall_partition = [this, app, pidx](dsn::error_code error) mutable {
         if (error == dsn::ERR_OK) {
-            zauto_write_lock l(_lock);
+            apps_write_lock l(this);
             app->partitions[pidx].partition_flags &= (~pc_flags::dropped);
+            ++app->partitions_version;
             process_one_partition(app);
         } else if (error == dsn::ERR_TIMEOUT) {
             tasking::enqueue(LPC_META_STATE_HIGH,
@@ -1694,10 +1935,8 @@ void server_state::recall_partition(std::shared_ptr<app_state> &app, int pidx)
     dassert((pc.partition_flags & pc_flags::dropped), "");
 
     pc.partition_flags = 0;
-    blob json_partition = dsn::json::json_forwarder<partition_configuration>::encode(pc);
-    std::string partition_path = get_partition_path(pc.pid);
-    _meta_svc->get_remote_storage()->set_data(
-        partition_path, json_partition, LPC_META_STATE_HIGH, on_recall_partition);
+    ++app->partitions_version;
+    write_partition_config_on_remote(pc, false, LPC_META_STATE_HIGH, on_recall_partition, nullptr);
 }
 
 void server_state::drop_partition(std::shared_ptr<app_state> &app, int pidx)
@@ -1861,7 +2100,7 @@ void server_state::downgrade_stateless_nodes(std::shared_ptr<app_state> &app,
 void server_state::on_update_configuration(
     std::shared_ptr<configuration_update_request> &cfg_request, dsn::message_ex *msg)
 {
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
     dsn::gpid &gpid = cfg_request->config.pid;
     std::shared_ptr<app_state> app = get_app(gpid.get_app_id());
     partition_configuration &pc = app->partitions[gpid.get_partition_index()];
@@ -1961,7 +2200,7 @@ void server_state::on_partition_node_dead(std::shared_ptr<app_state> &app,
 void server_state::on_change_node_state(rpc_address node, bool is_alive)
 {
     dinfo("change node(%s) state to %s", node.to_string(), is_alive ? "alive" : "dead");
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
     if (!is_alive) {
         auto iter = _nodes.find(node);
         if (iter == _nodes.end()) {
@@ -1987,7 +2226,7 @@ void server_state::on_change_node_state(rpc_address node, bool is_alive)
 void server_state::on_propose_balancer(const configuration_balancer_request &request,
                                        configuration_balancer_response &response)
 {
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
     std::shared_ptr<app_state> app = get_app(request.gpid.get_app_id());
     if (app == nullptr || app->status != app_status::AS_AVAILABLE ||
         request.gpid.get_partition_index() < 0 ||
@@ -2138,6 +2377,7 @@ error_code server_state::construct_partitions(
                 bool is_succeed =
                     construct_replica({&_all_apps, &_nodes}, pc.pid, app->max_replica_count);
                 if (is_succeed) {
+                    ++app->partitions_version;
                     ddebug("construct partition(%d.%d) succeed: %s",
                            app->app_id,
                            pc.pid.get_partition_index(),
@@ -2290,7 +2530,7 @@ server_state::sync_apps_from_replica_nodes(const std::vector<dsn::rpc_address> &
         return dsn::ERR_TRY_AGAIN;
     }
 
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
 
     dsn::error_code err = construct_apps(query_app_responses, replica_nodes, hint_message);
     if (err != dsn::ERR_OK) {
@@ -2339,7 +2579,7 @@ void server_state::on_start_recovery(const configuration_recovery_request &req,
 void server_state::clear_proposals()
 {
     ddebug("clear all exist proposals");
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
     for (auto &kv : _exist_apps) {
         std::shared_ptr<app_state> &app = kv.second;
         app->helpers->clear_proposals();
@@ -2397,7 +2637,7 @@ bool server_state::check_all_partitions()
     int total_partitions = 0;
     meta_function_level::type level = _meta_svc->get_function_level();
 
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
 
     update_partition_perf_counter();
 
@@ -2729,7 +2969,7 @@ void server_state::set_app_envs(const app_env_rpc &env_rpc)
         dassert(
             ec == ERR_OK, "update app_info to remote storage failed with err = %s", ec.to_string());
 
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         std::shared_ptr<app_state> app = get_app(app_name);
         std::string old_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
         for (int idx = 0; idx < keys.size(); idx++) {
@@ -2802,7 +3042,7 @@ void server_state::del_app_envs(const app_env_rpc &env_rpc)
         dassert(
             ec == ERR_OK, "update app_info to remote storage failed with err = %s", ec.to_string());
 
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         std::shared_ptr<app_state> app = get_app(app_name);
         std::string old_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
         for (const auto &key : keys) {
@@ -2896,7 +3136,7 @@ void server_state::clear_app_envs(const app_env_rpc &env_rpc)
                     "update app_info to remote storage failed with err = %s",
                     ec.to_string());
 
-            zauto_write_lock l(_lock);
+            apps_write_lock l(this);
             std::shared_ptr<app_state> app = get_app(app_name);
             std::string old_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
             if (prefix.empty()) {
@@ -3001,7 +3241,7 @@ void server_state::on_start_manual_compact(start_manual_compact_rpc rpc)
 
     // update local manual compaction status
     {
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         auto app = get_app(app_name);
         app->helpers->reset_manual_compact_status();
     }
@@ -3079,7 +3319,7 @@ void server_state::update_compaction_envs_on_remote_storage(start_manual_compact
     do_update_app_info(app_path, ainfo, [this, app_name, keys, values, rpc](error_code ec) {
         dassert_f(ec == ERR_OK, "update app_info to remote storage failed with err = {}", ec);
 
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         auto app = get_app(app_name);
         std::string old_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
         for (int idx = 0; idx < keys.size(); idx++) {
@@ -3302,7 +3542,7 @@ void server_state::set_max_replica_count(configuration_set_max_replica_count_rpc
 void server_state::set_max_replica_count_env_updating(std::shared_ptr<app_state> &app,
                                                       configuration_set_max_replica_count_rpc rpc)
 {
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
 
     auto iter = app->envs.find(replica_envs::UPDATE_MAX_REPLICA_COUNT);
     if (iter != app->envs.end()) {
@@ -3344,7 +3584,7 @@ void server_state::set_max_replica_count_env_updating(std::shared_ptr<app_state>
         {
             const auto new_max_replica_count = rpc.request().max_replica_count;
 
-            zauto_write_lock l(_lock);
+            apps_write_lock l(this);
 
             dassert_f(ec == ERR_OK,
                       "An error that can't be handled occurs while updating remote env of "
@@ -3378,7 +3618,7 @@ void server_state::do_update_max_replica_count(std::shared_ptr<app_state> &app,
 {
     std::shared_ptr<std::vector<error_code>> results;
     {
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
 
         results.reset(new std::vector<error_code>(app->partition_count));
         app->helpers->partitions_in_progress.store(app->partition_count);
@@ -3438,7 +3678,7 @@ void server_state::do_update_max_replica_count(std::shared_ptr<app_state> &app,
     {
         const auto new_max_replica_count = rpc.request().max_replica_count;
 
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
         for (int32_t i = 0; i < app->partition_count; ++i) {
             update_partition_max_replica_count(app, i, new_max_replica_count, on_partition_updated);
         }
@@ -3469,7 +3709,7 @@ void server_state::update_app_max_replica_count(std::shared_ptr<app_state> &app,
         const auto new_max_replica_count = rpc.request().max_replica_count;
         const auto old_max_replica_count = rpc.response().old_max_replica_count;
 
-        zauto_write_lock l(_lock);
+        apps_write_lock l(this);
 
         dassert_f(ec == ERR_OK,
                   "An error that can't be handled occurs while updating remote app-level "
@@ -3610,7 +3850,7 @@ task_ptr server_state::update_partition_max_replica_count_on_remote(
                                     const auto &gpid = new_partition_config.pid;
                                     const auto partition_index = gpid.get_partition_index();
 
-                                    zauto_write_lock l(_lock);
+                                    apps_write_lock l(this);
 
                                     auto &context = app->helpers->contexts[partition_index];
                                     context.pending_sync_task =
@@ -3629,12 +3869,9 @@ task_ptr server_state::update_partition_max_replica_count_on_remote(
              new_max_replica_count,
              new_ballot);
 
-    auto partition_path = get_partition_path(gpid);
-    auto json_config =
-        dsn::json::json_forwarder<partition_configuration>::encode(new_partition_config);
-    return _meta_svc->get_remote_storage()->set_data(
-        partition_path,
-        json_config,
+    return write_partition_config_on_remote(
+        new_partition_config,
+        false,
         LPC_META_STATE_HIGH,
         std::bind(&server_state::on_update_partition_max_replica_count_on_remote_reply,
                   this,
@@ -3657,7 +3894,7 @@ void server_state::on_update_partition_max_replica_count_on_remote_reply(
     const auto new_max_replica_count = new_partition_config.max_replica_count;
     const auto new_ballot = new_partition_config.ballot;
 
-    zauto_write_lock l(_lock);
+    apps_write_lock l(this);
 
     ddebug_f("reply for updating partition-level max_replica_count on remote storage: "
              "error_code={}, app_name={}, app_id={}, partition_id={}, new_max_replica_count={}, "
@@ -3679,7 +3916,7 @@ void server_state::on_update_partition_max_replica_count_on_remote_reply(
                                  const auto &gpid = new_partition_config.pid;
                                  const auto partition_index = gpid.get_partition_index();
 
-                                 zauto_write_lock l(_lock);
+                                 apps_write_lock l(this);
 
                                  auto &context = app->helpers->contexts[partition_index];
                                  context.pending_sync_task =
@@ -3735,6 +3972,7 @@ void server_state::update_partition_max_replica_count_locally(
     std::string new_config_str(boost::lexical_cast<std::string>(new_partition_config));
 
     old_partition_config = new_partition_config;
+    ++app->partitions_version;
 
     ddebug_f("local partition-level max_replica_count has been changed successfully: ",
              "app_name={}, app_id={}, partition_id={}, old_partition_config={}, "
@@ -3832,14 +4070,12 @@ void server_state::recover_all_partitions_max_replica_count(std::shared_ptr<app_
 
         new_pc.max_replica_count = new_max_replica_count;
         ++(new_pc.ballot);
-        auto partition_path = get_partition_path(new_pc.pid);
-        auto value = dsn::json::json_forwarder<partition_configuration>::encode(new_pc);
-        _meta_svc->get_remote_storage()->set_data(
-            partition_path,
-            value,
+        write_partition_config_on_remote(
+            new_pc,
+            false,
             LPC_META_CALLBACK,
             [this, app, i, new_pc](error_code ec) mutable {
-                zauto_write_lock l(_lock);
+                apps_write_lock l(this);
 
                 auto &old_pc = app->partitions[i];
                 std::string old_pc_str(boost::lexical_cast<std::string>(old_pc));
@@ -3870,6 +4106,7 @@ void server_state::recover_all_partitions_max_replica_count(std::shared_ptr<app_
                           new_pc_str);
 
                 old_pc = new_pc;
+                ++app->partitions_version;
 
                 ddebug_f("partition-level max_replica_count has been recovered successfully: "
                          "app_name={}, app_id={}, partition_index={}, partition_count={}, "
@@ -3911,7 +4148,7 @@ void server_state::recover_app_max_replica_count(std::shared_ptr<app_state> &app
         value,
         LPC_META_CALLBACK,
         [this, app, new_max_replica_count](error_code ec) mutable {
-            zauto_write_lock l(_lock);
+            apps_write_lock l(this);
 
             auto old_max_replica_count = app->max_replica_count;
             dassert_f(ec == ERR_OK,
@@ -46,6 +46,8 @@
 #include "common/replication_common.h"
 #include "meta_data.h"
 #include "meta_service.h"
+#include "partition_config_store.h"
+#include "server_state_view.h"
 
 namespace dsn {
 namespace replication {
@@ -75,6 +77,10 @@ class meta_service;
 // the content in _apps_root/<app-id>/<partition-id> is a json string for class
 // "partition-configuration"
 //
+// if [meta_server].partition_config_chunked_layout is enabled, the partitions are stored in
+// binary chunks of _apps_root/<app-id>/partition_chunks/<chunk-index> instead, see
+// partition_config_store for details.
+//
 // B. app management
 //
 // When recving create-app request from the DDL client(let's say, NEW-APP-NAME with NEW-APP-ID),
@@ -136,8 +142,36 @@ public:
         return iter->second;
     }
 
+    // Returns the latest published view of the apps, or a view built on the spot if none has
+    // been published, i.e. the publisher isn't started or is disabled.
+    server_state_view_ptr get_view() const;
+    // Publishes the first view and then one after every batch of updates, see apps_write_lock.
+    // Called after the apps are loaded, does nothing if [meta_server] enable_state_view is false.
+    void start_view_publisher();
+    void publish_view();
+
+    // Holds the write lock of the apps for a batch of updates, and publishes a view of the apps
+    // once the lock is released, so that the read-only requests see the batch as soon as it's
+    // done. The writers of the apps should use it instead of locking `_lock` directly.
+    class apps_write_lock
+    {
+    public:
+        explicit apps_write_lock(server_state *state);
+        ~apps_write_lock();
+
+        apps_write_lock(const apps_write_lock &) = delete;
+        apps_write_lock &operator=(const apps_write_lock &) = delete;
+
+    private:
+        server_state *_state;
+    };
+
     void query_configuration_by_index(const configuration_query_by_index_request &request,
                                       /*out*/ configuration_query_by_index_response &response);
+    static void
+    query_configuration_by_index(const server_state_view &view,
+                                 const configuration_query_by_index_request &request,
+                                 /*out*/ configuration_query_by_index_response &response);
     bool query_configuration_by_gpid(const dsn::gpid id, /*out*/ partition_configuration &config);
 
     // app options
@@ -146,6 +180,9 @@ public:
     void recall_app(dsn::message_ex *msg);
     void list_apps(const configuration_list_apps_request &request,
                    configuration_list_apps_response &response);
+    static void list_apps(const server_state_view &view,
+                          const configuration_list_apps_request &request,
+                          configuration_list_apps_response &response);
     void restore_app(dsn::message_ex *msg);
 
     // app env operations
@@ -206,6 +243,8 @@ private:
     error_code dump_app_states(const char *local_path,
                                const std::function<app_state *()> &iterator);
     error_code sync_apps_from_remote_storage();
+    // convert the partitions of all apps to the layout configured, called before they are loaded
+    error_code migrate_partitions_layout();
     // sync local state to remote storage,
     // if return OK, all states are synced correctly, and all apps are in stable state
     // else indicate error that remote storage responses
@@ -298,6 +337,14 @@ private:
         return oss.str();
     }
 
+    // Persists the partition configuration in the layout configured. In the legacy layout, the
+    // partition node is created if `create_new`, otherwise it must exist.
+    task_ptr write_partition_config_on_remote(const partition_configuration &pc,
+                                              bool create_new,
+                                              task_code cb_code,
+                                              const err_callback &cb,
+                                              task_tracker *tracker);
+
     void process_one_partition(std::shared_ptr<app_state> &app);
     void transition_staging_state(std::shared_ptr<app_state> &app);
 
@@ -362,6 +409,8 @@ private:
     friend class meta_partition_guardian_test;
     friend class meta_split_service;
     friend class meta_split_service_test;
+    friend class partition_config_store_test;
+    friend class server_state_view_test;
     friend class meta_service_test_app;
     friend class meta_test_base;
     friend class test::test_checker;
@@ -385,6 +434,15 @@ private:
     //_exist_apps + dropped apps: app_id -> app_state
     app_mapper _all_apps;
 
+    // the partition configurations persisted in the chunked layout
+    partition_config_store _partition_store;
+
+    // the latest published view of the apps, accessed by std::atomic_load/atomic_store
+    server_state_view_ptr _view;
+    // serializes the publishers of `_view`
+    zlock _view_lock;
+    std::atomic_bool _view_enabled{false};
+
     // for load balancer
     migration_list _temporary_list;
 
@@ -406,6 +464,7 @@ private:
     perf_counter_wrapper _recent_update_config_count;
     perf_counter_wrapper _recent_partition_change_unwritable_count;
     perf_counter_wrapper _recent_partition_change_writable_count;
+    perf_counter_wrapper _state_view_age_ms;
 };
 
 } // namespace replication
@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "server_state_view.h"
+
+#include <dsn/c/api_layer1.h>
+
+namespace dsn {
+namespace replication {
+
+/*static*/ std::shared_ptr<const server_state_view>
+server_state_view::build(const app_mapper &all_apps,
+                         const std::map<std::string, std::shared_ptr<app_state>> &exist_apps,
+                         const std::shared_ptr<const server_state_view> &prev)
+{
+    auto view = std::make_shared<server_state_view>();
+    view->publish_time_ms = dsn_now_ms();
+
+    bool changed = prev == nullptr || prev->all_apps.size() != all_apps.size() ||
+                   prev->exist_apps.size() != exist_apps.size();
+    for (const auto &kv : all_apps) {
+        const app_state &app = *kv.second;
+        std::shared_ptr<const app_view> prev_app;
+        if (prev != nullptr) {
+            auto iter = prev->all_apps.find(kv.first);
+            if (iter != prev->all_apps.end()) {
+                prev_app = iter->second;
+            }
+        }
+
+        if (prev_app != nullptr && prev_app->partitions_version == app.partitions_version &&
+            prev_app->info == static_cast<const app_info &>(app)) {
+            view->all_apps.emplace(kv.first, std::move(prev_app));
+        } else {
+            auto new_app = std::make_shared<app_view>();
+            new_app->info = app;
+            new_app->partitions = app.partitions;
+            new_app->partitions_version = app.partitions_version;
+            view->all_apps.emplace(kv.first, std::move(new_app));
+            changed = true;
+        }
+    }
+
+    for (const auto &kv : exist_apps) {
+        auto iter = view->all_apps.find(kv.second->app_id);
+        if (iter == view->all_apps.end()) {
+            continue;
+        }
+        view->exist_apps.emplace(kv.first, iter->second);
+        if (!changed) {
+            auto prev_iter = prev->exist_apps.find(kv.first);
+            changed = prev_iter == prev->exist_apps.end() || prev_iter->second != iter->second;
+        }
+    }
+
+    if (prev == nullptr || changed) {
+        view->version = prev == nullptr ? 1 : prev->version + 1;
+        view->change_time_ms = view->publish_time_ms;
+    } else {
+        view->version = prev->version;
+        view->change_time_ms = prev->change_time_ms;
+    }
+    return view;
+}
+
+} // namespace replication
+} // namespace dsn
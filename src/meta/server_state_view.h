@@ -0,0 +1,71 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "meta_data.h"
+
+namespace dsn {
+namespace replication {
+
+// The read-only part of an app_state.
+struct app_view
+{
+    app_info info;
+    std::vector<partition_configuration> partitions;
+    // app_state::partitions_version which `partitions` is copied at
+    int64_t partitions_version{0};
+};
+
+// An immutable copy of the apps in server_state, published after every batch of updates so that
+// the read-only requests (query_configuration_by_index, list_apps, and the http handlers built on
+// them) never wait for server_state::_lock, which may be held for long by the writers applying a
+// batch of configuration updates.
+//
+// The views are versioned and share the app_views not changed since the previous version, so
+// publishing a view only copies the apps whose partitions_version is bumped in between, rather
+// than comparing all the partitions.
+struct server_state_view
+{
+    // increased on every change of the apps
+    int64_t version{0};
+    uint64_t publish_time_ms{0};
+    // when the apps last changed, i.e. the publish time of the first view of this version
+    uint64_t change_time_ms{0};
+
+    // _exist_apps + dropped apps: app_id -> app_view
+    std::map<int32_t, std::shared_ptr<const app_view>> all_apps;
+    // available apps, dropping apps, creating apps: name -> app_view
+    std::map<std::string, std::shared_ptr<const app_view>> exist_apps;
+
+    // Builds the view of the apps, reusing the app_views of `prev` which are not changed.
+    // The caller should hold the read lock of the apps.
+    static std::shared_ptr<const server_state_view>
+    build(const app_mapper &all_apps,
+          const std::map<std::string, std::shared_ptr<app_state>> &exist_apps,
+          const std::shared_ptr<const server_state_view> &prev);
+};
+
+typedef std::shared_ptr<const server_state_view> server_state_view_ptr;
+
+} // namespace replication
+} // namespace dsn
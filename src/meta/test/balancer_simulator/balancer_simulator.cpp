@@ -25,11 +25,18 @@
  */
 
 #include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <sstream>
 #include <gtest/gtest.h>
 
 #include "meta/meta_data.h"
 #include "meta/server_load_balancer.h"
 #include "meta/greedy_load_balancer.h"
+#include "meta/cluster_balance_policy.h"
+#include "meta/flow_balance_policy.h"
+#include "meta/load_aware_balance_policy.h"
 #include "meta/test/misc/misc.h"
 
 using namespace dsn::replication;
@@ -192,9 +199,285 @@ void greedy_balancer_perfect_move_primary()
     }
 }
 
-int main(int, char **)
+// The load of the primary and the secondaries of every partition in every round.
+struct partition_load
 {
+    replica_load_info primary;
+    replica_load_info secondary;
+};
+typedef std::map<int, std::map<dsn::gpid, partition_load>> load_trace;
+
+// A load trace is a text file, every line of which is the load recorded in one round:
+//   <round> <app_id>.<partition_index> <P|S> <read_qps> <write_qps> <read_bytes_per_sec>
+//   <write_bytes_per_sec> <disk_usage_mb> <cpu_share>
+// where "P" is the load of the primary and "S" is the load of each secondary.
+bool read_load_trace(const char *file, /*out*/ load_trace &trace)
+{
+    std::ifstream in(file);
+    if (!in) {
+        derror("open load trace %s failed", file);
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream is(line);
+        int round, app_id, pidx;
+        char dot;
+        std::string role;
+        replica_load_info load;
+        is >> round >> app_id >> dot >> pidx >> role >> load.read_qps >> load.write_qps >>
+            load.read_bytes_per_sec >> load.write_bytes_per_sec >> load.disk_usage_mb >>
+            load.cpu_share;
+        if (is.fail() || dot != '.' || (role != "P" && role != "S")) {
+            derror("invalid line in load trace: %s", line.c_str());
+            return false;
+        }
+        partition_load &pl = trace[round][dsn::gpid(app_id, pidx)];
+        (role == "P" ? pl.primary : pl.secondary) = load;
+    }
+    return true;
+}
+
+// Generates a trace in which a few hot partitions take most of the reads, and the hot set
+// shifts every few rounds.
+void generate_load_trace(const app_mapper &apps, int rounds, /*out*/ load_trace &trace)
+{
+    for (int round = 0; round < rounds; ++round) {
+        int epoch = round / 5;
+        for (const auto &kv : apps) {
+            for (const auto &pc : kv.second->partitions) {
+                bool hot = (pc.pid.get_partition_index() + epoch * 7) % 20 == 0;
+                double read_qps = hot ? random32(5000, 10000) : random32(50, 150);
+                double write_qps = random32(10, 100);
+                int64_t disk_mb = 1024 + pc.pid.get_partition_index() % 10 * 100;
+
+                partition_load &pl = trace[round][pc.pid];
+                pl.primary.read_qps = read_qps;
+                pl.primary.read_bytes_per_sec = read_qps * 1024;
+                pl.primary.write_qps = write_qps;
+                pl.primary.write_bytes_per_sec = write_qps * 512;
+                pl.primary.disk_usage_mb = disk_mb;
+                pl.primary.cpu_share = (read_qps + write_qps) / 100000;
+
+                pl.secondary = pl.primary;
+                pl.secondary.read_qps = 0;
+                pl.secondary.read_bytes_per_sec = 0;
+                pl.secondary.cpu_share = write_qps / 100000;
+            }
+        }
+    }
+}
+
+// Rebuilds the serving replicas of all partitions with the loads of this round, as if the
+// replica servers reported them on config-sync.
+void apply_load(app_mapper &apps, const std::map<dsn::gpid, partition_load> &loads)
+{
+    for (auto &kv : apps) {
+        app_state &app = *kv.second;
+        for (int i = 0; i < app.partition_count; ++i) {
+            const dsn::partition_configuration &pc = app.partitions[i];
+            config_context &cc = app.helpers->contexts[i];
+            cc.serving.clear();
+
+            auto iter = loads.find(pc.pid);
+            partition_load pl = iter == loads.end() ? partition_load() : iter->second;
+            replica_info ri;
+            ri.disk_tag = "disk" + std::to_string(i % 4);
+            ri.__set_load(pl.primary);
+            cc.collect_serving_replica(pc.primary, ri);
+            ri.__set_load(pl.secondary);
+            for (const auto &addr : pc.secondaries) {
+                cc.collect_serving_replica(addr, ri);
+            }
+        }
+    }
+}
+
+// (max - min) / mean of the node loads
+double load_skew(const app_mapper &apps, const node_mapper &nodes)
+{
+    replica_load_info total;
+    for (const auto &kv : apps) {
+        for (const auto &cc : kv.second->helpers->contexts) {
+            for (const auto &r : cc.serving) {
+                load_aware_balance_policy::add_replica_load(r.load, total);
+            }
+        }
+    }
+    std::map<dsn::rpc_address, double> node_scores;
+    for (const auto &kv : nodes) {
+        node_scores[kv.first] = 0;
+    }
+    for (const auto &kv : apps) {
+        for (const auto &cc : kv.second->helpers->contexts) {
+            for (const auto &r : cc.serving) {
+                node_scores[r.node] +=
+                    load_aware_balance_policy::get_replica_load_score(r.load, total);
+            }
+        }
+    }
+    double min = node_scores.begin()->second, max = min, sum = 0;
+    for (const auto &kv : node_scores) {
+        min = std::min(min, kv.second);
+        max = std::max(max, kv.second);
+        sum += kv.second;
+    }
+    return sum > 0 ? (max - min) * node_scores.size() / sum : 0;
+}
+
+// Replays the trace round by round: the load-aware policy plans the moves on the loads of the
+// round, and the moves are applied before the next round.
+void replay_load_trace(const load_trace &trace, app_mapper &apps, node_mapper &nodes)
+{
+    load_aware_balance_policy policy(nullptr);
+    int total_moves = 0;
+    for (const auto &round : trace) {
+        apply_load(apps, round.second);
+        double skew_before = load_skew(apps, nodes);
+
+        migration_list ml;
+        meta_view view{&apps, &nodes};
+        policy.balance(false, &view, &ml);
+        total_moves += ml.size();
+        migration_check_and_apply(apps, nodes, ml, nullptr);
+
+        apply_load(apps, round.second);
+        double skew_after = load_skew(apps, nodes);
+        std::cout << "round " << round.first << ": moves = " << ml.size()
+                  << ", load skew = " << skew_before << " -> " << skew_after << std::endl;
+        // every move narrows the gap between a hotter node and a colder one
+        ASSERT_TRUE(skew_after <= skew_before + 1e-9);
+    }
+    std::cout << "total moves = " << total_moves << std::endl;
+}
+
+void load_aware_balancer_replay(const char *trace_file)
+{
+    app_mapper apps;
+    node_mapper nodes;
+    std::vector<dsn::rpc_address> node_list;
+    generate_node_list(node_list, 10, 20);
+    generate_balanced_apps(apps, nodes, node_list);
+
+    load_trace trace;
+    if (trace_file != nullptr) {
+        ASSERT_TRUE(read_load_trace(trace_file, trace));
+    } else {
+        generate_load_trace(apps, 20, trace);
+    }
+    replay_load_trace(trace, apps, nodes);
+}
+
+app_mapper clone_apps(const app_mapper &apps)
+{
+    app_mapper result;
+    for (const auto &kv : apps) {
+        std::shared_ptr<app_state> app = app_state::create(*kv.second);
+        app->partitions = kv.second->partitions;
+        for (int i = 0; i < app->partition_count; ++i) {
+            app->helpers->contexts[i].serving = kv.second->helpers->contexts[i].serving;
+        }
+        result.emplace(kv.first, app);
+    }
+    return result;
+}
+
+// Runs the balancer round by round until it plans no more move, as meta server does.
+void run_cluster_balancer(const char *name,
+                          load_balance_policy &policy,
+                          const app_mapper &origin_apps,
+                          const std::vector<dsn::rpc_address> &node_list,
+                          int disks_per_node)
+{
+    app_mapper apps = clone_apps(origin_apps);
+    node_mapper nodes;
+    nodes_fs_manager nfm;
+    generate_node_mapper(nodes, apps, node_list);
+    generate_node_fs_manager(apps, nodes, nfm, disks_per_node);
+
+    int rounds = 0, total_moves = 0;
+    uint64_t total_ns = 0, max_ns = 0;
+    for (; rounds < 100000; ++rounds) {
+        migration_list ml;
+        meta_view view{&apps, &nodes};
+        uint64_t start_ns = dsn_now_ns();
+        policy.balance(false, &view, &ml);
+        uint64_t elapsed_ns = dsn_now_ns() - start_ns;
+        total_ns += elapsed_ns;
+        max_ns = std::max(max_ns, elapsed_ns);
+        if (ml.empty()) {
+            break;
+        }
+        total_moves += ml.size();
+        migration_check_and_apply(apps, nodes, ml, &nfm);
+    }
+
+    unsigned min_count = UINT_MAX, max_count = 0, max_app_skew = 0;
+    for (const auto &kv : nodes) {
+        min_count = std::min(min_count, kv.second.partition_count());
+        max_count = std::max(max_count, kv.second.partition_count());
+    }
+    for (const auto &app : apps) {
+        unsigned app_min = UINT_MAX, app_max = 0;
+        for (const auto &kv : nodes) {
+            app_min = std::min(app_min, kv.second.partition_count(app.first));
+            app_max = std::max(app_max, kv.second.partition_count(app.first));
+        }
+        max_app_skew = std::max(max_app_skew, app_max - app_min);
+    }
+
+    std::cout << name << ": rounds = " << rounds << ", moves = " << total_moves
+              << ", planning time = " << total_ns / 1000000 << " ms (max "
+              << max_ns / 1000000 << " ms per round), node skew = " << max_count - min_count
+              << ", max app skew = " << max_app_skew << std::endl;
+}
+
+// Benchmarks the cluster balancers on a synthetic cluster just scaled out: the replicas are
+// spread over 80% of the nodes, and the others are newly added.
+void benchmark_cluster_balancers(int node_count, int apps_count)
+{
+    const int disks_per_node = 8;
+    std::vector<dsn::rpc_address> node_list = generate_node_list(node_count);
+    std::vector<dsn::rpc_address> old_nodes(node_list.begin(),
+                                            node_list.begin() + node_count * 4 / 5);
+    app_mapper apps;
+    generate_apps(apps, old_nodes, apps_count, disks_per_node, {16, 256}, true);
+
+    int replica_count = 0;
+    for (const auto &kv : apps) {
+        replica_count += kv.second->partition_count * kv.second->max_replica_count;
+    }
+    std::cout << "cluster: " << node_count << " nodes, " << apps_count << " apps, "
+              << replica_count << " replicas" << std::endl;
+
+    cluster_balance_policy greedy_policy(nullptr);
+    run_cluster_balancer("cluster_balance_policy", greedy_policy, apps, node_list, disks_per_node);
+    flow_balance_policy flow_policy(nullptr);
+    run_cluster_balancer("flow_balance_policy", flow_policy, apps, node_list, disks_per_node);
+}
+
+// Usage: sim_lb [--load-trace <file>] [--nodes <count>] [--apps <count>]
+int main(int argc, char **argv)
+{
+    const char *trace_file = nullptr;
+    int node_count = 100, apps_count = 20;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--load-trace") {
+            trace_file = argv[i + 1];
+        } else if (arg == "--nodes") {
+            node_count = atoi(argv[i + 1]);
+        } else if (arg == "--apps") {
+            apps_count = atoi(argv[i + 1]);
+        }
+    }
+
     dsn_run_config("config.ini", false);
     greedy_balancer_perfect_move_primary();
+    load_aware_balancer_replay(trace_file);
+    benchmark_cluster_balancers(std::max(node_count, 5), std::max(apps_count, 1));
     return 0;
 }
@@ -0,0 +1,135 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include "meta/flow_balance_policy.h"
+
+namespace dsn {
+namespace replication {
+
+class flow_balance_policy_test : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        for (int i = 0; i < 4; ++i) {
+            _addrs.emplace_back(rpc_address(1, i + 1));
+            get_node_state(_nodes, _addrs.back(), true)->set_alive(true);
+        }
+
+        app_info info;
+        info.app_id = 1;
+        info.app_name = "test";
+        info.status = app_status::AS_AVAILABLE;
+        info.partition_count = 8;
+        info.max_replica_count = 3;
+        _app = app_state::create(info);
+        _apps[info.app_id] = _app;
+
+        // all the replicas are on the first 3 nodes, the last node is newly added
+        for (int i = 0; i < info.partition_count; ++i) {
+            partition_configuration &pc = _app->partitions[i];
+            pc.primary = _addrs[i % 3];
+            pc.secondaries = {_addrs[(i + 1) % 3], _addrs[(i + 2) % 3]};
+            _nodes[pc.primary].put_partition(pc.pid, true);
+
+            replica_info ri;
+            ri.disk_tag = "disk1";
+            config_context &cc = _app->helpers->contexts[i];
+            cc.collect_serving_replica(pc.primary, ri);
+            for (const auto &addr : pc.secondaries) {
+                _nodes[addr].put_partition(pc.pid, false);
+                cc.collect_serving_replica(addr, ri);
+            }
+        }
+    }
+
+    migration_list balance()
+    {
+        meta_view view{&_apps, &_nodes};
+        migration_list list;
+        flow_balance_policy policy(nullptr);
+        policy.balance(false, &view, &list);
+        return list;
+    }
+
+    std::vector<rpc_address> _addrs;
+    node_mapper _nodes;
+    app_mapper _apps;
+    std::shared_ptr<app_state> _app;
+};
+
+TEST_F(flow_balance_policy_test, plan_all_moves_at_once)
+{
+    migration_list list = balance();
+
+    // 8 primaries and 16 secondaries on 4 nodes: 2 primaries and 4 secondaries are moved
+    ASSERT_EQ(6, list.size());
+    int copy_primary_count = 0;
+    for (const auto &kv : list) {
+        const configuration_balancer_request &request = *kv.second;
+        ASSERT_NE(balancer_request_type::move_primary, request.balance_type);
+        if (request.balance_type == balancer_request_type::copy_primary) {
+            ++copy_primary_count;
+        }
+        ASSERT_EQ(config_type::CT_ADD_SECONDARY_FOR_LB, request.action_list[0].type);
+        ASSERT_EQ(_addrs[3], request.action_list[0].node);
+    }
+    ASSERT_EQ(2, copy_primary_count);
+}
+
+TEST_F(flow_balance_policy_test, move_primary_first)
+{
+    // the new node serves a secondary of partition 0 and 1
+    for (int i = 0; i < 2; ++i) {
+        partition_configuration &pc = _app->partitions[i];
+        _nodes[pc.secondaries[0]].remove_partition(pc.pid, false);
+        pc.secondaries[0] = _addrs[3];
+        _nodes[_addrs[3]].put_partition(pc.pid, false);
+    }
+
+    migration_list list = balance();
+    int move_primary_count = 0;
+    for (const auto &kv : list) {
+        if (kv.second->balance_type == balancer_request_type::move_primary) {
+            ++move_primary_count;
+            ASSERT_LT(kv.first.get_partition_index(), 2);
+        }
+    }
+    ASSERT_EQ(2, move_primary_count);
+}
+
+TEST_F(flow_balance_policy_test, balanced)
+{
+    for (const auto &kv : balance()) {
+        partition_configuration &pc = _app->partitions[kv.first.get_partition_index()];
+        if (kv.second->balance_type == balancer_request_type::copy_primary) {
+            pc.primary = _addrs[3];
+        } else {
+            // the node removed by CT_REMOVE
+            const rpc_address &from = kv.second->action_list[1].node;
+            std::replace(pc.secondaries.begin(), pc.secondaries.end(), from, _addrs[3]);
+        }
+    }
+
+    // no more move once balanced
+    ASSERT_TRUE(balance().empty());
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,135 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+#include "meta/load_aware_balance_policy.h"
+
+namespace dsn {
+namespace replication {
+
+replica_load_info make_load(double read_qps, double write_qps)
+{
+    replica_load_info load;
+    load.read_qps = read_qps;
+    load.write_qps = write_qps;
+    return load;
+}
+
+TEST(load_aware_balance_policy, get_replica_load_score)
+{
+    replica_load_info total;
+    load_aware_balance_policy::add_replica_load(make_load(100, 10), total);
+    load_aware_balance_policy::add_replica_load(make_load(300, 30), total);
+    ASSERT_DOUBLE_EQ(400, total.read_qps);
+    ASSERT_DOUBLE_EQ(40, total.write_qps);
+
+    ASSERT_DOUBLE_EQ(
+        0.5, load_aware_balance_policy::get_replica_load_score(make_load(100, 10), total));
+    ASSERT_DOUBLE_EQ(
+        1.5, load_aware_balance_policy::get_replica_load_score(make_load(300, 30), total));
+    // the dimensions without any load are ignored
+    ASSERT_DOUBLE_EQ(0, load_aware_balance_policy::get_replica_load_score(make_load(0, 0), total));
+}
+
+class load_aware_balance_policy_test : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        for (int i = 0; i < 4; ++i) {
+            _addrs.emplace_back(rpc_address(1, i + 1));
+            get_node_state(_nodes, _addrs.back(), true)->set_alive(true);
+        }
+
+        app_info info;
+        info.app_id = 1;
+        info.app_name = "test";
+        info.status = app_status::AS_AVAILABLE;
+        info.partition_count = 4;
+        info.max_replica_count = 3;
+        _app = app_state::create(info);
+        _apps[info.app_id] = _app;
+
+        // the primary of partition 0 on node 0 is very hot
+        set_partition(0, 0, 1, 2, 1000);
+        set_partition(1, 0, 1, 3, 100);
+        set_partition(2, 1, 2, 3, 100);
+        set_partition(3, 2, 0, 3, 100);
+    }
+
+    void set_partition(int pidx, int primary, int secondary1, int secondary2, double read_qps)
+    {
+        partition_configuration &pc = _app->partitions[pidx];
+        pc.primary = _addrs[primary];
+        pc.secondaries = {_addrs[secondary1], _addrs[secondary2]};
+        _nodes[_addrs[primary]].put_partition(pc.pid, true);
+        _nodes[_addrs[secondary1]].put_partition(pc.pid, false);
+        _nodes[_addrs[secondary2]].put_partition(pc.pid, false);
+
+        config_context &cc = _app->helpers->contexts[pidx];
+        replica_info ri;
+        ri.disk_tag = "disk1";
+        ri.__set_load(make_load(read_qps, 10));
+        cc.collect_serving_replica(pc.primary, ri);
+        ri.__set_load(make_load(0, 10));
+        cc.collect_serving_replica(pc.secondaries[0], ri);
+        cc.collect_serving_replica(pc.secondaries[1], ri);
+    }
+
+    migration_list balance()
+    {
+        meta_view view{&_apps, &_nodes};
+        migration_list list;
+        load_aware_balance_policy policy(nullptr);
+        policy.balance(false, &view, &list);
+        return list;
+    }
+
+    std::vector<rpc_address> _addrs;
+    node_mapper _nodes;
+    app_mapper _apps;
+    std::shared_ptr<app_state> _app;
+};
+
+TEST_F(load_aware_balance_policy_test, balance)
+{
+    migration_list list = balance();
+    ASSERT_FALSE(list.empty());
+
+    // moving the hot primary only swaps the hot node, so the colder replicas are moved off it
+    auto iter = list.find(gpid(1, 0));
+    if (iter != list.end()) {
+        ASSERT_NE(_addrs[0], iter->second->action_list[1].node);
+    }
+    iter = list.find(gpid(1, 1));
+    ASSERT_NE(list.end(), iter);
+    ASSERT_EQ(balancer_request_type::copy_primary, iter->second->balance_type);
+    ASSERT_EQ(_addrs[0], iter->second->action_list[1].node);
+    ASSERT_EQ(_addrs[2], iter->second->action_list[3].target);
+}
+
+TEST_F(load_aware_balance_policy_test, load_not_reported)
+{
+    // a replica server of old version
+    replica_info ri;
+    ri.disk_tag = "disk1";
+    _app->helpers->contexts[3].collect_serving_replica(_addrs[3], ri);
+    ASSERT_TRUE(balance().empty());
+}
+
+} // namespace replication
+} // namespace dsn
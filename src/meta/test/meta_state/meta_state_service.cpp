@@ -30,6 +30,8 @@
 #include <gtest/gtest.h>
 #include <chrono>
 #include <thread>
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 
 #include "meta/meta_state_service_simple.h"
 #include "meta/meta_state_service_zookeeper.h"
@@ -37,6 +39,12 @@
 using namespace dsn;
 using namespace dsn::dist;
 
+namespace dsn {
+namespace dist {
+DSN_DECLARE_uint64(meta_state_service_simple_checkpoint_threshold_kb);
+} // namespace dist
+} // namespace dsn
+
 DEFINE_TASK_CODE(META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, TASK_PRIORITY_HIGH, THREAD_POOL_DEFAULT);
 
 typedef std::function<meta_state_service *()> service_creator_func;
@@ -287,6 +295,90 @@ TEST(meta_state_service, simple)
     provider_recursively_create_delete_test(simple_service_creator, simple_service_deleter);
 }
 
+TEST(meta_state_service, simple_checkpoint)
+{
+    const std::string work_dir = "./simple_checkpoint_test";
+    utils::filesystem::remove_path(work_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(work_dir));
+    const std::string snapshot_path =
+        utils::filesystem::path_combine(work_dir, "meta_state_service.snapshot");
+    const std::string legacy_log_path =
+        utils::filesystem::path_combine(work_dir, "meta_state_service.log");
+
+    auto old_threshold = FLAGS_meta_state_service_simple_checkpoint_threshold_kb;
+    FLAGS_meta_state_service_simple_checkpoint_threshold_kb = 1;
+
+    auto check_ok = [](error_code ec) { ASSERT_EQ(ERR_OK, ec); };
+    auto service = new meta_state_service_simple();
+    ASSERT_EQ(ERR_OK, service->initialize({work_dir}));
+    service->create_node("/c", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, check_ok)->wait();
+    for (int i = 0; i < 100; ++i) {
+        std::string node = "/c/" + std::to_string(i);
+        service
+            ->create_node(node,
+                          META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                          check_ok,
+                          blob::create_from_bytes(std::string(64, 'a')))
+            ->wait();
+    }
+    for (int i = 0; i < 50; ++i) {
+        std::string node = "/c/" + std::to_string(i);
+        service->delete_node(node, false, META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, check_ok)
+            ->wait();
+    }
+    for (int i = 0; i < 10 && !utils::filesystem::file_exists(snapshot_path); ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    ASSERT_TRUE(utils::filesystem::file_exists(snapshot_path));
+
+    // updates in the tail of the log, issued concurrently to be group committed
+    std::vector<task_ptr> tasks;
+    for (int i = 50; i < 100; ++i) {
+        std::string node = "/c/" + std::to_string(i);
+        tasks.emplace_back(service->set_data(node,
+                                             blob::create_from_bytes(std::to_string(i)),
+                                             META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                                             check_ok));
+    }
+    for (auto &t : tasks) {
+        t->wait();
+    }
+    FLAGS_meta_state_service_simple_checkpoint_threshold_kb = 0;
+    delete service;
+    ASSERT_FALSE(utils::filesystem::file_exists(legacy_log_path));
+
+    // recover from the snapshot and the tail of the log
+    service = new meta_state_service_simple();
+    ASSERT_EQ(ERR_OK, service->initialize({work_dir}));
+    service
+        ->get_children("/c",
+                       META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                       [](error_code ec, const std::vector<std::string> &children) {
+                           ASSERT_EQ(ERR_OK, ec);
+                           ASSERT_EQ(50, children.size());
+                       })
+        ->wait();
+    for (int i = 0; i < 100; ++i) {
+        std::string node = "/c/" + std::to_string(i);
+        service
+            ->get_data(node,
+                       META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                       [i](error_code ec, const blob &value) {
+                           if (i < 50) {
+                               ASSERT_EQ(ERR_OBJECT_NOT_FOUND, ec);
+                           } else {
+                               ASSERT_EQ(ERR_OK, ec);
+                               ASSERT_EQ(std::to_string(i), value.to_string());
+                           }
+                       })
+            ->wait();
+    }
+    delete service;
+
+    FLAGS_meta_state_service_simple_checkpoint_threshold_kb = old_threshold;
+    utils::filesystem::remove_path(work_dir);
+}
+
 TEST(meta_state_service, zookeeper)
 {
     auto zookeeper_service_creator = [] {
@@ -0,0 +1,78 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+#include "meta/min_cost_flow.h"
+
+namespace dsn {
+namespace replication {
+
+TEST(min_cost_flow, stop_when_not_profitable)
+{
+    min_cost_flow graph;
+    int s = graph.add_vertex();
+    int v = graph.add_vertex();
+    int t = graph.add_vertex();
+    graph.add_edge(s, v, 3, -5);
+    // a convex cost by parallel edges
+    int e1 = graph.add_edge(v, t, 1, 1);
+    int e2 = graph.add_edge(v, t, 1, 4);
+    int e3 = graph.add_edge(v, t, 1, 7);
+
+    ASSERT_EQ(2, graph.solve(s, t, 10));
+    ASSERT_DOUBLE_EQ(-5, graph.total_cost());
+    ASSERT_EQ(1, graph.get_flow(e1));
+    ASSERT_EQ(1, graph.get_flow(e2));
+    ASSERT_EQ(0, graph.get_flow(e3));
+}
+
+TEST(min_cost_flow, max_flow)
+{
+    min_cost_flow graph;
+    int s = graph.add_vertex();
+    int t = graph.add_vertex();
+    graph.add_edge(s, t, 10, -1);
+    ASSERT_EQ(4, graph.solve(s, t, 4));
+    ASSERT_DOUBLE_EQ(-4, graph.total_cost());
+}
+
+TEST(min_cost_flow, reroute_by_residual_edge)
+{
+    min_cost_flow graph;
+    int s = graph.add_vertex();
+    int a = graph.add_vertex();
+    int b = graph.add_vertex();
+    int c = graph.add_vertex();
+    int t = graph.add_vertex();
+    graph.add_edge(s, a, 1, -10);
+    graph.add_edge(s, b, 1, -10);
+    int ac = graph.add_edge(a, c, 1, 1);
+    int at = graph.add_edge(a, t, 1, 5);
+    int bc = graph.add_edge(b, c, 1, 1);
+    int ct = graph.add_edge(c, t, 1, 1);
+
+    // s->a->c->t first, then s->b->c->a->t cancels the flow of a->c
+    ASSERT_EQ(2, graph.solve(s, t, 10));
+    ASSERT_DOUBLE_EQ(-13, graph.total_cost());
+    ASSERT_EQ(0, graph.get_flow(ac));
+    ASSERT_EQ(1, graph.get_flow(at));
+    ASSERT_EQ(1, graph.get_flow(bc));
+    ASSERT_EQ(1, graph.get_flow(ct));
+}
+
+} // namespace replication
+} // namespace dsn
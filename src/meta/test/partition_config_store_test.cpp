@@ -0,0 +1,200 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+#include <dsn/cpp/json_helper.h>
+#include <dsn/utility/flags.h>
+
+#include "meta_test_base.h"
+#include "meta/meta_service.h"
+#include "meta/partition_config_store.h"
+#include "meta/server_state.h"
+
+namespace dsn {
+namespace replication {
+
+DSN_DECLARE_bool(partition_config_chunked_layout);
+DSN_DECLARE_int32(partition_config_chunk_size);
+
+class partition_config_store_test : public meta_test_base
+{
+public:
+    void TearDown() override
+    {
+        set_chunked_layout(false, 256);
+        meta_test_base::TearDown();
+    }
+
+    void set_chunked_layout(bool enabled, int32_t chunk_size)
+    {
+        FLAGS_partition_config_chunked_layout = enabled;
+        FLAGS_partition_config_chunk_size = chunk_size;
+    }
+
+    // reload all the apps as a new meta leader does
+    void reload()
+    {
+        ASSERT_EQ(ERR_OK, _ss->sync_apps_from_remote_storage());
+        ASSERT_TRUE(_ss->spin_wait_staging(30));
+    }
+
+    error_code get_data(const std::string &path, blob &value)
+    {
+        error_code err;
+        _ms->get_remote_storage()
+            ->get_data(path,
+                       LPC_META_CALLBACK,
+                       [&err, &value](error_code ec, const blob &v) {
+                           err = ec;
+                           value = v;
+                       })
+            ->wait();
+        return err;
+    }
+
+    partition_config_chunk get_chunk(const std::string &app_path, int32_t chunk_index)
+    {
+        blob value;
+        partition_config_chunk chunk;
+        EXPECT_EQ(ERR_OK,
+                  get_data(partition_config_store::get_chunk_path(app_path, chunk_index), value));
+        EXPECT_TRUE(partition_config_store::decode_chunk(value, chunk));
+        return chunk;
+    }
+
+    std::string app_path(const std::string &app_name)
+    {
+        return _ss->get_app_path(*find_app(app_name));
+    }
+};
+
+TEST_F(partition_config_store_test, encode_decode)
+{
+    partition_configuration pc;
+    pc.pid = gpid(2, 1);
+    pc.ballot = 5;
+    pc.primary = rpc_address("127.0.0.1", 34801);
+    pc.secondaries.emplace_back(rpc_address("127.0.0.1", 34802));
+    pc.max_replica_count = 3;
+
+    partition_config_chunk chunk;
+    chunk.app_id = 2;
+    chunk.start_index = 0;
+    chunk.entries.resize(3);
+    chunk.entries[1] = partition_config_store::encode_partition_config(pc);
+
+    partition_config_chunk decoded;
+    ASSERT_TRUE(
+        partition_config_store::decode_chunk(partition_config_store::encode_chunk(chunk), decoded));
+    ASSERT_EQ(2, decoded.app_id);
+    ASSERT_EQ(0, decoded.start_index);
+    ASSERT_EQ(3, decoded.entries.size());
+
+    partition_configuration decoded_pc;
+    ASSERT_FALSE(partition_config_store::decode_partition_config(decoded.entries[0], decoded_pc));
+    ASSERT_TRUE(partition_config_store::decode_partition_config(decoded.entries[1], decoded_pc));
+    ASSERT_EQ(pc, decoded_pc);
+
+    // json of the legacy layout
+    ASSERT_FALSE(partition_config_store::decode_chunk(
+        dsn::json::json_forwarder<partition_configuration>::encode(pc), decoded));
+
+    int32_t chunk_size = 0;
+    ASSERT_TRUE(partition_config_store::decode_chunk_size(
+        partition_config_store::encode_chunk_size(128), chunk_size));
+    ASSERT_EQ(128, chunk_size);
+}
+
+TEST_F(partition_config_store_test, create_app_in_chunks)
+{
+    set_chunked_layout(true, 4);
+    create_app("chunked_app", 6);
+    const std::string path = app_path("chunked_app");
+
+    blob value;
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, get_data(path + "/0", value));
+    ASSERT_EQ(ERR_OK, get_data(partition_config_store::get_chunk_root(path), value));
+    ASSERT_EQ("4", value.to_string());
+
+    partition_config_chunk chunk = get_chunk(path, 1);
+    ASSERT_EQ(4, chunk.start_index);
+    ASSERT_EQ(4, chunk.entries.size());
+    ASSERT_NE(0, chunk.entries[1].length());
+    ASSERT_EQ(0, chunk.entries[2].length());
+
+    auto before = find_app("chunked_app")->partitions;
+    reload();
+    ASSERT_EQ(before, find_app("chunked_app")->partitions);
+}
+
+TEST_F(partition_config_store_test, migrate_and_group_commit)
+{
+    create_app("legacy_app", 8);
+    const std::string path = app_path("legacy_app");
+    auto before = find_app("legacy_app")->partitions;
+
+    // legacy -> chunked
+    set_chunked_layout(true, 3);
+    reload();
+    ASSERT_EQ(before, find_app("legacy_app")->partitions);
+
+    blob value;
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, get_data(path + "/0", value));
+    partition_config_chunk chunk = get_chunk(path, 2);
+    ASSERT_EQ(6, chunk.start_index);
+    ASSERT_EQ(3, chunk.entries.size());
+    partition_configuration pc;
+    ASSERT_TRUE(partition_config_store::decode_partition_config(chunk.entries[1], pc));
+    ASSERT_EQ(before[7], pc);
+    ASSERT_EQ(0, chunk.entries[2].length());
+
+    // concurrent updates of the partitions in the same chunk are all persisted
+    std::atomic_int acked{0};
+    for (int i = 0; i < 3; ++i) {
+        partition_configuration new_pc = before[i];
+        new_pc.ballot += 10;
+        _ss->write_partition_config_on_remote(new_pc,
+                                              false,
+                                              LPC_META_STATE_HIGH,
+                                              [&acked](error_code ec) {
+                                                  ASSERT_EQ(ERR_OK, ec);
+                                                  ++acked;
+                                              },
+                                              _ss->tracker());
+    }
+    _ss->wait_all_task();
+    ASSERT_EQ(3, acked.load());
+    chunk = get_chunk(path, 0);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(partition_config_store::decode_partition_config(chunk.entries[i], pc));
+        ASSERT_EQ(before[i].ballot + 10, pc.ballot);
+    }
+
+    // chunked -> legacy
+    set_chunked_layout(false, 256);
+    reload();
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, get_data(partition_config_store::get_chunk_root(path), value));
+    ASSERT_EQ(ERR_OK, get_data(path + "/1", value));
+    ASSERT_TRUE(dsn::json::json_forwarder<partition_configuration>::decode(value, pc));
+    ASSERT_EQ(before[1].ballot + 10, pc.ballot);
+    ASSERT_EQ(before[1].ballot + 10, find_app("legacy_app")->partitions[1].ballot);
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,97 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+
+#include "meta_test_base.h"
+#include "meta/server_state.h"
+#include "meta/server_state_view.h"
+
+namespace dsn {
+namespace replication {
+
+class server_state_view_test : public meta_test_base
+{
+public:
+    // updates a partition in place, as the writers of server_state do in a batch of updates
+    void update_ballot(const std::string &app_name, int32_t pidx, int64_t ballot)
+    {
+        server_state::apps_write_lock l(_ss.get());
+        std::shared_ptr<app_state> app = find_app(app_name);
+        app->partitions[pidx].ballot = ballot;
+        ++app->partitions_version;
+    }
+
+    configuration_query_by_index_response query(const std::string &app_name)
+    {
+        configuration_query_by_index_request request;
+        configuration_query_by_index_response response;
+        request.app_name = app_name;
+        _ss->query_configuration_by_index(request, response);
+        return response;
+    }
+};
+
+TEST_F(server_state_view_test, publish)
+{
+    create_app("app1", 4);
+    create_app("app2", 4);
+
+    // no view is published, the reads see the latest state
+    update_ballot("app1", 0, 100);
+    ASSERT_EQ(100, query("app1").partitions[0].ballot);
+    ASSERT_EQ(nullptr, std::atomic_load(&_ss->_view));
+
+    _ss->start_view_publisher();
+    server_state_view_ptr v1 = _ss->get_view();
+    ASSERT_EQ(1, v1->version);
+    ASSERT_EQ(2, v1->exist_apps.size());
+
+    // nothing changed
+    _ss->publish_view();
+    server_state_view_ptr v2 = _ss->get_view();
+    ASSERT_EQ(v1->version, v2->version);
+    ASSERT_EQ(v1->change_time_ms, v2->change_time_ms);
+    ASSERT_EQ(v1->exist_apps.at("app1"), v2->exist_apps.at("app1"));
+
+    // a view is published once the batch of updates is done
+    update_ballot("app1", 0, 200);
+    server_state_view_ptr v3 = _ss->get_view();
+    ASSERT_EQ(v1->version + 1, v3->version);
+    ASSERT_EQ(v3->publish_time_ms, v3->change_time_ms);
+    ASSERT_EQ(200, query("app1").partitions[0].ballot);
+    ASSERT_EQ(100, v1->exist_apps.at("app1")->partitions[0].ballot);
+    // the unchanged app is shared between the views
+    ASSERT_NE(v1->exist_apps.at("app1"), v3->exist_apps.at("app1"));
+    ASSERT_EQ(v1->exist_apps.at("app2"), v3->exist_apps.at("app2"));
+
+    update_ballot("app2", 1, 300);
+    ASSERT_EQ(v3->version + 1, _ss->get_view()->version);
+    ASSERT_EQ(300, query("app2").partitions[1].ballot);
+
+    configuration_list_apps_request request;
+    configuration_list_apps_response response;
+    request.status = app_status::AS_AVAILABLE;
+    _ss->list_apps(request, response);
+    ASSERT_EQ(ERR_OK, response.err);
+    ASSERT_EQ(2, response.infos.size());
+
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, query("not_exist").err);
+}
+
+} // namespace replication
+} // namespace dsn
@@ -29,8 +29,11 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <algorithm>
 #include <cstdlib>
+#include <stdlib.h> // posix_memalign
 
+#include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/filesystem.h>
 #include <dsn/tool-api/async_calls.h>
 
@@ -44,9 +47,35 @@ DSN_DEFINE_uint32(
     "max rate per disk of send to remote node(MB/s)，zero means disable rate limiter");
 DSN_TAG_VARIABLE(max_send_rate_megabytes_per_disk, FT_MUTABLE);
 
+DSN_DEFINE_bool("nfs",
+                enable_direct_io_read,
+                false,
+                "whether to read the files to be copied with O_DIRECT, so that copying large files "
+                "doesn't evict the page cache of the foreground traffic");
+DSN_TAG_VARIABLE(enable_direct_io_read, FT_MUTABLE);
+
 DSN_DECLARE_int32(file_close_timer_interval_ms_on_server);
 DSN_DECLARE_int32(file_close_expire_time_ms);
 
+// O_DIRECT requires the buffer, offset and size of the reads to be aligned to the logical block
+// size of the device, which is 512 or 4096.
+static constexpr uint64_t DIRECT_IO_ALIGNMENT = 4096;
+
+// Falls back to buffered io if the file system doesn't support O_DIRECT, e.g. tmpfs.
+static disk_file *open_file_to_copy(const std::string &file_path, /*out*/ bool &direct_io)
+{
+    direct_io = false;
+    if (FLAGS_enable_direct_io_read) {
+        disk_file *hfile = file::open(file_path.c_str(), O_RDONLY | O_BINARY | O_DIRECT, 0);
+        if (hfile != nullptr) {
+            direct_io = true;
+            return hfile;
+        }
+        dwarn_f("open file {} with O_DIRECT failed, fall back to buffered io", file_path);
+    }
+    return file::open(file_path.c_str(), O_RDONLY | O_BINARY, 0);
+}
+
 nfs_service_impl::nfs_service_impl() : ::dsn::serverlet<nfs_service_impl>("nfs")
 {
     _file_close_timer = ::dsn::tasking::enqueue_timer(
@@ -77,6 +106,7 @@ void nfs_service_impl::on_copy(const ::dsn::service::copy_request &request,
     std::string file_path =
         dsn::utils::filesystem::path_combine(request.source_dir, request.file_name);
     disk_file *hfile;
+    bool direct_io = false;
 
     {
         zauto_lock l(_handles_map_lock);
@@ -84,11 +114,12 @@ void nfs_service_impl::on_copy(const ::dsn::service::copy_request &request,
 
         if (it == _handles_map.end()) // not found
         {
-            hfile = file::open(file_path.c_str(), O_RDONLY | O_BINARY, 0);
+            hfile = open_file_to_copy(file_path, direct_io);
             if (hfile) {
 
                 auto fh = std::make_shared<file_handle_info_on_server>();
                 fh->file_handle = hfile;
+                fh->direct_io = direct_io;
                 fh->file_access_count = 1;
                 fh->last_access_time = dsn_now_ms();
                 _handles_map.insert(std::make_pair(file_path, std::move(fh)));
@@ -96,6 +127,7 @@ void nfs_service_impl::on_copy(const ::dsn::service::copy_request &request,
         } else // found
         {
             hfile = it->second->file_handle;
+            direct_io = it->second->direct_io;
             it->second->file_access_count++;
             it->second->last_access_time = dsn_now_ms();
         }
@@ -114,8 +146,26 @@ void nfs_service_impl::on_copy(const ::dsn::service::copy_request &request,
         return;
     }
 
+    // with O_DIRECT, read the aligned range covering the request, and reply the requested part
+    uint64_t read_offset = request.offset;
+    uint64_t read_size = request.size;
+    std::shared_ptr<char> buffer;
+    if (direct_io) {
+        read_offset = request.offset / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+        uint64_t read_end = (request.offset + request.size + DIRECT_IO_ALIGNMENT - 1) /
+                            DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+        read_size = read_end - read_offset;
+        void *ptr = nullptr;
+        int ret = posix_memalign(&ptr, DIRECT_IO_ALIGNMENT, read_size);
+        dassert_f(ret == 0, "posix_memalign failed, size = {}, ret = {}", read_size, ret);
+        buffer = std::shared_ptr<char>(static_cast<char *>(ptr), free);
+    } else {
+        buffer = dsn::utils::make_shared_array<char>(request.size);
+    }
+    uint64_t head = request.offset - read_offset;
+
     std::shared_ptr<callback_para> cp = std::make_shared<callback_para>(std::move(reply));
-    cp->bb = blob(dsn::utils::make_shared_array<char>(request.size), request.size);
+    cp->bb = blob(std::move(buffer), static_cast<int>(head), request.size);
     cp->dst_dir = request.dst_dir;
     cp->source_disk_tag = request.source_disk_tag;
     cp->file_path = std::move(file_path);
@@ -125,14 +175,17 @@ void nfs_service_impl::on_copy(const ::dsn::service::copy_request &request,
 
     auto buffer_save = cp->bb.buffer().get();
 
-    file::read(
-        hfile,
-        buffer_save,
-        request.size,
-        request.offset,
-        LPC_NFS_READ,
-        &_tracker,
-        [this, cp](error_code err, size_t sz) mutable { internal_read_callback(err, sz, *cp); });
+    file::read(hfile,
+               buffer_save,
+               static_cast<int>(read_size),
+               read_offset,
+               LPC_NFS_READ,
+               &_tracker,
+               [this, cp, head](error_code err, size_t sz) mutable {
+                   // the bytes read before the requested offset are not replied
+                   sz = sz > head ? std::min<size_t>(sz - head, cp->size) : 0;
+                   internal_read_callback(err, sz, *cp);
+               });
 }
 
 void nfs_service_impl::internal_read_callback(error_code err, size_t sz, callback_para &cp)
@@ -102,11 +102,12 @@ private:
     struct file_handle_info_on_server
     {
         disk_file *file_handle;
+        bool direct_io;            // whether the file is opened with O_DIRECT
         int32_t file_access_count; // concurrent r/w count
         uint64_t last_access_time; // last touch time
 
         file_handle_info_on_server()
-            : file_handle(nullptr), file_access_count(0), last_access_time(0)
+            : file_handle(nullptr), direct_io(false), file_access_count(0), last_access_time(0)
         {
         }
 
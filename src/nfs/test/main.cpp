@@ -24,16 +24,30 @@
  * THE SOFTWARE.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+
 #include <gtest/gtest.h>
 
 #include <dsn/service_api_c.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/rand.h>
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/async_calls.h>
 #include <dsn/dist/nfs_node.h>
 
 using namespace dsn;
 
+namespace dsn {
+namespace service {
+DSN_DECLARE_bool(enable_direct_io_read);
+DSN_DECLARE_uint32(nfs_copy_block_bytes);
+} // namespace service
+} // namespace dsn
+
 DEFINE_TASK_CODE_AIO(LPC_AIO_TEST_NFS, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 struct aio_result
 {
@@ -176,6 +190,77 @@ TEST(nfs, basic)
     nfs->stop();
 }
 
+static std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+TEST(nfs, direct_io_read)
+{
+    utils::filesystem::remove_path("nfs_test_dir_direct");
+    utils::filesystem::remove_path("nfs_test_dir_direct_copy");
+    ASSERT_TRUE(utils::filesystem::create_directory("nfs_test_dir_direct"));
+
+    // the blocks are not aligned to the direct io alignment, and the last one is short
+    std::string content;
+    for (int i = 0; i < 5 * 5000 + 1234; ++i) {
+        content.push_back(static_cast<char>(rand::next_u32(0, 255)));
+    }
+    {
+        std::ofstream ofs("nfs_test_dir_direct/nfs_test_file", std::ios::binary);
+        ofs << content;
+    }
+
+    // the file system of the working directory may not support O_DIRECT, e.g. tmpfs, then the
+    // server falls back to buffered io
+    int fd = ::open("nfs_test_dir_direct/nfs_test_file", O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        std::cout << "O_DIRECT isn't supported here, the file is read buffered" << std::endl;
+    } else {
+        ::close(fd);
+    }
+
+    bool old_enable_direct_io_read = service::FLAGS_enable_direct_io_read;
+    uint32_t old_nfs_copy_block_bytes = service::FLAGS_nfs_copy_block_bytes;
+    service::FLAGS_enable_direct_io_read = true;
+    service::FLAGS_nfs_copy_block_bytes = 5000;
+
+    std::unique_ptr<dsn::nfs_node> nfs(dsn::nfs_node::create());
+    nfs->start();
+
+    aio_result r;
+    dsn::aio_task_ptr t = nfs->copy_remote_files(dsn::rpc_address("localhost", 20101),
+                                                 "default",
+                                                 "nfs_test_dir_direct",
+                                                 {"nfs_test_file"},
+                                                 "default",
+                                                 "nfs_test_dir_direct_copy",
+                                                 false,
+                                                 false,
+                                                 LPC_AIO_TEST_NFS,
+                                                 nullptr,
+                                                 [&r](dsn::error_code err, size_t sz) {
+                                                     r.err = err;
+                                                     r.sz = sz;
+                                                 },
+                                                 0);
+    ASSERT_NE(nullptr, t);
+    ASSERT_TRUE(t->wait(20000));
+    ASSERT_EQ(ERR_OK, r.err);
+    ASSERT_EQ(content.size(), r.sz);
+
+    // the bytes read with O_DIRECT are the same as the bytes read buffered
+    ASSERT_EQ(read_file("nfs_test_dir_direct/nfs_test_file"),
+              read_file("nfs_test_dir_direct_copy/nfs_test_file"));
+
+    nfs->stop();
+    service::FLAGS_enable_direct_io_read = old_enable_direct_io_read;
+    service::FLAGS_nfs_copy_block_bytes = old_nfs_copy_block_bytes;
+}
+
 int g_test_ret = 0;
 GTEST_API_ int main(int argc, char **argv)
 {
@@ -0,0 +1,274 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "chunked_file_uploader.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/tool-api/async_calls.h>
+#include <dsn/utility/safe_strerror_posix.h>
+#include <dsn/utility/strings.h>
+#include <dsn/utility/utils.h>
+
+namespace dsn {
+namespace replication {
+
+chunked_file_uploader::chunked_file_uploader(
+    const dist::block_service::block_file_ptr &file_handle,
+    const std::string &local_file,
+    uint64_t part_size,
+    int32_t max_uploading_parts,
+    folly::TokenBucket *rate_limiter,
+    task_code code,
+    task_tracker *tracker)
+    : _file_handle(file_handle),
+      _local_file(local_file),
+      _part_size(part_size),
+      _max_uploading_parts(std::max(1, max_uploading_parts)),
+      _rate_limiter(rate_limiter),
+      _code(code),
+      _tracker(tracker),
+      _fd(-1),
+      _file_size(0),
+      _read_offset(0),
+      _next_part_index(0),
+      _uploading_parts(0),
+      _uploaded_size(0),
+      _next_part_charged(false),
+      _reading(false),
+      _finished(false)
+{
+    dassert_f(_file_handle->support_multipart_upload(),
+              "file {} doesn't support multipart upload",
+              _file_handle->file_name());
+    dassert_f(_part_size > 0, "invalid part size");
+    MD5_Init(&_md5_ctx);
+}
+
+chunked_file_uploader::~chunked_file_uploader()
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+void chunked_file_uploader::start(callback cb)
+{
+    _cb = std::move(cb);
+
+    _fd = ::open(_local_file.c_str(), O_RDONLY);
+    struct stat st;
+    if (_fd < 0 || ::fstat(_fd, &st) != 0) {
+        derror_f("open local file {} for upload failed, err = {}",
+                 _local_file,
+                 utils::safe_strerror(errno));
+        finish(ERR_FILE_OPERATION_FAILED);
+        return;
+    }
+    _file_size = static_cast<uint64_t>(st.st_size);
+
+    chunked_file_uploader_ptr self(this);
+    if (_file_size == 0) {
+        tasking::enqueue(_code, _tracker, [self]() { self->complete(); });
+    } else {
+        tasking::enqueue(_code, _tracker, [self]() { self->read_next_parts(); });
+    }
+}
+
+void chunked_file_uploader::read_next_parts()
+{
+    chunked_file_uploader_ptr self(this);
+    while (true) {
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        int32_t part_index = 0;
+        {
+            zauto_lock l(_lock);
+            // only one reader at a time, so that the md5 is updated in the order of the file
+            // the first part starts the upload, the others wait until it's uploaded
+            if (_finished || _reading || _read_offset >= _file_size ||
+                _uploading_parts >= _max_uploading_parts ||
+                (_next_part_index == 1 && _uploading_parts > 0)) {
+                return;
+            }
+            length = std::min(_part_size, _file_size - _read_offset);
+
+            if (_rate_limiter != nullptr && !_next_part_charged) {
+                _next_part_charged = true;
+                auto wait_seconds = _rate_limiter->consumeWithBorrowNonBlocking(length);
+                if (wait_seconds && *wait_seconds > 0) {
+                    // the tokens are borrowed, read the part after they are refilled
+                    _reading = true;
+                    tasking::enqueue(
+                        _code,
+                        _tracker,
+                        [self]() {
+                            {
+                                zauto_lock l(self->_lock);
+                                self->_reading = false;
+                            }
+                            self->read_next_parts();
+                        },
+                        0,
+                        std::chrono::milliseconds(static_cast<int64_t>(*wait_seconds * 1000)));
+                    return;
+                }
+            }
+            _next_part_charged = false;
+
+            _reading = true;
+            offset = _read_offset;
+            part_index = _next_part_index++;
+            _read_offset += length;
+            _uploading_parts++;
+        }
+
+        std::shared_ptr<char> buffer = utils::make_shared_array<char>(length);
+        uint64_t read_size = 0;
+        while (read_size < length) {
+            ssize_t n =
+                ::pread(_fd, buffer.get() + read_size, length - read_size, offset + read_size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                derror_f("read local file {} failed, offset = {}, err = {}",
+                         _local_file,
+                         offset + read_size,
+                         n < 0 ? utils::safe_strerror(errno) : "unexpected end of file");
+                break;
+            }
+            read_size += n;
+        }
+
+        {
+            zauto_lock l(_lock);
+            _reading = false;
+            if (read_size == length) {
+                MD5_Update(&_md5_ctx, buffer.get(), length);
+            }
+        }
+        if (read_size != length) {
+            finish(ERR_FILE_OPERATION_FAILED);
+            return;
+        }
+
+        dist::block_service::upload_part_request req;
+        req.part_index = part_index;
+        req.offset = offset;
+        req.buffer = blob(std::move(buffer), static_cast<unsigned int>(length));
+        _file_handle->upload_part(
+            req,
+            _code,
+            [self, length](const dist::block_service::upload_part_response &resp) {
+                self->on_part_uploaded(resp, length);
+            },
+            _tracker);
+    }
+}
+
+void chunked_file_uploader::on_part_uploaded(const dist::block_service::upload_part_response &resp,
+                                             uint64_t length)
+{
+    if (resp.err != ERR_OK) {
+        derror_f("upload part of file {} failed, err = {}", _local_file, resp.err.to_string());
+        finish(resp.err);
+        return;
+    }
+    if (resp.uploaded_size != length) {
+        // never complete the upload, so that the parts are not combined into the file
+        derror_f("uploaded size of a part of file {} mismatch, expected({}) vs actual({})",
+                 _local_file,
+                 length,
+                 resp.uploaded_size);
+        finish(ERR_INVALID_DATA);
+        return;
+    }
+
+    bool all_uploaded = false;
+    {
+        zauto_lock l(_lock);
+        if (_finished) {
+            return;
+        }
+        _uploading_parts--;
+        _uploaded_size += resp.uploaded_size;
+        all_uploaded = _read_offset >= _file_size && _uploading_parts == 0 && !_reading;
+    }
+
+    if (all_uploaded) {
+        complete();
+    } else {
+        read_next_parts();
+    }
+}
+
+void chunked_file_uploader::complete()
+{
+    dist::block_service::complete_multipart_upload_request req;
+    {
+        zauto_lock l(_lock);
+        if (_finished) {
+            return;
+        }
+        unsigned char out[MD5_DIGEST_LENGTH];
+        MD5_Final(out, &_md5_ctx);
+        req.md5 = utils::md5_digest_to_hex(out);
+        req.part_count = _next_part_index;
+        // the block service rejects the parts and discards them if they mismatch the whole size
+        req.total_size = _file_size;
+    }
+
+    chunked_file_uploader_ptr self(this);
+    _file_handle->complete_multipart_upload(
+        req,
+        _code,
+        [self, req](const dist::block_service::complete_multipart_upload_response &resp) {
+            if (resp.err != ERR_OK) {
+                derror_f("complete multipart upload of file {} failed, err = {}",
+                         self->_local_file,
+                         resp.err.to_string());
+            }
+            self->finish(resp.err, req.total_size, req.md5);
+        },
+        _tracker);
+}
+
+void chunked_file_uploader::finish(error_code err, uint64_t uploaded_size, const std::string &md5)
+{
+    {
+        zauto_lock l(_lock);
+        if (_finished) {
+            return;
+        }
+        _finished = true;
+    }
+
+    result res;
+    res.err = err;
+    if (err == ERR_OK) {
+        res.uploaded_size = uploaded_size;
+        res.md5 = md5;
+    }
+    _cb(res);
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,95 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <openssl/md5.h>
+
+#include <dsn/dist/block_service.h>
+#include <dsn/tool-api/zlocks.h>
+#include <dsn/utility/TokenBucket.h>
+
+namespace dsn {
+namespace replication {
+
+// Uploads a local file to block service by multipart upload, reading the file only once:
+// parts are read sequentially in large chunks, fed into the md5 of the whole file, and
+// uploaded concurrently while the next parts are being read.
+//
+// The file handle must support multipart upload, see
+// block_file::support_multipart_upload().
+class chunked_file_uploader : public ref_counter
+{
+public:
+    struct result
+    {
+        error_code err;
+        uint64_t uploaded_size{0};
+        std::string md5;
+    };
+    typedef std::function<void(const result &)> callback;
+
+    // `rate_limiter` is shared by all the uploaders on this node, nullptr means no limit.
+    chunked_file_uploader(const dist::block_service::block_file_ptr &file_handle,
+                          const std::string &local_file,
+                          uint64_t part_size,
+                          int32_t max_uploading_parts,
+                          folly::TokenBucket *rate_limiter,
+                          task_code code,
+                          task_tracker *tracker);
+    ~chunked_file_uploader();
+
+    // `cb` is called exactly once when all the parts are uploaded and combined, or on the first
+    // failure.
+    void start(callback cb);
+
+private:
+    // read and upload parts until `_max_uploading_parts` are in flight
+    void read_next_parts();
+    // `length` is the size of the part read from the local file
+    void on_part_uploaded(const dist::block_service::upload_part_response &resp, uint64_t length);
+    void complete();
+    void finish(error_code err, uint64_t uploaded_size = 0, const std::string &md5 = "");
+
+    const dist::block_service::block_file_ptr _file_handle;
+    const std::string _local_file;
+    const uint64_t _part_size;
+    const int32_t _max_uploading_parts;
+    folly::TokenBucket *_rate_limiter;
+    const task_code _code;
+    task_tracker *_tracker;
+
+    callback _cb;
+    int _fd;
+    uint64_t _file_size;
+
+    zlock _lock; // protect the members below
+    MD5_CTX _md5_ctx;
+    uint64_t _read_offset;
+    int32_t _next_part_index;
+    int32_t _uploading_parts;
+    uint64_t _uploaded_size;
+    // the next part has been charged to the rate limiter but not read yet
+    bool _next_part_charged;
+    bool _reading;
+    bool _finished;
+};
+
+typedef dsn::ref_ptr<chunked_file_uploader> chunked_file_uploader_ptr;
+
+} // namespace replication
+} // namespace dsn
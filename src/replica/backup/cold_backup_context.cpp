@@ -20,12 +20,43 @@
 #include "replica/replica.h"
 #include "replica/replica_stub.h"
 #include "block_service/block_service_manager.h"
+#include "chunked_file_uploader.h"
 
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("replication",
+                  cold_backup_upload_part_size_mb,
+                  64,
+                  "part size(MB) of multipart upload of checkpoint files in cold backup");
+DSN_DEFINE_uint32("replication",
+                  cold_backup_max_uploading_parts_per_file,
+                  4,
+                  "max count of parts of one checkpoint file uploading concurrently");
+DSN_DEFINE_uint32("replication",
+                  cold_backup_upload_rate_limit_mb,
+                  0,
+                  "read rate limit(MB/s) of all the checkpoint files uploading by multipart upload "
+                  "on this node, 0 means no limit");
+
+// shared by all the cold backups on this node
+static folly::TokenBucket *upload_rate_limiter()
+{
+    if (FLAGS_cold_backup_upload_rate_limit_mb == 0) {
+        return nullptr;
+    }
+    static const double rate =
+        static_cast<double>(FLAGS_cold_backup_upload_rate_limit_mb) * (1 << 20);
+    // a whole part should be able to be consumed at once
+    static folly::TokenBucket limiter(
+        rate,
+        std::max(rate, static_cast<double>(FLAGS_cold_backup_upload_part_size_mb) * (1 << 20)));
+    return &limiter;
+}
+
 const char *cold_backup_status_to_string(cold_backup_status status)
 {
     switch (status) {
@@ -611,19 +642,13 @@ void cold_backup_context::prepare_upload()
         std::string &file = checkpoint_files[idx];
         file_meta f_meta;
         f_meta.name = file;
-        std::string file_full_path = ::dsn::utils::filesystem::path_combine(checkpoint_dir, file);
         int64_t file_size = checkpoint_file_sizes[idx];
-        std::string file_md5;
-        if (::dsn::utils::filesystem::md5sum(file_full_path, file_md5) != ERR_OK) {
-            derror("%s: get local file size or md5 fail, file = %s", name, file_full_path.c_str());
-            fail_upload("compute local file size or md5 failed");
-            return;
-        }
-        f_meta.md5 = file_md5;
+        // the md5 is computed while uploading the file, to avoid reading all the files
+        // before uploading starts, see set_file_md5()
         f_meta.size = file_size;
         _metadata.files.emplace_back(f_meta);
         _file_status.insert(std::make_pair(file, FileUploadUncomplete));
-        _file_infos.insert(std::make_pair(file, std::make_pair(file_size, file_md5)));
+        _file_infos.insert(std::make_pair(file, std::make_pair(file_size, std::string())));
     }
     _upload_file_size.store(0);
 }
@@ -646,15 +671,36 @@ void cold_backup_context::upload_file(const std::string &local_filename)
                 const dist::block_service::block_file_ptr &file_handle = resp.file_handle;
                 dassert(file_handle != nullptr, "");
                 int64_t local_file_size = _file_infos.at(local_filename).first;
-                std::string md5 = _file_infos.at(local_filename).second;
                 std::string full_path_local_file =
                     ::dsn::utils::filesystem::path_combine(checkpoint_dir, local_filename);
-                if (md5 == file_handle->get_md5sum() &&
+                // only compute the md5 before uploading if it's necessary, in other cases the
+                // file is read only once while uploading
+                std::string md5;
+                bool need_md5 = !file_handle->support_multipart_upload() ||
+                                (local_file_size == file_handle->get_size() &&
+                                 !file_handle->get_md5sum().empty());
+                if (need_md5) {
+                    if (::dsn::utils::filesystem::md5sum(full_path_local_file, md5) != ERR_OK) {
+                        derror("%s: get local file md5 fail, file = %s",
+                               name,
+                               full_path_local_file.c_str());
+                        fail_upload("compute local file md5 failed");
+                        release_ref();
+                        return;
+                    }
+                    set_file_md5(local_filename, md5);
+                }
+                if (need_md5 && md5 == file_handle->get_md5sum() &&
                     local_file_size == file_handle->get_size()) {
                     ddebug("%s: checkpoint file already exist on remote, file = %s",
                            name,
                            full_path_local_file.c_str());
                     on_upload_file_complete(local_filename);
+                } else if (file_handle->support_multipart_upload()) {
+                    ddebug("%s: start multipart upload checkpoint file to remote, file = %s",
+                           name,
+                           full_path_local_file.c_str());
+                    on_upload_multipart(file_handle, full_path_local_file);
                 } else {
                     ddebug("%s: start upload checkpoint file to remote, file = %s",
                            name,
@@ -777,6 +823,83 @@ void cold_backup_context::on_upload(const dist::block_service::block_file_ptr &f
         });
 }
 
+void cold_backup_context::on_upload_multipart(
+    const dist::block_service::block_file_ptr &file_handle, const std::string &full_path_local_file)
+{
+    add_ref();
+
+    uint64_t part_size = static_cast<uint64_t>(FLAGS_cold_backup_upload_part_size_mb) << 20;
+    chunked_file_uploader_ptr uploader(
+        new chunked_file_uploader(file_handle,
+                                  full_path_local_file,
+                                  part_size,
+                                  FLAGS_cold_backup_max_uploading_parts_per_file,
+                                  upload_rate_limiter(),
+                                  LPC_BACKGROUND_COLD_BACKUP,
+                                  nullptr));
+    uploader->start([this, file_handle, full_path_local_file](
+        const chunked_file_uploader::result &res) {
+        std::string local_filename = ::dsn::utils::filesystem::get_file_name(full_path_local_file);
+        if (res.err == ERR_OK) {
+            dassert(_file_infos.at(local_filename).first == static_cast<int64_t>(res.uploaded_size),
+                    "");
+            set_file_md5(local_filename, res.md5);
+            ddebug("%s: multipart upload checkpoint file complete, file = %s",
+                   name,
+                   full_path_local_file.c_str());
+            on_upload_file_complete(local_filename);
+        } else if (res.err == ERR_TIMEOUT) {
+            derror("%s: multipart upload checkpoint file timeout, retry after 10s, file = %s",
+                   name,
+                   full_path_local_file.c_str());
+            add_ref();
+
+            tasking::enqueue(LPC_BACKGROUND_COLD_BACKUP,
+                             nullptr,
+                             [this, file_handle, full_path_local_file, local_filename]() {
+                                 if (!is_ready_for_upload()) {
+                                     derror("%s: backup status has changed to %s, stop upload "
+                                            "checkpoint file to remote, file = %s",
+                                            name,
+                                            cold_backup_status_to_string(status()),
+                                            full_path_local_file.c_str());
+                                     file_upload_uncomplete(local_filename);
+                                 } else {
+                                     on_upload_multipart(file_handle, full_path_local_file);
+                                 }
+                                 release_ref();
+                             },
+                             0,
+                             std::chrono::seconds(10));
+        } else {
+            derror("%s: multipart upload checkpoint file to remote failed, file = %s, err = %s",
+                   name,
+                   full_path_local_file.c_str(),
+                   res.err.to_string());
+            fail_upload("upload checkpoint file to remote failed");
+        }
+        if (res.err != ERR_OK && _owner_replica != nullptr) {
+            _owner_replica->get_replica_stub()
+                ->_counter_cold_backup_recent_upload_file_fail_count->increment();
+        }
+        release_ref();
+    });
+}
+
+void cold_backup_context::set_file_md5(const std::string &local_filename, const std::string &md5)
+{
+    zauto_lock l(_lock);
+    _file_infos.at(local_filename).second = md5;
+}
+
+void cold_backup_context::fill_metadata_md5()
+{
+    zauto_lock l(_lock);
+    for (file_meta &f_meta : _metadata.files) {
+        f_meta.md5 = _file_infos.at(f_meta.name).second;
+    }
+}
+
 void cold_backup_context::write_backup_metadata()
 {
     if (_upload_status.load() == UploadComplete) {
@@ -797,6 +920,7 @@ void cold_backup_context::write_backup_metadata()
         [this, metadata](const dist::block_service::create_file_response &resp) {
             if (resp.err == ERR_OK) {
                 dassert(resp.file_handle != nullptr, "");
+                fill_metadata_md5();
                 blob buffer = json::json_forwarder<cold_backup_metadata>::encode(_metadata);
                 // hold itself until callback is executed
                 add_ref();
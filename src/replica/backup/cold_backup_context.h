@@ -294,7 +294,11 @@ private:
     void upload_file(const std::string &local_filename);
     void on_upload(const dist::block_service::block_file_ptr &file_handle,
                    const std::string &full_path_local_file);
+    void on_upload_multipart(const dist::block_service::block_file_ptr &file_handle,
+                             const std::string &full_path_local_file);
     void on_upload_file_complete(const std::string &local_filename);
+    void set_file_md5(const std::string &local_filename, const std::string &md5);
+    void fill_metadata_md5();
 
     // functions access the structure protected by _lock
     // return:
@@ -356,6 +360,7 @@ private:
 
     int32_t _max_concurrent_uploading_file_cnt;
     // filename -> <filesize, md5>
+    // md5 is set under _lock once the file is read, see set_file_md5()
     std::map<std::string, std::pair<int64_t, std::string>> _file_infos;
 
     zlock _lock; // lock the structure below
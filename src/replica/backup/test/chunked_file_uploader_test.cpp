@@ -0,0 +1,170 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/strings.h>
+#include <dsn/utility/synchronize.h>
+
+#include "block_service/local/local_service.h"
+#include "replica/backup/chunked_file_uploader.h"
+
+namespace dsn {
+namespace replication {
+
+using namespace dist::block_service;
+
+DEFINE_TASK_CODE(LPC_TEST_CHUNKED_UPLOAD, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+// A local file object which fails or shortens the chosen part, and records whether the other
+// parts are uploaded before the first one.
+class faulty_file_object : public local_file_object
+{
+public:
+    explicit faulty_file_object(const std::string &name) : local_file_object(name) {}
+
+    task_ptr upload_part(const upload_part_request &req,
+                         task_code code,
+                         const upload_part_callback &cb,
+                         task_tracker *tracker = nullptr) override
+    {
+        if (req.part_index != 0 && !first_part_uploaded.load()) {
+            uploaded_before_first_part = true;
+        }
+
+        upload_part_request part = req;
+        if (req.part_index == short_part_index) {
+            part.buffer = req.buffer.range(0, req.buffer.length() - 1);
+        }
+        bool failed = req.part_index == failed_part_index;
+        int32_t part_index = req.part_index;
+        return local_file_object::upload_part(
+            part,
+            code,
+            [this, cb, failed, part_index](const upload_part_response &r) {
+                upload_part_response resp = r;
+                if (failed) {
+                    resp.err = ERR_TIMEOUT;
+                    resp.uploaded_size = 0;
+                }
+                if (part_index == 0) {
+                    first_part_uploaded = true;
+                }
+                cb(resp);
+            },
+            tracker);
+    }
+
+    int32_t short_part_index{-1};
+    int32_t failed_part_index{-1};
+    std::atomic_bool first_part_uploaded{false};
+    std::atomic_bool uploaded_before_first_part{false};
+};
+
+class chunked_file_uploader_test : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        // 10 parts, the last one is shorter than the others
+        _content.clear();
+        for (int i = 0; i < 150; ++i) {
+            _content.push_back('a' + i % 26);
+        }
+        std::ofstream ofs(_local_file, std::ios::binary | std::ios::trunc);
+        ofs << _content;
+    }
+
+    void TearDown() override
+    {
+        utils::filesystem::remove_path(_local_file);
+        utils::filesystem::remove_path(_remote_file);
+        utils::filesystem::remove_path(local_service::get_metafile(_remote_file));
+        utils::filesystem::remove_path(local_service::get_multipart_file(_remote_file));
+    }
+
+    chunked_file_uploader::result upload(const block_file_ptr &file)
+    {
+        chunked_file_uploader::result res;
+        utils::notify_event done;
+        chunked_file_uploader_ptr uploader(new chunked_file_uploader(
+            file, _local_file, PART_SIZE, 4, nullptr, LPC_TEST_CHUNKED_UPLOAD, nullptr));
+        uploader->start([&res, &done](const chunked_file_uploader::result &r) {
+            res = r;
+            done.notify();
+        });
+        done.wait();
+        return res;
+    }
+
+    static const uint64_t PART_SIZE = 16;
+
+    const std::string _local_file{"chunked_file_uploader_test.local"};
+    const std::string _remote_file{"chunked_file_uploader_test.remote"};
+    std::string _content;
+};
+
+TEST_F(chunked_file_uploader_test, upload)
+{
+    dsn::ref_ptr<faulty_file_object> file(new faulty_file_object(_remote_file));
+    auto res = upload(file);
+    ASSERT_EQ(ERR_OK, res.err);
+    ASSERT_EQ(_content.size(), res.uploaded_size);
+    ASSERT_EQ(utils::string_md5(_content.data(), _content.size()), res.md5);
+    ASSERT_FALSE(file->uploaded_before_first_part.load());
+
+    std::string md5;
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(_remote_file, md5));
+    ASSERT_EQ(res.md5, md5);
+    ASSERT_EQ(res.md5, file->get_md5sum());
+}
+
+TEST_F(chunked_file_uploader_test, size_mismatch)
+{
+    dsn::ref_ptr<faulty_file_object> file(new faulty_file_object(_remote_file));
+    file->short_part_index = 3;
+    auto res = upload(file);
+    ASSERT_EQ(ERR_INVALID_DATA, res.err);
+    ASSERT_EQ(0, res.uploaded_size);
+    ASSERT_TRUE(res.md5.empty());
+    ASSERT_FALSE(utils::filesystem::file_exists(_remote_file));
+}
+
+TEST_F(chunked_file_uploader_test, part_failed_and_retried)
+{
+    dsn::ref_ptr<faulty_file_object> file(new faulty_file_object(_remote_file));
+    file->failed_part_index = 5;
+    auto res = upload(file);
+    ASSERT_EQ(ERR_TIMEOUT, res.err);
+    ASSERT_FALSE(utils::filesystem::file_exists(_remote_file));
+
+    // the retry starts a new upload, the parts left by the failed one are discarded
+    file = new faulty_file_object(_remote_file);
+    res = upload(file);
+    ASSERT_EQ(ERR_OK, res.err);
+    ASSERT_EQ(_content.size(), res.uploaded_size);
+
+    std::string md5;
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(_remote_file, md5));
+    ASSERT_EQ(utils::string_md5(_content.data(), _content.size()), md5);
+}
+
+} // namespace replication
+} // namespace dsn
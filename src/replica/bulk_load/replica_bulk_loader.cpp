@@ -15,6 +15,8 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+
 #include <dsn/dist/block_service.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/dist/replication/replication_app_base.h>
@@ -27,6 +29,30 @@
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("replication",
+                  bulk_load_max_downloading_files_per_replica,
+                  4,
+                  "max count of the sst files downloaded concurrently by a replica in bulk load");
+DSN_TAG_VARIABLE(bulk_load_max_downloading_files_per_replica, FT_MUTABLE);
+DSN_DEFINE_validator(bulk_load_max_downloading_files_per_replica,
+                     [](uint32_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint32("replication",
+                  bulk_load_max_downloading_files_per_node,
+                  16,
+                  "max count of the sst files downloaded concurrently by all the replicas in bulk "
+                  "load on this node");
+DSN_TAG_VARIABLE(bulk_load_max_downloading_files_per_node, FT_MUTABLE);
+DSN_DEFINE_validator(bulk_load_max_downloading_files_per_node,
+                     [](uint32_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint32("replication",
+                  bulk_load_download_rate_limit_mb,
+                  0,
+                  "download rate limit(MB/s) of all the replicas in bulk load on this node, 0 "
+                  "means no limit");
+DSN_TAG_VARIABLE(bulk_load_download_rate_limit_mb, FT_MUTABLE);
+
 replica_bulk_loader::replica_bulk_loader(replica *r)
     : replica_base(r), _replica(r), _stub(r->get_replica_stub())
 {
@@ -392,18 +418,22 @@ error_code replica_bulk_loader::start_download(const std::string &remote_dir,
 
     // start download
     _is_downloading.store(true);
-    _download_task = tasking::enqueue(
-        LPC_BACKGROUND_BULK_LOAD,
-        tracker(),
-        std::bind(
-            &replica_bulk_loader::download_files, this, provider_name, remote_dir, local_dir));
+    _download_task = tasking::enqueue(LPC_BACKGROUND_BULK_LOAD,
+                                      tracker(),
+                                      std::bind(&replica_bulk_loader::download_files,
+                                                this,
+                                                provider_name,
+                                                remote_dir,
+                                                local_dir,
+                                                _download_generation));
     return ERR_OK;
 }
 
 // ThreadPool: THREAD_POOL_DEFAULT
 void replica_bulk_loader::download_files(const std::string &provider_name,
                                          const std::string &remote_dir,
-                                         const std::string &local_dir)
+                                         const std::string &local_dir,
+                                         uint64_t generation)
 {
     FAIL_POINT_INJECT_F("replica_bulk_loader_download_files", [](string_view) {});
 
@@ -417,6 +447,10 @@ void replica_bulk_loader::download_files(const std::string &provider_name,
         remote_dir, local_dir, bulk_load_constant::BULK_LOAD_METADATA, fs, file_size);
     {
         zauto_write_lock l(_lock);
+        if (generation != _download_generation) {
+            ddebug_replica("bulk load states are cleared, abandon the download");
+            return;
+        }
         if (err != ERR_OK && err != ERR_PATH_ALREADY_EXIST) {
             try_decrease_bulk_load_download_count();
             _download_status.store(err);
@@ -437,22 +471,110 @@ void replica_bulk_loader::download_files(const std::string &provider_name,
     }
 
     // download sst files asynchronously
-    if (!_metadata.files.empty()) {
-        const file_meta &f_meta = _metadata.files[0];
-        _download_files_task[f_meta.name] = tasking::enqueue(
-            LPC_BACKGROUND_BULK_LOAD,
-            tracker(),
-            std::bind(&replica_bulk_loader::download_sst_file, this, remote_dir, local_dir, 0, fs));
+    zauto_write_lock l(_lock);
+    if (generation == _download_generation) {
+        start_download_sst_files(remote_dir, local_dir, fs);
+    }
+}
+
+// ThreadPool: THREAD_POOL_DEFAULT
+// need to acquire write lock while calling it
+void replica_bulk_loader::start_download_sst_files(const std::string &remote_dir,
+                                                   const std::string &local_dir,
+                                                   dist::block_service::block_filesystem *fs)
+{
+    // stop once bulk load is cleaned up or any file fails
+    while (_is_downloading.load() && _download_status.load() == ERR_OK &&
+           _next_download_file_index < static_cast<int32_t>(_metadata.files.size()) &&
+           _downloading_file_count <
+               static_cast<int32_t>(FLAGS_bulk_load_max_downloading_files_per_replica)) {
+        int32_t file_index = _next_download_file_index++;
+        ++_downloading_file_count;
+        _download_files_task[_metadata.files[file_index].name] =
+            tasking::enqueue(LPC_BACKGROUND_BULK_LOAD,
+                             tracker(),
+                             std::bind(&replica_bulk_loader::download_sst_file,
+                                       this,
+                                       remote_dir,
+                                       local_dir,
+                                       file_index,
+                                       fs,
+                                       false,
+                                       _download_generation));
+    }
+}
+
+// ThreadPool: THREAD_POOL_DEFAULT
+void replica_bulk_loader::delay_download_sst_file(const std::string &remote_dir,
+                                                  const std::string &local_dir,
+                                                  int32_t file_index,
+                                                  dist::block_service::block_filesystem *fs,
+                                                  std::chrono::milliseconds delay,
+                                                  uint64_t generation)
+{
+    zauto_write_lock l(_lock);
+    if (!_is_downloading.load() || generation != _download_generation) {
+        return;
     }
+    _download_files_task[_metadata.files[file_index].name] =
+        tasking::enqueue(LPC_BACKGROUND_BULK_LOAD,
+                         tracker(),
+                         std::bind(&replica_bulk_loader::download_sst_file,
+                                   this,
+                                   remote_dir,
+                                   local_dir,
+                                   file_index,
+                                   fs,
+                                   true,
+                                   generation),
+                         0,
+                         delay);
 }
 
 // ThreadPool: THREAD_POOL_DEFAULT
 void replica_bulk_loader::download_sst_file(const std::string &remote_dir,
                                             const std::string &local_dir,
                                             int32_t file_index,
-                                            dist::block_service::block_filesystem *fs)
+                                            dist::block_service::block_filesystem *fs,
+                                            bool charged,
+                                            uint64_t generation)
 {
-    const file_meta &f_meta = _metadata.files[file_index];
+    FAIL_POINT_INJECT_F("replica_bulk_loader_download_sst_file", [](string_view) {});
+
+    file_meta f_meta;
+    {
+        zauto_read_lock l(_lock);
+        if (generation != _download_generation) {
+            return;
+        }
+        f_meta = _metadata.files[file_index];
+    }
+
+    // the replicas on this node share the bandwidth, the whole file is charged at once
+    if (!charged && FLAGS_bulk_load_download_rate_limit_mb > 0) {
+        const double rate = static_cast<double>(FLAGS_bulk_load_download_rate_limit_mb) * (1 << 20);
+        auto wait_seconds = _stub->_bulk_load_download_rate_limiter.consumeWithBorrowNonBlocking(
+            f_meta.size, rate, std::max(rate, static_cast<double>(f_meta.size)));
+        if (wait_seconds && *wait_seconds > 0) {
+            delay_download_sst_file(
+                remote_dir,
+                local_dir,
+                file_index,
+                fs,
+                std::chrono::milliseconds(static_cast<int64_t>(*wait_seconds * 1000)),
+                generation);
+            return;
+        }
+    }
+    // and so do they share the count of the files downloading at once
+    if (++_stub->_bulk_load_downloading_file_count >
+        static_cast<int32_t>(FLAGS_bulk_load_max_downloading_files_per_node)) {
+        --_stub->_bulk_load_downloading_file_count;
+        delay_download_sst_file(
+            remote_dir, local_dir, file_index, fs, std::chrono::milliseconds(100), generation);
+        return;
+    }
+
     uint64_t f_size = 0;
     std::string f_md5;
     error_code ec = _stub->_block_service_manager.download_file(
@@ -481,6 +603,8 @@ void replica_bulk_loader::download_sst_file(const std::string &remote_dir,
             }
         }
     }
+    --_stub->_bulk_load_downloading_file_count;
+
     // Here we verify md5 and file size, md5 was calculated
     // from download buffer, file size is get from filesystem
     if (ec == ERR_OK && !verified) {
@@ -491,32 +615,28 @@ void replica_bulk_loader::download_sst_file(const std::string &remote_dir,
         }
     }
     if (ec != ERR_OK) {
-        {
-            zauto_write_lock l(_lock);
+        derror_replica("failed to download file({}), error = {}", f_meta.name, ec.to_string());
+        _stub->_counter_bulk_load_download_file_fail_count->increment();
+        zauto_write_lock l(_lock);
+        if (generation == _download_generation) {
+            --_downloading_file_count;
             try_decrease_bulk_load_download_count();
             _download_status.store(ec);
         }
-        derror_replica("failed to download file({}), error = {}", f_meta.name, ec.to_string());
-        _stub->_counter_bulk_load_download_file_fail_count->increment();
         return;
     }
-    // download file succeed, update progress
-    update_bulk_load_download_progress(f_size, f_meta.name);
     _stub->_counter_bulk_load_download_file_succ_count->increment();
     _stub->_counter_bulk_load_download_file_size->add(f_size);
+    // download file succeed, update progress
+    if (!update_bulk_load_download_progress(f_size, f_meta.name, generation)) {
+        return;
+    }
 
-    // download next file
-    if (file_index + 1 < _metadata.files.size()) {
-        const file_meta &f_meta = _metadata.files[file_index + 1];
-        _download_files_task[f_meta.name] =
-            tasking::enqueue(LPC_BACKGROUND_BULK_LOAD,
-                             tracker(),
-                             std::bind(&replica_bulk_loader::download_sst_file,
-                                       this,
-                                       remote_dir,
-                                       local_dir,
-                                       file_index + 1,
-                                       fs));
+    // download next files
+    zauto_write_lock l(_lock);
+    if (generation == _download_generation) {
+        --_downloading_file_count;
+        start_download_sst_files(remote_dir, local_dir, fs);
     }
 }
 
@@ -547,18 +667,22 @@ error_code replica_bulk_loader::parse_bulk_load_metadata(const std::string &fnam
 }
 
 // ThreadPool: THREAD_POOL_DEFAULT
-void replica_bulk_loader::update_bulk_load_download_progress(uint64_t file_size,
-                                                             const std::string &file_name)
+bool replica_bulk_loader::update_bulk_load_download_progress(uint64_t file_size,
+                                                             const std::string &file_name,
+                                                             uint64_t generation)
 {
     {
         zauto_write_lock l(_lock);
+        if (generation != _download_generation) {
+            return false;
+        }
         if (_metadata.file_total_size <= 0) {
             derror_replica("update downloading file({}) progress failed, metadata has invalid "
                            "file_total_size({}), current status = {}",
                            file_name,
                            _metadata.file_total_size,
                            enum_to_string(_status));
-            return;
+            return false;
         }
 
         ddebug_replica("update progress after downloading file({})", file_name);
@@ -576,7 +700,7 @@ void replica_bulk_loader::update_bulk_load_download_progress(uint64_t file_size,
     tasking::enqueue(LPC_REPLICATION_COMMON,
                      tracker(),
                      std::bind(&replica_bulk_loader::check_download_finish, this),
-                     get_gpid().thread_hash());
+                     get_gpid().thread_hash());    return true;
 }
 
 // ThreadPool: THREAD_POOL_REPLICATION, THREAD_POOL_DEFAULT
@@ -737,6 +861,9 @@ void replica_bulk_loader::clear_bulk_load_states()
         _download_task = nullptr;
         _metadata.files.clear();
         _metadata.file_total_size = 0;
+        _next_download_file_index = 0;
+        _downloading_file_count = 0;
+        ++_download_generation;
         _cur_downloaded_size.store(0);
         _download_progress.store(0);
         _download_status.store(ERR_OK);
@@ -850,11 +977,13 @@ void replica_bulk_loader::report_group_download_progress(/*out*/ bulk_load_respo
         zauto_read_lock l(_lock);
         primary_state.__set_download_progress(_download_progress.load());
         primary_state.__set_download_status(_download_status.load());
+        primary_state.__set_downloaded_size(_cur_downloaded_size.load());
     }
     response.group_bulk_load_state[_replica->_primary_states.membership.primary] = primary_state;
-    ddebug_replica("primary = {}, download progress = {}%, status = {}",
+    ddebug_replica("primary = {}, download progress = {}%, downloaded_size = {}, status = {}",
                    _replica->_primary_states.membership.primary.to_string(),
                    primary_state.download_progress,
+                   primary_state.downloaded_size,
                    primary_state.download_status);
 
     int32_t total_progress = primary_state.download_progress;
@@ -865,9 +994,12 @@ void replica_bulk_loader::report_group_download_progress(/*out*/ bulk_load_respo
             secondary_state.__isset.download_progress ? secondary_state.download_progress : 0;
         error_code s_status =
             secondary_state.__isset.download_status ? secondary_state.download_status : ERR_OK;
-        ddebug_replica("secondary = {}, download progress = {}%, status={}",
+        int64_t s_size =
+            secondary_state.__isset.downloaded_size ? secondary_state.downloaded_size : 0;
+        ddebug_replica("secondary = {}, download progress = {}%, downloaded_size = {}, status={}",
                        target_address.to_string(),
                        s_progress,
+                       s_size,
                        s_status);
         response.group_bulk_load_state[target_address] = secondary_state;
         total_progress += s_progress;
@@ -1010,6 +1142,7 @@ void replica_bulk_loader::report_bulk_load_states_to_primary(
         zauto_read_lock l(_lock);
         bulk_load_state.__set_download_progress(_download_progress.load());
         bulk_load_state.__set_download_status(_download_status.load());
+        bulk_load_state.__set_downloaded_size(_cur_downloaded_size.load());
     } break;
     case bulk_load_status::BLS_INGESTING:
         bulk_load_state.__set_ingest_status(_replica->_app->get_ingestion_status());
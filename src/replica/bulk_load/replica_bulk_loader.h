@@ -63,15 +63,35 @@ private:
 
     // download metadata file and create sst download tasks
     // metadata and sst files will be downloaded in {_dir}/.bulk_load directory
+    // the downloads are abandoned once the states are cleared since `generation`
     void download_files(const std::string &provider_name,
                         const std::string &remote_dir,
-                        const std::string &local_dir);
+                        const std::string &local_dir,
+                        uint64_t generation);
+
+    // start downloading the next sst files, at most
+    // [replication] bulk_load_max_downloading_files_per_replica at once
+    // need to acquire write lock while calling it
+    void start_download_sst_files(const std::string &remote_dir,
+                                  const std::string &local_dir,
+                                  dist::block_service::block_filesystem *fs);
 
     // download sst files from remote provider
+    // `charged` is true if the file has been charged to the node-level rate limiter
     void download_sst_file(const std::string &remote_dir,
                            const std::string &local_dir,
                            int32_t file_index,
-                           dist::block_service::block_filesystem *fs);
+                           dist::block_service::block_filesystem *fs,
+                           bool charged,
+                           uint64_t generation);
+
+    // retry download_sst_file after `delay`, when the node-level limits are reached
+    void delay_download_sst_file(const std::string &remote_dir,
+                                 const std::string &local_dir,
+                                 int32_t file_index,
+                                 dist::block_service::block_filesystem *fs,
+                                 std::chrono::milliseconds delay,
+                                 uint64_t generation);
 
     // \return ERR_FILE_OPERATION_FAILED: file not exist, get size failed, open file failed
     // \return ERR_CORRUPTION: parse failed
@@ -79,7 +99,10 @@ private:
     error_code parse_bulk_load_metadata(const std::string &fname);
 
     // update download progress after downloading sst files succeed
-    void update_bulk_load_download_progress(uint64_t file_size, const std::string &file_name);
+    // \return false if the states are cleared since `generation`
+    bool update_bulk_load_download_progress(uint64_t file_size,
+                                            const std::string &file_name,
+                                            uint64_t generation);
 
     // need to acquire write lock while calling it
     void try_decrease_bulk_load_download_count();
@@ -169,8 +192,15 @@ private:
     std::atomic<uint64_t> _cur_downloaded_size{0};
     std::atomic<int32_t> _download_progress{0};
     std::atomic<error_code> _download_status{ERR_OK};
+    // index of the next sst file to download
+    int32_t _next_download_file_index{0};
+    // count of the sst files being downloaded
+    int32_t _downloading_file_count{0};
+    // increased once the states are cleared, the downloads started before, which may still be
+    // running as they are cancelled without waiting, never touch the states of the later ones
+    uint64_t _download_generation{0};
     // }
-    // file_name -> downloading task
+    // file_name -> downloading task, protected by _lock as the files are downloaded concurrently
     std::map<std::string, task_ptr> _download_files_task;
     // download metadata and create download file tasks
     task_ptr _download_task;
@@ -17,16 +17,21 @@
 
 #include "replica/bulk_load/replica_bulk_loader.h"
 #include "replica/test/replica_test_base.h"
+#include "block_service/test/block_service_mock.h"
 
 #include <fstream>
 
 #include <dsn/tool-api/zlocks.h>
 #include <dsn/utility/fail_point.h>
+#include <dsn/utility/flags.h>
 #include <gtest/gtest.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_uint32(bulk_load_download_rate_limit_mb);
+DSN_DECLARE_uint32(bulk_load_max_downloading_files_per_node);
+
 class replica_bulk_loader_test : public replica_test_base
 {
 public:
@@ -93,7 +98,8 @@ public:
     void test_update_download_progress(uint64_t file_size)
     {
         _bulk_loader->_is_downloading.store(true);
-        _bulk_loader->update_bulk_load_download_progress(file_size, "test_file_name");
+        _bulk_loader->update_bulk_load_download_progress(
+            file_size, "test_file_name", _bulk_loader->_download_generation);
         _bulk_loader->tracker()->wait_outstanding_tasks();
     }
 
@@ -297,6 +303,64 @@ public:
         return true;
     }
 
+    void mock_downloading_files(int32_t file_count, int64_t file_size = 100)
+    {
+        _bulk_loader->_is_downloading.store(true);
+        for (int32_t i = 0; i < file_count; ++i) {
+            file_meta f_meta;
+            f_meta.name = "file_" + std::to_string(i);
+            f_meta.size = file_size;
+            _bulk_loader->_metadata.files.emplace_back(f_meta);
+        }
+        _bulk_loader->_metadata.file_total_size = file_size * file_count;
+    }
+
+    // download the file as if it's started by start_download_sst_files, returns the generation
+    // of the states it's started with
+    uint64_t start_download_sst_file(int32_t file_index)
+    {
+        zauto_write_lock l(_bulk_loader->_lock);
+        ++_bulk_loader->_next_download_file_index;
+        ++_bulk_loader->_downloading_file_count;
+        return _bulk_loader->_download_generation;
+    }
+
+    void test_download_sst_file(int32_t file_index)
+    {
+        uint64_t generation = start_download_sst_file(file_index);
+        _bulk_loader->download_sst_file(ROOT_PATH, LOCAL_DIR, file_index, &_fs, false, generation);
+    }
+
+    bool is_download_sst_file_pending(int32_t file_index)
+    {
+        zauto_write_lock l(_bulk_loader->_lock);
+        const std::string &file_name = _bulk_loader->_metadata.files[file_index].name;
+        auto iter = _bulk_loader->_download_files_task.find(file_name);
+        return iter != _bulk_loader->_download_files_task.end() && iter->second != nullptr &&
+               iter->second->state() != TASK_STATE_FINISHED &&
+               iter->second->state() != TASK_STATE_CANCELLED;
+    }
+
+    void test_cleanup_download_tasks()
+    {
+        zauto_write_lock l(_bulk_loader->_lock);
+        _bulk_loader->_is_downloading.store(false);
+        _bulk_loader->cleanup_download_tasks();
+    }
+
+    void test_start_download_sst_files()
+    {
+        zauto_write_lock l(_bulk_loader->_lock);
+        _bulk_loader->start_download_sst_files(ROOT_PATH, LOCAL_DIR, nullptr);
+    }
+
+    void mock_sst_file_downloaded(error_code err)
+    {
+        zauto_write_lock l(_bulk_loader->_lock);
+        --_bulk_loader->_downloading_file_count;
+        _bulk_loader->_download_status.store(err);
+    }
+
     void mock_downloading_progress(uint64_t file_total_size,
                                    uint64_t cur_downloaded_size,
                                    int32_t download_progress)
@@ -416,6 +480,7 @@ public:
 public:
     std::unique_ptr<mock_replica> _replica;
     std::unique_ptr<replica_bulk_loader> _bulk_loader;
+    dist::block_service::block_service_mock _fs;
 
     bulk_load_request _req;
     group_bulk_load_request _group_req;
@@ -567,6 +632,125 @@ TEST_F(replica_bulk_loader_test, finish_download_test)
     ASSERT_EQ(stub->get_bulk_load_downloading_count(), 2);
 }
 
+// download sst files test
+TEST_F(replica_bulk_loader_test, download_sst_files_in_window)
+{
+    fail::cfg("replica_bulk_loader_download_sst_file", "return()");
+    mock_downloading_files(6);
+
+    test_start_download_sst_files();
+    ASSERT_EQ(4, _bulk_loader->_downloading_file_count);
+    ASSERT_EQ(4, _bulk_loader->_next_download_file_index);
+    ASSERT_EQ(4u, _bulk_loader->_download_files_task.size());
+
+    // the next file starts once a file is downloaded
+    mock_sst_file_downloaded(ERR_OK);
+    test_start_download_sst_files();
+    ASSERT_EQ(4, _bulk_loader->_downloading_file_count);
+    ASSERT_EQ(5, _bulk_loader->_next_download_file_index);
+
+    // no more files start once a file fails
+    mock_sst_file_downloaded(ERR_CORRUPTION);
+    test_start_download_sst_files();
+    ASSERT_EQ(3, _bulk_loader->_downloading_file_count);
+    ASSERT_EQ(5, _bulk_loader->_next_download_file_index);
+
+    _replica->tracker()->wait_outstanding_tasks();
+}
+
+TEST_F(replica_bulk_loader_test, download_sst_file_failed)
+{
+    mock_downloading_files(2);
+    // the file downloaded from the mock provider doesn't match the md5
+    _bulk_loader->_metadata.files[0].md5 = "mismatched_md5";
+
+    test_download_sst_file(0);
+    ASSERT_EQ(ERR_CORRUPTION, _bulk_loader->_download_status.load());
+    ASSERT_EQ(0, stub->get_bulk_load_downloading_file_count());
+    ASSERT_EQ(0, _bulk_loader->_downloading_file_count);
+    // no more files start after the failure
+    ASSERT_EQ(1, _bulk_loader->_next_download_file_index);
+
+    _replica->tracker()->wait_outstanding_tasks();
+}
+
+TEST_F(replica_bulk_loader_test, download_sst_file_succeed)
+{
+    const std::string data = "write some data.\n";
+    mock_downloading_files(1, data.size());
+    utils::filesystem::create_directory(LOCAL_DIR);
+    std::ofstream os(utils::filesystem::path_combine(LOCAL_DIR, "file_0"));
+    os << data;
+    os.close();
+
+    test_download_sst_file(0);
+    ASSERT_EQ(ERR_OK, _bulk_loader->_download_status.load());
+    ASSERT_EQ(0, stub->get_bulk_load_downloading_file_count());
+    ASSERT_EQ(0, _bulk_loader->_downloading_file_count);
+    ASSERT_EQ(data.size(), _bulk_loader->_cur_downloaded_size.load());
+
+    _replica->tracker()->wait_outstanding_tasks();
+    utils::filesystem::remove_path(LOCAL_DIR);
+}
+
+TEST_F(replica_bulk_loader_test, download_sst_file_after_states_cleared)
+{
+    mock_downloading_files(2);
+    _bulk_loader->_metadata.files[0].md5 = "mismatched_md5";
+    uint64_t generation = start_download_sst_file(0);
+
+    // the states are cleared before the cancelled download runs
+    {
+        zauto_write_lock l(_bulk_loader->_lock);
+        _bulk_loader->_next_download_file_index = 0;
+        _bulk_loader->_downloading_file_count = 0;
+        _bulk_loader->_metadata.files.clear();
+        ++_bulk_loader->_download_generation;
+    }
+    // and the next download is started
+    mock_downloading_files(2);
+    ASSERT_EQ(generation + 1, start_download_sst_file(1));
+
+    // the stale download neither fails nor counts down the new one
+    _bulk_loader->download_sst_file(ROOT_PATH, LOCAL_DIR, 0, &_fs, false, generation);
+    ASSERT_EQ(ERR_OK, _bulk_loader->_download_status.load());
+    ASSERT_EQ(1, _bulk_loader->_downloading_file_count);
+    ASSERT_EQ(1, _bulk_loader->_next_download_file_index);
+    ASSERT_EQ(0, stub->get_bulk_load_downloading_file_count());
+
+    test_cleanup_download_tasks();
+    _replica->tracker()->wait_outstanding_tasks();
+}
+
+TEST_F(replica_bulk_loader_test, download_sst_file_delayed)
+{
+    const uint32_t old_rate_limit_mb = FLAGS_bulk_load_download_rate_limit_mb;
+    FLAGS_bulk_load_download_rate_limit_mb = 1;
+    // each file is larger than the bandwidth of a second
+    mock_downloading_files(2, 4 << 20);
+
+    // the first file is charged, but the node is downloading too many files
+    const int32_t max_node_file_count = FLAGS_bulk_load_max_downloading_files_per_node;
+    stub->set_bulk_load_downloading_file_count(max_node_file_count);
+    test_download_sst_file(0);
+    ASSERT_TRUE(is_download_sst_file_pending(0));
+    ASSERT_EQ(max_node_file_count, stub->get_bulk_load_downloading_file_count());
+
+    // the second file is rate limited
+    test_download_sst_file(1);
+    ASSERT_TRUE(is_download_sst_file_pending(1));
+    ASSERT_EQ(max_node_file_count, stub->get_bulk_load_downloading_file_count());
+
+    // the delayed files are still counted as downloading, rather than dropped
+    ASSERT_EQ(ERR_OK, _bulk_loader->_download_status.load());
+    ASSERT_EQ(2, _bulk_loader->_downloading_file_count);
+
+    test_cleanup_download_tasks();
+    _replica->tracker()->wait_outstanding_tasks();
+    stub->set_bulk_load_downloading_file_count(0);
+    FLAGS_bulk_load_download_rate_limit_mb = old_rate_limit_mb;
+}
+
 // start ingestion test
 TEST_F(replica_bulk_loader_test, start_ingestion_test)
 {
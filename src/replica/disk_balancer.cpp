@@ -0,0 +1,168 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "disk_balancer.h"
+
+#include "common/fs_manager.h"
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_bool("replication",
+                disk_balancer_enabled,
+                false,
+                "whether to migrate the replicas between the data dirs automatically to balance "
+                "their space and io load");
+DSN_TAG_VARIABLE(disk_balancer_enabled, FT_MUTABLE);
+
+DSN_DEFINE_uint32("replication",
+                  disk_balancer_interval_seconds,
+                  600,
+                  "the min interval between two replica migrations started by the disk balancer, "
+                  "which starts one only after the previous one is done");
+DSN_TAG_VARIABLE(disk_balancer_interval_seconds, FT_MUTABLE);
+
+DSN_DEFINE_int32("replication",
+                 disk_balancer_space_ratio_gap,
+                 10,
+                 "the disk balancer migrates a replica once the available space ratios of two "
+                 "data dirs differ by this many percents");
+DSN_TAG_VARIABLE(disk_balancer_space_ratio_gap, FT_MUTABLE);
+DSN_DEFINE_validator(disk_balancer_space_ratio_gap,
+                     [](int32_t value) -> bool { return value > 0 && value <= 100; });
+
+DSN_DEFINE_uint32("replication",
+                  disk_balancer_load_imbalance_percent,
+                  200,
+                  "the disk balancer migrates a replica off a data dir whose io load exceeds this "
+                  "percentage of the average, 0 to balance the space only");
+DSN_TAG_VARIABLE(disk_balancer_load_imbalance_percent, FT_MUTABLE);
+
+namespace {
+
+inline double available_ratio(const disk_balance_dir &dir, int64_t delta_mb)
+{
+    return (dir.available_mb + delta_mb) * 100.0 / dir.capacity_mb;
+}
+
+} // anonymous namespace
+
+/*extern*/ bool plan_disk_balance(const std::vector<disk_balance_dir> &dirs,
+                                  /*out*/ disk_balance_plan &plan)
+{
+    // the dirs whose disk stat is unavailable are left alone
+    std::vector<const disk_balance_dir *> candidates;
+    for (const auto &dir : dirs) {
+        if (dir.capacity_mb > 0) {
+            candidates.push_back(&dir);
+        }
+    }
+    if (candidates.size() < 2) {
+        return false;
+    }
+
+    auto set_plan = [&plan](const disk_balance_dir *origin,
+                            const disk_balance_dir *target,
+                            const disk_balance_replica &replica) {
+        plan.pid = replica.pid;
+        plan.origin_disk = origin->tag;
+        plan.target_disk = target->tag;
+        return true;
+    };
+
+    const disk_balance_dir *fullest = nullptr;
+    const disk_balance_dir *emptiest = nullptr;
+    for (const auto *dir : candidates) {
+        if (fullest == nullptr || available_ratio(*fullest, 0) > available_ratio(*dir, 0)) {
+            fullest = dir;
+        }
+        if (dir->normal &&
+            (emptiest == nullptr || available_ratio(*emptiest, 0) < available_ratio(*dir, 0))) {
+            emptiest = dir;
+        }
+    }
+    if (emptiest != nullptr && emptiest != fullest &&
+        available_ratio(*emptiest, 0) - available_ratio(*fullest, 0) >=
+            FLAGS_disk_balancer_space_ratio_gap) {
+        // moving this much makes the two ratios even
+        double even_mb = (static_cast<double>(emptiest->available_mb) * fullest->capacity_mb -
+                          static_cast<double>(fullest->available_mb) * emptiest->capacity_mb) /
+                         (fullest->capacity_mb + emptiest->capacity_mb);
+        const disk_balance_replica *selected = nullptr;
+        for (const auto &replica : fullest->movable_replicas) {
+            if (replica.disk_usage_mb > 0 && replica.disk_usage_mb <= even_mb &&
+                (selected == nullptr || selected->disk_usage_mb < replica.disk_usage_mb)) {
+                selected = &replica;
+            }
+        }
+        if (selected != nullptr) {
+            return set_plan(fullest, emptiest, *selected);
+        }
+    }
+
+    if (FLAGS_disk_balancer_load_imbalance_percent == 0) {
+        return false;
+    }
+
+    double total_io = 0;
+    const disk_balance_dir *busiest = nullptr;
+    for (const auto *dir : candidates) {
+        total_io += dir->io_bytes_per_sec;
+        if (busiest == nullptr || busiest->io_bytes_per_sec < dir->io_bytes_per_sec) {
+            busiest = dir;
+        }
+    }
+    double average_io = total_io / candidates.size();
+    if (busiest->io_bytes_per_sec * 100 <=
+        average_io * FLAGS_disk_balancer_load_imbalance_percent) {
+        return false;
+    }
+
+    const disk_balance_replica *selected = nullptr;
+    const disk_balance_dir *target = nullptr;
+    for (const auto *dir : candidates) {
+        if (dir == busiest || !dir->normal) {
+            continue;
+        }
+        // no more than half of the gap, so that the target doesn't become the busier one
+        double io_limit = (busiest->io_bytes_per_sec - dir->io_bytes_per_sec) / 2;
+        for (const auto &replica : busiest->movable_replicas) {
+            if (replica.io_bytes_per_sec <= 0 || replica.io_bytes_per_sec > io_limit) {
+                continue;
+            }
+            // neither run the target short of space, nor unbalance the space the other way round
+            double target_ratio = available_ratio(*dir, -replica.disk_usage_mb);
+            if (target_ratio < FLAGS_disk_min_available_space_ratio ||
+                available_ratio(*busiest, replica.disk_usage_mb) - target_ratio >=
+                    FLAGS_disk_balancer_space_ratio_gap) {
+                continue;
+            }
+            if (selected == nullptr || selected->io_bytes_per_sec < replica.io_bytes_per_sec) {
+                selected = &replica;
+                target = dir;
+            }
+        }
+    }
+    if (selected != nullptr) {
+        return set_plan(busiest, target, *selected);
+    }
+    return false;
+}
+
+} // namespace replication
+} // namespace dsn
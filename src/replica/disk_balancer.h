@@ -0,0 +1,70 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <dsn/tool-api/gpid.h>
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace replication {
+DSN_DECLARE_bool(disk_balancer_enabled);
+DSN_DECLARE_uint32(disk_balancer_interval_seconds);
+
+// A replica which the disk balancer may migrate.
+struct disk_balance_replica
+{
+    gpid pid;
+    int64_t disk_usage_mb;
+    double io_bytes_per_sec;
+};
+
+// A data dir as seen by the disk balancer.
+struct disk_balance_dir
+{
+    std::string tag;
+    int64_t capacity_mb;
+    int64_t available_mb;
+    // whether new replicas may be put on this dir
+    bool normal;
+    double io_bytes_per_sec;
+    std::vector<disk_balance_replica> movable_replicas;
+};
+
+struct disk_balance_plan
+{
+    gpid pid;
+    std::string origin_disk;
+    std::string target_disk;
+};
+
+// Picks a replica to migrate between the data dirs of this node, returns false if there's none.
+//
+// The available space ratios are balanced first: a replica is moved from the dir with the least
+// ratio to the one with the most, once they differ by [replication]
+// disk_balancer_space_ratio_gap. Then the io load: a replica is moved off the busiest dir if its
+// load exceeds [replication] disk_balancer_load_imbalance_percent of the average. Either way the
+// replica moved never overshoots, so that the balancer doesn't move it back later.
+extern bool plan_disk_balance(const std::vector<disk_balance_dir> &dirs,
+                              /*out*/ disk_balance_plan &plan);
+
+} // namespace replication
+} // namespace dsn
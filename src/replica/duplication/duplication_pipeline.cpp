@@ -40,7 +40,9 @@ namespace replication {
 
 void load_mutation::run()
 {
-    decree last_decree = _duplicator->progress().last_decree;
+    // continue from the last loaded batch, which may still be being shipped
+    decree last_decree =
+        std::max(_duplicator->progress().last_decree, _log_on_disk->last_loaded_decree());
     _start_decree = last_decree + 1;
     if (_replica->private_log()->max_commit_on_disk() < _start_decree) {
         // wait 100ms for next try if no mutation was added.
@@ -67,35 +69,70 @@ load_mutation::load_mutation(replica_duplicator *duplicator,
 
 void ship_mutation::ship(mutation_tuple_set &&in)
 {
-    _mutation_duplicator->duplicate(std::move(in), [this](size_t total_shipped_size) mutable {
-        update_progress();
-        _counter_dup_shipped_bytes_rate->add(total_shipped_size);
-        step_down_next_stage();
+    uint64_t batch_id = _first_batch_id + _in_flight_batches.size() - 1;
+    _mutation_duplicator->duplicate(std::move(in), [this, batch_id](size_t total_shipped_size) {
+        // the callback may be called in any thread, switch back to the pipeline
+        schedule([this, batch_id, total_shipped_size]() {
+            on_batch_shipped(batch_id, total_shipped_size);
+        });
     });
 }
 
 void ship_mutation::run(decree &&last_decree, mutation_tuple_set &&in)
 {
-    _last_decree = last_decree;
+    // the empty batch also takes a place, so that the progress is updated in order
+    _in_flight_batches.push_back({last_decree, in.empty()});
 
     if (in.empty()) {
         update_progress();
-        step_down_next_stage();
-        return;
+    } else {
+        ship(std::move(in));
     }
 
-    ship(std::move(in));
+    _waiting_for_window = true;
+    try_step_down();
+}
+
+void ship_mutation::on_batch_shipped(uint64_t batch_id, size_t total_shipped_size)
+{
+    dcheck_ge_replica(batch_id, _first_batch_id);
+    dcheck_lt_replica(batch_id - _first_batch_id, _in_flight_batches.size());
+    _in_flight_batches[batch_id - _first_batch_id].shipped = true;
+    _counter_dup_shipped_bytes_rate->add(total_shipped_size);
+
+    update_progress();
+    try_step_down();
 }
 
 void ship_mutation::update_progress()
 {
+    decree last_decree = invalid_decree;
+    while (!_in_flight_batches.empty() && _in_flight_batches.front().shipped) {
+        last_decree = _in_flight_batches.front().last_decree;
+        _in_flight_batches.pop_front();
+        _first_batch_id++;
+    }
+    if (last_decree == invalid_decree) {
+        return;
+    }
+
     dcheck_eq_replica(
-        _duplicator->update_progress(duplication_progress().set_last_decree(_last_decree)),
+        _duplicator->update_progress(duplication_progress().set_last_decree(last_decree)),
         error_s::ok());
 
     // committed decree never decreases
     decree last_committed_decree = _replica->last_committed_decree();
-    dcheck_ge_replica(last_committed_decree, _last_decree);
+    dcheck_ge_replica(last_committed_decree, last_decree);
+}
+
+void ship_mutation::try_step_down()
+{
+    if (!_waiting_for_window ||
+        _in_flight_batches.size() >= FLAGS_duplicate_max_in_flight_batches) {
+        return;
+    }
+    _waiting_for_window = false;
+    step_down_next_stage();
 }
 
 ship_mutation::ship_mutation(replica_duplicator *duplicator)
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include <dsn/cpp/pipeline.h>
 #include <dsn/dist/replication/replica_base.h>
 #include <dsn/dist/replication/mutation_duplicator.h>
@@ -56,6 +58,11 @@ private:
 // ship_mutation is a pipeline stage receiving a set of mutations,
 // sending them to the remote cluster. After finished, the pipeline
 // will restart from load_mutation.
+// Up to [replication] duplicate_max_in_flight_batches batches are shipped at the same time, so
+// that the next batches are loaded while waiting for the remote cluster. The progress is updated
+// in the order of the batches, whatever order they complete in.
+// The batches are handed to mutation_duplicator as they are, the wire format including any
+// compression is up to its implementation.
 // ThreadPool: THREAD_POOL_REPLICATION
 class ship_mutation final : public replica_base,
                             public pipeline::when<decree, mutation_tuple_set>,
@@ -71,8 +78,14 @@ public:
     void ship(mutation_tuple_set &&in);
 
 private:
+    void on_batch_shipped(uint64_t batch_id, size_t total_shipped_size);
+
+    // Updates the progress to the last decree of the leading shipped batches.
     void update_progress();
 
+    // Steps down to load the next batch if the window isn't full.
+    void try_step_down();
+
     friend class ship_mutation_test;
     friend class replica_duplicator_test;
 
@@ -82,7 +95,17 @@ private:
     replica *_replica;
     replica_stub *_stub;
 
-    decree _last_decree{invalid_decree};
+    struct in_flight_batch
+    {
+        decree last_decree;
+        bool shipped;
+    };
+    // the batches being shipped in the order of decree, the id of the first one is
+    // `_first_batch_id`, and the following ones are numbered consecutively
+    std::deque<in_flight_batch> _in_flight_batches;
+    uint64_t _first_batch_id{0};
+    // whether the next batch is to be loaded once the window has room
+    bool _waiting_for_window{false};
 
     perf_counter_wrapper _counter_dup_shipped_bytes_rate;
 };
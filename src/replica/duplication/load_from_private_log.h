@@ -48,6 +48,9 @@ public:
 
     void set_start_decree(decree start_decree);
 
+    // The last decree of the mutations passed down, which may not be shipped yet.
+    decree last_loaded_decree() const { return _mutation_batch.last_decree(); }
+
     /// ==== Implementation ==== ///
 
     /// Find the log file that contains `_start_decree`.
@@ -170,7 +170,7 @@ void mutation_batch::add_mutation_if_valid(mutation_ptr &mu, decree start_decree
         }
 
         _total_bytes += bb.length();
-        _loaded_mutations.emplace(
+        _loaded_mutations.emplace_back(
             std::make_tuple(mu->data.header.timestamp, update.code, std::move(bb)));
     }
 }
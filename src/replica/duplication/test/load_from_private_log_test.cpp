@@ -161,7 +161,7 @@ public:
                 // we create one mutation_update per mutation
                 // the mutations are started from 1
                 for (mutation_tuple mut : mutations) {
-                    loaded_mutations.emplace(mut);
+                    loaded_mutations.emplace_back(mut);
                 }
 
                 if (loaded_mutations.size() < total || d < last_decree) {
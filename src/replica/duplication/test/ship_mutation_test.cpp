@@ -15,6 +15,9 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <deque>
+#include <iostream>
+
 #include "replica/duplication/mutation_batch.h"
 #include "replica/duplication/duplication_pipeline.h"
 #include "duplication_test_base.h"
@@ -22,6 +25,10 @@
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_uint32(duplicate_max_in_flight_batches);
+
+DEFINE_TASK_CODE(LPC_TEST_REMOTE_CLUSTER, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
 /*static*/ mock_mutation_duplicator::duplicate_function mock_mutation_duplicator::_func;
 
 struct mock_stage : pipeline::when<>
@@ -29,6 +36,22 @@ struct mock_stage : pipeline::when<>
     void run() override {}
 };
 
+// Feeds the prepared batches to the next stage, as load_mutation does.
+struct feed_stage : pipeline::when<>, pipeline::result<decree, mutation_tuple_set>
+{
+    void run() override
+    {
+        if (batches.empty()) {
+            return;
+        }
+        auto batch = std::move(batches.front());
+        batches.pop_front();
+        step_down_next_stage(std::move(batch.first), std::move(batch.second));
+    }
+
+    std::deque<std::pair<decree, mutation_tuple_set>> batches;
+};
+
 class ship_mutation_test : public duplication_test_base
 {
 public:
@@ -86,11 +109,120 @@ public:
         return duplicator->_ship.get();
     }
 
+    // Ships `batch_count` batches starting from `next_decree` to a stand-in of the remote
+    // cluster, which acks each batch after `rtt_ms`. Returns the time taken in milliseconds.
+    uint64_t ship_with_latency(uint32_t max_in_flight_batches,
+                               int batch_count,
+                               int rtt_ms,
+                               decree &next_decree)
+    {
+        uint32_t old_max_in_flight_batches = FLAGS_duplicate_max_in_flight_batches;
+        FLAGS_duplicate_max_in_flight_batches = max_in_flight_batches;
+
+        feed_stage feeder;
+        decree last_decree = invalid_decree;
+        for (int i = 0; i < batch_count; ++i, next_decree += 2) {
+            // the first mutation is committed by the second one
+            mutation_batch batch(duplicator.get());
+            batch.add(create_test_mutation(next_decree, "hello"));
+            batch.add(create_test_mutation(next_decree + 1, "hello"));
+            feeder.batches.emplace_back(next_decree, batch.move_all_mutations());
+            last_decree = next_decree;
+        }
+        _replica->set_last_committed_decree(next_decree);
+
+        mock_mutation_duplicator::mock(
+            [rtt_ms](mutation_tuple_set, mutation_duplicator::callback cb) {
+                tasking::enqueue(LPC_TEST_REMOTE_CLUSTER,
+                                 nullptr,
+                                 [cb]() { cb(0); },
+                                 0,
+                                 std::chrono::milliseconds(rtt_ms));
+            });
+
+        ship_mutation shipper(duplicator.get());
+        pipeline::base base;
+        base.thread_pool(LPC_REPLICATION_LONG_LOW).task_tracker(_replica->tracker());
+        base.from(feeder).link(shipper).link(feeder);
+
+        uint64_t start_ms = dsn_now_ms();
+        base.run_pipeline();
+        while (duplicator->progress().last_decree != last_decree &&
+               dsn_now_ms() - start_ms < 60000) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        uint64_t elapsed_ms = dsn_now_ms() - start_ms;
+        EXPECT_EQ(last_decree, duplicator->progress().last_decree);
+
+        base.pause();
+        base.wait_all();
+        FLAGS_duplicate_max_in_flight_batches = old_max_in_flight_batches;
+        return elapsed_ms;
+    }
+
     std::unique_ptr<replica_duplicator> duplicator;
 };
 
 TEST_F(ship_mutation_test, ship_mutation_tuple_set) { test_ship_mutation_tuple_set(); }
 
+// ensure the batches are shipped concurrently within the window, and the progress is updated in
+// the order of decree no matter in which order the batches are shipped.
+TEST_F(ship_mutation_test, ship_in_window)
+{
+    uint32_t old_max_in_flight_batches = FLAGS_duplicate_max_in_flight_batches;
+    FLAGS_duplicate_max_in_flight_batches = 2;
+
+    ship_mutation shipper(duplicator.get());
+    mock_stage end;
+    pipeline::base base;
+    base.thread_pool(LPC_REPLICATION_LONG_LOW).task_tracker(_replica->tracker());
+    base.from(shipper).link(end);
+    _replica->set_last_committed_decree(4);
+    decree start_decree = duplicator->progress().last_decree;
+
+    std::vector<mutation_duplicator::callback> callbacks;
+    mock_mutation_duplicator::mock(
+        [&callbacks](mutation_tuple_set, mutation_duplicator::callback cb) {
+            callbacks.emplace_back(std::move(cb));
+        });
+
+    // mutation 1 and 3 are committed by the next ones
+    for (decree d = 1; d <= 3; d += 2) {
+        mutation_batch batch(duplicator.get());
+        batch.add(create_test_mutation(d, "hello"));
+        batch.add(create_test_mutation(d + 1, "hello"));
+        shipper.run(decree(d), batch.move_all_mutations());
+    }
+    ASSERT_EQ(callbacks.size(), 2);
+
+    callbacks[1](0);
+    base.wait_all();
+    ASSERT_EQ(duplicator->progress().last_decree, start_decree);
+
+    callbacks[0](0);
+    base.wait_all();
+    ASSERT_EQ(duplicator->progress().last_decree, 3);
+
+    FLAGS_duplicate_max_in_flight_batches = old_max_in_flight_batches;
+}
+
+// The pipeline shipping to a remote cluster of 20ms round trip time: with the window of 4 in-flight
+// batches, it takes about a quarter of the time of the stop-and-wait shipping.
+TEST_F(ship_mutation_test, ship_with_remote_latency)
+{
+    const int BATCH_COUNT = 20;
+    const int RTT_MS = 20;
+    decree next_decree = 1;
+    uint64_t stop_and_wait_ms = ship_with_latency(1, BATCH_COUNT, RTT_MS, next_decree);
+    uint64_t windowed_ms = ship_with_latency(4, BATCH_COUNT, RTT_MS, next_decree);
+    std::cout << "shipped " << BATCH_COUNT << " batches with " << RTT_MS
+              << "ms rtt: stop-and-wait " << stop_and_wait_ms << "ms, window of 4 " << windowed_ms
+              << "ms" << std::endl;
+
+    ASSERT_GE(stop_and_wait_ms, BATCH_COUNT * RTT_MS);
+    ASSERT_LT(windowed_ms, stop_and_wait_ms / 2);
+}
+
 void retry(pipeline::base *base)
 {
     base->schedule([base]() { retry(base); }, 10_s);
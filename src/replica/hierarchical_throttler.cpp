@@ -0,0 +1,146 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "hierarchical_throttler.h"
+
+#include <algorithm>
+
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_int64("replication",
+                 node_write_throttling_units,
+                 0,
+                 "max write request units per second admitted by this node, 0 means no limit");
+DSN_DEFINE_int64("replication",
+                 node_read_throttling_units,
+                 0,
+                 "max read request units per second admitted by this node, 0 means no limit");
+
+hierarchical_throttler::hierarchical_throttler()
+{
+    _node_write_bucket.reset(FLAGS_node_write_throttling_units);
+    _node_read_bucket.reset(FLAGS_node_read_throttling_units);
+}
+
+std::shared_ptr<table_throttling_budget>
+hierarchical_throttler::get_table_budget(const gpid &pid)
+{
+    zauto_lock l(_lock);
+    table_context &ctx = _tables[pid.get_app_id()];
+    ctx.partitions.insert(pid.get_partition_index());
+    if (ctx.budget == nullptr) {
+        ctx.budget = std::make_shared<table_throttling_budget>();
+    }
+    return ctx.budget;
+}
+
+void hierarchical_throttler::update_replica(const gpid &pid,
+                                            int32_t partition_count,
+                                            int64_t table_write_units,
+                                            int64_t table_read_units,
+                                            bool is_primary)
+{
+    zauto_lock l(_lock);
+    table_context &ctx = _tables[pid.get_app_id()];
+    if (ctx.budget == nullptr) {
+        ctx.budget = std::make_shared<table_throttling_budget>();
+    }
+    ctx.partition_count = partition_count;
+    ctx.write_units = table_write_units;
+    ctx.read_units = table_read_units;
+    ctx.partitions.insert(pid.get_partition_index());
+    if (is_primary) {
+        ctx.primary_partitions.insert(pid.get_partition_index());
+    } else {
+        ctx.primary_partitions.erase(pid.get_partition_index());
+    }
+    refresh_table_budget(ctx);
+}
+
+void hierarchical_throttler::remove_replica(const gpid &pid)
+{
+    zauto_lock l(_lock);
+    auto iter = _tables.find(pid.get_app_id());
+    if (iter == _tables.end()) {
+        return;
+    }
+    iter->second.partitions.erase(pid.get_partition_index());
+    iter->second.primary_partitions.erase(pid.get_partition_index());
+    if (iter->second.partitions.empty()) {
+        _tables.erase(iter);
+        return;
+    }
+    refresh_table_budget(iter->second);
+}
+
+/*static*/ void hierarchical_throttler::refresh_table_budget(const table_context &ctx)
+{
+    auto share = [&ctx](int64_t table_units) -> int64_t {
+        if (table_units <= 0 || ctx.partition_count <= 0 || ctx.primary_partitions.empty()) {
+            return 0;
+        }
+        return std::max<int64_t>(
+            1,
+            table_units * static_cast<int64_t>(ctx.primary_partitions.size()) /
+                ctx.partition_count);
+    };
+    ctx.budget->write_bucket.reset(share(ctx.write_units));
+    ctx.budget->read_bucket.reset(share(ctx.read_units));
+}
+
+bool hierarchical_throttler::admit_write(table_throttling_budget *budget, int64_t units)
+{
+    return admit(budget->write_bucket, _node_write_bucket, units);
+}
+
+bool hierarchical_throttler::admit_read(table_throttling_budget *budget, int64_t units)
+{
+    return admit(budget->read_bucket, _node_read_bucket, units);
+}
+
+void hierarchical_throttler::refund_write(table_throttling_budget *budget, int64_t units)
+{
+    budget->write_bucket.refund(units);
+    _node_write_bucket.refund(units);
+}
+
+void hierarchical_throttler::refund_read(table_throttling_budget *budget, int64_t units)
+{
+    budget->read_bucket.refund(units);
+    _node_read_bucket.refund(units);
+}
+
+/*static*/ bool hierarchical_throttler::admit(utils::sharded_token_bucket &table_bucket,
+                                              utils::sharded_token_bucket &node_bucket,
+                                              int64_t units)
+{
+    if (!table_bucket.consume(units)) {
+        return false;
+    }
+    if (!node_bucket.consume(units)) {
+        // not charged to the table if rejected by node
+        table_bucket.refund(units);
+        return false;
+    }
+    return true;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,107 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include <dsn/tool-api/gpid.h>
+#include <dsn/tool-api/zlocks.h>
+#include <dsn/utils/sharded_token_bucket.h>
+
+namespace dsn {
+namespace replication {
+
+// The token buckets shared by all the replicas of one table on this node.
+struct table_throttling_budget
+{
+    utils::sharded_token_bucket write_bucket;
+    utils::sharded_token_bucket read_bucket;
+};
+
+// Node-level and table-level admission control of client requests, on top of the per-replica
+// `throttling_controller`s.
+//
+// - node level: all the requests on this node share one budget, see
+//   [replication] node_write_throttling_units / node_read_throttling_units.
+// - table level: the table-wide budget configured by app envs
+//   (replica_envs::TABLE_WRITE_THROTTLING / TABLE_READ_THROTTLING) is divided by the partition
+//   count, and the shares of all the primaries of the table on this node are put into one
+//   bucket. Thus a hot partition can use the budget left unused by the cold ones of the same
+//   table, while the node-wide limit still holds.
+//
+// Requests are charged by request units, see replication_app_base::get_request_units().
+//
+// admit_write()/admit_read() are lock-free and called by replicas in the hot path, the other
+// methods are only called on configuration changes.
+class hierarchical_throttler
+{
+public:
+    hierarchical_throttler();
+
+    // Registers the replica `pid` and returns the budget shared by the local replicas of its
+    // table, the replica should cache it.
+    std::shared_ptr<table_throttling_budget> get_table_budget(const gpid &pid);
+
+    // Updates the table-wide limits (units per second, 0 means unlimited) of `pid`'s table, and
+    // whether `pid` is a primary on this node, which takes a share of the table-wide limits.
+    void update_replica(const gpid &pid,
+                        int32_t partition_count,
+                        int64_t table_write_units,
+                        int64_t table_read_units,
+                        bool is_primary);
+
+    // The table is forgotten once all its local replicas are removed, e.g. after it's dropped.
+    void remove_replica(const gpid &pid);
+
+    // Returns true if `units` are admitted by both the table and node level.
+    bool admit_write(table_throttling_budget *budget, int64_t units);
+    bool admit_read(table_throttling_budget *budget, int64_t units);
+
+    // Gives back the units admitted by admit_xxx(), for the requests rejected afterwards.
+    void refund_write(table_throttling_budget *budget, int64_t units);
+    void refund_read(table_throttling_budget *budget, int64_t units);
+
+private:
+    struct table_context
+    {
+        int32_t partition_count = 0;
+        int64_t write_units = 0;
+        int64_t read_units = 0;
+        std::set<int32_t> partitions;
+        std::set<int32_t> primary_partitions;
+        std::shared_ptr<table_throttling_budget> budget;
+    };
+
+    static bool admit(utils::sharded_token_bucket &table_bucket,
+                      utils::sharded_token_bucket &node_bucket,
+                      int64_t units);
+    static void refresh_table_budget(const table_context &ctx);
+
+    friend class hierarchical_throttler_test;
+
+    mutable zlock _lock;
+    std::map<int32_t, table_context> _tables;
+
+    utils::sharded_token_bucket _node_write_bucket;
+    utils::sharded_token_bucket _node_read_bucket;
+};
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,295 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "hotkey_detector.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#include <dsn/c/api_layer1.h>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/dist/replication/replication_enums.h>
+#include <dsn/tool-api/task.h>
+#include <dsn/utility/flags.h>
+#include <nlohmann/json.hpp>
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_uint32("replication",
+                  hotkey_detect_window_seconds,
+                  10,
+                  "the hotkey detector counts the keys in windows of this many seconds");
+DSN_TAG_VARIABLE(hotkey_detect_window_seconds, FT_MUTABLE);
+
+DSN_DEFINE_uint32("replication",
+                  hotkey_detect_sample_one_in,
+                  1,
+                  "the hotkey detector samples 1 in N requests");
+DSN_TAG_VARIABLE(hotkey_detect_sample_one_in, FT_MUTABLE);
+
+DSN_DEFINE_uint32("replication",
+                  hotkey_min_percent,
+                  5,
+                  "a key is hot if it takes at least this percentage of the sampled requests");
+DSN_TAG_VARIABLE(hotkey_min_percent, FT_MUTABLE);
+
+namespace {
+
+inline uint64_t relaxed_load(const std::atomic<uint64_t> &v)
+{
+    return v.load(std::memory_order_relaxed);
+}
+
+inline void relaxed_store(std::atomic<uint64_t> &v, uint64_t value)
+{
+    v.store(value, std::memory_order_relaxed);
+}
+
+// mixes the key hash for each row of the sketch, the partition hashes may be poorly distributed
+inline uint32_t sketch_index(uint64_t key_hash, int row)
+{
+    uint64_t h = (key_hash + static_cast<uint64_t>(row) * 0x9E3779B97F4A7C15ULL) *
+                 0xBF58476D1CE4E5B9ULL;
+    return static_cast<uint32_t>((h ^ (h >> 31)) % hotkey_detector::SKETCH_WIDTH);
+}
+
+} // anonymous namespace
+
+struct hotkey_detector::shard
+{
+    struct top_entry
+    {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> count{0};
+    };
+
+    std::atomic<uint32_t> sketch[SKETCH_DEPTH][SKETCH_WIDTH];
+    top_entry top[TOP_K];
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> window_start_ms{0};
+
+    // the result of the last complete window
+    top_entry last_top[TOP_K];
+    std::atomic<uint64_t> last_total{0};
+
+    shard() { reset(0); }
+
+    void reset(uint64_t now_ms)
+    {
+        for (auto &row : sketch) {
+            for (auto &c : row) {
+                c.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (int i = 0; i < TOP_K; ++i) {
+            relaxed_store(top[i].key, 0);
+            relaxed_store(top[i].count, 0);
+            relaxed_store(last_top[i].key, 0);
+            relaxed_store(last_top[i].count, 0);
+        }
+        relaxed_store(total, 0);
+        relaxed_store(last_total, 0);
+        relaxed_store(window_start_ms, now_ms);
+    }
+
+    // starts a new window, and keeps the result of the current one
+    void rotate(uint64_t now_ms)
+    {
+        for (int i = 0; i < TOP_K; ++i) {
+            relaxed_store(last_top[i].key, relaxed_load(top[i].key));
+            relaxed_store(last_top[i].count, relaxed_load(top[i].count));
+            relaxed_store(top[i].key, 0);
+            relaxed_store(top[i].count, 0);
+        }
+        relaxed_store(last_total, relaxed_load(total));
+        relaxed_store(total, 0);
+        for (auto &row : sketch) {
+            for (auto &c : row) {
+                c.store(0, std::memory_order_relaxed);
+            }
+        }
+        relaxed_store(window_start_ms, now_ms);
+    }
+
+    void add(uint64_t key_hash)
+    {
+        // the shard is written by one thread mostly, so load-and-store is used rather than the
+        // costly read-modify-write, some counts may be lost if not, which is acceptable
+        uint32_t estimate = std::numeric_limits<uint32_t>::max();
+        for (int row = 0; row < SKETCH_DEPTH; ++row) {
+            std::atomic<uint32_t> &c = sketch[row][sketch_index(key_hash, row)];
+            uint32_t v = c.load(std::memory_order_relaxed) + 1;
+            c.store(v, std::memory_order_relaxed);
+            estimate = std::min(estimate, v);
+        }
+        relaxed_store(total, relaxed_load(total) + 1);
+
+        // update the heavy hitters: refresh the key if it's in the list, or replace the least
+        // one if the key outnumbers it
+        int min_index = 0;
+        uint64_t min_count = std::numeric_limits<uint64_t>::max();
+        for (int i = 0; i < TOP_K; ++i) {
+            uint64_t count = relaxed_load(top[i].count);
+            if (count != 0 && relaxed_load(top[i].key) == key_hash) {
+                relaxed_store(top[i].count, estimate);
+                return;
+            }
+            if (count < min_count) {
+                min_count = count;
+                min_index = i;
+            }
+        }
+        if (estimate > min_count) {
+            relaxed_store(top[min_index].key, key_hash);
+            relaxed_store(top[min_index].count, estimate);
+        }
+    }
+};
+
+hotkey_detector::hotkey_detector(hotkey_type::type type) : _type(type) {}
+
+hotkey_detector::~hotkey_detector() = default;
+
+error_code hotkey_detector::start()
+{
+    zauto_lock l(_lock);
+    if (detecting()) {
+        return ERR_SERVICE_ALREADY_EXIST;
+    }
+
+    uint64_t now_ms = dsn_now_ms();
+    if (_shards == nullptr) {
+        _shards.reset(new shard[SHARD_COUNT]);
+    }
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        _shards[i].reset(now_ms);
+    }
+    _start_ms = now_ms;
+    _detecting.store(true, std::memory_order_release);
+    return ERR_OK;
+}
+
+void hotkey_detector::stop()
+{
+    zauto_lock l(_lock);
+    // the shards are kept, so the result can still be queried after stopped
+    _detecting.store(false, std::memory_order_relaxed);
+}
+
+void hotkey_detector::record_internal(uint64_t key_hash)
+{
+    int worker_index = task::get_current_worker_index();
+    shard &s = _shards[(worker_index < 0 ? 0 : worker_index) % SHARD_COUNT];
+
+    uint32_t sample_one_in = FLAGS_hotkey_detect_sample_one_in;
+    uint64_t sequence = relaxed_load(s.sequence) + 1;
+    relaxed_store(s.sequence, sequence);
+    if (sample_one_in > 1 && sequence % sample_one_in != 0) {
+        return;
+    }
+
+    uint64_t now_ms = dsn_now_ms();
+    if (now_ms - relaxed_load(s.window_start_ms) >= FLAGS_hotkey_detect_window_seconds * 1000) {
+        s.rotate(now_ms);
+    }
+    s.add(key_hash);
+}
+
+std::vector<hotkey_info> hotkey_detector::query() const
+{
+    zauto_lock l(_lock);
+    std::vector<hotkey_info> result;
+    if (_shards == nullptr) {
+        return result;
+    }
+
+    std::unordered_map<uint64_t, uint64_t> counts;
+    uint64_t total = 0;
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        const shard &s = _shards[i];
+        // prefer the last complete window
+        uint64_t last_total = relaxed_load(s.last_total);
+        const shard::top_entry *top = last_total > 0 ? s.last_top : s.top;
+        total += last_total > 0 ? last_total : relaxed_load(s.total);
+        for (int j = 0; j < TOP_K; ++j) {
+            uint64_t count = relaxed_load(top[j].count);
+            if (count > 0) {
+                counts[relaxed_load(top[j].key)] += count;
+            }
+        }
+    }
+    if (total == 0) {
+        return result;
+    }
+
+    for (const auto &kv : counts) {
+        double percent = 100.0 * kv.second / total;
+        if (percent >= FLAGS_hotkey_min_percent) {
+            result.push_back({kv.first, kv.second, percent});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const hotkey_info &l, const hotkey_info &r) {
+        return l.count > r.count;
+    });
+    return result;
+}
+
+std::string hotkey_detector::query_json() const
+{
+    nlohmann::json hotkeys = nlohmann::json::array();
+    for (const auto &info : query()) {
+        hotkeys.push_back(nlohmann::json{{"key_hash", info.key_hash},
+                                         {"count", info.count},
+                                         {"percent", info.percent}});
+    }
+    return nlohmann::json{{"type", enum_to_string(_type)},
+                          {"detecting", detecting()},
+                          {"hotkeys", hotkeys}}
+        .dump();
+}
+
+void hotkey_detector::on_detect_hotkey(const detect_hotkey_request &req,
+                                       /*out*/ detect_hotkey_response &resp)
+{
+    switch (req.action) {
+    case detect_action::START:
+        resp.err = start();
+        if (resp.err != ERR_OK) {
+            resp.__set_err_hint(
+                fmt::format("{} hotkey detection is running now", enum_to_string(_type)));
+        }
+        break;
+    case detect_action::STOP:
+        stop();
+        resp.err = ERR_OK;
+        break;
+    case detect_action::QUERY:
+        resp.err = ERR_OK;
+        resp.__set_hotkey_result(query_json());
+        break;
+    default:
+        resp.err = ERR_INVALID_PARAMETERS;
+        resp.__set_err_hint(fmt::format("invalid detect_action {}", req.action));
+        break;
+    }
+}
+
+} // namespace replication
+} // namespace dsn
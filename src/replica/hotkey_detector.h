@@ -0,0 +1,108 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <dsn/dist/replication/replication_types.h>
+#include <dsn/tool-api/zlocks.h>
+#include <dsn/utility/ports.h>
+
+namespace dsn {
+namespace replication {
+
+struct hotkey_info
+{
+    // the partition hash of the requests, which is the hash of the key the client uses to route
+    uint64_t key_hash;
+    // the estimated count of the sampled requests with the key
+    uint64_t count;
+    // percentage of `count` in all the sampled requests
+    double percent;
+};
+
+// Finds the hot keys of a replica, for one type of requests (read or write).
+//
+// The keys are identified by the partition hash in the request header, so it works for all the
+// storage apps without decoding the requests. The requests are sampled into a count-min sketch
+// plus a top-k list of heavy hitters, which are sharded by the worker threads, so that recording
+// takes no lock. Each shard starts over every [replication] hotkey_detect_window_seconds, the
+// query merges the shards of the last complete window (or the current one if there's none yet).
+//
+// A shard is written only by the threads mapped to it, and read by the queries concurrently, the
+// counts are approximate anyway, so the counters are relaxed atomics without further
+// synchronization.
+class hotkey_detector
+{
+public:
+    static const int SKETCH_DEPTH = 4;
+    static const int SKETCH_WIDTH = 1024;
+    static const int TOP_K = 8;
+    static const int SHARD_COUNT = 8;
+
+    explicit hotkey_detector(hotkey_type::type type);
+    ~hotkey_detector();
+
+    hotkey_type::type type() const { return _type; }
+
+    // Returns ERR_SERVICE_ALREADY_EXIST if it's detecting.
+    error_code start();
+    void stop();
+    bool detecting() const { return _detecting.load(std::memory_order_relaxed); }
+
+    // Called on the request path.
+    void record(uint64_t key_hash)
+    {
+        if (dsn_likely(!_detecting.load(std::memory_order_acquire))) {
+            return;
+        }
+        record_internal(key_hash);
+    }
+
+    // Gets the keys taking at least [replication] hotkey_min_percent of the sampled requests,
+    // in descending order of count.
+    std::vector<hotkey_info> query() const;
+
+    // Handles the START/STOP/QUERY of the replica/hotkeys http call. The detect_hotkey_rpc is
+    // still served by the storage app, which reports the raw keys.
+    void on_detect_hotkey(const detect_hotkey_request &req, /*out*/ detect_hotkey_response &resp);
+
+    // The hot keys in json.
+    std::string query_json() const;
+
+private:
+    struct shard;
+
+    void record_internal(uint64_t key_hash);
+
+    const hotkey_type::type _type;
+    std::atomic<bool> _detecting{false};
+
+    mutable zlock _lock; // serializes start, stop and query
+    uint64_t _start_ms{0};
+    // allocated at the first start, and kept until destruction so that the recording threads
+    // never see them freed
+    std::unique_ptr<shard[]> _shards;
+
+    friend class hotkey_detector_test;
+};
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,311 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "learn_file_diff.h"
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/filesystem.h>
+
+namespace dsn {
+namespace replication {
+
+bool file_md5_cache::get(const std::string &path,
+                         int64_t size,
+                         time_t mtime,
+                         /*out*/ std::string &md5)
+{
+    if (lookup(path, size, mtime, md5)) {
+        return true;
+    }
+
+    // hash without the lock, the lookups shouldn't wait for the file to be read
+    bool ok = utils::filesystem::md5sum(path, md5) == ERR_OK;
+    zauto_lock l(_lock);
+    if (!ok) {
+        _entries.erase(path);
+        return false;
+    }
+    _entries[path] = entry{size, mtime, md5};
+    return true;
+}
+
+bool file_md5_cache::lookup(const std::string &path,
+                            int64_t size,
+                            time_t mtime,
+                            /*out*/ std::string &md5) const
+{
+    zauto_lock l(_lock);
+    auto iter = _entries.find(path);
+    if (iter == _entries.end() || iter->second.size != size || iter->second.mtime != mtime) {
+        return false;
+    }
+    md5 = iter->second.md5;
+    return true;
+}
+
+bool file_md5_cache::contains(const std::string &path, int64_t size, time_t mtime) const
+{
+    std::string md5;
+    return lookup(path, size, mtime, md5);
+}
+
+void file_md5_cache::remove_absent()
+{
+    std::vector<std::string> paths;
+    {
+        zauto_lock l(_lock);
+        for (const auto &kv : _entries) {
+            paths.push_back(kv.first);
+        }
+    }
+
+    std::vector<std::string> absent_paths;
+    for (const auto &path : paths) {
+        if (!utils::filesystem::file_exists(path)) {
+            absent_paths.push_back(path);
+        }
+    }
+
+    zauto_lock l(_lock);
+    for (const auto &path : absent_paths) {
+        _entries.erase(path);
+    }
+}
+
+namespace learn_file_diff {
+
+static bool get_file_stat(const std::string &path, /*out*/ int64_t &size, /*out*/ time_t &mtime)
+{
+    return utils::filesystem::file_size(path, size) &&
+           utils::filesystem::last_write_time(path, mtime);
+}
+
+// Path of `path` relative to `dir`, or empty if `path` isn't under `dir`.
+static std::string relative_path(const std::string &dir, const std::string &path)
+{
+    if (dir.empty()) {
+        return std::string();
+    }
+    if (path.size() <= dir.size() || path.compare(0, dir.size(), dir) != 0) {
+        return std::string();
+    }
+    size_t pos = dir.size();
+    while (pos < path.size() && path[pos] == '/') {
+        ++pos;
+    }
+    return path.substr(pos);
+}
+
+void build_manifest(const std::string &replica_dir,
+                    const std::vector<std::string> &dirs,
+                    size_t max_files,
+                    int64_t max_hash_bytes,
+                    file_md5_cache &cache,
+                    /*out*/ std::vector<learn_file_meta> &manifest)
+{
+    manifest.clear();
+    cache.remove_absent();
+
+    // the paths listed by get_subfiles() are normalized
+    std::string base_dir;
+    utils::filesystem::get_normalized_path(replica_dir, base_dir);
+
+    int64_t hashed_bytes = 0;
+    for (const auto &dir : dirs) {
+        std::vector<std::string> files;
+        if (!utils::filesystem::directory_exists(dir) ||
+            !utils::filesystem::get_subfiles(dir, files, true)) {
+            continue;
+        }
+
+        for (const auto &file : files) {
+            if (manifest.size() >= max_files) {
+                return;
+            }
+
+            learn_file_meta meta;
+            meta.name = relative_path(base_dir, file);
+            time_t mtime;
+            if (meta.name.empty() || !get_file_stat(file, meta.size, mtime)) {
+                continue;
+            }
+            if (!cache.contains(file, meta.size, mtime)) {
+                if (hashed_bytes + meta.size > max_hash_bytes) {
+                    continue;
+                }
+                hashed_bytes += meta.size;
+            }
+            if (cache.get(file, meta.size, mtime, meta.md5)) {
+                manifest.emplace_back(std::move(meta));
+            }
+        }
+    }
+}
+
+std::vector<std::string> find_unhashed_files(const std::vector<learn_file_meta> &manifest,
+                                             const std::string &dir,
+                                             const file_md5_cache &cache)
+{
+    std::multimap<std::string, int64_t> candidates;
+    for (const auto &meta : manifest) {
+        candidates.emplace(utils::filesystem::get_file_name(meta.name), meta.size);
+    }
+
+    std::vector<std::string> files;
+    std::vector<std::string> unhashed_files;
+    if (!utils::filesystem::directory_exists(dir) ||
+        !utils::filesystem::get_subfiles(dir, files, true)) {
+        return unhashed_files;
+    }
+    for (const auto &file : files) {
+        auto range = candidates.equal_range(utils::filesystem::get_file_name(file));
+        if (range.first == range.second) {
+            continue;
+        }
+        int64_t size;
+        time_t mtime;
+        if (!get_file_stat(file, size, mtime) || cache.contains(file, size, mtime)) {
+            continue;
+        }
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (iter->second == size) {
+                unhashed_files.push_back(file);
+                break;
+            }
+        }
+    }
+    return unhashed_files;
+}
+
+void hash_files(const std::vector<std::string> &files,
+                int64_t max_hash_bytes,
+                file_md5_cache &cache)
+{
+    int64_t hashed_bytes = 0;
+    for (const auto &file : files) {
+        int64_t size;
+        time_t mtime;
+        if (!get_file_stat(file, size, mtime) || cache.contains(file, size, mtime)) {
+            continue;
+        }
+        if (hashed_bytes + size > max_hash_bytes) {
+            continue;
+        }
+        hashed_bytes += size;
+        std::string md5;
+        cache.get(file, size, mtime, md5);
+    }
+}
+
+std::map<std::string, std::string> diff(const std::vector<learn_file_meta> &manifest,
+                                        const std::string &base_dir,
+                                        const std::vector<std::string> &files,
+                                        const file_md5_cache &cache)
+{
+    // the same file may be named differently on learner and learnee, e.g. in the data dir of
+    // the learner but in a checkpoint dir of the learnee, so match the files by file name
+    std::multimap<std::string, const learn_file_meta *> candidates;
+    for (const auto &meta : manifest) {
+        candidates.emplace(utils::filesystem::get_file_name(meta.name), &meta);
+    }
+
+    std::map<std::string, std::string> retained;
+    for (const auto &file : files) {
+        auto range = candidates.equal_range(utils::filesystem::get_file_name(file));
+        if (range.first == range.second) {
+            continue;
+        }
+
+        std::string name = relative_path(base_dir, file);
+        int64_t size;
+        time_t mtime;
+        if (name.empty() || !get_file_stat(file, size, mtime)) {
+            continue;
+        }
+
+        std::string md5;
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            const learn_file_meta &meta = *iter->second;
+            if (meta.size != size) {
+                continue;
+            }
+            if (md5.empty() && !cache.lookup(file, size, mtime, md5)) {
+                break;
+            }
+            if (meta.md5 == md5) {
+                retained.emplace(std::move(name), meta.name);
+                break;
+            }
+        }
+    }
+    return retained;
+}
+
+bool prepare_learn_dir(const std::string &replica_dir,
+                       const std::string &learn_dir,
+                       const std::vector<learn_file_meta> &manifest,
+                       const std::vector<std::string> &files,
+                       const std::map<std::string, std::string> &retained_files,
+                       /*out*/ std::vector<std::string> &copy_files)
+{
+    copy_files.clear();
+
+    const std::string staging_dir = learn_dir + ".staging";
+    utils::filesystem::remove_path(staging_dir);
+    if (!utils::filesystem::create_directory(staging_dir)) {
+        derror_f("create learn staging dir {} failed", staging_dir);
+        return false;
+    }
+
+    std::map<std::string, int64_t> manifest_sizes;
+    for (const auto &meta : manifest) {
+        manifest_sizes.emplace(meta.name, meta.size);
+    }
+
+    for (const auto &file : files) {
+        auto iter = retained_files.find(file);
+        if (iter == retained_files.end()) {
+            copy_files.push_back(file);
+            continue;
+        }
+
+        // the retained file must be the one described in the manifest, which is checked by
+        // size as rehashing is too expensive here
+        const std::string src = utils::filesystem::path_combine(replica_dir, iter->second);
+        const std::string target = utils::filesystem::path_combine(staging_dir, file);
+        auto size_iter = manifest_sizes.find(iter->second);
+        int64_t size;
+        if (size_iter == manifest_sizes.end() || !utils::filesystem::file_size(src, size) ||
+            size != size_iter->second ||
+            !utils::filesystem::create_directory(utils::filesystem::remove_file_name(target)) ||
+            !utils::filesystem::link_file(src, target)) {
+            dwarn_f("link retained file {} to {} failed, copy it from learnee", src, target);
+            copy_files.push_back(file);
+        }
+    }
+
+    if (!utils::filesystem::remove_path(learn_dir) ||
+        !utils::filesystem::rename_path(staging_dir, learn_dir)) {
+        derror_f("replace learn dir {} with {} failed", learn_dir, staging_dir);
+        return false;
+    }
+    return true;
+}
+
+} // namespace learn_file_diff
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,118 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dsn/dist/replication/replication_types.h>
+#include <dsn/tool-api/zlocks.h>
+
+namespace dsn {
+namespace replication {
+
+// Caches the md5 of the files, keyed by path and invalidated once the size or the last write
+// time of the file changes. Thread safe: the files are hashed in THREAD_POOL_REPLICATION_LONG,
+// while the replication thread only looks up the cached md5s.
+class file_md5_cache
+{
+public:
+    // Hashes the file if its md5 isn't cached. Returns false if the file can't be read.
+    bool get(const std::string &path, int64_t size, time_t mtime, /*out*/ std::string &md5);
+    // Returns false if the md5 of the file isn't cached, never reads the file.
+    bool lookup(const std::string &path,
+                int64_t size,
+                time_t mtime,
+                /*out*/ std::string &md5) const;
+    bool contains(const std::string &path, int64_t size, time_t mtime) const;
+
+    void remove_absent();
+    size_t size() const
+    {
+        zauto_lock l(_lock);
+        return _entries.size();
+    }
+
+private:
+    struct entry
+    {
+        int64_t size;
+        time_t mtime;
+        std::string md5;
+    };
+    mutable zlock _lock;
+    std::map<std::string, entry> _entries;
+};
+
+// File-level diff of the checkpoints for app learning: a learner which held the replica before
+// (a node re-added soon after a failure, or a learning round which failed halfway) still has
+// most of the immutable checkpoint files, it tells the learnee what it has, and the learnee
+// only ships the files which are missing or changed.
+//
+// The files are never hashed in the replication thread. Hashing is bounded by `max_hash_bytes`
+// per call, files beyond the budget are left out of the manifest (on learner) or simply copied
+// (on learnee), and the md5s are cached so that the next round continues where the budget ran
+// out.
+namespace learn_file_diff {
+
+// On learner: builds the manifest of the regular files under `dirs`, named relative to
+// `replica_dir`. It hashes the files, so call it in THREAD_POOL_REPLICATION_LONG.
+void build_manifest(const std::string &replica_dir,
+                    const std::vector<std::string> &dirs,
+                    size_t max_files,
+                    int64_t max_hash_bytes,
+                    file_md5_cache &cache,
+                    /*out*/ std::vector<learn_file_meta> &manifest);
+
+// On learnee: the regular files under `dir` which the learner may retain, i.e. a file with the
+// same name and size is in the manifest, but whose md5s aren't cached yet.
+std::vector<std::string> find_unhashed_files(const std::vector<learn_file_meta> &manifest,
+                                             const std::string &dir,
+                                             const file_md5_cache &cache);
+
+// Hashes `files` into the cache until `max_hash_bytes` runs out, call it in
+// THREAD_POOL_REPLICATION_LONG.
+void hash_files(const std::vector<std::string> &files,
+                int64_t max_hash_bytes,
+                file_md5_cache &cache);
+
+// On learnee: finds the files in `files` (full paths) the learner already has, a file is
+// retained if a file with the same name, size and md5 is in the manifest. Only the cached md5s
+// are compared, see find_unhashed_files().
+// Returns the path relative to `base_dir` -> the name in the manifest.
+std::map<std::string, std::string> diff(const std::vector<learn_file_meta> &manifest,
+                                        const std::string &base_dir,
+                                        const std::vector<std::string> &files,
+                                        const file_md5_cache &cache);
+
+// On learner: recreates `learn_dir` with the retained files hard-linked into it, the files
+// to be copied from learnee are returned in `copy_files`.
+// The retained files may reside in `learn_dir` itself, so they are linked into a staging dir
+// which then replaces `learn_dir`.
+bool prepare_learn_dir(const std::string &replica_dir,
+                       const std::string &learn_dir,
+                       const std::vector<learn_file_meta> &manifest,
+                       const std::vector<std::string> &files,
+                       const std::map<std::string, std::string> &retained_files,
+                       /*out*/ std::vector<std::string> &copy_files);
+
+} // namespace learn_file_diff
+} // namespace replication
+} // namespace dsn
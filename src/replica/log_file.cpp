@@ -37,6 +37,19 @@
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("replication",
+                  log_read_ahead_buffer_count,
+                  2,
+                  "count of the buffers read ahead when reading a mutation log file sequentially, "
+                  "e.g. by duplication, learning and replay");
+DSN_DEFINE_validator(log_read_ahead_buffer_count, [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_uint32("replication",
+                  log_read_ahead_buffer_size_kb,
+                  1024,
+                  "size of each buffer read ahead when reading a mutation log file sequentially");
+DSN_DEFINE_validator(log_read_ahead_buffer_size_kb,
+                     [](uint32_t value) -> bool { return value > 0; });
+
 log_file::~log_file() { close(); }
 /*static */ log_file_ptr log_file::open_read(const char *path, /*out*/ error_code &err)
 {
@@ -320,11 +333,13 @@ aio_task_ptr log_file::commit_log_blocks(log_appender &pending,
                                  hash);
     }
 
-    if (utils::FLAGS_enable_latency_tracer) {
+    if (tsk->_tracer != nullptr && tsk->_tracer->enabled()) {
         tsk->_tracer->set_parent_point_name("commit_pending_mutations");
         tsk->_tracer->set_description("log");
         for (const auto &mutation : pending.mutations()) {
-            mutation->_tracer->add_sub_tracer(tsk->_tracer);
+            if (mutation->_tracer != nullptr) {
+                mutation->_tracer->add_sub_tracer(tsk->_tracer);
+            }
         }
     }
 
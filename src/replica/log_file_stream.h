@@ -28,42 +28,50 @@
 
 #pragma once
 
+#include <dsn/utility/flags.h>
+
 #include "log_file.h"
 
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_uint32(log_read_ahead_buffer_count);
+DSN_DECLARE_uint32(log_read_ahead_buffer_size_kb);
+
 // log_file::file_streamer
+//
+// Reads the file sequentially through a ring of buffers. The buffers are filled by the aio
+// reads issued ahead of the reader, in the order of the ring, so that up to
+// [replication] log_read_ahead_buffer_count * log_read_ahead_buffer_size_kb bytes are being
+// read from the disk while the reader is decoding the previous blocks.
 class log_file::file_streamer
 {
 public:
     explicit file_streamer(disk_file *fd, size_t file_offset)
-        : _file_dispatched_bytes(file_offset), _file_handle(fd)
+        : _buffers(FLAGS_log_read_ahead_buffer_count),
+          _buffer_size(FLAGS_log_read_ahead_buffer_size_kb * 1024),
+          _file_dispatched_bytes(file_offset),
+          _file_handle(fd)
     {
-        _current_buffer = _buffers + 0;
-        _next_buffer = _buffers + 1;
+        for (auto &buf : _buffers) {
+            buf._buffer.reset(new char[_buffer_size]);
+        }
         fill_buffers();
     }
-    ~file_streamer()
-    {
-        _current_buffer->wait_ongoing_task();
-        _next_buffer->wait_ongoing_task();
-    }
+    ~file_streamer() { wait_all_ongoing_tasks(); }
     // try to reset file_offset
     void reset(size_t file_offset)
     {
-        _current_buffer->wait_ongoing_task();
-        _next_buffer->wait_ongoing_task();
+        wait_all_ongoing_tasks();
         // fast path if we can just move the cursor
-        if (_current_buffer->_file_offset_of_buffer <= file_offset &&
-            _current_buffer->_file_offset_of_buffer + _current_buffer->_end > file_offset) {
-            _current_buffer->_begin = file_offset - _current_buffer->_file_offset_of_buffer;
+        buffer_t &cur = current();
+        if (cur._file_offset_of_buffer <= file_offset &&
+            cur._file_offset_of_buffer + cur._end > file_offset) {
+            cur._begin = file_offset - cur._file_offset_of_buffer;
+            fill_buffers();
         } else {
-            _current_buffer->_begin = _current_buffer->_end = _next_buffer->_begin =
-                _next_buffer->_end = 0;
-            _file_dispatched_bytes = file_offset;
+            restart(file_offset);
         }
-        fill_buffers();
     }
 
     // TODO(wutao1): use string_view instead of using blob.
@@ -86,34 +94,33 @@ public:
         }                                                                                          \
     } while (0)
 
-        TRY(_current_buffer->wait_ongoing_task());
-        if (size < _current_buffer->length()) {
-            result.assign(_current_buffer->_buffer.get(), _current_buffer->_begin, size);
-            _current_buffer->_begin += size;
+        TRY(current().wait_ongoing_task());
+        if (size < current().length()) {
+            result.assign(current()._buffer.get(), current()._begin, size);
+            current()._begin += size;
         } else {
-            _current_buffer->drain(writer);
-            // we can now assign result since writer must have allocated a buffer.
-            dassert(writer.total_size() != 0, "writer.total_size = %d", writer.total_size());
-            if (size > writer.total_size()) {
-                TRY(_next_buffer->wait_ongoing_task());
-                _next_buffer->consume(writer,
-                                      std::min(size - writer.total_size(), _next_buffer->length()));
-                // We hope that this never happens, it would deteriorate performance
-                if (size > writer.total_size()) {
-                    auto task =
-                        file::read(_file_handle,
-                                   writer.get_current_buffer().buffer().get() + writer.total_size(),
-                                   size - writer.total_size(),
-                                   _file_dispatched_bytes,
-                                   LPC_AIO_IMMEDIATE_CALLBACK,
-                                   nullptr,
-                                   nullptr);
-                    task->wait();
-                    writer.write_empty(task->get_transferred_size());
-                    _file_dispatched_bytes += task->get_transferred_size();
-                    TRY(task->error());
+            while (true) {
+                buffer_t &cur = current();
+                cur.consume(writer, std::min(size - writer.total_size(), cur.length()));
+                if (writer.total_size() == size) {
+                    break;
+                }
+
+                // the current buffer is drained, refill it and move on to the next one
+                size_t next_offset = cur._file_offset_of_buffer + cur._end;
+                fill_buffers();
+                if (current()._file_offset_of_buffer != next_offset) {
+                    // the file was shorter than a buffer when it was read, so the buffers
+                    // read after it don't follow the data
+                    restart(next_offset);
+                }
+                TRY(current().wait_ongoing_task());
+                if (current().empty()) {
+                    TRY(ERR_HANDLE_EOF);
                 }
             }
+            // we can now assign result since writer must have allocated a buffer.
+            dassert(writer.total_size() != 0, "writer.total_size = %d", writer.total_size());
             result = writer.get_current_buffer();
         }
         fill_buffers();
@@ -122,43 +129,59 @@ public:
     }
 
 private:
+    struct buffer_t;
+
+    buffer_t &current() { return _buffers[_current]; }
+
+    // Issues the reads into the drained buffers, each of which is then moved to the end of
+    // the ring, so that the ring from the current buffer follows the order of the file.
     void fill_buffers()
     {
-        while (!_current_buffer->_have_ongoing_task && _current_buffer->empty()) {
-            _current_buffer->_begin = _current_buffer->_end = 0;
-            _current_buffer->_file_offset_of_buffer = _file_dispatched_bytes;
-            _current_buffer->_have_ongoing_task = true;
-            _current_buffer->_task = file::read(_file_handle,
-                                                _current_buffer->_buffer.get(),
-                                                block_size_bytes,
-                                                _file_dispatched_bytes,
-                                                LPC_AIO_IMMEDIATE_CALLBACK,
-                                                nullptr,
-                                                nullptr);
-            _file_dispatched_bytes += block_size_bytes;
-            std::swap(_current_buffer, _next_buffer);
+        while (!current()._have_ongoing_task && current().empty()) {
+            buffer_t &cur = current();
+            cur._begin = cur._end = 0;
+            cur._file_offset_of_buffer = _file_dispatched_bytes;
+            cur._have_ongoing_task = true;
+            cur._task = file::read(_file_handle,
+                                   cur._buffer.get(),
+                                   _buffer_size,
+                                   _file_dispatched_bytes,
+                                   LPC_AIO_IMMEDIATE_CALLBACK,
+                                   nullptr,
+                                   nullptr);
+            _file_dispatched_bytes += _buffer_size;
+            _current = (_current + 1) % _buffers.size();
+        }
+    }
+
+    // Drops all the buffers and reads from `file_offset` again.
+    void restart(size_t file_offset)
+    {
+        wait_all_ongoing_tasks();
+        for (auto &buf : _buffers) {
+            buf._begin = buf._end = 0;
+        }
+        _current = 0;
+        _file_dispatched_bytes = file_offset;
+        fill_buffers();
+    }
+
+    void wait_all_ongoing_tasks()
+    {
+        for (auto &buf : _buffers) {
+            buf.wait_ongoing_task();
         }
     }
 
-    // buffer size, in bytes
-    // TODO(wutao1): call it BLOCK_BYTES_SIZE
-    static constexpr size_t block_size_bytes = 1024 * 1024; // 1MB
     struct buffer_t
     {
-        std::unique_ptr<char[]> _buffer; // with block_size
+        std::unique_ptr<char[]> _buffer; // with _buffer_size
         size_t _begin, _end;             // [buffer[begin]..buffer[end]) contains unconsumed_data
         size_t _file_offset_of_buffer;   // file offset projected to buffer[0]
         bool _have_ongoing_task;
         aio_task_ptr _task;
 
-        buffer_t()
-            : _buffer(new char[block_size_bytes]),
-              _begin(0),
-              _end(0),
-              _file_offset_of_buffer(0),
-              _have_ongoing_task(false)
-        {
-        }
+        buffer_t() : _begin(0), _end(0), _file_offset_of_buffer(0), _have_ongoing_task(false) {}
         size_t length() const { return _end - _begin; }
         bool empty() const { return length() == 0; }
         void consume(binary_writer &dest, size_t len)
@@ -166,26 +189,21 @@ private:
             dest.write(_buffer.get() + _begin, len);
             _begin += len;
         }
-        size_t drain(binary_writer &dest)
-        {
-            auto len = length();
-            consume(dest, len);
-            return len;
-        }
         error_code wait_ongoing_task()
         {
             if (_have_ongoing_task) {
                 _task->wait();
                 _have_ongoing_task = false;
                 _end += _task->get_transferred_size();
-                dassert(_end <= block_size_bytes, "invalid io_size.");
                 return _task->error();
             } else {
                 return ERR_OK;
             }
         }
-    } _buffers[2];
-    buffer_t *_current_buffer, *_next_buffer;
+    };
+    std::vector<buffer_t> _buffers;
+    const size_t _buffer_size;
+    size_t _current{0};
 
     // number of bytes we have issued read operations
     size_t _file_dispatched_bytes;
@@ -61,8 +61,11 @@ mutation::mutation()
     _create_ts_ns = dsn_now_ns();
     _tid = ++s_tid;
     _is_sync_to_child = false;
-    _tracer = std::make_shared<dsn::utils::latency_tracer>(
-        false, "mutation", FLAGS_abnormal_write_trace_latency_threshold);
+    // the tracer is only created if enabled, as it's much larger than the mutation itself
+    if (utils::FLAGS_enable_latency_tracer) {
+        _tracer = std::make_shared<dsn::utils::latency_tracer>(
+            false, "mutation", FLAGS_abnormal_write_trace_latency_threshold);
+    }
 }
 
 mutation_ptr mutation::copy_no_reply(const mutation_ptr &old_mu)
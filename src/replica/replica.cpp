@@ -37,6 +37,8 @@
 #include "replica_disk_migrator.h"
 #include "runtime/security/access_controller.h"
 
+#include <mutex>
+
 #include <dsn/utils/latency_tracer.h>
 #include <dsn/cpp/json_helper.h>
 #include <dsn/dist/replication/replication_app_base.h>
@@ -47,6 +49,7 @@
 #include <dsn/utility/string_conv.h>
 #include <dsn/utility/strings.h>
 #include <dsn/tool-api/rpc_message.h>
+#include <dsn/tool-api/task_worker.h>
 
 namespace dsn {
 namespace replication {
@@ -83,6 +86,7 @@ replica::replica(replica_stub *stub,
     _stub = stub;
     _dir = dir;
     _options = &stub->options();
+    _table_throttling_budget = stub->_throttler.get_table_budget(gpid);
     init_state();
     _config.pid = gpid;
     _bulk_loader = make_unique<replica_bulk_loader>(this);
@@ -185,6 +189,7 @@ void replica::init_state()
     _config.pid.set_partition_index(0);
     _config.status = partition_status::PS_INACTIVE;
     _primary_states.membership.ballot = 0;
+    publish_read_state();
     _create_time_ms = dsn_now_ms();
     _last_config_change_time_ms = _create_time_ms;
     update_last_checkpoint_generate_time();
@@ -221,54 +226,101 @@ void replica::on_client_read(dsn::message_ex *request, bool ignore_throttling)
 
     CHECK_REQUEST_IF_SPLITTING(read)
 
-    if (status() == partition_status::PS_INACTIVE ||
-        status() == partition_status::PS_POTENTIAL_SECONDARY) {
+    // the replication thread may be changing the configuration meanwhile, so check the state
+    // published by it instead of `_config`
+    partition_status::type read_status = _read_status.load(std::memory_order_acquire);
+    if (read_status == partition_status::PS_INACTIVE ||
+        read_status == partition_status::PS_POTENTIAL_SECONDARY) {
         response_client_read(request, ERR_INVALID_STATE);
         return;
     }
 
+    // several threads of a non-partitioned pool may serve the reads of this replica at the same
+    // time, the throttling controllers and the app which isn't declared to be read concurrency
+    // safe must be accessed exclusively then
+    bool concurrent = is_concurrent_read();
     if (!request->is_backup_request()) {
         // only backup request is allowed to read from a stale replica
 
-        if (!ignore_throttling && throttle_read_request(request)) {
-            return;
+        if (!ignore_throttling) {
+            std::unique_lock<zlock> l(_read_throttling_lock, std::defer_lock);
+            if (concurrent) {
+                l.lock();
+            }
+            if (throttle_read_request(request)) {
+                return;
+            }
         }
 
-        if (status() != partition_status::PS_PRIMARY) {
+        if (read_status != partition_status::PS_PRIMARY) {
             response_client_read(request, ERR_INVALID_STATE);
             return;
         }
 
         // a small window where the state is not the latest yet
-        if (last_committed_decree() < _primary_states.last_prepare_decree_on_new_primary) {
+        decree committed = _app->last_committed_decree();
+        decree min_decree = _read_min_decree.load(std::memory_order_acquire);
+        if (committed < min_decree) {
             derror_replica("last_committed_decree(%" PRId64
                            ") < last_prepare_decree_on_new_primary(%" PRId64 ")",
-                           last_committed_decree(),
-                           _primary_states.last_prepare_decree_on_new_primary);
+                           committed,
+                           min_decree);
             response_client_read(request, ERR_INVALID_STATE);
             return;
         }
     } else {
-        if (!ignore_throttling && throttle_backup_request(request)) {
-            return;
+        if (!ignore_throttling) {
+            std::unique_lock<zlock> l(_read_throttling_lock, std::defer_lock);
+            if (concurrent) {
+                l.lock();
+            }
+            if (throttle_backup_request(request)) {
+                return;
+            }
         }
         _counter_backup_request_qps->increment();
     }
 
+    _read_hotkey_detector.record(request->header->client.partition_hash);
+
     uint64_t start_time_ns = dsn_now_ns();
     dassert(_app != nullptr, "");
-    _app->on_request(request);
+    int64_t request_bytes = request->body_size();
+    {
+        std::unique_lock<zlock> l(_app_read_lock, std::defer_lock);
+        if (concurrent && !_app->is_read_concurrency_safe()) {
+            l.lock();
+        }
+        _app->on_request(request);
+    }
+    uint64_t cost_ns = dsn_now_ns() - start_time_ns;
+    _load_stats.on_read(request_bytes, cost_ns);
 
     // If the corresponding perf counter exist, count the duration of this operation.
     // rpc code of request is already checked in message_ex::rpc_code, so it will always be legal
     if (_counters_table_level_latency[request->rpc_code()] != nullptr) {
-        _counters_table_level_latency[request->rpc_code()]->set(dsn_now_ns() - start_time_ns);
+        _counters_table_level_latency[request->rpc_code()]->set(cost_ns);
     }
 }
 
+/*static*/ bool replica::is_concurrent_read()
+{
+    task_worker *worker = task::get_current_worker2();
+    return worker != nullptr && !worker->pool_spec().partitioned;
+}
+
+void replica::publish_read_state()
+{
+    _read_min_decree.store(_primary_states.last_prepare_decree_on_new_primary,
+                           std::memory_order_relaxed);
+    _read_status.store(status(), std::memory_order_release);
+}
+
 void replica::response_client_read(dsn::message_ex *request, error_code error)
 {
-    _stub->response_client(get_gpid(), true, request, status(), error);
+    // the reads may be served out of the replication thread, see on_client_read
+    _stub->response_client(
+        get_gpid(), true, request, _read_status.load(std::memory_order_relaxed), error);
 }
 
 void replica::response_client_write(dsn::message_ex *request, error_code error)
@@ -298,6 +350,7 @@ void replica::execute_mutation(mutation_ptr &mu)
 
     error_code err = ERR_OK;
     decree d = mu->data.header.decree;
+    uint64_t start_time_ns = dsn_now_ns();
 
     switch (status()) {
     case partition_status::PS_INACTIVE:
@@ -378,6 +431,17 @@ void replica::execute_mutation(mutation_ptr &mu)
     dinfo(
         "TwoPhaseCommit, %s: mutation %s committed, err = %s", name(), mu->name(), err.to_string());
 
+    if (err == ERR_OK && _app->last_committed_decree() == d) {
+        int64_t write_count = 0, write_bytes = 0;
+        for (const auto &update : mu->data.updates) {
+            if (update.code != RPC_REPLICATION_WRITE_EMPTY) {
+                ++write_count;
+                write_bytes += update.data.length();
+            }
+        }
+        _load_stats.on_apply(write_count, write_bytes, dsn_now_ns() - start_time_ns);
+    }
+
     if (err != ERR_OK) {
         handle_local_failure(err);
     }
@@ -500,6 +564,8 @@ void replica::close()
 
     _counter_private_log_size.clear();
 
+    _stub->_throttler.remove_replica(get_gpid());
+
     // duplication_impl may have ongoing tasks.
     // release it before release replica.
     _duplication_mgr.reset();
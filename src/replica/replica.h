@@ -44,6 +44,7 @@
 
 #include <dsn/tool-api/uniq_timestamp_us.h>
 #include <dsn/tool-api/thread_access_checker.h>
+#include <dsn/tool-api/zlocks.h>
 #include <dsn/cpp/serverlet.h>
 
 #include <dsn/perf_counter/perf_counter_wrapper.h>
@@ -55,6 +56,10 @@
 #include "prepare_list.h"
 #include "replica_context.h"
 #include "utils/throttling_controller.h"
+#include "hierarchical_throttler.h"
+#include "replica_load_stats.h"
+#include "learn_file_diff.h"
+#include "hotkey_detector.h"
 
 namespace dsn {
 namespace security {
@@ -169,7 +174,11 @@ public:
     //    messages from peers (primary or secondary)
     //
     void on_prepare(dsn::message_ex *request);
-    void on_learn(dsn::message_ex *msg, const learn_request &request);
+    // `learn_files_hashed` is true if the checkpoint files the learner may retain have been
+    // hashed in the background for this request, see learn_file_diff::find_unhashed_files().
+    void on_learn(dsn::message_ex *msg,
+                  const learn_request &request,
+                  bool learn_files_hashed = false);
     void on_learn_completion_notification(const group_check_response &report,
                                           /*out*/ learn_notify_response &response);
     void on_learn_completion_notification_reply(error_code err,
@@ -209,6 +218,7 @@ public:
     replica_stub *get_replica_stub() { return _stub; }
     bool verbose_commit_log() const;
     dsn::task_tracker *tracker() { return &_tracker; }
+    replica_load_stats &load_stats() { return _load_stats; }
 
     //
     // Duplication
@@ -275,6 +285,11 @@ private:
     void response_client_write(dsn::message_ex *request, error_code error);
     void execute_mutation(mutation_ptr &mu);
     mutation_ptr new_mutation(decree decree);
+    // publish the state checked by on_client_read() after `_config` is changed
+    void publish_read_state();
+    // whether the current thread is of a non-partitioned pool, where the reads of a replica may
+    // be served by several threads at the same time
+    static bool is_concurrent_read();
 
     // initialization
     replica(replica_stub *stub,
@@ -301,10 +316,12 @@ private:
                               bool pop_all_committed_mutations = false,
                               int64_t learn_signature = invalid_signature);
     void on_append_log_completed(mutation_ptr &mu, error_code err, size_t size);
+    // `tracer_index` is the index of the sub tracer of `mu->_tracer` for the prepare message
     void on_prepare_reply(std::pair<mutation_ptr, partition_status::type> pr,
                           error_code err,
                           dsn::message_ex *request,
-                          dsn::message_ex *reply);
+                          dsn::message_ex *reply,
+                          int tracer_index);
     void do_possible_commit_on_primary(mutation_ptr &mu);
     void ack_prepare_message(error_code err, mutation_ptr &mu);
     void cleanup_preparing_mutations(bool wait);
@@ -312,6 +329,9 @@ private:
     /////////////////////////////////////////////////////////////////
     // learning
     void init_learn(uint64_t signature);
+    void send_learn_request(learn_request &&request);
+    // builds learn_request::learner_files off the replication thread, then sends the request
+    void send_learn_request_with_files(learn_request &&request);
     void on_learn_reply(error_code err, learn_request &&req, learn_response &&resp);
     void on_copy_remote_state_completed(error_code err,
                                         size_t size,
@@ -454,6 +474,11 @@ private:
 
     void on_detect_hotkey(const detect_hotkey_request &req, /*out*/ detect_hotkey_response &resp);
 
+    hotkey_detector &get_hotkey_detector(hotkey_type::type type)
+    {
+        return type == hotkey_type::READ ? _read_hotkey_detector : _write_hotkey_detector;
+    }
+
     uint32_t query_data_version() const;
 
     //
@@ -470,6 +495,12 @@ private:
     void update_throttle_env_internal(const std::map<std::string, std::string> &envs,
                                       const std::string &key,
                                       throttling_controller &cntl);
+    void update_table_throttle_env_internal(const std::map<std::string, std::string> &envs,
+                                            const std::string &key,
+                                            /*out*/ int64_t &units);
+    /// update the share of table-level throttling budget this replica takes on this node,
+    /// should be called whenever the replica status changes
+    void update_table_throttling_share();
 
     // update allowed users for access controller
     void update_ac_allowed_users(const std::map<std::string, std::string> &envs);
@@ -557,6 +588,13 @@ private:
     // so the "thread-unsafe" generator works fine
     uniq_timestamp_us _uniq_timestamp_us;
 
+    // the state checked by on_client_read(), which may run on a thread other than the
+    // replication thread, published by publish_read_state() whenever the configuration changes
+    std::atomic<partition_status::type> _read_status{partition_status::PS_INACTIVE};
+    std::atomic<decree> _read_min_decree{0};
+    // serializes the reads served concurrently if the app isn't read concurrency safe
+    zlock _app_read_lock;
+
     // replica status specific states
     primary_context _primary_states;
     secondary_context _secondary_states;
@@ -589,6 +627,21 @@ private:
     throttling_controller _write_size_throttling_controller; // throttling by bytes-per-second
     throttling_controller _read_qps_throttling_controller;
     throttling_controller _backup_request_qps_throttling_controller;
+    // guards the read throttling when the reads are served concurrently, see on_client_read()
+    zlock _read_throttling_lock;
+    // table-level throttling, shared by all replicas of this table on the node
+    std::shared_ptr<table_throttling_budget> _table_throttling_budget;
+    int64_t _table_write_throttling_units{0};
+    int64_t _table_read_throttling_units{0};
+
+    // the load reported to meta server for load-aware balancing
+    replica_load_stats _load_stats;
+
+    hotkey_detector _read_hotkey_detector{hotkey_type::READ};
+    hotkey_detector _write_hotkey_detector{hotkey_type::WRITE};
+
+    // md5s of the checkpoint files, used to diff the files for app learning
+    file_md5_cache _file_md5_cache;
 
     // duplication
     std::unique_ptr<replica_duplicator_manager> _duplication_mgr;
@@ -105,6 +105,8 @@ void replica::on_client_write(dsn::message_ex *request, bool ignore_throttling)
         return;
     }
 
+    _write_hotkey_detector.record(request->header->client.partition_hash);
+
     if (FLAGS_reject_write_when_disk_insufficient &&
         (disk_space_insufficient() || _primary_states.secondary_disk_space_insufficient())) {
         response_client_write(request, ERR_DISK_INSUFFICIENT);
@@ -166,7 +168,9 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation, bool pop_all_c
             "invalid partition_status, status = %s",
             enum_to_string(status()));
 
-    mu->_tracer->set_description("primary");
+    if (mu->_tracer != nullptr) {
+        mu->_tracer->set_description("primary");
+    }
     ADD_POINT(mu->_tracer);
 
     error_code err = ERR_OK;
@@ -186,7 +190,9 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation, bool pop_all_c
         mu->set_id(get_ballot(), mu->data.header.decree);
     }
 
-    mu->_tracer->set_name(fmt::format("mutation[{}]", mu->name()));
+    if (mu->_tracer != nullptr && mu->_tracer->enabled()) {
+        mu->_tracer->set_name(fmt::format("mutation[{}]", mu->name()));
+    }
     dlog(level,
          "%s: mutation %s init_prepare, mutation_tid=%" PRIu64,
          name(),
@@ -317,6 +323,18 @@ ErrOut:
     return;
 }
 
+// The name of the peer is registered once for each thread, rather than built and looked up for
+// each mutation. The peers are few, so the cache is never cleaned.
+static utils::latency_stage_id peer_latency_stage(rpc_address addr)
+{
+    thread_local std::unordered_map<rpc_address, utils::latency_stage_id> stages;
+    auto iter = stages.find(addr);
+    if (iter == stages.end()) {
+        iter = stages.emplace(addr, utils::register_latency_stage(addr.to_string())).first;
+    }
+    return iter->second;
+}
+
 void replica::send_prepare_message(::dsn::rpc_address addr,
                                    partition_status::type status,
                                    const mutation_ptr &mu,
@@ -324,8 +342,11 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
                                    bool pop_all_committed_mutations,
                                    int64_t learn_signature)
 {
-    mu->_tracer->add_sub_tracer(addr.to_string());
-    ADD_POINT(mu->_tracer->sub_tracer(addr.to_string()));
+    int tracer_index = -1;
+    if (mu->_tracer != nullptr && mu->_tracer->enabled()) {
+        tracer_index = mu->_tracer->add_sub_tracer(peer_latency_stage(addr));
+        ADD_POINT(mu->_tracer->sub_tracer(tracer_index));
+    }
 
     dsn::message_ex *msg = dsn::message_ex::create_request(
         RPC_PREPARE, timeout_milliseconds, get_gpid().thread_hash());
@@ -348,7 +369,8 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
                   msg,
                   &_tracker,
                   [=](error_code err, dsn::message_ex *request, dsn::message_ex *reply) {
-                      on_prepare_reply(std::make_pair(mu, rconfig.status), err, request, reply);
+                      on_prepare_reply(
+                          std::make_pair(mu, rconfig.status), err, request, reply, tracer_index);
                   },
                   get_gpid().thread_hash());
 
@@ -395,8 +417,10 @@ void replica::on_prepare(dsn::message_ex *request)
     decree decree = mu->data.header.decree;
 
     dinfo("%s: mutation %s on_prepare", name(), mu->name());
-    mu->_tracer->set_name(fmt::format("mutation[{}]", mu->name()));
-    mu->_tracer->set_description("secondary");
+    if (mu->_tracer != nullptr && mu->_tracer->enabled()) {
+        mu->_tracer->set_name(fmt::format("mutation[{}]", mu->name()));
+        mu->_tracer->set_description("secondary");
+    }
     ADD_POINT(mu->_tracer);
 
     dassert(mu->data.header.pid == rconfig.pid,
@@ -599,7 +623,8 @@ void replica::on_append_log_completed(mutation_ptr &mu, error_code err, size_t s
 void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> pr,
                                error_code err,
                                dsn::message_ex *request,
-                               dsn::message_ex *reply)
+                               dsn::message_ex *reply,
+                               int tracer_index)
 {
     _checker.only_one_thread_access();
 
@@ -630,7 +655,8 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
         ::dsn::unmarshall(reply, resp);
     }
 
-    auto send_prepare_tracer = mu->_tracer->sub_tracer(request->to_address.to_string());
+    auto send_prepare_tracer =
+        mu->_tracer != nullptr ? mu->_tracer->sub_tracer(tracer_index) : nullptr;
     APPEND_EXTERN_POINT(send_prepare_tracer, resp.receive_timestamp, "remote_receive");
     APPEND_EXTERN_POINT(send_prepare_tracer, resp.response_timestamp, "remote_reply");
     ADD_CUSTOM_POINT(send_prepare_tracer, resp.err.to_string());
@@ -773,7 +799,7 @@ void replica::ack_prepare_message(error_code err, mutation_ptr &mu)
     resp.ballot = get_ballot();
     resp.decree = mu->data.header.decree;
 
-    resp.__set_receive_timestamp(mu->_tracer->start_time());
+    resp.__set_receive_timestamp(mu->create_ts_ns());
     resp.__set_response_timestamp(dsn_now_ns());
 
     // for partition_status::PS_POTENTIAL_SECONDARY ONLY
@@ -701,6 +701,7 @@ bool replica::update_local_configuration(const replica_configuration &config,
     FAIL_POINT_INJECT_F("replica_update_local_configuration", [=](dsn::string_view) -> bool {
         auto old_status = status();
         _config = config;
+        publish_read_state();
         ddebug_replica(
             "update status from {} to {}", enum_to_string(old_status), enum_to_string(status()));
         return true;
@@ -809,6 +810,7 @@ bool replica::update_local_configuration(const replica_configuration &config,
     bool r = false;
     uint64_t oldTs = _last_config_change_time_ms;
     _config = config;
+    publish_read_state();
     // we should durable the new ballot to prevent the inconsistent state
     if (_config.ballot > old_ballot) {
         dsn::error_code result = _app->update_init_info_ballot_and_decree(this);
@@ -1045,6 +1047,8 @@ bool replica::update_local_configuration(const replica_configuration &config,
            boost::lexical_cast<std::string>(_config).c_str());
 
     if (status() != old_status) {
+        update_table_throttling_share();
+
         bool is_closing =
             (status() == partition_status::PS_ERROR ||
              (status() == partition_status::PS_INACTIVE && get_ballot() > old_ballot));
@@ -152,5 +152,64 @@ void replica_http_service::query_manual_compaction_handler(const http_request &r
     resp.body = json.dump();
 }
 
+void replica_http_service::query_hotkeys_handler(const http_request &req, http_response &resp)
+{
+    int32_t app_id = -1;
+    int32_t partition_index = -1;
+    detect_hotkey_request request;
+    request.type = hotkey_type::READ;
+    request.action = detect_action::QUERY;
+    for (const auto &p : req.query_args) {
+        bool valid = true;
+        if (p.first == "app_id") {
+            valid = buf2int32(p.second, app_id) && app_id >= 0;
+        } else if (p.first == "partition_index") {
+            valid = buf2int32(p.second, partition_index) && partition_index >= 0;
+        } else if (p.first == "type") {
+            valid = p.second == "read" || p.second == "write";
+            request.type = p.second == "write" ? hotkey_type::WRITE : hotkey_type::READ;
+        } else if (p.first == "action") {
+            if (p.second == "start") {
+                request.action = detect_action::START;
+            } else if (p.second == "stop") {
+                request.action = detect_action::STOP;
+            } else {
+                valid = p.second == "query";
+            }
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            resp.body = fmt::format("invalid argument {}={}", p.first, p.second);
+            resp.status_code = http_status_code::bad_request;
+            return;
+        }
+    }
+    if (app_id < 0 || partition_index < 0) {
+        resp.body = "app_id and partition_index should not be empty";
+        resp.status_code = http_status_code::bad_request;
+        return;
+    }
+
+    gpid pid(app_id, partition_index);
+    replica_ptr rep = _stub->get_replica(pid);
+    if (rep == nullptr) {
+        resp.body = fmt::format("replica {} not found", pid);
+        resp.status_code = http_status_code::not_found;
+        return;
+    }
+
+    // served by the built-in detector, while detect_hotkey_rpc is still served by the storage app
+    detect_hotkey_response response;
+    rep->get_hotkey_detector(request.type).on_detect_hotkey(request, response);
+    if (response.err != ERR_OK) {
+        resp.body = response.err_hint;
+        resp.status_code = http_status_code::bad_request;
+        return;
+    }
+    resp.body = response.__isset.hotkey_result ? response.hotkey_result : "{}";
+    resp.status_code = http_status_code::ok;
+}
+
 } // namespace replication
 } // namespace dsn
@@ -45,6 +45,13 @@ public:
                                    std::placeholders::_1,
                                    std::placeholders::_2),
                          "ip:port/replica/maual_compaction?app_id=<app_id>");
+        register_handler("hotkeys",
+                         std::bind(&replica_http_service::query_hotkeys_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2),
+                         "ip:port/replica/hotkeys?app_id=<app_id>&partition_index=<partition_index>"
+                         "&type=<read|write>&action=<start|stop|query>");
     }
 
     std::string path() const override { return "replica"; }
@@ -52,6 +59,7 @@ public:
     void query_duplication_handler(const http_request &req, http_response &resp);
     void query_app_data_version_handler(const http_request &req, http_response &resp);
     void query_manual_compaction_handler(const http_request &req, http_response &resp);
+    void query_hotkeys_handler(const http_request &req, http_response &resp);
 
     inline const char *manual_compaction_status_to_string(manual_compaction_status::type status)
     {
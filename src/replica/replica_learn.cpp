@@ -42,10 +42,32 @@
 #include <dsn/utility/filesystem.h>
 #include <dsn/dist/replication/replication_app_base.h>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_bool("replication",
+                learn_app_by_file_diff,
+                true,
+                "whether the learner tells the learnee the checkpoint files it still holds, so "
+                "that only the missing or changed files are copied when learning app");
+DSN_TAG_VARIABLE(learn_app_by_file_diff, FT_MUTABLE);
+
+DSN_DEFINE_uint32("replication",
+                  learn_app_file_diff_max_files,
+                  100000,
+                  "max count of the retained files the learner reports for one learning round");
+
+DSN_DEFINE_uint32("replication",
+                  learn_app_file_diff_max_hash_mb,
+                  128,
+                  "max size of the files hashed in THREAD_POOL_REPLICATION_LONG for the "
+                  "checkpoint file diff in one learning round, on learner and learnee "
+                  "respectively, the hashes are cached so the following rounds continue with "
+                  "the rest files");
+DSN_TAG_VARIABLE(learn_app_file_diff_max_hash_mb, FT_MUTABLE);
+
 void replica::init_learn(uint64_t signature)
 {
     _checker.only_one_thread_access();
@@ -202,6 +224,58 @@ void replica::init_learn(uint64_t signature)
     request.learner = _stub->_primary_address;
     request.signature = _potential_secondary_states.learning_version;
     _app->prepare_get_checkpoint(request.app_specific_learn_request);
+    if (FLAGS_learn_app_by_file_diff) {
+        // the learnee asks for the manifest only if it chooses to learn app
+        request.__set_learner_files_available(true);
+    }
+
+    send_learn_request(std::move(request));
+}
+
+// ThreadPool: THREAD_POOL_REPLICATION
+void replica::send_learn_request_with_files(learn_request &&request) // on learner
+{
+    // the data dir holds the checkpoints of the previous membership, and the learn dir
+    // holds the files copied by a previous round of learning which failed halfway.
+    // Hashing them may take long, so the manifest is built off the replication thread.
+    request.__isset.learner_files_available = false;
+    std::vector<std::string> dirs = {_app->data_dir(), _app->learn_dir()};
+    tasking::enqueue(
+        LPC_REPLICATION_LONG_LOW,
+        &_tracker,
+        [ this, dirs = std::move(dirs), request = std::move(request) ]() mutable {
+            learn_file_diff::build_manifest(
+                _dir,
+                dirs,
+                FLAGS_learn_app_file_diff_max_files,
+                static_cast<int64_t>(FLAGS_learn_app_file_diff_max_hash_mb) << 20,
+                _file_md5_cache,
+                request.learner_files);
+            request.__isset.learner_files = !request.learner_files.empty();
+            tasking::enqueue(LPC_REPLICATION_COMMON,
+                             &_tracker,
+                             [ this, request = std::move(request) ]() mutable {
+                                 send_learn_request(std::move(request));
+                             },
+                             get_gpid().thread_hash());
+        });
+}
+
+// ThreadPool: THREAD_POOL_REPLICATION
+void replica::send_learn_request(learn_request &&request) // on learner
+{
+    _checker.only_one_thread_access();
+
+    if (status() != partition_status::PS_POTENTIAL_SECONDARY ||
+        request.signature != (int64_t)_potential_secondary_states.learning_version ||
+        !_potential_secondary_states.learning_round_is_running) {
+        dwarn_replica("send_learn_request[{}]: learning is reset while building the manifest, "
+                      "status = {}, learning_version = {}",
+                      request.signature,
+                      enum_to_string(status()),
+                      _potential_secondary_states.learning_version);
+        return;
+    }
 
     ddebug("%s: init_learn[%016" PRIx64 "]: learnee = %s, learn_duration = %" PRIu64
            " ms, max_gced_decree = %" PRId64 ", local_committed_decree = %" PRId64 ", "
@@ -323,7 +397,9 @@ decree replica::get_learn_start_decree(const learn_request &request) // on prima
     return learn_start_decree;
 }
 
-void replica::on_learn(dsn::message_ex *msg, const learn_request &request)
+void replica::on_learn(dsn::message_ex *msg,
+                       const learn_request &request,
+                       bool learn_files_hashed)
 {
     _checker.only_one_thread_access();
 
@@ -355,6 +431,34 @@ void replica::on_learn(dsn::message_ex *msg, const learn_request &request)
         return;
     }
 
+    if (FLAGS_learn_app_by_file_diff && request.__isset.learner_files && !learn_files_hashed) {
+        std::vector<std::string> unhashed_files = learn_file_diff::find_unhashed_files(
+            request.learner_files, _app->data_dir(), _file_md5_cache);
+        if (!unhashed_files.empty()) {
+            // hash the files the learner may retain off the replication thread, then handle the
+            // request again, nothing is changed for it so far
+            ddebug_replica("on_learn[{}]: learner = {}, hash {} files before diffing them",
+                           request.signature,
+                           request.learner.to_string(),
+                           unhashed_files.size());
+            tasking::enqueue(
+                LPC_REPLICATION_LONG_LOW,
+                &_tracker,
+                [ this, unhashed_files = std::move(unhashed_files), msg = message_ptr(msg),
+                  request ]() {
+                    learn_file_diff::hash_files(
+                        unhashed_files,
+                        static_cast<int64_t>(FLAGS_learn_app_file_diff_max_hash_mb) << 20,
+                        _file_md5_cache);
+                    tasking::enqueue(LPC_REPLICATION_COMMON,
+                                     &_tracker,
+                                     [this, msg, request]() { on_learn(msg, request, true); },
+                                     get_gpid().thread_hash());
+                });
+            return;
+        }
+    }
+
     // prepare learn_start_decree
     decree local_committed_decree = last_committed_decree();
 
@@ -482,6 +586,15 @@ void replica::on_learn(dsn::message_ex *msg, const learn_request &request)
                    _app->last_durable_decree());
             response.type = learn_type::LT_APP;
             response.state = learn_state();
+            if (FLAGS_learn_app_by_file_diff && request.__isset.learner_files_available &&
+                request.learner_files_available) {
+                ddebug_replica("on_learn[{}]: learner = {}, ask for the files held by learner",
+                               request.signature,
+                               request.learner.to_string());
+                response.__set_learner_files_requested(true);
+                reply(msg, response);
+                return;
+            }
         }
 
         if (response.type == learn_type::LT_LOG) {
@@ -527,6 +640,18 @@ void replica::on_learn(dsn::message_ex *msg, const learn_request &request)
             } else {
                 response.base_local_dir = _app->data_dir();
                 response.__set_replica_disk_tag(get_replica_disk_tag());
+                if (FLAGS_learn_app_by_file_diff && request.__isset.learner_files) {
+                    response.__set_retained_files(learn_file_diff::diff(request.learner_files,
+                                                                        response.base_local_dir,
+                                                                        response.state.files,
+                                                                        _file_md5_cache));
+                    ddebug_replica("on_learn[{}]: learner = {}, {} of {} checkpoint files "
+                                   "are retained on learner",
+                                   request.signature,
+                                   request.learner.to_string(),
+                                   response.retained_files.size(),
+                                   response.state.files.size());
+                }
                 ddebug(
                     "%s: on_learn[%016" PRIx64 "]: learner = %s, get app learn state succeed, "
                     "learned_meta_size = %u, learned_file_count = %u, learned_to_decree = %" PRId64,
@@ -633,6 +758,12 @@ void replica::on_learn_reply(error_code err, learn_request &&req, learn_response
         return;
     }
 
+    if (resp.__isset.learner_files_requested && resp.learner_files_requested) {
+        // the learnee chooses to learn app, continue this round with the local files
+        send_learn_request_with_files(std::move(req));
+        return;
+    }
+
     // local state is newer than learnee
     if (resp.last_committed_decree < _app->last_committed_decree()) {
         dwarn("%s: on_learn_reply[%016" PRIx64
@@ -885,10 +1016,33 @@ void replica::on_learn_reply(error_code err, learn_request &&req, learn_response
 
     else if (resp.state.files.size() > 0) {
         auto learn_dir = _app->learn_dir();
-        utils::filesystem::remove_path(learn_dir);
-        utils::filesystem::create_directory(learn_dir);
+        std::vector<std::string> copy_files;
+        bool learn_dir_ok = false;
+        if (resp.__isset.retained_files && !resp.retained_files.empty()) {
+            learn_dir_ok = learn_file_diff::prepare_learn_dir(_dir,
+                                                              learn_dir,
+                                                              req.learner_files,
+                                                              resp.state.files,
+                                                              resp.retained_files,
+                                                              copy_files);
+            for (const auto &file : copy_files) {
+                // failed to link, copied from learnee
+                resp.retained_files.erase(file);
+            }
+            ddebug_replica("on_learn_reply[{}]: learnee = {}, link {} retained files, "
+                           "copy {} files",
+                           req.signature,
+                           resp.config.primary.to_string(),
+                           resp.state.files.size() - copy_files.size(),
+                           copy_files.size());
+        } else {
+            utils::filesystem::remove_path(learn_dir);
+            utils::filesystem::create_directory(learn_dir);
+            learn_dir_ok = dsn::utils::filesystem::directory_exists(learn_dir);
+            copy_files = resp.state.files;
+        }
 
-        if (!dsn::utils::filesystem::directory_exists(learn_dir)) {
+        if (!learn_dir_ok) {
             derror("%s: on_learn_reply[%016" PRIx64
                    "]: learnee = %s, create replica learn dir %s failed",
                    name(),
@@ -913,6 +1067,22 @@ void replica::on_learn_reply(error_code err, learn_request &&req, learn_response
             return;
         }
 
+        if (copy_files.empty()) {
+            // all the files are retained on local
+            _potential_secondary_states.learn_remote_files_task =
+                tasking::create_task(LPC_LEARN_REMOTE_DELTA_FILES, &_tracker, [
+                    this,
+                    copy_start = _potential_secondary_states.duration_ms(),
+                    req_cap = std::move(req),
+                    resp_cap = std::move(resp)
+                ]() mutable {
+                    on_copy_remote_state_completed(
+                        ERR_OK, 0, copy_start, std::move(req_cap), std::move(resp_cap));
+                });
+            _potential_secondary_states.learn_remote_files_task->enqueue();
+            return;
+        }
+
         bool high_priority = (resp.type == learn_type::LT_APP ? false : true);
         ddebug("%s: on_learn_reply[%016" PRIx64 "]: learnee = %s, learn_duration = %" PRIu64
                " ms, start to copy remote files, copy_file_count = %d, priority = %s",
@@ -920,14 +1090,14 @@ void replica::on_learn_reply(error_code err, learn_request &&req, learn_response
                req.signature,
                resp.config.primary.to_string(),
                _potential_secondary_states.duration_ms(),
-               static_cast<int>(resp.state.files.size()),
+               static_cast<int>(copy_files.size()),
                high_priority ? "high" : "low");
 
         _potential_secondary_states.learn_remote_files_task = _stub->_nfs->copy_remote_files(
             resp.config.primary,
             resp.replica_disk_tag,
             resp.base_local_dir,
-            resp.state.files,
+            copy_files,
             get_replica_disk_tag(),
             learn_dir,
             true, // overwrite
@@ -1065,9 +1235,11 @@ void replica::on_copy_remote_state_completed(error_code err,
     }
 
     if (err == ERR_OK) {
-        _potential_secondary_states.learning_copy_file_count += resp.state.files.size();
+        // the retained files are linked rather than copied
+        size_t copy_file_count = resp.state.files.size() - resp.retained_files.size();
+        _potential_secondary_states.learning_copy_file_count += copy_file_count;
         _potential_secondary_states.learning_copy_file_size += size;
-        _stub->_counter_replicas_learning_recent_copy_file_count->add(resp.state.files.size());
+        _stub->_counter_replicas_learning_recent_copy_file_count->add(copy_file_count);
         _stub->_counter_replicas_learning_recent_copy_file_size->add(size);
     }
 
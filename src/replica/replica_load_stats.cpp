@@ -0,0 +1,118 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "replica_load_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_uint32("replication",
+                  replica_load_decay_seconds,
+                  60,
+                  "the time constant of the decayed averages of the replica load reported to "
+                  "meta server");
+DSN_DEFINE_uint32("replication",
+                  replica_load_disk_usage_interval_seconds,
+                  300,
+                  "the min interval to scan the data dir of a replica for its disk usage");
+DSN_TAG_VARIABLE(replica_load_disk_usage_interval_seconds, FT_MUTABLE);
+
+namespace {
+
+int64_t get_dir_size_mb(const std::string &dir)
+{
+    std::vector<std::string> files;
+    if (!utils::filesystem::get_subfiles(dir, files, true)) {
+        return 0;
+    }
+    int64_t total = 0;
+    for (const auto &file : files) {
+        int64_t size = 0;
+        if (utils::filesystem::file_size(file, size)) {
+            total += size;
+        }
+    }
+    return total >> 20;
+}
+
+} // anonymous namespace
+
+replica_load_stats::replica_load_stats() : _last_collect_ms(0), _last_disk_scan_ms(0)
+{
+    _load.read_qps = 0;
+    _load.write_qps = 0;
+    _load.read_bytes_per_sec = 0;
+    _load.write_bytes_per_sec = 0;
+    _load.disk_usage_mb = 0;
+    _load.cpu_share = 0;
+}
+
+replica_load_info replica_load_stats::collect(uint64_t now_ms)
+{
+    zauto_lock l(_lock);
+
+    int64_t read_count = _read_count.exchange(0, std::memory_order_relaxed);
+    int64_t write_count = _write_count.exchange(0, std::memory_order_relaxed);
+    int64_t read_bytes = _read_bytes.exchange(0, std::memory_order_relaxed);
+    int64_t write_bytes = _write_bytes.exchange(0, std::memory_order_relaxed);
+    uint64_t cost_ns = _cost_ns.exchange(0, std::memory_order_relaxed);
+
+    if (_last_collect_ms != 0 && now_ms > _last_collect_ms) {
+        double seconds = (now_ms - _last_collect_ms) / 1000.0;
+        // the weight of the new sample grows with the time it covers, so that the averages
+        // don't depend on how frequently they are collected
+        double alpha = 1 - std::exp(-seconds / std::max(1u, FLAGS_replica_load_decay_seconds));
+        auto decay = [alpha, seconds](double &avg, double amount) {
+            avg += alpha * (amount / seconds - avg);
+        };
+        decay(_load.read_qps, read_count);
+        decay(_load.write_qps, write_count);
+        decay(_load.read_bytes_per_sec, read_bytes);
+        decay(_load.write_bytes_per_sec, write_bytes);
+        decay(_load.cpu_share, cost_ns / 1e9);
+    }
+    _last_collect_ms = now_ms;
+    return _load;
+}
+
+bool replica_load_stats::should_scan_disk_usage(uint64_t now_ms)
+{
+    zauto_lock l(_lock);
+    if (_last_disk_scan_ms != 0 &&
+        now_ms < _last_disk_scan_ms + FLAGS_replica_load_disk_usage_interval_seconds * 1000ULL) {
+        return false;
+    }
+    _last_disk_scan_ms = now_ms;
+    return true;
+}
+
+void replica_load_stats::update_disk_usage(const std::string &data_dir)
+{
+    int64_t disk_usage_mb = get_dir_size_mb(data_dir);
+    zauto_lock l(_lock);
+    _load.disk_usage_mb = disk_usage_mb;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,88 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include <dsn/tool-api/zlocks.h>
+
+#include "metadata_types.h"
+
+namespace dsn {
+namespace replication {
+
+// The load of one replica, reported to meta server on config-sync so that the balancer can see
+// hot partitions rather than only replica counts.
+//
+// The hot path only bumps atomic counters, the counters are folded into exponentially decayed
+// averages (see [replication] replica_load_decay_seconds) when the load is collected, which
+// happens once per config-sync. The disk usage is scanned by a background task instead, since
+// walking the data dir may take long.
+class replica_load_stats
+{
+public:
+    replica_load_stats();
+
+    void on_read(int64_t bytes, uint64_t cost_ns)
+    {
+        _read_count.fetch_add(1, std::memory_order_relaxed);
+        _read_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        _cost_ns.fetch_add(cost_ns, std::memory_order_relaxed);
+    }
+    // Called on every replica applying a mutation, secondaries bear the write load as well.
+    void on_apply(int64_t write_count, int64_t bytes, uint64_t cost_ns)
+    {
+        _write_count.fetch_add(write_count, std::memory_order_relaxed);
+        _write_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        _cost_ns.fetch_add(cost_ns, std::memory_order_relaxed);
+    }
+
+    // Folds the counters since the last collection into the averages, and returns them along
+    // with the disk usage of the last scan.
+    replica_load_info collect(uint64_t now_ms);
+
+    // Returns true at most once per [replication] replica_load_disk_usage_interval_seconds, then
+    // the caller should scan the disk usage by update_disk_usage() off the hot threads.
+    bool should_scan_disk_usage(uint64_t now_ms);
+    // Walks `data_dir` for the disk usage, which is I/O bound and must not be called with any
+    // lock held.
+    void update_disk_usage(const std::string &data_dir);
+
+    // Returns the averages as of the last collection.
+    replica_load_info last_collected()
+    {
+        zauto_lock l(_lock);
+        return _load;
+    }
+
+private:
+    std::atomic<int64_t> _read_count{0};
+    std::atomic<int64_t> _write_count{0};
+    std::atomic<int64_t> _read_bytes{0};
+    std::atomic<int64_t> _write_bytes{0};
+    std::atomic<uint64_t> _cost_ns{0};
+
+    zlock _lock;
+    uint64_t _last_collect_ms;
+    uint64_t _last_disk_scan_ms;
+    replica_load_info _load;
+};
+
+} // namespace replication
+} // namespace dsn
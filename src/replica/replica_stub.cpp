@@ -43,6 +43,7 @@
 #include "split/replica_split_manager.h"
 #include "replica_disk_migrator.h"
 #include "disk_cleaner.h"
+#include "disk_balancer.h"
 
 #include <boost/algorithm/string/replace.hpp>
 #include <dsn/cpp/json_helper.h>
@@ -75,6 +76,12 @@ DSN_DEFINE_uint32("replication",
                   "max concurrent manual emergency checkpoint running count");
 DSN_TAG_VARIABLE(max_concurrent_manual_emergency_checkpointing_count, FT_MUTABLE);
 
+DSN_DEFINE_uint32("replication",
+                  gc_max_concurrent_replica_count,
+                  4,
+                  "max count of the replicas whose private logs are flushed concurrently by gc");
+DSN_TAG_VARIABLE(gc_max_concurrent_replica_count, FT_MUTABLE);
+
 bool replica_stub::s_not_exit_on_log_failure = false;
 
 replica_stub::replica_stub(replica_state_subscriber subscriber /*= nullptr*/,
@@ -261,6 +268,10 @@ void replica_stub::install_perf_counters()
 
     _counter_shared_log_size.init_app_counter(
         "eon.replica_stub", "shared.log.size(MB)", COUNTER_TYPE_NUMBER, "shared log size(MB)");
+    _counter_gc_duration_ms.init_app_counter("eon.replica_stub",
+                                             "replicas.gc.duration(ms)",
+                                             COUNTER_TYPE_NUMBER_PERCENTILES,
+                                             "time used by a round of garbage collection(ms)");
     _counter_shared_log_recent_write_size.init_app_counter(
         "eon.replica_stub",
         "shared.log.recent.write.size",
@@ -734,8 +745,9 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
 
     if (_options.delay_for_fd_timeout_on_start) {
         uint64_t now_time_ms = dsn_now_ms();
-        uint64_t delay_time_ms =
-            (_options.fd_grace_seconds + 3) * 1000; // for more 3 seconds than grace seconds
+        // for more 3 seconds than grace seconds, which may be extended for the jittery nodes
+        uint64_t delay_time_ms = (_options.fd_grace_seconds + 3) * 1000 +
+                                 fd::failure_detector::get_max_lease_extension_ms();
         if (now_time_ms < dsn::utils::process_start_millis() + delay_time_ms) {
             uint64_t delay = dsn::utils::process_start_millis() + delay_time_ms - now_time_ms;
             ddebug("delay for %" PRIu64 "ms to make failure detector timeout", delay);
@@ -1330,6 +1342,14 @@ void replica_stub::get_local_replicas(std::vector<replica_info> &replicas)
         }
         replica_info info;
         get_replica_info(info, rep);
+        uint64_t now_ms = dsn_now_ms();
+        info.__set_load(rep->load_stats().collect(now_ms));
+        if (rep->load_stats().should_scan_disk_usage(now_ms)) {
+            // never walk the data dir under _replicas_lock, the usage is reported on the next sync
+            tasking::enqueue(LPC_REPLICATION_LONG_LOW, rep->tracker(), [rep]() {
+                rep->load_stats().update_disk_usage(rep->dir());
+            });
+        }
         replicas.push_back(std::move(info));
     }
 
@@ -1703,26 +1723,44 @@ void replica_stub::on_gc_replica(replica_stub_ptr this_, gpid id)
     }
 }
 
-void replica_stub::on_gc()
+// The state of a round of garbage collection, shared by the per-replica tasks of the round.
+struct replica_stub::gc_round
 {
-    uint64_t start = dsn_now_ns();
-
-    struct gc_info
+    struct replica_gc_info
     {
         replica_ptr rep;
         partition_status::type status;
         mutation_log_ptr plog;
         decree last_durable_decree;
         int64_t init_offset_in_shared_log;
+        // the condition to gc the shared log, filled by the task of the replica
+        replica_log_info log_info;
     };
 
-    std::unordered_map<gpid, gc_info> rs;
+    uint64_t start_ns;
+    // the map is never changed after the round starts, each task only fills its own entry
+    std::unordered_map<gpid, replica_gc_info> replicas;
+    // the replicas in the order they are collected, the index of the next one to start
+    std::vector<gpid> order;
+    std::atomic<size_t> next_index{0};
+    std::atomic<size_t> remaining_count{0};
+};
+
+void replica_stub::on_gc()
+{
+    if (_gc_running.exchange(true)) {
+        dwarn_f("the last round of garbage collection is still running, skip this round");
+        return;
+    }
+
+    auto round = std::make_shared<gc_round>();
+    round->start_ns = dsn_now_ns();
     {
         zauto_read_lock l(_replicas_lock);
         // collect info in lock to prevent the case that the replica is closed in replica::close()
         for (auto &kv : _replicas) {
             const replica_ptr &rep = kv.second;
-            gc_info &info = rs[kv.first];
+            gc_round::replica_gc_info &info = round->replicas[kv.first];
             info.rep = rep;
             info.status = rep->status();
             info.plog = rep->private_log();
@@ -1731,10 +1769,93 @@ void replica_stub::on_gc()
         }
     }
 
-    ddebug("start to garbage collection, replica_count = %d", (int)rs.size());
+    ddebug("start to garbage collection, replica_count = %d", (int)round->replicas.size());
+
+    if (round->replicas.empty()) {
+        on_gc_round_completed(round);
+        return;
+    }
+
+    // flushing the private logs is the costly part, which is done by the per-replica tasks; only a
+    // few of them are outstanding at a time to leave the long pool to learning and opening, each
+    // finished task starts the next one and the last finished task completes the round
+    round->order.reserve(round->replicas.size());
+    for (const auto &kv : round->replicas) {
+        round->order.push_back(kv.first);
+    }
+    round->remaining_count.store(round->order.size());
+    uint32_t concurrency = std::max(1u, FLAGS_gc_max_concurrent_replica_count);
+    for (uint32_t i = 0; i < concurrency; ++i) {
+        if (!start_next_gc_replica(round)) {
+            break;
+        }
+    }
+}
+
+bool replica_stub::start_next_gc_replica(const std::shared_ptr<gc_round> &round)
+{
+    size_t index = round->next_index.fetch_add(1);
+    if (index >= round->order.size()) {
+        return false;
+    }
+    gpid id = round->order[index];
+    tasking::enqueue(LPC_PER_REPLICA_GC,
+                     &_tracker,
+                     [this, round, id]() { on_gc_replica_log(round, id); },
+                     id.thread_hash());
+    return true;
+}
+
+void replica_stub::on_gc_replica_log(const std::shared_ptr<gc_round> &round, gpid id)
+{
+    gc_round::replica_gc_info &info = round->replicas.at(id);
+    replica_log_info &ri = info.log_info;
+    if (_log != nullptr) {
+        if (info.plog) {
+            // flush private log to update plog_max_commit_on_disk,
+            // and just flush once to avoid flushing infinitely
+            info.plog->flush_once();
+
+            decree plog_max_commit_on_disk = info.plog->max_commit_on_disk();
+            ri.max_decree = std::min(info.last_durable_decree, plog_max_commit_on_disk);
+            ddebug("gc_shared: gc condition for %s, status = %s, garbage_max_decree = %" PRId64
+                   ", last_durable_decree= %" PRId64 ", plog_max_commit_on_disk = %" PRId64 "",
+                   info.rep->name(),
+                   enum_to_string(info.status),
+                   ri.max_decree,
+                   info.last_durable_decree,
+                   plog_max_commit_on_disk);
+        } else {
+            ri.max_decree = info.last_durable_decree;
+            ddebug("gc_shared: gc condition for %s, status = %s, garbage_max_decree = %" PRId64
+                   ", last_durable_decree = %" PRId64 "",
+                   info.rep->name(),
+                   enum_to_string(info.status),
+                   ri.max_decree,
+                   info.last_durable_decree);
+        }
+        ri.valid_start_offset = info.init_offset_in_shared_log;
+    }
+
+    start_next_gc_replica(round);
+    if (round->remaining_count.fetch_sub(1) == 1) {
+        tasking::enqueue(LPC_GARBAGE_COLLECT_LOGS_AND_REPLICAS, &_tracker, [this, round]() {
+            on_gc_round_completed(round);
+        });
+    }
+}
+
+void replica_stub::on_gc_round_completed(const std::shared_ptr<gc_round> &round)
+{
+    auto &rs = round->replicas;
 
     // gc shared prepare log
     //
+    // The shared log is truncated once per round over the conditions of all the replicas, rather
+    // than incrementally as each replica is done: a file of the shared log holds the mutations of
+    // all the replicas, so it can't be removed until the slowest replica of the round is done,
+    // and the truncation itself only removes the files, which is cheap.
+    //
     // Now that checkpoint is very important for gc, we must be able to trigger checkpoint when
     // necessary.
     // that is, we should be able to trigger memtable flush when necessary.
@@ -1754,35 +1875,8 @@ void replica_stub::on_gc()
     //
     if (_log != nullptr) {
         replica_log_info_map gc_condition;
-        for (auto &kv : rs) {
-            replica_log_info ri;
-            replica_ptr &rep = kv.second.rep;
-            mutation_log_ptr &plog = kv.second.plog;
-            if (plog) {
-                // flush private log to update plog_max_commit_on_disk,
-                // and just flush once to avoid flushing infinitely
-                plog->flush_once();
-
-                decree plog_max_commit_on_disk = plog->max_commit_on_disk();
-                ri.max_decree = std::min(kv.second.last_durable_decree, plog_max_commit_on_disk);
-                ddebug("gc_shared: gc condition for %s, status = %s, garbage_max_decree = %" PRId64
-                       ", last_durable_decree= %" PRId64 ", plog_max_commit_on_disk = %" PRId64 "",
-                       rep->name(),
-                       enum_to_string(kv.second.status),
-                       ri.max_decree,
-                       kv.second.last_durable_decree,
-                       plog_max_commit_on_disk);
-            } else {
-                ri.max_decree = kv.second.last_durable_decree;
-                ddebug("gc_shared: gc condition for %s, status = %s, garbage_max_decree = %" PRId64
-                       ", last_durable_decree = %" PRId64 "",
-                       rep->name(),
-                       enum_to_string(kv.second.status),
-                       ri.max_decree,
-                       kv.second.last_durable_decree);
-            }
-            ri.valid_start_offset = kv.second.init_offset_in_shared_log;
-            gc_condition[kv.first] = ri;
+        for (const auto &kv : rs) {
+            gc_condition[kv.first] = kv.second.log_info;
         }
 
         std::set<gpid> prevent_gc_replicas;
@@ -1900,7 +1994,10 @@ void replica_stub::on_gc()
     _counter_replicas_splitting_max_async_learn_time_ms->set(splitting_max_async_learn_time_ms);
     _counter_replicas_splitting_max_copy_file_size->set(splitting_max_copy_file_size);
 
-    ddebug("finish to garbage collection, time_used_ns = %" PRIu64, dsn_now_ns() - start);
+    uint64_t time_used_ns = dsn_now_ns() - round->start_ns;
+    _counter_gc_duration_ms->set(time_used_ns / 1000000);
+    _gc_running.store(false);
+    ddebug("finish to garbage collection, time_used_ns = %" PRIu64, time_used_ns);
 }
 
 void replica_stub::on_disk_stat()
@@ -1913,6 +2010,7 @@ void replica_stub::on_disk_stat()
     _fs_manager.update_disk_stat();
     update_disk_holding_replicas();
     update_disks_status();
+    balance_disks();
 
     _counter_replicas_error_replica_dir_count->set(report.error_replica_count);
     _counter_replicas_garbage_replica_dir_count->set(report.garbage_replica_count);
@@ -2795,6 +2893,7 @@ replica_ptr replica_stub::create_child_replica_if_not_found(gpid child_pid,
                         [=](dsn::string_view) -> replica_ptr {
                             replica *rep = new replica(this, child_pid, *app, "./", false);
                             rep->_config.status = partition_status::PS_INACTIVE;
+                            rep->publish_read_state();
                             _replicas.insert(replicas::value_type(child_pid, rep));
                             ddebug_f("mock create_child_replica_if_not_found succeed");
                             return rep;
@@ -2880,6 +2979,7 @@ void replica_stub::update_disk_holding_replicas()
         // holding_replicas
         dir_node->holding_primary_replicas.clear();
         dir_node->holding_secondary_replicas.clear();
+        double io_bytes_per_sec = 0;
         for (const auto &holding_replicas : dir_node->holding_replicas) {
             const std::set<dsn::gpid> &pids = holding_replicas.second;
             for (const auto &pid : pids) {
@@ -2887,6 +2987,8 @@ void replica_stub::update_disk_holding_replicas()
                 if (replica == nullptr) {
                     continue;
                 }
+                replica_load_info load = replica->load_stats().last_collected();
+                io_bytes_per_sec += load.read_bytes_per_sec + load.write_bytes_per_sec;
                 if (replica->status() == partition_status::PS_PRIMARY) {
                     dir_node->holding_primary_replicas[holding_replicas.first].emplace(pid);
                 } else if (replica->status() == partition_status::PS_SECONDARY) {
@@ -2894,7 +2996,72 @@ void replica_stub::update_disk_holding_replicas()
                 }
             }
         }
+        dir_node->recent_io_bytes_per_sec = io_bytes_per_sec;
+    }
+}
+
+void replica_stub::balance_disks()
+{
+    if (!FLAGS_disk_balancer_enabled) {
+        return;
+    }
+    uint64_t now_ms = dsn_now_ms();
+    if (_last_disk_balance_ms != 0 &&
+        now_ms < _last_disk_balance_ms + FLAGS_disk_balancer_interval_seconds * 1000ULL) {
+        return;
+    }
+
+    std::vector<disk_balance_dir> dirs;
+    for (const auto &dir_node : _fs_manager._dir_nodes) {
+        disk_balance_dir dir;
+        dir.tag = dir_node->tag;
+        dir.capacity_mb = dir_node->disk_capacity_mb;
+        dir.available_mb = dir_node->disk_available_mb;
+        dir.normal = dir_node->status == disk_status::NORMAL;
+        dir.io_bytes_per_sec = dir_node->recent_io_bytes_per_sec;
+        for (const auto &holding_replicas : dir_node->holding_replicas) {
+            for (const auto &pid : holding_replicas.second) {
+                replica_ptr replica = get_replica(pid);
+                if (replica == nullptr) {
+                    continue;
+                }
+                // one migration at a time
+                if (replica->disk_migrator()->status() != disk_migration_status::IDLE) {
+                    return;
+                }
+                // only the secondaries can be migrated
+                if (replica->status() != partition_status::PS_SECONDARY) {
+                    continue;
+                }
+                replica_load_info load = replica->load_stats().last_collected();
+                dir.movable_replicas.push_back(
+                    {pid, load.disk_usage_mb, load.read_bytes_per_sec + load.write_bytes_per_sec});
+            }
+        }
+        dirs.emplace_back(std::move(dir));
+    }
+
+    disk_balance_plan plan;
+    if (!plan_disk_balance(dirs, plan)) {
+        return;
     }
+    replica_ptr replica = get_replica(plan.pid);
+    if (replica == nullptr) {
+        return;
+    }
+
+    ddebug_f("{}: disk balancer migrates replica({}) from {} to {}",
+             _primary_address_str,
+             plan.pid,
+             plan.origin_disk,
+             plan.target_disk);
+    auto request = make_unique<replica_disk_migrate_request>();
+    request->pid = plan.pid;
+    request->origin_disk = plan.origin_disk;
+    request->target_disk = plan.target_disk;
+    replica->disk_migrator()->on_migrate_replica(
+        replica_disk_migrate_rpc(std::move(request), RPC_REPLICA_DISK_MIGRATE));
+    _last_disk_balance_ms = now_ms;
 }
 
 void replica_stub::on_bulk_load(bulk_load_rpc rpc)
@@ -37,11 +37,13 @@
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/dist/failure_detector_multimaster.h>
 #include <dsn/dist/nfs_node.h>
+#include <dsn/utility/TokenBucket.h>
 
 #include "common/replication_common.h"
 #include "common/bulk_load_common.h"
 #include "common/fs_manager.h"
 #include "block_service/block_service_manager.h"
+#include "hierarchical_throttler.h"
 #include "replica.h"
 
 namespace dsn {
@@ -279,6 +281,14 @@ private:
     replica_life_cycle get_replica_life_cycle(gpid id);
     void on_gc_replica(replica_stub_ptr this_, gpid id);
 
+    struct gc_round;
+    // starts the task of the next replica of the round, returns false if all are started
+    bool start_next_gc_replica(const std::shared_ptr<gc_round> &round);
+    // collects the condition to gc the shared log of a replica, with its private log flushed
+    virtual void on_gc_replica_log(const std::shared_ptr<gc_round> &round, gpid id);
+    // gc the shared log and update the statistics once all the replicas of the round are done
+    void on_gc_round_completed(const std::shared_ptr<gc_round> &round);
+
     void response_client(gpid id,
                          bool is_read,
                          dsn::message_ex *request,
@@ -288,6 +298,9 @@ private:
 
     void update_disks_status();
 
+    // Starts a replica migration between the data dirs if the disk balancer finds them unbalanced.
+    void balance_disks();
+
     void register_ctrl_command();
 
     int get_app_id_from_replicas(std::string app_name)
@@ -365,7 +378,11 @@ private:
     ::dsn::task_ptr _config_query_task;
     ::dsn::task_ptr _config_sync_timer_task;
     ::dsn::task_ptr _gc_timer_task;
+    // whether a round of garbage collection is running
+    std::atomic_bool _gc_running{false};
     ::dsn::task_ptr _disk_stat_timer_task;
+    // when the disk balancer started the last replica migration
+    uint64_t _last_disk_balance_ms{0};
     ::dsn::task_ptr _mem_release_timer_task;
 
     std::unique_ptr<duplication_sync_timer> _duplication_sync_timer;
@@ -408,11 +425,18 @@ private:
     // nfs_node
     std::unique_ptr<dsn::nfs_node> _nfs;
 
+    // node-level and table-level throttling of client requests
+    hierarchical_throttler _throttler;
+
     // write body size exceed this threshold will be logged and reject, 0 means no check
     uint64_t _max_allowed_write_size;
 
     // replica count executing bulk load downloading concurrently
     std::atomic_int _bulk_load_downloading_count;
+    // sst file count downloading concurrently by all the replicas in bulk load
+    std::atomic_int _bulk_load_downloading_file_count{0};
+    // the download bandwidth shared by all the replicas in bulk load
+    folly::DynamicTokenBucket _bulk_load_download_rate_limiter;
 
     // replica count executing emergency checkpoint concurrently
     std::atomic_int _manual_emergency_checkpointing_count;
@@ -456,6 +480,7 @@ private:
     perf_counter_wrapper _counter_replicas_recent_group_check_fail_count;
 
     perf_counter_wrapper _counter_shared_log_size;
+    perf_counter_wrapper _counter_gc_duration_ms;
     perf_counter_wrapper _counter_shared_log_recent_write_size;
     perf_counter_wrapper _counter_recent_trigger_emergency_checkpoint_count;
 
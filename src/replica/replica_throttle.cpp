@@ -23,11 +23,13 @@
 #include <dsn/dist/replication/replication_app_base.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/dist/replication/replica_envs.h>
+#include <dsn/utils/token_bucket_throttling_controller.h>
 
 namespace dsn {
 namespace replication {
 
-#define THROTTLE_REQUEST(op_type, throttling_type, request, request_units)                         \
+// `hierarchy_units` are refunded to the node and the table if the request is rejected here
+#define THROTTLE_REQUEST(op_type, throttling_type, request, request_units, hierarchy_units)        \
     do {                                                                                           \
         int64_t delay_ms = 0;                                                                      \
         auto type = _##op_type##_##throttling_type##_throttling_controller.control(                \
@@ -42,6 +44,8 @@ namespace replication {
                     std::chrono::milliseconds(delay_ms));                                          \
                 _counter_recent_##op_type##_throttling_delay_count->increment();                   \
             } else { /** type == throttling_controller::REJECT **/                                 \
+                _stub->_throttler.refund_##op_type(_table_throttling_budget.get(),                 \
+                                                   hierarchy_units);                               \
                 if (delay_ms > 0) {                                                                \
                     tasking::enqueue(LPC_##op_type##_THROTTLING_DELAY,                             \
                                      &_tracker,                                                    \
@@ -59,16 +63,31 @@ namespace replication {
         }                                                                                          \
     } while (0)
 
+#define THROTTLE_REQUEST_BY_HIERARCHY(op_type, request, units)                                     \
+    do {                                                                                           \
+        if (!_stub->_throttler.admit_##op_type(_table_throttling_budget.get(), units)) {           \
+            response_client_##op_type(request, ERR_BUSY);                                          \
+            _counter_recent_##op_type##_throttling_reject_count->increment();                      \
+            return true;                                                                           \
+        }                                                                                          \
+    } while (0)
+
+// The node and the table are charged first, so that the requests delayed by the replica, which
+// skip the throttling when they are retried, are charged as well.
 bool replica::throttle_write_request(message_ex *request)
 {
-    THROTTLE_REQUEST(write, qps, request, 1);
-    THROTTLE_REQUEST(write, size, request, request->body_size());
+    int64_t units = _app->get_request_units(request);
+    THROTTLE_REQUEST_BY_HIERARCHY(write, request, units);
+    THROTTLE_REQUEST(write, qps, request, 1, units);
+    THROTTLE_REQUEST(write, size, request, request->body_size(), units);
     return false;
 }
 
 bool replica::throttle_read_request(message_ex *request)
 {
-    THROTTLE_REQUEST(read, qps, request, 1);
+    int64_t units = _app->get_request_units(request);
+    THROTTLE_REQUEST_BY_HIERARCHY(read, request, units);
+    THROTTLE_REQUEST(read, qps, request, 1, units);
     return false;
 }
 
@@ -104,6 +123,11 @@ void replica::update_throttle_envs(const std::map<std::string, std::string> &env
     update_throttle_env_internal(envs,
                                  replica_envs::BACKUP_REQUEST_QPS_THROTTLING,
                                  _backup_request_qps_throttling_controller);
+    update_table_throttle_env_internal(
+        envs, replica_envs::TABLE_WRITE_THROTTLING, _table_write_throttling_units);
+    update_table_throttle_env_internal(
+        envs, replica_envs::TABLE_READ_THROTTLING, _table_read_throttling_units);
+    update_table_throttling_share();
 }
 
 void replica::update_throttle_env_internal(const std::map<std::string, std::string> &envs,
@@ -136,5 +160,41 @@ void replica::update_throttle_env_internal(const std::map<std::string, std::stri
     }
 }
 
+void replica::update_table_throttle_env_internal(const std::map<std::string, std::string> &envs,
+                                                 const std::string &key,
+                                                 int64_t &units)
+{
+    int64_t old_units = units;
+    auto find = envs.find(key);
+    if (find == envs.end()) {
+        units = 0;
+    } else {
+        bool enabled = false;
+        std::string parse_error;
+        if (!utils::token_bucket_throttling_controller::transform_env_string(
+                find->second, units, enabled, parse_error)) {
+            dwarn_replica("parse env failed, key = \"{}\", value = \"{}\", error = \"{}\"",
+                          key,
+                          find->second,
+                          parse_error);
+            units = 0;
+        } else if (!enabled) {
+            units = 0;
+        }
+    }
+    if (units != old_units) {
+        ddebug_replica("switch {} from {} to {} units per second", key, old_units, units);
+    }
+}
+
+void replica::update_table_throttling_share()
+{
+    _stub->_throttler.update_replica(get_gpid(),
+                                     _app_info.partition_count,
+                                     _table_write_throttling_units,
+                                     _table_read_throttling_units,
+                                     status() == partition_status::PS_PRIMARY);
+}
+
 } // namespace replication
 } // namespace dsn
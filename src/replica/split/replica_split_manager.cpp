@@ -28,6 +28,15 @@ namespace dsn {
 namespace replication {
 DSN_DECLARE_bool(empty_write_disabled);
 
+DSN_DEFINE_uint32("replication",
+                  split_child_checkpoint_timeout_seconds,
+                  600,
+                  "max seconds for the child to wait for its checkpoint during partition split, "
+                  "the split fails if it is exceeded");
+DSN_TAG_VARIABLE(split_child_checkpoint_timeout_seconds, FT_MUTABLE);
+
+static constexpr uint64_t REPLAY_PROGRESS_REPORT_INTERVAL_MS = 10000;
+
 replica_split_manager::replica_split_manager(replica *r)
     : replica_base(r), _replica(r), _stub(r->get_replica_stub())
 {
@@ -118,6 +127,7 @@ void replica_split_manager::child_init_replica(gpid parent_gpid,
     _replica->_config.ballot = init_ballot;
     _replica->_config.primary = primary_address;
     _replica->_config.status = partition_status::PS_PARTITION_SPLIT;
+    _replica->publish_read_state();
 
     // initialize split context
     _replica->_split_states.parent_gpid = parent_gpid;
@@ -357,20 +367,64 @@ void replica_split_manager::child_learn_states(learn_state lstate,
         return;
     }
 
-    // generate a checkpoint synchronously
-    err = _replica->_app->sync_checkpoint();
-    if (err != ERR_OK) {
-        derror_replica("failed to generate checkpoint synchrounously, error={}", err);
+    child_wait_checkpoint(_replica->_app->last_committed_decree(), dsn_now_ms());
+}
+
+// ThreadPool: THREAD_POOL_REPLICATION_LONG
+void replica_split_manager::child_wait_checkpoint(decree checkpoint_decree,
+                                                  uint64_t wait_start_ms) // on child partition
+{
+    if (status() != partition_status::PS_PARTITION_SPLIT) {
+        derror_replica("wrong status({})", enum_to_string(status()));
+        child_handle_async_learn_error();
         return;
     }
 
-    err = _replica->update_init_info_ballot_and_decree();
+    if (_replica->_app->last_durable_decree() < checkpoint_decree) {
+        // child receives no writes during async learn, so the memtable must be flushed
+        error_code err = _replica->_app->async_checkpoint(true);
+        // ERR_TRY_AGAIN: the flushing is triggered, ERR_WRONG_TIMING: a checkpoint is ongoing
+        if (err != ERR_OK && err != ERR_TRY_AGAIN && err != ERR_WRONG_TIMING) {
+            derror_replica("failed to generate checkpoint asynchronously, error={}", err);
+            child_handle_async_learn_error();
+            return;
+        }
+        if (_replica->_app->last_durable_decree() < checkpoint_decree) {
+            uint64_t wait_ms = dsn_now_ms() - wait_start_ms;
+            if (wait_ms >= FLAGS_split_child_checkpoint_timeout_seconds * 1000) {
+                derror_replica("wait for the checkpoint timeout, last_durable_decree={}, "
+                               "checkpoint_decree={}, wait_time={}ms",
+                               _replica->_app->last_durable_decree(),
+                               checkpoint_decree,
+                               wait_ms);
+                child_handle_async_learn_error();
+                return;
+            }
+            ddebug_replica("wait for the checkpoint, last_durable_decree={}, checkpoint_decree={}",
+                           _replica->_app->last_durable_decree(),
+                           checkpoint_decree);
+            _replica->_split_states.async_learn_task =
+                tasking::enqueue(LPC_PARTITION_SPLIT_ASYNC_LEARN,
+                                 tracker(),
+                                 std::bind(&replica_split_manager::child_wait_checkpoint,
+                                           this,
+                                           checkpoint_decree,
+                                           wait_start_ms),
+                                 0,
+                                 std::chrono::seconds(1));
+            return;
+        }
+    }
+
+    error_code err = _replica->update_init_info_ballot_and_decree();
     if (err != ERR_OK) {
         derror_replica("update_init_info_ballot_and_decree failed, error={}", err);
+        child_handle_async_learn_error();
         return;
     }
 
-    ddebug_replica("learn parent states asynchronously succeed");
+    ddebug_replica("learn parent states asynchronously succeed, time_used={}ms",
+                   _replica->_split_states.async_learn_ms());
 
     tasking::enqueue(LPC_PARTITION_SPLIT,
                      tracker(),
@@ -408,10 +462,35 @@ replica_split_manager::child_apply_private_logs(std::vector<std::string> plog_fi
                            }
                        });
 
+    // report the progress periodically, to know how long a split takes
+    uint64_t replay_start_ms = dsn_now_ms();
+    uint64_t last_report_ms = replay_start_ms;
+    uint64_t replayed_bytes = 0;
+    auto report_progress = [&](decree d) {
+        uint64_t now_ms = dsn_now_ms();
+        if (now_ms - last_report_ms < REPLAY_PROGRESS_REPORT_INTERVAL_MS) {
+            return;
+        }
+        last_report_ms = now_ms;
+        uint64_t used_ms = now_ms - replay_start_ms;
+        uint64_t remaining_bytes =
+            total_file_size > replayed_bytes ? total_file_size - replayed_bytes : 0;
+        ddebug_replica("replaying private_log files, replayed_bytes={}, total_bytes={}, "
+                       "replayed_decree={}, time_used={}ms, eta={}ms",
+                       replayed_bytes,
+                       total_file_size,
+                       d,
+                       used_ms,
+                       replayed_bytes > 0 ? used_ms * remaining_bytes / replayed_bytes : 0);
+    };
+
     // replay private log
     ec = mutation_log::replay(plog_files,
-                              [&plist](int log_length, mutation_ptr &mu) {
+                              [&plist, &replayed_bytes, &report_progress](int log_length,
+                                                                          mutation_ptr &mu) {
+                                  replayed_bytes += log_length;
                                   decree d = mu->data.header.decree;
+                                  report_progress(d);
                                   if (d <= plist.last_committed_decree()) {
                                       return false;
                                   }
@@ -437,9 +516,12 @@ replica_split_manager::child_apply_private_logs(std::vector<std::string> plog_fi
     _stub->_counter_replicas_splitting_recent_copy_file_count->add(plog_files.size());
     _stub->_counter_replicas_splitting_recent_copy_file_size->add(total_file_size);
 
-    ddebug_replica("replay private_log files succeed, file count={}, app last_committed_decree={}",
+    ddebug_replica("replay private_log files succeed, file count={}, replayed_bytes={}, app "
+                   "last_committed_decree={}, time_used={}ms",
                    plog_files.size(),
-                   _replica->_app->last_committed_decree());
+                   replayed_bytes,
+                   _replica->_app->last_committed_decree(),
+                   dsn_now_ms() - replay_start_ms);
 
     // apply in-memory mutations if replay private logs succeed
     int count = 0;
@@ -804,6 +886,8 @@ void replica_split_manager::update_local_partition_count(
 
     _replica->_app->set_partition_version(_replica->_app_info.partition_count - 1);
     _partition_version.store(_replica->_app_info.partition_count - 1);
+    // the share of the table-level throttling is per partition
+    _replica->update_table_throttling_share();
 }
 
 // ThreadPool: THREAD_POOL_REPLICATION
@@ -74,6 +74,13 @@ private:
                                         uint64_t total_file_size,
                                         decree last_committed_decree);
 
+    // Waits until the checkpoint of child covers `checkpoint_decree`, which is generated
+    // asynchronously not to block the thread while flushing. The learned mutations aren't in the
+    // private log of child, so they must be durable before child catches up. The split fails if
+    // the checkpoint isn't generated within `split_child_checkpoint_timeout_seconds` since
+    // `wait_start_ms`.
+    void child_wait_checkpoint(decree checkpoint_decree, uint64_t wait_start_ms);
+
     // child catch up parent states while executing async learn task
     void child_catch_up_states();
 
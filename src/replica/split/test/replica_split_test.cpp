@@ -644,6 +644,42 @@ TEST_F(replica_split_test, child_learn_states_tests)
     }
 }
 
+// child_wait_checkpoint tests
+TEST_F(replica_split_test, child_wait_checkpoint_succeed)
+{
+    fail::cfg("replica_child_catch_up_states", "return()");
+    generate_child();
+    mock_child_split_context(true, false);
+    _child_replica->set_app_last_committed_decree(DECREE);
+    _child_replica->update_last_durable_decree(DECREE - 1);
+    _child_replica->update_expect_last_durable_decree(DECREE);
+
+    _child_split_mgr->child_wait_checkpoint(DECREE, dsn_now_ms());
+    _child_replica->tracker()->wait_outstanding_tasks();
+    ASSERT_EQ(_child_replica->last_durable_decree(), DECREE);
+    ASSERT_EQ(_child_replica->status(), partition_status::PS_PARTITION_SPLIT);
+
+    cleanup_child_split_context();
+}
+
+TEST_F(replica_split_test, child_wait_checkpoint_timeout)
+{
+    fail::cfg("replica_stub_split_replica_exec", "return()");
+    generate_child();
+    mock_child_split_context(true, false);
+    _child_replica->set_app_last_committed_decree(DECREE);
+    _child_replica->update_last_durable_decree(DECREE - 1);
+    _child_replica->update_expect_last_durable_decree(DECREE - 1);
+
+    // the checkpoint isn't generated, and the waiting started long ago
+    _child_split_mgr->child_wait_checkpoint(DECREE, 0);
+    _child_replica->tracker()->wait_outstanding_tasks();
+    ASSERT_EQ(_child_replica->last_durable_decree(), DECREE - 1);
+    ASSERT_EQ(_child_replica->status(), partition_status::PS_ERROR);
+
+    cleanup_child_split_context();
+}
+
 // child_apply_private_logs test
 TEST_F(replica_split_test, child_apply_private_logs_succeed)
 {
@@ -0,0 +1,96 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "replica/disk_balancer.h"
+
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace replication {
+
+static disk_balance_dir
+mock_dir(const std::string &tag, int64_t available_mb, double io_bytes_per_sec = 0)
+{
+    disk_balance_dir dir;
+    dir.tag = tag;
+    dir.capacity_mb = 1000;
+    dir.available_mb = available_mb;
+    dir.normal = true;
+    dir.io_bytes_per_sec = io_bytes_per_sec;
+    return dir;
+}
+
+TEST(disk_balancer_test, balance_space)
+{
+    std::vector<disk_balance_dir> dirs = {mock_dir("tag_1", 100), mock_dir("tag_2", 500)};
+    dirs[0].movable_replicas = {{gpid(1, 1), 100, 0}, {gpid(1, 2), 400, 0}, {gpid(1, 3), 150, 0}};
+
+    // moving 200MB evens the ratios out, the largest replica within it is chosen
+    disk_balance_plan plan;
+    ASSERT_TRUE(plan_disk_balance(dirs, plan));
+    ASSERT_EQ(gpid(1, 3), plan.pid);
+    ASSERT_EQ("tag_1", plan.origin_disk);
+    ASSERT_EQ("tag_2", plan.target_disk);
+
+    // no replica is small enough
+    dirs[0].movable_replicas = {{gpid(1, 2), 400, 0}};
+    ASSERT_FALSE(plan_disk_balance(dirs, plan));
+
+    // the target is short of space
+    dirs[0].movable_replicas = {{gpid(1, 1), 100, 0}};
+    dirs[1].normal = false;
+    ASSERT_FALSE(plan_disk_balance(dirs, plan));
+    dirs[1].normal = true;
+
+    // the gap is too small
+    dirs[0].available_mb = 450;
+    ASSERT_FALSE(plan_disk_balance(dirs, plan));
+
+    // the capacity is unknown
+    dirs[0].available_mb = 100;
+    dirs[1].capacity_mb = 0;
+    ASSERT_FALSE(plan_disk_balance(dirs, plan));
+}
+
+TEST(disk_balancer_test, balance_load)
+{
+    std::vector<disk_balance_dir> dirs = {
+        mock_dir("tag_1", 500, 1000), mock_dir("tag_2", 500, 0), mock_dir("tag_3", 500, 0)};
+    dirs[0].movable_replicas = {
+        {gpid(1, 1), 10, 100}, {gpid(1, 2), 10, 400}, {gpid(1, 3), 10, 600}};
+
+    // no more than half of the load gap is moved
+    disk_balance_plan plan;
+    ASSERT_TRUE(plan_disk_balance(dirs, plan));
+    ASSERT_EQ(gpid(1, 2), plan.pid);
+    ASSERT_EQ("tag_1", plan.origin_disk);
+    ASSERT_EQ("tag_2", plan.target_disk);
+
+    // the replica is too large to keep the space balanced
+    dirs[0].movable_replicas = {{gpid(1, 2), 100, 400}};
+    ASSERT_FALSE(plan_disk_balance(dirs, plan));
+
+    // the load is balanced enough
+    dirs[0].movable_replicas = {{gpid(1, 2), 10, 400}};
+    dirs[1].io_bytes_per_sec = 800;
+    dirs[2].io_bytes_per_sec = 800;
+    ASSERT_FALSE(plan_disk_balance(dirs, plan));
+}
+
+} // namespace replication
+} // namespace dsn
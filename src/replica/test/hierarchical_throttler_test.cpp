@@ -0,0 +1,119 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "replica/hierarchical_throttler.h"
+
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace replication {
+
+class hierarchical_throttler_test : public ::testing::Test
+{
+public:
+    void set_node_write_units(int64_t units) { _throttler._node_write_bucket.reset(units); }
+
+    int64_t table_write_rate(const gpid &pid)
+    {
+        return _throttler.get_table_budget(pid)->write_bucket.rate();
+    }
+
+    int64_t table_read_rate(const gpid &pid)
+    {
+        return _throttler.get_table_budget(pid)->read_bucket.rate();
+    }
+
+    bool table_exists(int32_t app_id) { return _throttler._tables.count(app_id) > 0; }
+
+    hierarchical_throttler _throttler;
+};
+
+TEST_F(hierarchical_throttler_test, table_share)
+{
+    // table with 8 partitions, 8000 units/s for write and unlimited for read
+    _throttler.update_replica(gpid(1, 0), 8, 8000, 0, true);
+    ASSERT_EQ(1000, table_write_rate(gpid(1, 0)));
+    ASSERT_EQ(0, table_read_rate(gpid(1, 0)));
+
+    _throttler.update_replica(gpid(1, 1), 8, 8000, 0, true);
+    _throttler.update_replica(gpid(1, 2), 8, 8000, 0, false);
+    ASSERT_EQ(2000, table_write_rate(gpid(1, 0)));
+
+    // the budget is shared by all replicas of the table
+    ASSERT_EQ(_throttler.get_table_budget(gpid(1, 0)), _throttler.get_table_budget(gpid(1, 1)));
+    ASSERT_NE(_throttler.get_table_budget(gpid(1, 0)), _throttler.get_table_budget(gpid(2, 0)));
+
+    // primary downgraded
+    _throttler.update_replica(gpid(1, 1), 8, 8000, 0, false);
+    ASSERT_EQ(1000, table_write_rate(gpid(1, 0)));
+
+    _throttler.remove_replica(gpid(1, 0));
+    ASSERT_EQ(0, table_write_rate(gpid(1, 1)));
+
+    // partition count changed by split, 2 primaries of 16 partitions
+    _throttler.update_replica(gpid(1, 1), 16, 8000, 0, true);
+    _throttler.update_replica(gpid(1, 2), 16, 8000, 0, true);
+    ASSERT_EQ(1000, table_write_rate(gpid(1, 1)));
+
+    // the share isn't truncated by the partition count
+    _throttler.update_replica(gpid(1, 1), 3, 100, 0, true);
+    _throttler.update_replica(gpid(1, 2), 3, 100, 0, true);
+    ASSERT_EQ(66, table_write_rate(gpid(1, 1)));
+}
+
+TEST_F(hierarchical_throttler_test, remove_table)
+{
+    _throttler.update_replica(gpid(1, 0), 2, 200, 0, true);
+    _throttler.update_replica(gpid(1, 1), 2, 200, 0, false);
+    _throttler.update_replica(gpid(2, 0), 1, 100, 0, true);
+
+    _throttler.remove_replica(gpid(1, 0));
+    ASSERT_TRUE(table_exists(1));
+
+    // the table is dropped
+    _throttler.remove_replica(gpid(1, 1));
+    ASSERT_FALSE(table_exists(1));
+    ASSERT_TRUE(table_exists(2));
+
+    // removing an unknown replica is harmless
+    _throttler.remove_replica(gpid(1, 1));
+    ASSERT_FALSE(table_exists(1));
+}
+
+TEST_F(hierarchical_throttler_test, admit)
+{
+    _throttler.update_replica(gpid(1, 0), 4, 400, 0, true);
+    auto budget = _throttler.get_table_budget(gpid(1, 0));
+
+    // 100 units/s on this node, read is unlimited
+    ASSERT_TRUE(_throttler.admit_write(budget.get(), 100));
+    ASSERT_FALSE(_throttler.admit_write(budget.get(), 100));
+    ASSERT_TRUE(_throttler.admit_read(budget.get(), 100000));
+
+    // the units rejected by the replica are given back
+    _throttler.refund_write(budget.get(), 100);
+    ASSERT_TRUE(_throttler.admit_write(budget.get(), 100));
+
+    // node level limit takes effect on tables without limit
+    set_node_write_units(10);
+    auto other = _throttler.get_table_budget(gpid(2, 0));
+    ASSERT_TRUE(_throttler.admit_write(other.get(), 10));
+    ASSERT_FALSE(_throttler.admit_write(other.get(), 10));
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,129 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+#include <dsn/utility/flags.h>
+
+#include "replica/hotkey_detector.h"
+
+namespace dsn {
+namespace replication {
+
+DSN_DECLARE_uint32(hotkey_detect_sample_one_in);
+
+class hotkey_detector_test : public testing::Test
+{
+public:
+    // records `hot_count` requests of the hot key, interleaved with `cold_count` distinct keys
+    static void record(hotkey_detector &detector, uint64_t hot_key, int hot_count, int cold_count)
+    {
+        for (int i = 0; i < std::max(hot_count, cold_count); ++i) {
+            if (i < hot_count) {
+                detector.record(hot_key);
+            }
+            if (i < cold_count) {
+                detector.record(1000000 + i);
+            }
+        }
+    }
+};
+
+TEST_F(hotkey_detector_test, not_detecting)
+{
+    hotkey_detector detector(hotkey_type::READ);
+    record(detector, 42, 100, 100);
+    ASSERT_FALSE(detector.detecting());
+    ASSERT_TRUE(detector.query().empty());
+}
+
+TEST_F(hotkey_detector_test, find_hotkey)
+{
+    hotkey_detector detector(hotkey_type::WRITE);
+    ASSERT_EQ(ERR_OK, detector.start());
+    ASSERT_EQ(ERR_SERVICE_ALREADY_EXIST, detector.start());
+
+    record(detector, 42, 600, 400);
+    auto hotkeys = detector.query();
+    ASSERT_EQ(1, hotkeys.size());
+    ASSERT_EQ(42, hotkeys[0].key_hash);
+    // the count-min sketch never underestimates
+    ASSERT_GE(hotkeys[0].count, 600);
+    ASSERT_GE(hotkeys[0].percent, 60.0);
+
+    // the result is kept after stopped
+    detector.stop();
+    record(detector, 43, 1000, 0);
+    hotkeys = detector.query();
+    ASSERT_EQ(1, hotkeys.size());
+    ASSERT_EQ(42, hotkeys[0].key_hash);
+
+    // restarting clears the result
+    ASSERT_EQ(ERR_OK, detector.start());
+    ASSERT_TRUE(detector.query().empty());
+}
+
+TEST_F(hotkey_detector_test, no_hotkey)
+{
+    hotkey_detector detector(hotkey_type::READ);
+    ASSERT_EQ(ERR_OK, detector.start());
+    record(detector, 42, 0, 2000);
+    ASSERT_TRUE(detector.query().empty());
+}
+
+TEST_F(hotkey_detector_test, sampling)
+{
+    FLAGS_hotkey_detect_sample_one_in = 10;
+    hotkey_detector detector(hotkey_type::READ);
+    ASSERT_EQ(ERR_OK, detector.start());
+    // not interleaved, as 1 in 10 requests of the thread are sampled
+    record(detector, 42, 1000, 0);
+    record(detector, 0, 0, 1000);
+    auto hotkeys = detector.query();
+    ASSERT_EQ(1, hotkeys.size());
+    ASSERT_EQ(42, hotkeys[0].key_hash);
+    ASSERT_LT(hotkeys[0].count, 1000);
+    FLAGS_hotkey_detect_sample_one_in = 1;
+}
+
+TEST_F(hotkey_detector_test, on_detect_hotkey)
+{
+    hotkey_detector detector(hotkey_type::READ);
+    detect_hotkey_request req;
+    detect_hotkey_response resp;
+    req.type = hotkey_type::READ;
+
+    req.action = detect_action::START;
+    detector.on_detect_hotkey(req, resp);
+    ASSERT_EQ(ERR_OK, resp.err);
+    detector.on_detect_hotkey(req, resp);
+    ASSERT_EQ(ERR_SERVICE_ALREADY_EXIST, resp.err);
+
+    record(detector, 42, 100, 0);
+    req.action = detect_action::QUERY;
+    detector.on_detect_hotkey(req, resp);
+    ASSERT_EQ(ERR_OK, resp.err);
+    ASSERT_TRUE(resp.__isset.hotkey_result);
+    ASSERT_NE(std::string::npos, resp.hotkey_result.find(R"("key_hash":42)"));
+
+    req.action = detect_action::STOP;
+    detector.on_detect_hotkey(req, resp);
+    ASSERT_EQ(ERR_OK, resp.err);
+    ASSERT_FALSE(detector.detecting());
+}
+
+} // namespace replication
+} // namespace dsn
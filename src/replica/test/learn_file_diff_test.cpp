@@ -0,0 +1,159 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+#include <dsn/utility/filesystem.h>
+
+#include "replica/learn_file_diff.h"
+
+namespace dsn {
+namespace replication {
+
+class learn_file_diff_test : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        utils::filesystem::remove_path(_root);
+        utils::filesystem::create_directory(_learner_dir);
+        utils::filesystem::create_directory(_learnee_dir);
+    }
+
+    void TearDown() override { utils::filesystem::remove_path(_root); }
+
+    static void write(const std::string &path, std::string content)
+    {
+        utils::filesystem::create_directory(utils::filesystem::remove_file_name(path));
+        ASSERT_TRUE(utils::filesystem::write_file(path, content));
+    }
+
+    static std::string read(const std::string &path)
+    {
+        std::string content;
+        EXPECT_EQ(ERR_OK, utils::filesystem::read_file(path, content));
+        return content;
+    }
+
+protected:
+    const std::string _root = "./learn_file_diff_test";
+    const std::string _learner_dir = _root + "/learner";
+    const std::string _learnee_dir = _root + "/learnee";
+};
+
+TEST_F(learn_file_diff_test, diff_and_link)
+{
+    // learner: data/rdb/1.sst and 2.sst from the previous membership, learn/checkpoint/3.sst
+    // copied by a failed round
+    write(_learner_dir + "/data/rdb/1.sst", "sst-1");
+    write(_learner_dir + "/data/rdb/2.sst", "sst-2-old");
+    write(_learner_dir + "/learn/checkpoint/3.sst", "sst-3");
+    write(_learner_dir + "/data/rdb/MANIFEST", "manifest-old");
+
+    file_md5_cache learner_cache;
+    std::vector<learn_file_meta> manifest;
+    learn_file_diff::build_manifest(_learner_dir,
+                                    {_learner_dir + "/data", _learner_dir + "/learn"},
+                                    100,
+                                    1 << 20,
+                                    learner_cache,
+                                    manifest);
+    ASSERT_EQ(4, manifest.size());
+    ASSERT_EQ(4, learner_cache.size());
+
+    // learnee: 1.sst and 3.sst are unchanged, 2.sst is rewritten with the same name, 4.sst
+    // and the MANIFEST are new
+    const std::string data_dir = _learnee_dir + "/data";
+    std::vector<std::string> files;
+    for (const auto &kv : std::map<std::string, std::string>{{"checkpoint/1.sst", "sst-1"},
+                                                             {"checkpoint/2.sst", "sst-2-new"},
+                                                             {"checkpoint/3.sst", "sst-3"},
+                                                             {"checkpoint/4.sst", "sst-4"},
+                                                             {"checkpoint/MANIFEST", "manifest"}}) {
+        write(data_dir + "/" + kv.first, kv.second);
+        files.push_back(data_dir + "/" + kv.first);
+    }
+
+    // the diff only compares the cached md5s, the candidates are hashed beforehand
+    file_md5_cache learnee_cache;
+    ASSERT_TRUE(learn_file_diff::diff(manifest, data_dir, files, learnee_cache).empty());
+    std::vector<std::string> unhashed_files =
+        learn_file_diff::find_unhashed_files(manifest, data_dir, learnee_cache);
+    // 4.sst isn't in the manifest, and the MANIFEST differs in size
+    ASSERT_EQ(3, unhashed_files.size());
+    learn_file_diff::hash_files(unhashed_files, 1 << 20, learnee_cache);
+    ASSERT_EQ(3, learnee_cache.size());
+    ASSERT_TRUE(learn_file_diff::find_unhashed_files(manifest, data_dir, learnee_cache).empty());
+
+    auto retained = learn_file_diff::diff(manifest, data_dir, files, learnee_cache);
+    ASSERT_EQ(2, retained.size());
+    ASSERT_EQ("data/rdb/1.sst", retained["checkpoint/1.sst"]);
+    ASSERT_EQ("learn/checkpoint/3.sst", retained["checkpoint/3.sst"]);
+
+    // the files are relative to the data dir on learner
+    for (auto &file : files) {
+        file = file.substr(data_dir.length() + 1);
+    }
+    const std::string learn_dir = _learner_dir + "/learn";
+    std::vector<std::string> copy_files;
+    ASSERT_TRUE(learn_file_diff::prepare_learn_dir(
+        _learner_dir, learn_dir, manifest, files, retained, copy_files));
+    ASSERT_EQ(
+        std::vector<std::string>({"checkpoint/2.sst", "checkpoint/4.sst", "checkpoint/MANIFEST"}),
+        copy_files);
+    ASSERT_EQ("sst-1", read(learn_dir + "/checkpoint/1.sst"));
+    ASSERT_EQ("sst-3", read(learn_dir + "/checkpoint/3.sst"));
+    ASSERT_FALSE(utils::filesystem::path_exists(learn_dir + ".staging"));
+}
+
+TEST_F(learn_file_diff_test, hash_budget)
+{
+    write(_learner_dir + "/data/1.sst", "0123456789");
+    write(_learner_dir + "/data/2.sst", "0123456789");
+
+    // only one file fits the budget in a round, the next round continues with the cache
+    file_md5_cache cache;
+    std::vector<learn_file_meta> manifest;
+    learn_file_diff::build_manifest(_learner_dir, {_learner_dir}, 100, 15, cache, manifest);
+    ASSERT_EQ(1, manifest.size());
+    learn_file_diff::build_manifest(_learner_dir, {_learner_dir}, 100, 15, cache, manifest);
+    ASSERT_EQ(2, manifest.size());
+
+    learn_file_diff::build_manifest(_learner_dir, {_learner_dir}, 1, 15, cache, manifest);
+    ASSERT_EQ(1, manifest.size());
+
+    // the removed files are evicted from the cache
+    utils::filesystem::remove_path(_learner_dir + "/data/2.sst");
+    learn_file_diff::build_manifest(_learner_dir, {_learner_dir}, 100, 0, cache, manifest);
+    ASSERT_EQ(1, manifest.size());
+    ASSERT_EQ(1, cache.size());
+}
+
+TEST_F(learn_file_diff_test, hash_files_budget)
+{
+    write(_learnee_dir + "/1.sst", "0123456789");
+    write(_learnee_dir + "/2.sst", "0123456789");
+    std::vector<std::string> files = {_learnee_dir + "/1.sst", _learnee_dir + "/2.sst"};
+
+    file_md5_cache cache;
+    learn_file_diff::hash_files(files, 15, cache);
+    ASSERT_EQ(1, cache.size());
+    learn_file_diff::hash_files(files, 15, cache);
+    ASSERT_EQ(2, cache.size());
+}
+
+} // namespace replication
+} // namespace dsn
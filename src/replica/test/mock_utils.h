@@ -74,7 +74,12 @@ public:
         utils::filesystem::create_file(fmt::format("{}/checkpoint.file", checkpoint_dir));
         return ERR_OK;
     }
-    int on_request(message_ex *request) override { return 0; }
+    int on_request(message_ex *request) override
+    {
+        ++_request_count;
+        return 0;
+    }
+    int request_count() const { return _request_count.load(); }
     std::string query_compact_state() const { return ""; };
 
     // we mock the followings
@@ -101,6 +106,7 @@ public:
 
 private:
     std::map<std::string, std::string> _envs;
+    std::atomic<int> _request_count{0};
     decree _decree = 5;
     ingestion_status::type _ingestion_status;
     decree _last_durable_decree{0};
@@ -150,9 +156,9 @@ public:
 
     replica_duplicator_manager &get_replica_duplicator_manager() { return *_duplication_mgr; }
 
-    void as_primary() { _config.status = partition_status::PS_PRIMARY; }
+    void as_primary() { set_partition_status(partition_status::PS_PRIMARY); }
 
-    void as_secondary() { _config.status = partition_status::PS_SECONDARY; }
+    void as_secondary() { set_partition_status(partition_status::PS_SECONDARY); }
 
     void mock_max_gced_decree(decree d) { _max_gced_decree = d; }
 
@@ -165,14 +171,32 @@ public:
         return _max_gced_decree;
     }
     /// helper functions
-    void set_replica_config(replica_configuration &config) { _config = config; }
-    void set_partition_status(partition_status::type status) { _config.status = status; }
+    void set_replica_config(replica_configuration &config)
+    {
+        _config = config;
+        publish_read_state();
+    }
+    void set_partition_status(partition_status::type status)
+    {
+        _config.status = status;
+        publish_read_state();
+    }
     void set_last_committed_decree(decree d) { _prepare_list->reset(d); }
     prepare_list *get_plist() const { return _prepare_list.get(); }
     void prepare_list_truncate(decree d) { _prepare_list->truncate(d); }
     void prepare_list_commit_hard(decree d) { _prepare_list->commit(d, COMMIT_TO_DECREE_HARD); }
     decree get_app_last_committed_decree() { return _app->last_committed_decree(); }
     void set_app_last_committed_decree(decree d) { _app->_last_committed_decree = d; }
+    int get_app_request_count()
+    {
+        return dynamic_cast<mock_replication_app_base *>(_app.get())->request_count();
+    }
+    // as the new primary does on the replication thread
+    void set_read_min_decree(decree d)
+    {
+        _primary_states.last_prepare_decree_on_new_primary = d;
+        publish_read_state();
+    }
     void set_primary_partition_configuration(partition_configuration &pconfig)
     {
         _primary_states.membership = pconfig;
@@ -273,6 +297,26 @@ public:
 
     void set_state_connected() { _state = replica_node_state::NS_Connected; }
 
+    void remove_replica(gpid id)
+    {
+        zauto_write_lock l(_replicas_lock);
+        _replicas.erase(id);
+        mock_replicas.erase(id);
+    }
+
+    bool gc_running() const { return _gc_running.load(); }
+
+    // called at the start of the gc task of each replica
+    std::function<void(gpid)> gc_replica_log_hook;
+
+    void on_gc_replica_log(const std::shared_ptr<gc_round> &round, gpid id) override
+    {
+        if (gc_replica_log_hook) {
+            gc_replica_log_hook(id);
+        }
+        replica_stub::on_gc_replica_log(round, id);
+    }
+
     rpc_address get_meta_server_address() const override { return rpc_address("127.0.0.2", 12321); }
 
     std::map<gpid, mock_replica *> mock_replicas;
@@ -353,6 +397,15 @@ public:
         _bulk_load_downloading_count.store(count);
     }
 
+    int32_t get_bulk_load_downloading_file_count() const
+    {
+        return _bulk_load_downloading_file_count.load();
+    }
+    void set_bulk_load_downloading_file_count(int32_t count)
+    {
+        _bulk_load_downloading_file_count.store(count);
+    }
+
     void set_rpc_address(const rpc_address &address) { _primary_address = address; }
 };
 
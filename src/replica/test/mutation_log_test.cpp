@@ -30,6 +30,13 @@
 #include <dsn/utility/filesystem.h>
 #include <gtest/gtest.h>
 
+namespace dsn {
+namespace replication {
+DSN_DECLARE_uint32(log_read_ahead_buffer_count);
+DSN_DECLARE_uint32(log_read_ahead_buffer_size_kb);
+} // namespace replication
+} // namespace dsn
+
 using namespace ::dsn;
 using namespace ::dsn::replication;
 
@@ -441,6 +448,22 @@ TEST_F(mutation_log_test, replay_single_file_1) { test_replay_single_file(1); }
 
 TEST_F(mutation_log_test, replay_single_file_10) { test_replay_single_file(10); }
 
+// the log blocks are much larger than the read-ahead buffers, and span several of them
+TEST_F(mutation_log_test, replay_single_file_with_small_read_ahead_buffers)
+{
+    uint32_t old_buffer_count = FLAGS_log_read_ahead_buffer_count;
+    uint32_t old_buffer_size_kb = FLAGS_log_read_ahead_buffer_size_kb;
+    for (uint32_t buffer_count : {1, 3}) {
+        FLAGS_log_read_ahead_buffer_count = buffer_count;
+        FLAGS_log_read_ahead_buffer_size_kb = 4;
+        utils::filesystem::remove_path(_log_dir);
+        utils::filesystem::create_directory(_log_dir);
+        test_replay_single_file(5000);
+    }
+    FLAGS_log_read_ahead_buffer_count = old_buffer_count;
+    FLAGS_log_read_ahead_buffer_size_kb = old_buffer_size_kb;
+}
+
 // mutation_log::open
 TEST_F(mutation_log_test, open)
 {
@@ -287,5 +287,29 @@ TEST_F(replica_disk_test, add_new_disk_test)
     }
 }
 
+TEST_F(replica_disk_test, allocate_dir_test)
+{
+    // all the mock dirs hold 3 replicas of app 1, and are of the same capacity, the dirs of more
+    // available space are preferred
+    remove_mock_dir_node("tag_empty_1");
+    auto &fs_manager = stub->_fs_manager;
+    auto nodes = get_dir_nodes();
+    std::string dir;
+
+    fs_manager.allocate_dir(gpid(app_info_1.app_id, 100), "replica", dir);
+    ASSERT_TRUE(nodes[4]->has(gpid(app_info_1.app_id, 100)));
+
+    // tag_4 is the busiest
+    nodes[3]->recent_io_bytes_per_sec = 100;
+    fs_manager.allocate_dir(gpid(app_info_1.app_id, 101), "replica", dir);
+    ASSERT_TRUE(nodes[2]->has(gpid(app_info_1.app_id, 101)));
+
+    // tag_3 is short of space
+    nodes[2]->status = disk_status::SPACE_INSUFFICIENT;
+    fs_manager.allocate_dir(gpid(app_info_1.app_id, 102), "replica", dir);
+    ASSERT_TRUE(nodes[4]->has(gpid(app_info_1.app_id, 102)));
+    nodes[2]->status = disk_status::NORMAL;
+}
+
 } // namespace replication
 } // namespace dsn
@@ -0,0 +1,180 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/utility/flags.h>
+#include <dsn/utility/synchronize.h>
+#include <dsn/tool-api/zlocks.h>
+
+#include "replica_test_base.h"
+
+namespace dsn {
+namespace replication {
+
+DSN_DECLARE_uint32(gc_max_concurrent_replica_count);
+
+class replica_stub_gc_test : public replica_stub_test_base
+{
+public:
+    void SetUp() override { _max_concurrent_count = FLAGS_gc_max_concurrent_replica_count; }
+
+    void TearDown() override { FLAGS_gc_max_concurrent_replica_count = _max_concurrent_count; }
+
+    void add_replicas(int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            stub->add_non_primary_replica(1, i);
+        }
+    }
+
+    // runs a round of gc, returns the replicas whose gc task ran
+    std::set<gpid> run_gc_round()
+    {
+        {
+            zauto_lock l(_lock);
+            _gc_replicas.clear();
+        }
+        stub->on_gc();
+        wait_gc_round();
+
+        zauto_lock l(_lock);
+        return _gc_replicas;
+    }
+
+    void wait_gc_round()
+    {
+        for (int i = 0; i < 1000 && stub->gc_running(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_FALSE(stub->gc_running());
+    }
+
+    void record_gc_replica(gpid id)
+    {
+        zauto_lock l(_lock);
+        ASSERT_TRUE(_gc_replicas.insert(id).second);
+    }
+
+    zlock _lock;
+    std::set<gpid> _gc_replicas;
+    uint32_t _max_concurrent_count;
+};
+
+TEST_F(replica_stub_gc_test, round_completed)
+{
+    // no replica
+    ASSERT_TRUE(run_gc_round().empty());
+
+    add_replicas(8);
+    stub->gc_replica_log_hook = [this](gpid id) { record_gc_replica(id); };
+    ASSERT_EQ(8, run_gc_round().size());
+
+    // the next round starts after the last one is completed
+    ASSERT_EQ(8, run_gc_round().size());
+}
+
+TEST_F(replica_stub_gc_test, concurrency_limited)
+{
+    FLAGS_gc_max_concurrent_replica_count = 3;
+    add_replicas(12);
+
+    std::atomic<int> running_count{0};
+    std::atomic<int> max_running_count{0};
+    stub->gc_replica_log_hook = [&](gpid id) {
+        int running = running_count.fetch_add(1) + 1;
+        int max_running = max_running_count.load();
+        while (running > max_running &&
+               !max_running_count.compare_exchange_weak(max_running, running)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        record_gc_replica(id);
+        // the next task is started once the condition is collected
+        running_count.fetch_sub(1);
+    };
+
+    ASSERT_EQ(12, run_gc_round().size());
+    ASSERT_GE(3, max_running_count.load());
+    ASSERT_LE(1, max_running_count.load());
+}
+
+TEST_F(replica_stub_gc_test, skip_round_while_running)
+{
+    FLAGS_gc_max_concurrent_replica_count = 1;
+    add_replicas(2);
+
+    utils::notify_event blocked;
+    utils::notify_event resumed;
+    std::atomic_bool first{true};
+    stub->gc_replica_log_hook = [&](gpid id) {
+        if (first.exchange(false)) {
+            blocked.notify();
+            resumed.wait();
+        }
+        record_gc_replica(id);
+    };
+    stub->on_gc();
+    blocked.wait();
+
+    // the round is still running, so this one is skipped
+    ASSERT_TRUE(stub->gc_running());
+    stub->on_gc();
+
+    resumed.notify();
+    wait_gc_round();
+    zauto_lock l(_lock);
+    ASSERT_EQ(2, _gc_replicas.size());
+}
+
+TEST_F(replica_stub_gc_test, replica_closed_during_round)
+{
+    FLAGS_gc_max_concurrent_replica_count = 1;
+    add_replicas(4);
+
+    // the first task of the round blocks until another replica of the round is closed
+    gpid closed;
+    utils::notify_event blocked;
+    utils::notify_event resumed;
+    std::atomic_bool first{true};
+    stub->gc_replica_log_hook = [&](gpid id) {
+        if (first.exchange(false)) {
+            closed = id.get_partition_index() == 0 ? gpid(1, 1) : gpid(1, 0);
+            blocked.notify();
+            resumed.wait();
+        }
+        record_gc_replica(id);
+    };
+
+    stub->on_gc();
+    blocked.wait();
+    stub->remove_replica(closed);
+    resumed.notify();
+    wait_gc_round();
+
+    // the closed replica is still held by the round, which is completed as usual
+    {
+        zauto_lock l(_lock);
+        ASSERT_EQ(4, _gc_replicas.size());
+        ASSERT_EQ(1, _gc_replicas.count(closed));
+    }
+
+    // and it's gone from the next round
+    auto replicas = run_gc_round();
+    ASSERT_EQ(3, replicas.size());
+    ASSERT_EQ(0, replicas.count(closed));
+}
+
+} // namespace replication
+} // namespace dsn
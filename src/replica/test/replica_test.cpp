@@ -19,6 +19,7 @@
 #include <dsn/utility/defer.h>
 #include <gtest/gtest.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/synchronize.h>
 #include "runtime/rpc/network.sim.h"
 
 #include "common/backup_common.h"
@@ -29,6 +30,8 @@
 namespace dsn {
 namespace replication {
 
+DEFINE_TASK_CODE(LPC_TEST_CONCURRENT_READ, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
 class replica_test : public replica_test_base
 {
 public:
@@ -63,6 +66,8 @@ public:
         return _mock_replica->_counter_backup_request_qps->get_integer_value();
     }
 
+    static bool is_concurrent_read() { return replica::is_concurrent_read(); }
+
     bool get_validate_partition_hash() const { return _mock_replica->_validate_partition_hash; }
 
     void reset_validate_partition_hash() { _mock_replica->_validate_partition_hash = false; }
@@ -274,6 +279,63 @@ TEST_F(replica_test, backup_request_qps)
     ASSERT_GT(get_table_level_backup_request_qps(), 0);
 }
 
+TEST_F(replica_test, concurrent_read_with_config_changed)
+{
+    struct dsn::message_header header;
+    std::unique_ptr<tools::sim_network_provider> sim_net(
+        new tools::sim_network_provider(nullptr, nullptr));
+    rpc_session_ptr session = sim_net->create_client_session(rpc_address());
+    auto create_read_request = [&]() {
+        message_ptr request = dsn::message_ex::create_request(task_code());
+        request->header = &header;
+        request->io_session = session;
+        return request;
+    };
+
+    _mock_replica->set_app_last_committed_decree(10);
+    _mock_replica->set_read_min_decree(5);
+
+    // the reads are served by the non-partitioned pool, while this thread changes the status and
+    // the min decree as the replication thread does
+    const int READ_COUNT = 2000;
+    std::vector<message_ptr> requests;
+    std::atomic<int> done_count{0};
+    utils::notify_event all_done;
+    for (int i = 0; i < READ_COUNT; ++i) {
+        requests.push_back(create_read_request());
+        message_ex *request = requests.back().get();
+        tasking::enqueue(LPC_TEST_CONCURRENT_READ, nullptr, [&, request]() {
+            EXPECT_TRUE(is_concurrent_read());
+            _mock_replica->on_client_read(request);
+            if (++done_count == READ_COUNT) {
+                all_done.notify();
+            }
+        });
+    }
+    for (int i = 0; done_count.load() < READ_COUNT; ++i) {
+        _mock_replica->set_partition_status(i % 3 == 0 ? partition_status::PS_SECONDARY
+                                                       : partition_status::PS_PRIMARY);
+        _mock_replica->set_read_min_decree(i % 2 == 0 ? 5 : 20);
+    }
+    all_done.wait();
+    int served_count = _mock_replica->get_app_request_count();
+    ASSERT_LE(served_count, READ_COUNT);
+
+    // the reads always see the latest published state once the configuration is stable
+    _mock_replica->set_partition_status(partition_status::PS_PRIMARY);
+    _mock_replica->set_read_min_decree(20);
+    _mock_replica->on_client_read(create_read_request());
+    ASSERT_EQ(served_count, _mock_replica->get_app_request_count());
+
+    _mock_replica->set_read_min_decree(5);
+    _mock_replica->on_client_read(create_read_request());
+    ASSERT_EQ(served_count + 1, _mock_replica->get_app_request_count());
+
+    _mock_replica->set_partition_status(partition_status::PS_SECONDARY);
+    _mock_replica->on_client_read(create_read_request());
+    ASSERT_EQ(served_count + 1, _mock_replica->get_app_request_count());
+}
+
 TEST_F(replica_test, query_data_version_test)
 {
     replica_http_service http_svc(stub.get());
@@ -29,6 +29,7 @@
 #include <dsn/toollet/tracer.h>
 #include <dsn/toollet/profiler.h>
 #include <dsn/toollet/fault_injector.h>
+#include <dsn/toollet/event_recorder.h>
 
 #include <dsn/tool/providers.common.h>
 
@@ -43,4 +44,5 @@ void dsn_core_init()
     dsn::tools::register_toollet<dsn::tools::tracer>("tracer");
     dsn::tools::register_toollet<dsn::tools::profiler>("profiler");
     dsn::tools::register_toollet<dsn::tools::fault_injector>("fault_injector");
+    dsn::tools::register_toollet<dsn::tools::event_recorder>("event_recorder");
 }
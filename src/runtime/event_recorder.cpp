@@ -0,0 +1,350 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/toollet/event_recorder.h>
+
+#include <atomic>
+#include <mutex>
+
+#include <dsn/tool-api/aio_task.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/process_utils.h>
+#include <fmt/format.h>
+
+namespace dsn {
+namespace tools {
+
+DSN_DEFINE_uint32("core",
+                  event_recorder_sample_one_in,
+                  1,
+                  "the event recorder records the events of 1 in N tasks/rpcs, 0 to stop");
+DSN_TAG_VARIABLE(event_recorder_sample_one_in, FT_MUTABLE);
+
+DSN_DEFINE_uint32("core",
+                  event_recorder_ring_size,
+                  32768,
+                  "count of the events kept by the event recorder per thread");
+
+namespace {
+
+// The events of a thread, written by the owner thread only.
+//
+// The readers copy the slots without synchronization with the writer, and drop the slots which
+// might have been overwritten during the copy by checking the head again afterwards.
+class event_ring
+{
+public:
+    event_ring(size_t capacity, int tid, std::string thread_name)
+        : _mask(capacity - 1),
+          _events(new trace_event[capacity]),
+          _tid(tid),
+          _thread_name(std::move(thread_name))
+    {
+    }
+
+    void push(const trace_event &e)
+    {
+        uint64_t head = _head.load(std::memory_order_relaxed);
+        _events[head & _mask] = e;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    thread_trace_events read(uint64_t since_ns) const
+    {
+        thread_trace_events result;
+        result.tid = _tid;
+        result.thread_name = _thread_name;
+
+        const uint64_t capacity = _mask + 1;
+        uint64_t head = _head.load(std::memory_order_acquire);
+        uint64_t start = head > capacity ? head - capacity : 0;
+        std::vector<trace_event> events;
+        events.reserve(head - start);
+        for (uint64_t i = start; i < head; ++i) {
+            events.push_back(_events[i & _mask]);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t new_head = _head.load(std::memory_order_relaxed);
+        // the slots before `new_head - capacity` may be overwritten while copying
+        uint64_t valid_start = new_head > capacity ? new_head - capacity : 0;
+        size_t skip = valid_start > start ? std::min(valid_start - start, head - start) : 0;
+        for (size_t i = skip; i < events.size(); ++i) {
+            if (events[i].ts_ns >= since_ns) {
+                result.events.push_back(events[i]);
+            }
+        }
+        return result;
+    }
+
+private:
+    const uint64_t _mask;
+    std::unique_ptr<trace_event[]> _events;
+    std::atomic<uint64_t> _head{0};
+    const int _tid;
+    const std::string _thread_name;
+};
+
+// The rings are kept after their threads exit, so that the events are still visible, and the
+// pointers held by the threads never dangle.
+std::mutex s_rings_lock;
+std::vector<std::unique_ptr<event_ring>> s_rings;
+
+__thread event_ring *tls_ring = nullptr;
+
+event_ring *get_ring()
+{
+    if (dsn_likely(tls_ring != nullptr)) {
+        return tls_ring;
+    }
+
+    size_t capacity = 1;
+    while (capacity < std::max(FLAGS_event_recorder_ring_size, 2u)) {
+        capacity <<= 1;
+    }
+    int tid = utils::get_current_tid();
+    task_worker *worker = task::get_current_worker2();
+    std::string name = worker != nullptr ? worker->name() : fmt::format("thread.{}", tid);
+
+    auto ring = make_unique<event_ring>(capacity, tid, std::move(name));
+    tls_ring = ring.get();
+    std::lock_guard<std::mutex> guard(s_rings_lock);
+    s_rings.emplace_back(std::move(ring));
+    return tls_ring;
+}
+
+inline bool is_sampled(uint64_t key)
+{
+    uint32_t one_in = FLAGS_event_recorder_sample_one_in;
+    if (one_in <= 1) {
+        return one_in == 1;
+    }
+    // mix the bits as the ids are sequential in the low bits
+    return ((key * 0x9E3779B97F4A7C15ULL) >> 32) % one_in == 0;
+}
+
+uint64_t trace_id_of(task *t)
+{
+    switch (t->spec().type) {
+    case TASK_TYPE_RPC_REQUEST:
+        return static_cast<rpc_request_task *>(t)->get_request()->header->trace_id;
+    case TASK_TYPE_RPC_RESPONSE:
+        return static_cast<rpc_response_task *>(t)->get_request()->header->trace_id;
+    default:
+        return 0;
+    }
+}
+
+void on_task_begin(task *t)
+{
+    event_recorder::record(trace_event_type::task_begin, t->spec().code, t->id(), trace_id_of(t));
+}
+
+void on_task_end(task *t)
+{
+    event_recorder::record(trace_event_type::task_end, t->spec().code, t->id(), trace_id_of(t));
+}
+
+void on_aio_call(task *caller, aio_task *callee)
+{
+    event_recorder::record(trace_event_type::aio_call, callee->spec().code, callee->id(), 0);
+}
+
+void on_aio_enqueue(aio_task *t)
+{
+    event_recorder::record(trace_event_type::aio_complete, t->spec().code, t->id(), 0);
+}
+
+void on_rpc_call(task *caller, message_ex *req, rpc_response_task *callee)
+{
+    event_recorder::record(trace_event_type::rpc_call,
+                           req->local_rpc_code,
+                           callee != nullptr ? callee->id() : 0,
+                           req->header->trace_id);
+}
+
+void on_rpc_response_enqueue(rpc_response_task *resp)
+{
+    // recorded with the request code, to be paired with the rpc_call event
+    message_ex *req = resp->get_request();
+    event_recorder::record(trace_event_type::rpc_response_enqueue,
+                           req->local_rpc_code,
+                           resp->id(),
+                           req->header->trace_id);
+}
+
+void on_rpc_request_enqueue(rpc_request_task *t)
+{
+    event_recorder::record(trace_event_type::rpc_request_enqueue,
+                           t->spec().code,
+                           t->id(),
+                           t->get_request()->header->trace_id);
+}
+
+void on_rpc_reply(task *caller, message_ex *msg)
+{
+    // recorded with the request code, to be paired with the rpc_request_enqueue event
+    int32_t code = caller != nullptr ? caller->spec().code.code() : msg->local_rpc_code.code();
+    event_recorder::record(trace_event_type::rpc_reply,
+                           code,
+                           caller != nullptr ? caller->id() : 0,
+                           msg->header->trace_id);
+}
+
+const char *phase_of(trace_event_type type)
+{
+    switch (type) {
+    case trace_event_type::task_begin:
+        return "B";
+    case trace_event_type::task_end:
+        return "E";
+    case trace_event_type::rpc_call:
+    case trace_event_type::rpc_request_enqueue:
+    case trace_event_type::aio_call:
+        return "b";
+    default:
+        return "e";
+    }
+}
+
+const char *category_of(trace_event_type type)
+{
+    switch (type) {
+    case trace_event_type::task_begin:
+    case trace_event_type::task_end:
+        return "task";
+    case trace_event_type::rpc_call:
+    case trace_event_type::rpc_response_enqueue:
+        return "rpc.client";
+    case trace_event_type::rpc_request_enqueue:
+    case trace_event_type::rpc_reply:
+        return "rpc.server";
+    default:
+        return "aio";
+    }
+}
+
+} // anonymous namespace
+
+event_recorder::event_recorder(const char *name) : toollet(name) {}
+
+void event_recorder::install(service_spec &spec)
+{
+    for (int i = 0; i <= dsn::task_code::max(); i++) {
+        if (i == TASK_CODE_INVALID) {
+            continue;
+        }
+
+        task_spec *spec = task_spec::get(i);
+        dassert(spec != nullptr, "task_spec cannot be null");
+
+        spec->on_task_begin.put_back(on_task_begin, "event_recorder");
+        spec->on_task_end.put_back(on_task_end, "event_recorder");
+        spec->on_aio_call.put_back(on_aio_call, "event_recorder");
+        spec->on_aio_enqueue.put_back(on_aio_enqueue, "event_recorder");
+        spec->on_rpc_call.put_back(on_rpc_call, "event_recorder");
+        spec->on_rpc_response_enqueue.put_back(on_rpc_response_enqueue, "event_recorder");
+        spec->on_rpc_request_enqueue.put_back(on_rpc_request_enqueue, "event_recorder");
+        spec->on_rpc_reply.put_back(on_rpc_reply, "event_recorder");
+    }
+}
+
+/*static*/ void
+event_recorder::record(trace_event_type type, int32_t code, uint64_t id, uint64_t trace_id)
+{
+    // sample by the trace id if any, so that all the events of an rpc are sampled together
+    if (!is_sampled(trace_id != 0 ? trace_id : id)) {
+        return;
+    }
+
+    trace_event e;
+    e.ts_ns = dsn_now_ns();
+    e.id = id;
+    e.trace_id = trace_id;
+    e.code = code;
+    e.type = type;
+    get_ring()->push(e);
+}
+
+/*static*/ std::vector<thread_trace_events> event_recorder::snapshot(uint64_t duration_ms)
+{
+    uint64_t now_ns = dsn_now_ns();
+    uint64_t since_ns = now_ns > duration_ms * 1000000 ? now_ns - duration_ms * 1000000 : 0;
+
+    std::vector<event_ring *> rings;
+    {
+        std::lock_guard<std::mutex> guard(s_rings_lock);
+        for (const auto &ring : s_rings) {
+            rings.push_back(ring.get());
+        }
+    }
+
+    std::vector<thread_trace_events> result;
+    for (event_ring *ring : rings) {
+        thread_trace_events events = ring->read(since_ns);
+        if (!events.events.empty()) {
+            result.emplace_back(std::move(events));
+        }
+    }
+    return result;
+}
+
+/*static*/ void event_recorder::append_chrome_trace(const thread_trace_events &events,
+                                                    /*inout*/ bool &first,
+                                                    /*out*/ std::string &out)
+{
+    auto append_separator = [&first, &out]() {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+    };
+
+    append_separator();
+    out += fmt::format(
+        R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+        events.tid,
+        events.thread_name);
+
+    for (const trace_event &e : events.events) {
+        append_separator();
+        out += fmt::format(R"({{"name":"{}","cat":"{}","ph":"{}","ts":{:.3f},"pid":1,"tid":{})",
+                           task_code(e.code).to_string(),
+                           category_of(e.type),
+                           phase_of(e.type),
+                           e.ts_ns / 1000.0,
+                           events.tid);
+        switch (e.type) {
+        case trace_event_type::task_begin:
+        case trace_event_type::task_end:
+            break;
+        case trace_event_type::aio_call:
+        case trace_event_type::aio_complete:
+            // the async events are paired by category, name and id
+            out += fmt::format(R"(,"id":"{:#x}")", e.id);
+            break;
+        default:
+            out += fmt::format(R"(,"id":"{:#x}")", e.trace_id);
+            break;
+        }
+        out += fmt::format(
+            R"(,"args":{{"task_id":"{:#x}","trace_id":"{:#x}"}}}})", e.id, e.trace_id);
+    }
+}
+
+} // namespace tools
+} // namespace dsn
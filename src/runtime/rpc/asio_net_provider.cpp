@@ -405,10 +405,12 @@ error_code asio_udp_provider::start(rpc_channel channel, int port, bool client_o
     return ERR_OK;
 }
 
-// use a round-robin scheme to choose the next io_service to use.
+// use a round-robin scheme to choose the next io_service to use, so that the sessions, including
+// the parallel ones to the same peer, are spread evenly over the io_service threads.
 boost::asio::io_service &asio_network_provider::get_io_service()
 {
-    return *_io_services[rand::next_u32(0, FLAGS_io_service_worker_count - 1)];
+    uint32_t index = _next_io_service.fetch_add(1, std::memory_order_relaxed);
+    return *_io_services[index % _io_services.size()];
 }
 
 } // namespace tools
@@ -76,6 +76,7 @@ private:
 
     std::shared_ptr<boost::asio::ip::tcp::acceptor> _acceptor;
     std::vector<std::unique_ptr<boost::asio::io_service>> _io_services;
+    std::atomic<uint32_t> _next_io_service{0};
     std::vector<std::shared_ptr<std::thread>> _workers;
     ::dsn::rpc_address _address;
 };
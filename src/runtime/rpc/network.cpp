@@ -33,6 +33,13 @@
 #include <dsn/dist/fmt_logging.h>
 
 namespace dsn {
+DSN_DEFINE_uint32("network",
+                  client_sessions_per_peer,
+                  1,
+                  "count of the client sessions to a remote address for the rpc calls of "
+                  "TC_DEFAULT traffic class, which are chosen by the thread hash of the requests");
+DSN_DEFINE_validator(client_sessions_per_peer, [](uint32_t value) -> bool { return value > 0; });
+
 /*static*/ join_point<void, rpc_session *>
     rpc_session::on_rpc_session_connected("rpc.session.connected");
 /*static*/ join_point<void, rpc_session *>
@@ -249,6 +256,12 @@ int rpc_session::prepare_parser()
     return 0;
 }
 
+int rpc_session::pending_send_count() const
+{
+    utils::auto_lock<utils::ex_lock_nr> l(_lock);
+    return _message_count + static_cast<int>(_sending_msgs.size());
+}
+
 void rpc_session::send_message(message_ex *msg)
 {
     msg->add_ref(); // released in on_send_completed
@@ -590,6 +603,9 @@ connection_oriented_network::connection_oriented_network(rpc_engine *srv, networ
     : network(srv, inner_provider)
 {
     _cfg_conn_threshold_per_ip = 0;
+    for (int tc = 0; tc < TC_COUNT; ++tc) {
+        _clients[tc].resize(tc == TC_DEFAULT ? FLAGS_client_sessions_per_peer : 1);
+    }
     _client_session_count.init_global_counter("server",
                                               "network",
                                               "client_session_count",
@@ -606,9 +622,11 @@ void connection_oriented_network::inject_drop_message(message_ex *msg, bool is_s
         //   normal (not forwarding) reply message from server to client, in which case
         //   the io_session has also been set.
         dassert(is_send, "received message should always has io_session set");
+        rpc_traffic_class_t tc = traffic_class_of(msg);
+        const auto &clients = _clients[tc][lane_of(msg, tc)];
         utils::auto_read_lock l(_clients_lock);
-        auto it = _clients.find(msg->to_address);
-        if (it != _clients.end()) {
+        auto it = clients.find(msg->to_address);
+        if (it != clients.end()) {
             s = it->second;
         }
     }
@@ -618,16 +636,45 @@ void connection_oriented_network::inject_drop_message(message_ex *msg, bool is_s
     }
 }
 
+/*static*/ rpc_traffic_class_t connection_oriented_network::traffic_class_of(message_ex *request)
+{
+    task_spec *spec = task_spec::get(request->local_rpc_code);
+    return spec != nullptr ? spec->rpc_traffic_class : TC_DEFAULT;
+}
+
+uint32_t connection_oriented_network::lane_of(message_ex *request, rpc_traffic_class_t tc) const
+{
+    const auto &lanes = _clients[tc];
+    if (lanes.size() == 1) {
+        return 0;
+    }
+    return static_cast<uint32_t>(request->header->client.thread_hash) % lanes.size();
+}
+
+int connection_oriented_network::client_session_count() const
+{
+    size_t count = 0;
+    for (const auto &lanes : _clients) {
+        for (const auto &clients : lanes) {
+            count += clients.size();
+        }
+    }
+    return (int)count;
+}
+
 void connection_oriented_network::send_message(message_ex *request)
 {
     rpc_session_ptr client = nullptr;
     auto &to = request->to_address;
+    rpc_traffic_class_t tc = traffic_class_of(request);
+    uint32_t lane = lane_of(request, tc);
+    auto &clients = _clients[tc][lane];
 
     // TODO: thread-local client ptr cache
     {
         utils::auto_read_lock l(_clients_lock);
-        auto it = _clients.find(to);
-        if (it != _clients.end()) {
+        auto it = clients.find(to);
+        if (it != clients.end()) {
             client = it->second;
         }
     }
@@ -636,21 +683,25 @@ void connection_oriented_network::send_message(message_ex *request)
     bool new_client = false;
     if (nullptr == client.get()) {
         utils::auto_write_lock l(_clients_lock);
-        auto it = _clients.find(to);
-        if (it != _clients.end()) {
+        auto it = clients.find(to);
+        if (it != clients.end()) {
             client = it->second;
         } else {
             client = create_client_session(to);
-            _clients.insert(client_sessions::value_type(to, client));
+            client->set_client_lane(tc, lane);
+            clients.insert(client_sessions::value_type(to, client));
             new_client = true;
         }
-        ip_count = (int)_clients.size();
+        ip_count = client_session_count();
     }
 
     // init connection if necessary
     if (new_client) {
-        ddebug("client session created, remote_server = %s, current_count = %d",
+        ddebug("client session created, remote_server = %s, traffic_class = %s, lane = %u, "
+               "current_count = %d",
                client->remote_address().to_string(),
+               enum_to_string(tc),
+               lane,
                ip_count);
         _client_session_count->set(ip_count);
         client->connect();
@@ -786,12 +837,13 @@ void connection_oriented_network::on_client_session_connected(rpc_session_ptr &s
     int ip_count = 0;
     bool r = false;
     {
+        const auto &clients = _clients[s->traffic_class()][s->lane()];
         utils::auto_read_lock l(_clients_lock);
-        auto it = _clients.find(s->remote_address());
-        if (it != _clients.end() && it->second.get() == s.get()) {
+        auto it = clients.find(s->remote_address());
+        if (it != clients.end() && it->second.get() == s.get()) {
             r = true;
         }
-        ip_count = (int)_clients.size();
+        ip_count = client_session_count();
     }
 
     if (r) {
@@ -807,13 +859,14 @@ void connection_oriented_network::on_client_session_disconnected(rpc_session_ptr
     int ip_count = 0;
     bool r = false;
     {
+        auto &clients = _clients[s->traffic_class()][s->lane()];
         utils::auto_write_lock l(_clients_lock);
-        auto it = _clients.find(s->remote_address());
-        if (it != _clients.end() && it->second.get() == s.get()) {
-            _clients.erase(it);
+        auto it = clients.find(s->remote_address());
+        if (it != clients.end() && it->second.get() == s.get()) {
+            clients.erase(it);
             r = true;
         }
-        ip_count = (int)_clients.size();
+        ip_count = client_session_count();
     }
 
     if (r) {
@@ -145,8 +145,10 @@ task_spec::task_spec(int code,
       rpc_request_is_write_idempotent(false),
       priority(pri),
       pool_code(pool),
+      disk_io_class(IOC_FOREGROUND),
       rpc_call_header_format(NET_HDR_DSN),
       rpc_call_channel(RPC_CHANNEL_TCP),
+      rpc_traffic_class(TC_DEFAULT),
       rpc_message_crc_required(false),
       on_task_create((std::string(name) + std::string(".create")).c_str()),
       on_task_enqueue((std::string(name) + std::string(".enqueue")).c_str()),
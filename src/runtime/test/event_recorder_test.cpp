@@ -0,0 +1,136 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <thread>
+
+#include <dsn/toollet/event_recorder.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/process_utils.h>
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace tools {
+
+DSN_DECLARE_uint32(event_recorder_sample_one_in);
+DSN_DECLARE_uint32(event_recorder_ring_size);
+
+DEFINE_TASK_CODE(LPC_EVENT_RECORDER_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+// Records `count` pairs of task_begin/task_end events in a new thread, returns its tid.
+static int record_in_new_thread(uint64_t count)
+{
+    int tid = 0;
+    std::thread t([&tid, count]() {
+        tid = utils::get_current_tid();
+        for (uint64_t i = 1; i <= count; ++i) {
+            event_recorder::record(trace_event_type::task_begin, LPC_EVENT_RECORDER_TEST, i, 0);
+            event_recorder::record(trace_event_type::task_end, LPC_EVENT_RECORDER_TEST, i, 0);
+        }
+    });
+    t.join();
+    return tid;
+}
+
+static const thread_trace_events *find_thread(const std::vector<thread_trace_events> &threads,
+                                              int tid)
+{
+    for (const auto &t : threads) {
+        if (t.tid == tid) {
+            return &t;
+        }
+    }
+    return nullptr;
+}
+
+TEST(event_recorder_test, record_and_snapshot)
+{
+    int tid = record_in_new_thread(10);
+    auto threads = event_recorder::snapshot(60 * 1000);
+    const thread_trace_events *events = find_thread(threads, tid);
+    ASSERT_NE(nullptr, events);
+    ASSERT_EQ(fmt::format("thread.{}", tid), events->thread_name);
+    ASSERT_EQ(20, events->events.size());
+    for (size_t i = 0; i < events->events.size(); ++i) {
+        const trace_event &e = events->events[i];
+        ASSERT_EQ(i / 2 + 1, e.id);
+        ASSERT_EQ(i % 2 == 0 ? trace_event_type::task_begin : trace_event_type::task_end, e.type);
+        ASSERT_EQ(LPC_EVENT_RECORDER_TEST.code(), e.code);
+        if (i > 0) {
+            ASSERT_LE(events->events[i - 1].ts_ns, e.ts_ns);
+        }
+    }
+}
+
+TEST(event_recorder_test, ring_overwritten)
+{
+    // the oldest events are dropped once the ring is full
+    int tid = record_in_new_thread(FLAGS_event_recorder_ring_size);
+    auto threads = event_recorder::snapshot(60 * 1000);
+    const thread_trace_events *events = find_thread(threads, tid);
+    ASSERT_NE(nullptr, events);
+    ASSERT_EQ(FLAGS_event_recorder_ring_size, events->events.size());
+    ASSERT_EQ(FLAGS_event_recorder_ring_size / 2 + 1, events->events.front().id);
+    ASSERT_EQ(FLAGS_event_recorder_ring_size, events->events.back().id);
+}
+
+TEST(event_recorder_test, sampling)
+{
+    FLAGS_event_recorder_sample_one_in = 0;
+    int tid = record_in_new_thread(100);
+    ASSERT_EQ(nullptr, find_thread(event_recorder::snapshot(60 * 1000), tid));
+
+    FLAGS_event_recorder_sample_one_in = 4;
+    tid = record_in_new_thread(1000);
+    auto threads = event_recorder::snapshot(60 * 1000);
+    const thread_trace_events *events = find_thread(threads, tid);
+    ASSERT_NE(nullptr, events);
+    // both the begin and end events of a sampled task are recorded
+    ASSERT_EQ(0, events->events.size() % 2);
+    ASSERT_GT(events->events.size(), 2 * 1000 / 8);
+    ASSERT_LT(events->events.size(), 2 * 1000 / 2);
+
+    FLAGS_event_recorder_sample_one_in = 1;
+}
+
+TEST(event_recorder_test, chrome_trace)
+{
+    thread_trace_events events;
+    events.tid = 123;
+    events.thread_name = "THREAD_POOL_DEFAULT0";
+    events.events.push_back({1000, 1, 0, LPC_EVENT_RECORDER_TEST, trace_event_type::task_begin});
+    events.events.push_back({2500, 1, 0, LPC_EVENT_RECORDER_TEST, trace_event_type::task_end});
+    events.events.push_back({3000, 2, 0, LPC_EVENT_RECORDER_TEST, trace_event_type::aio_call});
+
+    bool first = true;
+    std::string out;
+    event_recorder::append_chrome_trace(events, first, out);
+    ASSERT_FALSE(first);
+    ASSERT_EQ(
+        R"({"name":"thread_name","ph":"M","pid":1,"tid":123,)"
+        R"("args":{"name":"THREAD_POOL_DEFAULT0"}},)"
+        R"({"name":"LPC_EVENT_RECORDER_TEST","cat":"task","ph":"B","ts":1.000,"pid":1,"tid":123,)"
+        R"("args":{"task_id":"0x1","trace_id":"0x0"}},)"
+        R"({"name":"LPC_EVENT_RECORDER_TEST","cat":"task","ph":"E","ts":2.500,"pid":1,"tid":123,)"
+        R"("args":{"task_id":"0x1","trace_id":"0x0"}},)"
+        R"({"name":"LPC_EVENT_RECORDER_TEST","cat":"aio","ph":"b","ts":3.000,"pid":1,"tid":123,)"
+        R"("id":"0x2","args":{"task_id":"0x2","trace_id":"0x0"}})",
+        out);
+}
+
+} // namespace tools
+} // namespace dsn
@@ -52,6 +52,10 @@
 using namespace dsn;
 using namespace dsn::tools;
 
+namespace dsn {
+DSN_DECLARE_uint32(client_sessions_per_peer);
+}
+
 class asio_network_provider_test : public asio_network_provider
 {
 public:
@@ -69,8 +73,28 @@ public:
     }
 };
 
+class sim_network_provider_test : public sim_network_provider
+{
+public:
+    sim_network_provider_test(rpc_engine *srv, network *inner_provider)
+        : sim_network_provider(srv, inner_provider)
+    {
+    }
+
+    size_t client_session_count(rpc_traffic_class_t tc)
+    {
+        utils::auto_read_lock l(_clients_lock);
+        size_t count = 0;
+        for (const auto &clients : _clients[tc]) {
+            count += clients.size();
+        }
+        return count;
+    }
+};
+
 static int TEST_PORT = 20401;
 DEFINE_TASK_CODE_RPC(RPC_TEST_NETPROVIDER, TASK_PRIORITY_COMMON, THREAD_POOL_TEST_SERVER)
+DEFINE_TASK_CODE_RPC(RPC_TEST_NETPROVIDER_BULK, TASK_PRIORITY_COMMON, THREAD_POOL_TEST_SERVER)
 
 volatile int wait_flag = 0;
 void response_handler(dsn::error_code ec,
@@ -306,3 +330,56 @@ TEST(tools_common, asio_network_provider_connection_threshold)
 
     TEST_PORT++;
 }
+
+TEST(tools_common, traffic_class_sessions)
+{
+    if (dsn::service_engine::instance().spec().semaphore_factory_name ==
+        "dsn::tools::sim_semaphore_provider")
+        return;
+
+    ASSERT_TRUE(dsn_rpc_register_handler(
+        RPC_TEST_NETPROVIDER, "rpc.test.netprovider", rpc_server_response));
+    ASSERT_TRUE(dsn_rpc_register_handler(
+        RPC_TEST_NETPROVIDER_BULK, "rpc.test.netprovider.bulk", rpc_server_response));
+    task_spec::get(RPC_TEST_NETPROVIDER_BULK)->rpc_traffic_class = TC_BULK;
+
+    FLAGS_client_sessions_per_peer = 2;
+    std::unique_ptr<sim_network_provider_test> sim_net(
+        new sim_network_provider_test(task::get_current_rpc(), nullptr));
+    FLAGS_client_sessions_per_peer = 1;
+    ASSERT_EQ(ERR_OK, sim_net->start(RPC_CHANNEL_TCP, TEST_PORT, false));
+
+    // the requests to the same server are sent through a session per traffic class, and the
+    // ones of TC_DEFAULT are spread over 2 sessions by their thread hash
+    for (int thread_hash = 0; thread_hash < 4; ++thread_hash) {
+        for (task_code code : {RPC_TEST_NETPROVIDER, RPC_TEST_NETPROVIDER_BULK}) {
+            message_ex *msg = message_ex::create_request(code, 0, thread_hash);
+            msg->to_address = rpc_address("localhost", TEST_PORT);
+            std::unique_ptr<char[]> buf(new char[128]);
+            memset(buf.get(), 0, 128);
+            strcpy(buf.get(), "hello world");
+            ::dsn::marshall(msg, std::string(buf.get()));
+
+            wait_flag = 0;
+            rpc_response_task *t = new rpc_response_task(msg,
+                                                         std::bind(&response_handler,
+                                                                   std::placeholders::_1,
+                                                                   std::placeholders::_2,
+                                                                   std::placeholders::_3,
+                                                                   buf.get()),
+                                                         0);
+            sim_net->engine()->matcher()->on_call(msg, t);
+            sim_net->send_message(msg);
+            wait_response();
+        }
+    }
+    ASSERT_EQ(0, sim_net->client_session_count(TC_CONTROL));
+    ASSERT_EQ(2, sim_net->client_session_count(TC_DEFAULT));
+    ASSERT_EQ(1, sim_net->client_session_count(TC_BULK));
+
+    task_spec::get(RPC_TEST_NETPROVIDER_BULK)->rpc_traffic_class = TC_DEFAULT;
+    ASSERT_TRUE(dsn_rpc_unregiser_handler(RPC_TEST_NETPROVIDER));
+    ASSERT_TRUE(dsn_rpc_unregiser_handler(RPC_TEST_NETPROVIDER_BULK));
+
+    TEST_PORT++;
+}
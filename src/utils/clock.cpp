@@ -18,20 +18,187 @@
 #include <dsn/utility/clock.h>
 #include <dsn/utils/time_utils.h>
 #include <dsn/utility/dlib.h>
+#include <dsn/utility/flags.h>
 #include <dsn/utility/smart_pointers.h>
 
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
 DSN_API uint64_t dsn_now_ns() { return dsn::utils::clock::instance()->now_ns(); }
 
 namespace dsn {
 namespace utils {
 
+DSN_DEFINE_bool("core",
+                enable_tsc_clock,
+                false,
+                "whether to read the time from the invariant TSC instead of the system clock, "
+                "ignored if the cpu doesn't support");
+DSN_DEFINE_uint32("core",
+                  tsc_clock_resync_interval_ms,
+                  1000,
+                  "interval to re-synchronize the TSC clock to the system clock");
+
 std::unique_ptr<clock> clock::_clock = make_unique<clock>();
 
 const clock *clock::instance() { return _clock.get(); }
 
-uint64_t clock::now_ns() const { return get_current_physical_time_ns(); }
+uint64_t clock::now_ns() const
+{
+    if (FLAGS_enable_tsc_clock && tsc_clock::available()) {
+        return tsc_clock::now_ns();
+    }
+    return get_current_physical_time_ns();
+}
 
 void clock::mock(clock *mock_clock) { _clock.reset(mock_clock); }
 
+namespace {
+
+inline uint64_t read_tsc()
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+bool has_invariant_tsc()
+{
+#if defined(__x86_64__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// The conversion from the ticks into the time, as
+//   ns = ns_base + ((tsc - tsc_base) * mult >> 32)
+// where (tsc_base, ns_base) is the last point sampled from both clocks.
+//
+// It's re-synchronized by whichever thread finds it out of date, while being read by all the
+// others, so it's published through a seqlock. The readers never wait for the writer, they fall
+// back to the system clock instead.
+class tsc_calibration
+{
+public:
+    tsc_calibration()
+    {
+        // spin for a few milliseconds to get the initial rate
+        uint64_t tsc = read_tsc();
+        uint64_t ns = get_current_physical_time_ns();
+        uint64_t now_tsc, now_ns;
+        do {
+            now_tsc = read_tsc();
+            now_ns = get_current_physical_time_ns();
+        } while (now_ns - ns < kInitialCalibrationNs);
+
+        _mult.store(calc_mult(now_ns - ns, std::max<uint64_t>(now_tsc - tsc, 1)),
+                    std::memory_order_relaxed);
+        _tsc_base.store(now_tsc, std::memory_order_relaxed);
+        _ns_base.store(now_ns, std::memory_order_relaxed);
+        _seq.store(0, std::memory_order_release);
+    }
+
+    uint64_t now_ns()
+    {
+        while (true) {
+            uint64_t seq = _seq.load(std::memory_order_acquire);
+            if (seq & 1) {
+                return get_current_physical_time_ns();
+            }
+            uint64_t tsc_base = _tsc_base.load(std::memory_order_relaxed);
+            uint64_t ns_base = _ns_base.load(std::memory_order_relaxed);
+            uint64_t mult = _mult.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_seq.load(std::memory_order_relaxed) != seq) {
+                continue;
+            }
+
+            uint64_t tsc = read_tsc();
+            // the TSCs of the cores may differ slightly, never go before the base
+            uint64_t delta = tsc > tsc_base ? tsc - tsc_base : 0;
+            uint64_t delta_ns =
+                static_cast<uint64_t>((static_cast<__uint128_t>(delta) * mult) >> 32);
+            if (delta_ns >= FLAGS_tsc_clock_resync_interval_ms * 1000000) {
+                if (!resync(seq, tsc_base, ns_base, mult)) {
+                    return get_current_physical_time_ns();
+                }
+                continue;
+            }
+            return ns_base + delta_ns;
+        }
+    }
+
+private:
+    // The shift is done in 128 bits, as `ns` exceeds 32 bits once a few seconds pass without
+    // being re-synchronized.
+    static uint64_t calc_mult(uint64_t ns, uint64_t ticks)
+    {
+        return static_cast<uint64_t>((static_cast<__uint128_t>(ns) << 32) / ticks);
+    }
+
+    bool resync(uint64_t seq, uint64_t tsc_base, uint64_t ns_base, uint64_t mult)
+    {
+        if (!_seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+            return false;
+        }
+        // the readers must see the odd sequence before any of the new values
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint64_t tsc = read_tsc();
+        uint64_t ns = get_current_physical_time_ns();
+        // take the rate over the last interval, unless the system clock has been stepped, e.g.,
+        // by ntp, in which case only the base is moved
+        if (ns > ns_base && tsc > tsc_base) {
+            uint64_t new_mult = calc_mult(ns - ns_base, tsc - tsc_base);
+            if (new_mult > mult - mult / 100 && new_mult < mult + mult / 100) {
+                mult = new_mult;
+            }
+        }
+
+        _mult.store(mult, std::memory_order_relaxed);
+        _tsc_base.store(tsc, std::memory_order_relaxed);
+        _ns_base.store(ns, std::memory_order_relaxed);
+        _seq.store(seq + 2, std::memory_order_release);
+        return true;
+    }
+
+    static const uint64_t kInitialCalibrationNs = 10000000;
+
+    // odd while being updated
+    std::atomic<uint64_t> _seq{1};
+    std::atomic<uint64_t> _tsc_base{0};
+    std::atomic<uint64_t> _ns_base{0};
+    std::atomic<uint64_t> _mult{0};
+};
+
+tsc_calibration &calibration()
+{
+    static tsc_calibration c;
+    return c;
+}
+
+} // anonymous namespace
+
+/*static*/ bool tsc_clock::available()
+{
+    static const bool available = has_invariant_tsc();
+    return available;
+}
+
+/*static*/ uint64_t tsc_clock::now_ns() { return calibration().now_ns(); }
+
 } // namespace utils
 } // namespace dsn
@@ -0,0 +1,143 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <fmt/ostream.h>
+
+#include <dsn/c/api_layer1.h>
+#include <dsn/utility/clock.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/string_conv.h>
+#include <dsn/utils/time_utils.h>
+
+namespace dsn {
+namespace utils {
+DSN_DECLARE_bool(enable_tsc_clock);
+} // namespace utils
+} // namespace dsn
+
+void print_usage(const char *cmd)
+{
+    fmt::print(stderr, "USAGE: {} <num_operations> <num_threads>\n", cmd);
+    fmt::print(stderr, "Run a simple benchmark that measures the cost per call of each clock.\n\n");
+
+    fmt::print(stderr,
+               "    <num_operations>       the number of calls executed by each thread\n");
+    fmt::print(stderr, "    <num_threads>          the number of threads\n");
+}
+
+uint64_t clock_gettime_ns(clockid_t clock_id)
+{
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void run_bench(int64_t num_operations,
+               int64_t num_threads,
+               const char *name,
+               const std::function<uint64_t()> &now)
+{
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> sums(num_threads, 0);
+
+    uint64_t start = dsn::utils::get_current_physical_time_ns();
+    for (int64_t i = 0; i < num_threads; i++) {
+        threads.emplace_back([num_operations, &now, &sums, i]() {
+            uint64_t sum = 0;
+            for (int64_t j = 0; j < num_operations; ++j) {
+                sum += now();
+            }
+            // keep the calls from being optimized away
+            sums[i] = sum;
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    uint64_t end = dsn::utils::get_current_physical_time_ns();
+
+    fmt::print(stdout,
+               "Running {} calls of {} with {} threads took {} ms, {:.2f} ns per call.\n",
+               num_operations,
+               name,
+               num_threads,
+               (end - start) / 1000000,
+               static_cast<double>(end - start) / num_operations);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    int64_t num_operations;
+    if (!dsn::buf2int64(argv[1], num_operations) || num_operations <= 0) {
+        fmt::print(stderr, "Invalid num_operations: {}\n\n", argv[1]);
+
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    int64_t num_threads;
+    if (!dsn::buf2int64(argv[2], num_threads) || num_threads <= 0) {
+        fmt::print(stderr, "Invalid num_threads: {}\n\n", argv[2]);
+
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    run_bench(num_operations, num_threads, "clock_gettime(CLOCK_MONOTONIC)", []() {
+        return clock_gettime_ns(CLOCK_MONOTONIC);
+    });
+    run_bench(num_operations, num_threads, "clock_gettime(CLOCK_REALTIME_COARSE)", []() {
+        return clock_gettime_ns(CLOCK_REALTIME_COARSE);
+    });
+    run_bench(num_operations, num_threads, "get_current_physical_time_ns", []() {
+        return dsn::utils::get_current_physical_time_ns();
+    });
+
+    dsn::utils::FLAGS_enable_tsc_clock = false;
+    run_bench(num_operations, num_threads, "dsn_now_ns (system clock)", []() {
+        return dsn_now_ns();
+    });
+
+    if (!dsn::utils::tsc_clock::available()) {
+        fmt::print(stdout, "The cpu has no invariant TSC, skip the TSC clock.\n");
+        return 0;
+    }
+    run_bench(num_operations, num_threads, "tsc_clock::now_ns", []() {
+        return dsn::utils::tsc_clock::now_ns();
+    });
+    dsn::utils::FLAGS_enable_tsc_clock = true;
+    run_bench(num_operations, num_threads, "dsn_now_ns (tsc clock)", []() {
+        return dsn_now_ns();
+    });
+
+    return 0;
+}
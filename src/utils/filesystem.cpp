@@ -762,11 +762,7 @@ error_code md5sum(const std::string &file_path, /*out*/ std::string &result)
     fclose(fp);
     MD5_Final(out, &c);
 
-    char str[MD5_DIGEST_LENGTH * 2 + 1];
-    str[MD5_DIGEST_LENGTH * 2] = 0;
-    for (int n = 0; n < MD5_DIGEST_LENGTH; n++)
-        sprintf(str + n + n, "%02x", out[n]);
-    result.assign(str);
+    result = md5_digest_to_hex(out);
 
     return ERR_OK;
 }
@@ -22,6 +22,8 @@
 #include <dsn/utility/config_api.h>
 #include <dsn/utility/flags.h>
 
+#include <algorithm>
+#include <deque>
 #include <utility>
 #include "lockp.std.h"
 #include "shared_io_service.h"
@@ -51,9 +53,108 @@ std::unordered_map<std::string, perf_counter_ptr> counters_trace_latency;
 // }
 
 utils::rw_lock_nr task_code_lock; //{
-std::unordered_map<std::string, bool> task_codes;
+std::unordered_map<int, bool> task_codes;
 // }
 
+namespace {
+
+// stages are rarely added after warming up, the count is limited in case a caller passes
+// unbounded messages
+const latency_stage_id MAX_STAGES = 8192;
+
+struct string_view_hash
+{
+    size_t operator()(string_view s) const
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : s) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+class latency_stage_registry
+{
+public:
+    static latency_stage_registry &instance()
+    {
+        static latency_stage_registry registry;
+        return registry;
+    }
+
+    latency_stage_id get_or_register(string_view name)
+    {
+        {
+            utils::auto_read_lock read(_lock);
+            auto iter = _ids.find(name);
+            if (iter != _ids.end()) {
+                return iter->second;
+            }
+        }
+
+        utils::auto_write_lock write(_lock);
+        auto iter = _ids.find(name);
+        if (iter != _ids.end()) {
+            return iter->second;
+        }
+        if (_names.size() >= MAX_STAGES) {
+            return _overflow_stage;
+        }
+        auto stage = static_cast<latency_stage_id>(_names.size());
+        // the key refers to the string in the deque, which is never moved
+        _names.emplace_back(name.data(), name.size());
+        _ids.emplace(string_view(_names.back()), stage);
+        return stage;
+    }
+
+    const char *name(latency_stage_id stage)
+    {
+        utils::auto_read_lock read(_lock);
+        return stage < _names.size() ? _names[stage].c_str() : "";
+    }
+
+private:
+    latency_stage_registry()
+    {
+        // 0 is reserved for the points not written yet
+        _names.emplace_back("");
+        _overflow_stage = get_or_register("too_many_latency_stages");
+    }
+
+    utils::rw_lock_nr _lock; //{
+    std::deque<std::string> _names;
+    std::unordered_map<string_view, latency_stage_id, string_view_hash> _ids;
+    // }
+    latency_stage_id _overflow_stage;
+};
+
+} // anonymous namespace
+
+latency_stage_id register_latency_stage(string_view name)
+{
+    return latency_stage_registry::instance().get_or_register(name);
+}
+
+const char *latency_stage_name(latency_stage_id stage)
+{
+    return latency_stage_registry::instance().name(stage);
+}
+
+latency_stage_site::latency_stage_site(const char *file, int line, const char *function)
+    : _name(fmt::format("{}:{}:{}", file, line, function)), _stage(register_latency_stage(_name))
+{
+}
+
+latency_stage_id latency_stage_site::stage(string_view message) const
+{
+    char buf[256];
+    auto result = fmt::format_to_n(
+        buf, sizeof(buf), "{}_{}", _name, fmt::string_view(message.data(), message.size()));
+    return register_latency_stage(string_view(buf, std::min(result.size, sizeof(buf))));
+}
+
 perf_counter_ptr get_trace_counter(const std::string &name)
 {
     {
@@ -91,26 +192,25 @@ bool is_enable_trace(const dsn::task_code &code)
         return true;
     }
 
-    std::string code_name(dsn::task_code(code).to_string());
     {
         utils::auto_read_lock read(task_code_lock);
-        auto iter = task_codes.find(code_name);
+        auto iter = task_codes.find(code.code());
         if (iter != task_codes.end()) {
             return iter->second;
         }
     }
 
     utils::auto_write_lock write(task_code_lock);
-    auto iter = task_codes.find(code_name);
+    auto iter = task_codes.find(code.code());
     if (iter != task_codes.end()) {
         return iter->second;
     }
 
-    std::string section_name = std::string("task.") + code_name;
+    std::string section_name = std::string("task.") + code.to_string();
     auto enable_trace = dsn_config_get_value_bool(
         section_name.c_str(), "enable_trace", false, "whether to enable trace this kind of task");
 
-    task_codes.emplace(code_name, enable_trace);
+    task_codes.emplace(code.code(), enable_trace);
     return enable_trace;
 }
 
@@ -127,7 +227,10 @@ latency_tracer::latency_tracer(bool is_sub,
       _task_code(code),
       _enable_trace(is_enable_trace(code))
 {
-    append_point(fmt::format("{}:{}:{}", __FILENAME__, __LINE__, __FUNCTION__), _start_time);
+    if (_enable_trace) {
+        static const latency_stage_site site(__FILENAME__, __LINE__, __FUNCTION__);
+        record_point(site.stage(), _start_time);
+    }
 }
 
 latency_tracer::~latency_tracer()
@@ -140,68 +243,104 @@ latency_tracer::~latency_tracer()
     dump_trace_points(traces);
 }
 
-void latency_tracer::add_point(const std::string &stage_name)
+void latency_tracer::record_point(latency_stage_id stage, uint64_t ts)
+{
+    uint32_t index = _point_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_POINTS) {
+        return;
+    }
+    _points[index].ts = ts;
+    _points[index].stage.store(stage, std::memory_order_release);
+    _last_stage.store(stage, std::memory_order_relaxed);
+}
+
+void latency_tracer::add_point(latency_stage_id stage)
 {
     if (!_enable_trace) {
         return;
     }
 
     uint64_t ts = dsn_now_ns();
-    utils::auto_write_lock write(_point_lock);
-    _points.emplace(ts, stage_name);
-    _last_time = ts;
-    _last_stage = stage_name;
+    _last_time.store(ts, std::memory_order_relaxed);
+    record_point(stage, ts);
 }
 
-void latency_tracer::append_point(const std::string &stage_name, uint64_t timestamp)
+void latency_tracer::append_point(latency_stage_id stage, uint64_t timestamp)
 {
     if (!_enable_trace) {
         return;
     }
 
-    utils::auto_write_lock write(_point_lock);
-    uint64_t cur_ts = timestamp > _last_time ? timestamp : _last_time + 1;
-    _points.emplace(cur_ts, stage_name);
-    _last_time = cur_ts;
-    _last_stage = stage_name;
+    uint64_t last_ts = _last_time.load(std::memory_order_relaxed);
+    uint64_t cur_ts;
+    do {
+        cur_ts = timestamp > last_ts ? timestamp : last_ts + 1;
+    } while (!_last_time.compare_exchange_weak(last_ts, cur_ts, std::memory_order_relaxed));
+    record_point(stage, cur_ts);
 }
 
-void latency_tracer::add_sub_tracer(const std::string &name)
+int latency_tracer::add_sub_tracer(const std::string &name)
 {
     if (!_enable_trace) {
-        return;
+        return -1;
     }
 
     auto sub_tracer = std::make_shared<dsn::utils::latency_tracer>(true, name, 0);
-    sub_tracer->set_parent_point_name(_last_stage);
+    sub_tracer->_parent_stage = _last_stage.load(std::memory_order_relaxed);
     sub_tracer->set_description(_description);
-    utils::auto_write_lock write(_sub_lock);
-    _sub_tracers.emplace(name, sub_tracer);
+    return add_sub_tracer(sub_tracer);
 }
 
-void latency_tracer::add_sub_tracer(const std::shared_ptr<latency_tracer> &tracer)
+int latency_tracer::add_sub_tracer(latency_stage_id name)
 {
     if (!_enable_trace) {
-        return;
+        return -1;
     }
 
-    utils::auto_write_lock write(_sub_lock);
-    _sub_tracers.emplace(tracer->name(), tracer);
+    auto sub_tracer = std::make_shared<dsn::utils::latency_tracer>(true, std::string(), 0);
+    sub_tracer->_name_stage = name;
+    sub_tracer->_parent_stage = _last_stage.load(std::memory_order_relaxed);
+    sub_tracer->set_description(_description);
+    return add_sub_tracer(sub_tracer);
 }
 
-std::shared_ptr<latency_tracer> latency_tracer::sub_tracer(const std::string &name)
+int latency_tracer::add_sub_tracer(const std::shared_ptr<latency_tracer> &tracer)
 {
     if (!_enable_trace) {
+        return -1;
+    }
+
+    int index = _sub_tracer_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_SUB_TRACERS) {
+        return -1;
+    }
+    _sub_tracers[index] = tracer;
+    return index;
+}
+
+std::shared_ptr<latency_tracer> latency_tracer::sub_tracer(int index) const
+{
+    if (!_enable_trace || index < 0 || index >= MAX_SUB_TRACERS) {
         return nullptr;
     }
+    return _sub_tracers[index];
+}
 
-    utils::auto_read_lock read(_sub_lock);
-    auto iter = _sub_tracers.find(name);
-    if (iter != _sub_tracers.end()) {
-        return iter->second;
+std::vector<std::pair<uint64_t, latency_stage_id>> latency_tracer::sorted_points() const
+{
+    std::vector<std::pair<uint64_t, latency_stage_id>> points;
+    uint32_t count = std::min<uint32_t>(_point_count.load(std::memory_order_relaxed), MAX_POINTS);
+    points.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        latency_stage_id stage = _points[i].stage.load(std::memory_order_acquire);
+        if (stage != 0) {
+            points.emplace_back(_points[i].ts, stage);
+        }
     }
-    dwarn_f("can't find the [{}] sub tracer of {}", name, _name);
-    return nullptr;
+    std::stable_sort(points.begin(), points.end(), [](const auto &l, const auto &r) {
+        return l.first < r.first;
+    });
+    return points;
 }
 
 void latency_tracer::dump_trace_points(/*out*/ std::string &traces)
@@ -212,30 +351,27 @@ void latency_tracer::dump_trace_points(/*out*/ std::string &traces)
 
     uint64_t total_time_used;
     {
-        utils::auto_read_lock point_lock(_point_lock);
-        if (_points.empty()) {
+        auto points = sorted_points();
+        if (points.empty()) {
             return;
         }
 
-        uint64_t start_time = _points.begin()->first;
-        total_time_used = _points.rbegin()->first - start_time;
+        uint64_t start_time = points.front().first;
+        total_time_used = points.back().first - start_time;
         std::string header_format = _is_sub ? "          " : "***************";
         traces.append(fmt::format("\t{}[TRACE:[{}.{}]{}]{}\n",
                                   header_format,
                                   _description,
                                   dsn::task_code(_task_code).to_string(),
-                                  _name,
+                                  name(),
                                   header_format));
-        uint64_t previous_point_ts = _points.begin()->first;
-        std::string previous_point_name = _points.begin()->second;
-        for (const auto &point : _points) {
-            if (point.first == start_time) {
-                continue;
-            }
-            auto cur_point_ts = point.first;
-            auto cur_point_name = point.second;
-            auto span_duration = point.first - previous_point_ts;
-            auto total_latency = point.first - start_time;
+        uint64_t previous_point_ts = start_time;
+        const char *previous_point_name = latency_stage_name(points.front().second);
+        for (size_t i = 1; i < points.size(); ++i) {
+            auto cur_point_ts = points[i].first;
+            const char *cur_point_name = latency_stage_name(points[i].second);
+            auto span_duration = cur_point_ts - previous_point_ts;
+            auto total_latency = cur_point_ts - start_time;
 
             if (FLAGS_enable_latency_tracer_report) {
                 std::string counter_name =
@@ -246,8 +382,9 @@ void latency_tracer::dump_trace_points(/*out*/ std::string &traces)
             if (total_time_used >= _threshold) {
                 std::string trace_format = _is_sub ? " " : "";
                 std::string trace_name =
-                    _is_sub ? fmt::format("{}.{}", _parent_point_name, cur_point_name)
-                            : cur_point_name;
+                    _is_sub
+                        ? fmt::format("{}.{}", latency_stage_name(_parent_stage), cur_point_name)
+                        : cur_point_name;
                 std::string trace_log =
                     fmt::format("\t{}TRACE:name={:<110}, span={:>20}, total={:>20}, "
                                 "ts={:<20}\n",
@@ -262,12 +399,16 @@ void latency_tracer::dump_trace_points(/*out*/ std::string &traces)
             previous_point_ts = cur_point_ts;
             previous_point_name = cur_point_name;
         }
+        if (_point_count.load(std::memory_order_relaxed) > MAX_POINTS) {
+            traces.append(fmt::format("\t{} points dropped\n",
+                                      _point_count.load(std::memory_order_relaxed) - MAX_POINTS));
+        }
     }
 
-    {
-        utils::auto_read_lock tracer_lock(_sub_lock);
-        for (const auto &sub : _sub_tracers) {
-            sub.second->dump_trace_points(traces);
+    int sub_tracer_count = std::min<int>(_sub_tracer_count.load(), MAX_SUB_TRACERS);
+    for (int i = 0; i < sub_tracer_count; ++i) {
+        if (_sub_tracers[i] != nullptr) {
+            _sub_tracers[i]->dump_trace_points(traces);
         }
     }
 
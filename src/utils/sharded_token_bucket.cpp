@@ -0,0 +1,178 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/utils/sharded_token_bucket.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <dsn/c/api_layer1.h>
+
+namespace dsn {
+namespace utils {
+
+sharded_token_bucket::sharded_token_bucket(uint32_t shard_count)
+    : _shard_count(shard_count > 0 ? shard_count
+                                   : std::max(1u, std::thread::hardware_concurrency())),
+      _shards(new shard[_shard_count])
+{
+}
+
+void sharded_token_bucket::reset(int64_t rate, int64_t burst)
+{
+    if (rate <= 0) {
+        _rate.store(0, std::memory_order_relaxed);
+        return;
+    }
+    if (burst <= 0) {
+        burst = rate;
+    }
+
+    // the remainders go to the first shards, so that the shard rates sum up to `rate` exactly
+    uint32_t active_count = static_cast<uint32_t>(std::min<int64_t>(_shard_count, rate));
+    int64_t total_burst = 0;
+    for (uint32_t i = 0; i < active_count; ++i) {
+        int64_t shard_rate = rate / active_count + (i < rate % active_count ? 1 : 0);
+        int64_t shard_burst = std::max(
+            shard_rate, burst / active_count + (i < burst % active_count ? 1 : 0));
+        _shards[i].rate.store(shard_rate, std::memory_order_relaxed);
+        _shards[i].burst.store(shard_burst, std::memory_order_relaxed);
+        total_burst += shard_burst;
+    }
+    for (uint32_t i = active_count; i < _shard_count; ++i) {
+        _shards[i].rate.store(0, std::memory_order_relaxed);
+        _shards[i].burst.store(0, std::memory_order_relaxed);
+        _shards[i].tokens.store(0, std::memory_order_relaxed);
+    }
+    _burst.store(total_burst, std::memory_order_relaxed);
+    _active_shard_count.store(active_count, std::memory_order_relaxed);
+    _rate.store(rate, std::memory_order_release);
+}
+
+sharded_token_bucket::shard &sharded_token_bucket::home_shard()
+{
+    static std::atomic<uint32_t> next_thread_index{0};
+    static thread_local uint32_t thread_index =
+        next_thread_index.fetch_add(1, std::memory_order_relaxed);
+    return _shards[thread_index % _active_shard_count.load(std::memory_order_relaxed)];
+}
+
+void sharded_token_bucket::refill(shard &s, uint64_t now_ns)
+{
+    uint64_t last_ns = s.last_refill_ns.load(std::memory_order_acquire);
+    if (now_ns <= last_ns) {
+        return;
+    }
+
+    int64_t rate = s.rate.load(std::memory_order_relaxed);
+    int64_t burst = s.burst.load(std::memory_order_relaxed);
+    if (rate <= 0) {
+        return;
+    }
+    double new_tokens = static_cast<double>(now_ns - last_ns) * rate / 1e9;
+    if (new_tokens < 1) {
+        return;
+    }
+
+    // only advance the refill time by the whole tokens generated, so that the fraction
+    // is not lost by frequent refills
+    int64_t added = static_cast<int64_t>(std::min<double>(new_tokens, burst));
+    uint64_t new_last_ns =
+        added == burst ? now_ns : last_ns + static_cast<uint64_t>(added * 1e9 / rate);
+    if (!s.last_refill_ns.compare_exchange_strong(last_ns, new_last_ns)) {
+        // another thread has refilled this shard
+        return;
+    }
+
+    int64_t cur = s.tokens.load(std::memory_order_relaxed);
+    while (!s.tokens.compare_exchange_weak(cur, std::min(cur + added, burst))) {
+    }
+}
+
+bool sharded_token_bucket::try_take(shard &s, int64_t units)
+{
+    int64_t cur = s.tokens.load(std::memory_order_relaxed);
+    while (cur >= units) {
+        if (s.tokens.compare_exchange_weak(cur, cur - units)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sharded_token_bucket::consume(int64_t units) { return consume(units, dsn_now_ns()); }
+
+bool sharded_token_bucket::consume(int64_t units, uint64_t now_ns)
+{
+    if (!enabled() || units <= 0) {
+        return true;
+    }
+
+    // a request larger than the whole capacity could never be admitted, so it is
+    // charged as a full bucket instead
+    units = std::min(units, _burst.load(std::memory_order_relaxed));
+
+    shard &home = home_shard();
+    refill(home, now_ns);
+    if (try_take(home, units)) {
+        return true;
+    }
+
+    // borrow from the other shards
+    int64_t taken = 0;
+    uint32_t active_count = _active_shard_count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < active_count && taken < units; ++i) {
+        shard &s = _shards[i];
+        refill(s, now_ns);
+        int64_t cur = s.tokens.load(std::memory_order_relaxed);
+        while (cur > 0) {
+            int64_t take = std::min(cur, units - taken);
+            if (s.tokens.compare_exchange_weak(cur, cur - take)) {
+                taken += take;
+                break;
+            }
+        }
+    }
+    if (taken < units) {
+        refund(taken);
+        return false;
+    }
+    return true;
+}
+
+void sharded_token_bucket::refund(int64_t units)
+{
+    if (!enabled() || units <= 0) {
+        return;
+    }
+    // consume() charges at most the capacity
+    units = std::min(units, _burst.load(std::memory_order_relaxed));
+    home_shard().tokens.fetch_add(units, std::memory_order_relaxed);
+}
+
+int64_t sharded_token_bucket::available(uint64_t now_ns)
+{
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < _shard_count; ++i) {
+        refill(_shards[i], now_ns);
+        sum += _shards[i].tokens.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+} // namespace utils
+} // namespace dsn
@@ -209,15 +209,17 @@ std::string string_md5(const char *buffer, unsigned length)
     }
     MD5_Final(out, &c);
 
+    return md5_digest_to_hex(out);
+}
+
+std::string md5_digest_to_hex(const unsigned char *digest)
+{
     char str[MD5_DIGEST_LENGTH * 2 + 1];
     str[MD5_DIGEST_LENGTH * 2] = 0;
     for (int n = 0; n < MD5_DIGEST_LENGTH; n++)
-        sprintf(str + n + n, "%02x", out[n]);
-
-    std::string result;
-    result.assign(str);
+        sprintf(str + n + n, "%02x", digest[n]);
 
-    return result;
+    return std::string(str);
 }
 } // namespace utils
 } // namespace dsn
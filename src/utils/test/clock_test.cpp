@@ -0,0 +1,73 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <dsn/c/api_layer1.h>
+#include <dsn/utility/clock.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utils/time_utils.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace utils {
+
+DSN_DECLARE_bool(enable_tsc_clock);
+
+class fixed_clock : public clock
+{
+public:
+    uint64_t now_ns() const override { return 12345; }
+};
+
+TEST(clock_test, mock)
+{
+    clock::mock(new fixed_clock());
+    ASSERT_EQ(12345u, dsn_now_ns());
+
+    // the mock clock takes precedence over the TSC clock
+    FLAGS_enable_tsc_clock = true;
+    ASSERT_EQ(12345u, dsn_now_ns());
+    FLAGS_enable_tsc_clock = false;
+
+    clock::mock(new clock());
+}
+
+TEST(clock_test, tsc_clock)
+{
+    if (!tsc_clock::available()) {
+        return;
+    }
+
+    // both clocks are in the same epoch and close to each other
+    for (int i = 0; i < 1000; ++i) {
+        uint64_t before_ns = get_current_physical_time_ns();
+        uint64_t tsc_ns = tsc_clock::now_ns();
+        uint64_t after_ns = get_current_physical_time_ns();
+        ASSERT_LE(before_ns, tsc_ns + 100000);
+        ASSERT_LE(tsc_ns, after_ns + 100000);
+    }
+
+    FLAGS_enable_tsc_clock = true;
+    uint64_t before_ns = get_current_physical_time_ns();
+    uint64_t now_ns = dsn_now_ns();
+    uint64_t after_ns = get_current_physical_time_ns();
+    ASSERT_LE(before_ns, now_ns + 100000);
+    ASSERT_LE(now_ns, after_ns + 100000);
+    FLAGS_enable_tsc_clock = false;
+}
+
+} // namespace utils
+} // namespace dsn
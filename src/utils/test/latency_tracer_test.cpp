@@ -72,12 +72,21 @@ public:
 
     std::map<int64_t, std::string> get_points(const std::shared_ptr<latency_tracer> &tracer)
     {
-        return tracer->_points;
+        std::map<int64_t, std::string> points;
+        for (const auto &point : tracer->sorted_points()) {
+            points.emplace(point.first, latency_stage_name(point.second));
+        }
+        return points;
     }
 
     std::shared_ptr<latency_tracer> get_sub_tracer(const std::shared_ptr<latency_tracer> &tracer)
     {
-        return tracer->sub_tracer("sub");
+        return tracer->sub_tracer(0);
+    }
+
+    uint32_t get_point_count(const std::shared_ptr<latency_tracer> &tracer)
+    {
+        return tracer->sorted_points().size();
     }
 };
 
@@ -138,5 +147,73 @@ TEST_F(latency_tracer_test, add_point)
     auto tracer4_points = get_points(_tracer4);
     ASSERT_EQ(tracer4_points.size(), 0);
 }
+
+TEST_F(latency_tracer_test, stage_registry)
+{
+    latency_stage_id stage1 = register_latency_stage("latency_tracer_test.stage");
+    latency_stage_id stage2 = register_latency_stage(std::string("latency_tracer_test.stage"));
+    ASSERT_NE(0, stage1);
+    ASSERT_EQ(stage1, stage2);
+    ASSERT_STREQ("latency_tracer_test.stage", latency_stage_name(stage1));
+    ASSERT_NE(stage1, register_latency_stage("latency_tracer_test.other_stage"));
+}
+
+TEST_F(latency_tracer_test, stage_site)
+{
+    latency_stage_site site("latency_tracer_test.cpp", 1, "stage_site");
+    ASSERT_STREQ("latency_tracer_test.cpp:1:stage_site", latency_stage_name(site.stage()));
+
+    // the literal message is resolved once and cached by the site
+    latency_stage_id literal = site.stage("literal");
+    ASSERT_STREQ("latency_tracer_test.cpp:1:stage_site_literal", latency_stage_name(literal));
+    ASSERT_EQ(literal, site.stage("literal"));
+    ASSERT_EQ(literal, site.stage(std::string("literal")));
+
+    // the dynamic messages are looked up each time
+    latency_stage_id dynamic = site.stage(std::string("dynamic"));
+    ASSERT_NE(literal, dynamic);
+    ASSERT_STREQ("latency_tracer_test.cpp:1:stage_site_dynamic", latency_stage_name(dynamic));
+    ASSERT_EQ(literal, site.stage("literal"));
+}
+
+TEST_F(latency_tracer_test, sub_tracer_index)
+{
+    auto tracer = std::make_shared<latency_tracer>(false, "name", 0);
+    ASSERT_EQ(nullptr, tracer->sub_tracer(0));
+    for (int i = 0; i < latency_tracer::MAX_SUB_TRACERS; i++) {
+        ASSERT_EQ(i, tracer->add_sub_tracer(fmt::format("sub{}", i)));
+        ASSERT_EQ(fmt::format("sub{}", i), tracer->sub_tracer(i)->name());
+    }
+    // the sub tracers beyond the capacity are dropped
+    ASSERT_EQ(-1, tracer->add_sub_tracer("sub"));
+    ASSERT_EQ(nullptr, tracer->sub_tracer(-1));
+    ASSERT_EQ(nullptr, tracer->sub_tracer(latency_tracer::MAX_SUB_TRACERS));
+}
+
+TEST_F(latency_tracer_test, concurrent_add_point)
+{
+    auto tracer = std::make_shared<latency_tracer>(false, "name", 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&tracer]() {
+            for (int j = 0; j < latency_tracer::MAX_POINTS; j++) {
+                ADD_POINT(tracer);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    // the points beyond the capacity are dropped
+    ASSERT_EQ(latency_tracer::MAX_POINTS, get_point_count(tracer));
+}
+
+TEST_F(latency_tracer_test, sub_tracer_named_by_stage)
+{
+    auto tracer = std::make_shared<latency_tracer>(false, "name", 0);
+    int index = tracer->add_sub_tracer(register_latency_stage("127.0.0.1:34801"));
+    ASSERT_EQ(0, index);
+    ASSERT_EQ("127.0.0.1:34801", tracer->sub_tracer(index)->name());
+}
 } // namespace utils
 } // namespace dsn
@@ -0,0 +1,127 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <dsn/utils/sharded_token_bucket.h>
+
+namespace dsn {
+namespace utils {
+
+const uint64_t kSecondNs = 1000000000;
+
+class sharded_token_bucket_test : public testing::Test
+{
+};
+
+TEST_F(sharded_token_bucket_test, disabled)
+{
+    sharded_token_bucket bucket(4);
+    ASSERT_FALSE(bucket.enabled());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(bucket.consume(1000000, kSecondNs));
+    }
+
+    bucket.reset(100);
+    ASSERT_TRUE(bucket.enabled());
+    bucket.reset(0);
+    ASSERT_FALSE(bucket.enabled());
+}
+
+TEST_F(sharded_token_bucket_test, consume_and_refill)
+{
+    sharded_token_bucket bucket(4);
+    bucket.reset(400);
+
+    // the bucket is full at the beginning
+    ASSERT_EQ(400, bucket.available(kSecondNs));
+
+    // borrow from all the shards
+    ASSERT_TRUE(bucket.consume(300, kSecondNs));
+    ASSERT_TRUE(bucket.consume(100, kSecondNs));
+    ASSERT_FALSE(bucket.consume(1, kSecondNs));
+    ASSERT_EQ(0, bucket.available(kSecondNs));
+
+    // half a second later, half of the tokens are refilled
+    ASSERT_EQ(200, bucket.available(kSecondNs + kSecondNs / 2));
+    ASSERT_FALSE(bucket.consume(201, kSecondNs + kSecondNs / 2));
+    ASSERT_EQ(200, bucket.available(kSecondNs + kSecondNs / 2));
+    ASSERT_TRUE(bucket.consume(200, kSecondNs + kSecondNs / 2));
+
+    // never refilled over the capacity
+    ASSERT_EQ(400, bucket.available(10 * kSecondNs));
+
+    bucket.refund(10);
+    ASSERT_EQ(410, bucket.available(10 * kSecondNs));
+}
+
+TEST_F(sharded_token_bucket_test, rate_split_exactly)
+{
+    sharded_token_bucket bucket(64);
+
+    // the remainder of the rate isn't dropped
+    bucket.reset(100);
+    ASSERT_EQ(100, bucket.available(kSecondNs));
+    ASSERT_TRUE(bucket.consume(100, kSecondNs));
+    ASSERT_FALSE(bucket.consume(1, kSecondNs));
+    ASSERT_EQ(100, bucket.available(2 * kSecondNs));
+
+    // a rate smaller than the shard count isn't rounded up per shard
+    bucket.reset(10);
+    ASSERT_EQ(10, bucket.available(3 * kSecondNs));
+    ASSERT_TRUE(bucket.consume(10, 3 * kSecondNs));
+    ASSERT_FALSE(bucket.consume(1, 3 * kSecondNs));
+    ASSERT_EQ(10, bucket.available(10 * kSecondNs));
+}
+
+TEST_F(sharded_token_bucket_test, oversized_request)
+{
+    sharded_token_bucket bucket(2);
+    bucket.reset(100);
+
+    // a request larger than the capacity is admitted when the bucket is full
+    ASSERT_TRUE(bucket.consume(1000, kSecondNs));
+    ASSERT_FALSE(bucket.consume(1000, kSecondNs));
+    ASSERT_TRUE(bucket.consume(1000, 2 * kSecondNs));
+}
+
+TEST_F(sharded_token_bucket_test, concurrent_consume)
+{
+    sharded_token_bucket bucket(8);
+    bucket.reset(10000);
+
+    std::atomic<int64_t> admitted{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 5000; ++j) {
+                if (bucket.consume(1, kSecondNs)) {
+                    admitted.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(10000, admitted.load());
+}
+
+} // namespace utils
+} // namespace dsn